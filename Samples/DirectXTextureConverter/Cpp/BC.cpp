@@ -319,9 +319,288 @@ static void OptimizeRGB(_Out_ HDRColorA *pX, _Out_ HDRColorA *pY,
 
 
 //-------------------------------------------------------------------------------------
-inline static void DecodeBC1( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_ const D3DX_BC1 *pBC, _In_ bool isbc1 )
+// Four-wide version of OptimizeRGB, with one block per vector lane. Each lane follows
+// exactly the same sequence of operations as the scalar version so the endpoints
+// are bit-identical; lanes that converge early are masked off until all are done.
+static void OptimizeRGBx4(_Out_writes_(4) HDRColorA *pX, _Out_writes_(4) HDRColorA *pY,
+                          _In_reads_(4) const HDRColorA *const *ppPoints, _In_reads_(4) const size_t *pSteps, _In_ DWORD flags)
 {
-    assert( pColor && pBC );
+    static const float fEpsilon = (0.25f / 64.0f) * (0.25f / 64.0f);
+    static const float pC3[] = { 2.0f/2.0f, 1.0f/2.0f, 0.0f/2.0f, 0.0f };
+    static const float pD3[] = { 0.0f/2.0f, 1.0f/2.0f, 2.0f/2.0f, 0.0f };
+    static const float pC4[] = { 3.0f/3.0f, 2.0f/3.0f, 1.0f/3.0f, 0.0f/3.0f };
+    static const float pD4[] = { 0.0f/3.0f, 1.0f/3.0f, 2.0f/3.0f, 3.0f/3.0f };
+
+    static const XMVECTORF32 s_Epsilon = { fEpsilon, fEpsilon, fEpsilon, fEpsilon };
+    static const XMVECTORF32 s_OneEighth = { 1.0f / 8.0f, 1.0f / 8.0f, 1.0f / 8.0f, 1.0f / 8.0f };
+    static const XMVECTORF32 s_TwoColor = { 1.0f / 4096.0f, 1.0f / 4096.0f, 1.0f / 4096.0f, 1.0f / 4096.0f };
+    static const XMVECTORF32 s_FltMin = { FLT_MIN, FLT_MIN, FLT_MIN, FLT_MIN };
+    static const XMVECTORF32 s_StepIndex[] = { { 0.f, 0.f, 0.f, 0.f }, { 1.f, 1.f, 1.f, 1.f }, { 2.f, 2.f, 2.f, 2.f }, { 3.f, 3.f, 3.f, 3.f } };
+
+    // Transpose so each vector holds the same point from all four blocks
+    XMVECTOR PtR[NUM_PIXELS_PER_BLOCK];
+    XMVECTOR PtG[NUM_PIXELS_PER_BLOCK];
+    XMVECTOR PtB[NUM_PIXELS_PER_BLOCK];
+
+    for(size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+    {
+        XMMATRIX M( XMLoadFloat4( reinterpret_cast<const XMFLOAT4*>( &ppPoints[0][iPoint] ) ),
+                    XMLoadFloat4( reinterpret_cast<const XMFLOAT4*>( &ppPoints[1][iPoint] ) ),
+                    XMLoadFloat4( reinterpret_cast<const XMFLOAT4*>( &ppPoints[2][iPoint] ) ),
+                    XMLoadFloat4( reinterpret_cast<const XMFLOAT4*>( &ppPoints[3][iPoint] ) ) );
+        M = XMMatrixTranspose( M );
+
+        PtR[iPoint] = M.r[0];
+        PtG[iPoint] = M.r[1];
+        PtB[iPoint] = M.r[2];
+    }
+
+    // Color-keyed blocks use 3 steps rather than 4, so the weights are per-lane
+    XMVECTOR vC[4], vD[4];
+    for(size_t iStep = 0; iStep < 4; iStep++)
+    {
+        float c[4], d[4];
+        for(size_t iLane = 0; iLane < 4; iLane++)
+        {
+            assert( pSteps[iLane] == 3 || pSteps[iLane] == 4 );
+            c[iLane] = (3 == pSteps[iLane]) ? pC3[iStep] : pC4[iStep];
+            d[iLane] = (3 == pSteps[iLane]) ? pD3[iStep] : pD4[iStep];
+        }
+        vC[iStep] = XMLoadFloat4( reinterpret_cast<const XMFLOAT4*>( c ) );
+        vD[iStep] = XMLoadFloat4( reinterpret_cast<const XMFLOAT4*>( d ) );
+    }
+
+    XMVECTOR fSteps = XMVectorSet( (float) (pSteps[0] - 1), (float) (pSteps[1] - 1), (float) (pSteps[2] - 1), (float) (pSteps[3] - 1) );
+
+    // Find Min and Max points, as starting point
+    XMVECTOR XR, XG, XB;
+    if (flags & BC_FLAGS_UNIFORM)
+    {
+        XR = XG = XB = g_XMOne;
+    }
+    else
+    {
+        XR = XMVectorReplicate( g_Luminance.r );
+        XG = XMVectorReplicate( g_Luminance.g );
+        XB = XMVectorReplicate( g_Luminance.b );
+    }
+
+    XMVECTOR YR = XMVectorZero();
+    XMVECTOR YG = XMVectorZero();
+    XMVECTOR YB = XMVectorZero();
+
+    for(size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+    {
+        XR = XMVectorMin( PtR[iPoint], XR );
+        XG = XMVectorMin( PtG[iPoint], XG );
+        XB = XMVectorMin( PtB[iPoint], XB );
+
+        YR = XMVectorMax( PtR[iPoint], YR );
+        YG = XMVectorMax( PtG[iPoint], YG );
+        YB = XMVectorMax( PtB[iPoint], YB );
+    }
+
+    // Diagonal axis
+    XMVECTOR ABR = XMVectorSubtract( YR, XR );
+    XMVECTOR ABG = XMVectorSubtract( YG, XG );
+    XMVECTOR ABB = XMVectorSubtract( YB, XB );
+
+    XMVECTOR fAB = XMVectorAdd( XMVectorAdd( XMVectorMultiply( ABR, ABR ), XMVectorMultiply( ABG, ABG ) ), XMVectorMultiply( ABB, ABB ) );
+
+    // Single color block.. no need to root-find
+    XMVECTOR vDone = XMVectorLess( fAB, s_FltMin );
+
+    // Try all four axis directions, to determine which diagonal best fits data
+    XMVECTOR fABInv = XMVectorDivide( g_XMOne, fAB );
+
+    XMVECTOR DirR = XMVectorMultiply( ABR, fABInv );
+    XMVECTOR DirG = XMVectorMultiply( ABG, fABInv );
+    XMVECTOR DirB = XMVectorMultiply( ABB, fABInv );
+
+    XMVECTOR MidR = XMVectorMultiply( XMVectorAdd( XR, YR ), g_XMOneHalf );
+    XMVECTOR MidG = XMVectorMultiply( XMVectorAdd( XG, YG ), g_XMOneHalf );
+    XMVECTOR MidB = XMVectorMultiply( XMVectorAdd( XB, YB ), g_XMOneHalf );
+
+    XMVECTOR fDir[4];
+    fDir[0] = fDir[1] = fDir[2] = fDir[3] = XMVectorZero();
+
+    for(size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+    {
+        XMVECTOR r = XMVectorMultiply( XMVectorSubtract( PtR[iPoint], MidR ), DirR );
+        XMVECTOR g = XMVectorMultiply( XMVectorSubtract( PtG[iPoint], MidG ), DirG );
+        XMVECTOR b = XMVectorMultiply( XMVectorSubtract( PtB[iPoint], MidB ), DirB );
+
+        XMVECTOR f;
+
+        f = XMVectorAdd( XMVectorAdd( r, g ), b );
+        fDir[0] = XMVectorAdd( fDir[0], XMVectorMultiply( f, f ) );
+
+        f = XMVectorSubtract( XMVectorAdd( r, g ), b );
+        fDir[1] = XMVectorAdd( fDir[1], XMVectorMultiply( f, f ) );
+
+        f = XMVectorAdd( XMVectorSubtract( r, g ), b );
+        fDir[2] = XMVectorAdd( fDir[2], XMVectorMultiply( f, f ) );
+
+        f = XMVectorSubtract( XMVectorSubtract( r, g ), b );
+        fDir[3] = XMVectorAdd( fDir[3], XMVectorMultiply( f, f ) );
+    }
+
+    XMVECTOR fDirMax = fDir[0];
+    XMVECTOR vSwapG = XMVectorFalseInt();
+    XMVECTOR vSwapB = XMVectorFalseInt();
+
+    for(size_t iDir = 1; iDir < 4; iDir++)
+    {
+        XMVECTOR vSel = XMVectorGreater( fDir[iDir], fDirMax );
+
+        fDirMax = XMVectorSelect( fDirMax, fDir[iDir], vSel );
+        vSwapG = XMVectorSelect( vSwapG, (iDir & 2) ? XMVectorTrueInt() : XMVectorFalseInt(), vSel );
+        vSwapB = XMVectorSelect( vSwapB, (iDir & 1) ? XMVectorTrueInt() : XMVectorFalseInt(), vSel );
+    }
+
+    vSwapG = XMVectorAndCInt( vSwapG, vDone );
+    vSwapB = XMVectorAndCInt( vSwapB, vDone );
+
+    XMVECTOR t = XG;
+    XG = XMVectorSelect( XG, YG, vSwapG );
+    YG = XMVectorSelect( YG, t, vSwapG );
+
+    t = XB;
+    XB = XMVectorSelect( XB, YB, vSwapB );
+    YB = XMVectorSelect( YB, t, vSwapB );
+
+    // Two color block.. no need to root-find
+    vDone = XMVectorOrInt( vDone, XMVectorLess( fAB, s_TwoColor ) );
+
+    // Use Newton's Method to find local minima of sum-of-squares error.
+    for(size_t iIteration = 0; iIteration < 8; iIteration++)
+    {
+        if ( XMVector4EqualInt( vDone, XMVectorTrueInt() ) )
+            break;
+
+        // Calculate new steps
+        XMVECTOR StepR[4], StepG[4], StepB[4];
+
+        for(size_t iStep = 0; iStep < 4; iStep++)
+        {
+            StepR[iStep] = XMVectorAdd( XMVectorMultiply( XR, vC[iStep] ), XMVectorMultiply( YR, vD[iStep] ) );
+            StepG[iStep] = XMVectorAdd( XMVectorMultiply( XG, vC[iStep] ), XMVectorMultiply( YG, vD[iStep] ) );
+            StepB[iStep] = XMVectorAdd( XMVectorMultiply( XB, vC[iStep] ), XMVectorMultiply( YB, vD[iStep] ) );
+        }
+
+        // Calculate color direction
+        DirR = XMVectorSubtract( YR, XR );
+        DirG = XMVectorSubtract( YG, XG );
+        DirB = XMVectorSubtract( YB, XB );
+
+        XMVECTOR fLen = XMVectorAdd( XMVectorAdd( XMVectorMultiply( DirR, DirR ), XMVectorMultiply( DirG, DirG ) ), XMVectorMultiply( DirB, DirB ) );
+
+        vDone = XMVectorOrInt( vDone, XMVectorLess( fLen, s_TwoColor ) );
+
+        XMVECTOR fScale = XMVectorDivide( fSteps, fLen );
+
+        DirR = XMVectorMultiply( DirR, fScale );
+        DirG = XMVectorMultiply( DirG, fScale );
+        DirB = XMVectorMultiply( DirB, fScale );
+
+        // Evaluate function, and derivatives
+        XMVECTOR d2X, d2Y, dXR, dXG, dXB, dYR, dYG, dYB;
+        d2X = d2Y = dXR = dXG = dXB = dYR = dYG = dYB = XMVectorZero();
+
+        for(size_t iPoint = 0; iPoint < NUM_PIXELS_PER_BLOCK; iPoint++)
+        {
+            XMVECTOR fDot = XMVectorAdd( XMVectorAdd( XMVectorMultiply( XMVectorSubtract( PtR[iPoint], XR ), DirR ),
+                                                      XMVectorMultiply( XMVectorSubtract( PtG[iPoint], XG ), DirG ) ),
+                                         XMVectorMultiply( XMVectorSubtract( PtB[iPoint], XB ), DirB ) );
+
+            XMVECTOR vStep = XMVectorTruncate( XMVectorAdd( fDot, g_XMOneHalf ) );
+            vStep = XMVectorSelect( vStep, fSteps, XMVectorGreaterOrEqual( fDot, fSteps ) );
+            vStep = XMVectorSelect( vStep, XMVectorZero(), XMVectorLessOrEqual( fDot, XMVectorZero() ) );
+
+            XMVECTOR fC = vC[0];
+            XMVECTOR fD = vD[0];
+            XMVECTOR SR = StepR[0];
+            XMVECTOR SG = StepG[0];
+            XMVECTOR SB = StepB[0];
+
+            for(size_t iStep = 1; iStep < 4; iStep++)
+            {
+                XMVECTOR vSel = XMVectorEqual( vStep, s_StepIndex[iStep] );
+                fC = XMVectorSelect( fC, vC[iStep], vSel );
+                fD = XMVectorSelect( fD, vD[iStep], vSel );
+                SR = XMVectorSelect( SR, StepR[iStep], vSel );
+                SG = XMVectorSelect( SG, StepG[iStep], vSel );
+                SB = XMVectorSelect( SB, StepB[iStep], vSel );
+            }
+
+            XMVECTOR DiffR = XMVectorSubtract( SR, PtR[iPoint] );
+            XMVECTOR DiffG = XMVectorSubtract( SG, PtG[iPoint] );
+            XMVECTOR DiffB = XMVectorSubtract( SB, PtB[iPoint] );
+
+            XMVECTOR fCScaled = XMVectorMultiply( fC, s_OneEighth );
+            XMVECTOR fDScaled = XMVectorMultiply( fD, s_OneEighth );
+
+            d2X = XMVectorAdd( d2X, XMVectorMultiply( fCScaled, fC ) );
+            dXR = XMVectorAdd( dXR, XMVectorMultiply( fCScaled, DiffR ) );
+            dXG = XMVectorAdd( dXG, XMVectorMultiply( fCScaled, DiffG ) );
+            dXB = XMVectorAdd( dXB, XMVectorMultiply( fCScaled, DiffB ) );
+
+            d2Y = XMVectorAdd( d2Y, XMVectorMultiply( fDScaled, fD ) );
+            dYR = XMVectorAdd( dYR, XMVectorMultiply( fDScaled, DiffR ) );
+            dYG = XMVectorAdd( dYG, XMVectorMultiply( fDScaled, DiffG ) );
+            dYB = XMVectorAdd( dYB, XMVectorMultiply( fDScaled, DiffB ) );
+        }
+
+        // Move endpoints (only in lanes still iterating)
+        XMVECTOR vMoveX = XMVectorAndCInt( XMVectorGreater( d2X, XMVectorZero() ), vDone );
+        XMVECTOR vMoveY = XMVectorAndCInt( XMVectorGreater( d2Y, XMVectorZero() ), vDone );
+
+        XMVECTOR f = XMVectorDivide( g_XMNegativeOne, d2X );
+
+        XR = XMVectorSelect( XR, XMVectorAdd( XR, XMVectorMultiply( dXR, f ) ), vMoveX );
+        XG = XMVectorSelect( XG, XMVectorAdd( XG, XMVectorMultiply( dXG, f ) ), vMoveX );
+        XB = XMVectorSelect( XB, XMVectorAdd( XB, XMVectorMultiply( dXB, f ) ), vMoveX );
+
+        f = XMVectorDivide( g_XMNegativeOne, d2Y );
+
+        YR = XMVectorSelect( YR, XMVectorAdd( YR, XMVectorMultiply( dYR, f ) ), vMoveY );
+        YG = XMVectorSelect( YG, XMVectorAdd( YG, XMVectorMultiply( dYG, f ) ), vMoveY );
+        YB = XMVectorSelect( YB, XMVectorAdd( YB, XMVectorMultiply( dYB, f ) ), vMoveY );
+
+        XMVECTOR vConverged = XMVectorLess( XMVectorMultiply( dXR, dXR ), s_Epsilon );
+        vConverged = XMVectorAndInt( vConverged, XMVectorLess( XMVectorMultiply( dXG, dXG ), s_Epsilon ) );
+        vConverged = XMVectorAndInt( vConverged, XMVectorLess( XMVectorMultiply( dXB, dXB ), s_Epsilon ) );
+        vConverged = XMVectorAndInt( vConverged, XMVectorLess( XMVectorMultiply( dYR, dYR ), s_Epsilon ) );
+        vConverged = XMVectorAndInt( vConverged, XMVectorLess( XMVectorMultiply( dYG, dYG ), s_Epsilon ) );
+        vConverged = XMVectorAndInt( vConverged, XMVectorLess( XMVectorMultiply( dYB, dYB ), s_Epsilon ) );
+
+        vDone = XMVectorOrInt( vDone, vConverged );
+    }
+
+    XMFLOAT4 xr, xg, xb, yr, yg, yb;
+    XMStoreFloat4( &xr, XR );
+    XMStoreFloat4( &xg, XG );
+    XMStoreFloat4( &xb, XB );
+    XMStoreFloat4( &yr, YR );
+    XMStoreFloat4( &yg, YG );
+    XMStoreFloat4( &yb, YB );
+
+    pX[0].r = xr.x; pX[0].g = xg.x; pX[0].b = xb.x;
+    pX[1].r = xr.y; pX[1].g = xg.y; pX[1].b = xb.y;
+    pX[2].r = xr.z; pX[2].g = xg.z; pX[2].b = xb.z;
+    pX[3].r = xr.w; pX[3].g = xg.w; pX[3].b = xb.w;
+
+    pY[0].r = yr.x; pY[0].g = yg.x; pY[0].b = yb.x;
+    pY[1].r = yr.y; pY[1].g = yg.y; pY[1].b = yb.y;
+    pY[2].r = yr.z; pY[2].g = yg.z; pY[2].b = yb.z;
+    pY[3].r = yr.w; pY[3].g = yg.w; pY[3].b = yb.w;
+}
+
+
+//-------------------------------------------------------------------------------------
+inline static void DecodeBC1Palette( _Out_writes_(4) XMVECTOR *pPalette, _In_ const D3DX_BC1 *pBC, _In_ bool isbc1 )
+{
+    assert( pPalette && pBC );
     static_assert( sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes" );
 
     static XMVECTORF32 s_Scale = { 1.f/31.f, 1.f/63.f, 1.f/31.f, 1.f };
@@ -350,29 +629,66 @@ inline static void DecodeBC1( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColo
         clr3 = XMVectorLerp( clr0, clr1, 2.f/3.f );
     }
 
+    pPalette[0] = clr0;
+    pPalette[1] = clr1;
+    pPalette[2] = clr2;
+    pPalette[3] = clr3;
+}
+
+inline static void DecodeBC1( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_ const D3DX_BC1 *pBC, _In_ bool isbc1 )
+{
+    assert( pColor && pBC );
+
+    XMVECTOR clr[4];
+    DecodeBC1Palette( clr, pBC, isbc1 );
+
     uint32_t dw = pBC->bitmap;
 
     for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 2)
     {
-        switch(dw & 3)
-        {
-        case 0: pColor[i] = clr0; break;
-        case 1: pColor[i] = clr1; break;
-        case 2: pColor[i] = clr2; break;
-
-        case 3:
-        default: pColor[i] = clr3; break;
-        }
+        pColor[i] = clr[ dw & 3 ];
     }
 }
 
 
 //-------------------------------------------------------------------------------------
+// Decode straight to R8G8B8A8. Only the palette goes through the float decode and
+// _StoreScanline, so texels come out exactly as the XMVECTOR path would write them.
+//-------------------------------------------------------------------------------------
+inline static void StoreRGBA8( _Out_writes_bytes_(count * 4) void *pDest, _In_reads_(count) const XMVECTOR *pSource, _In_ size_t count )
+{
+    // Every lane is scaled and rounded the same way, so this also rounds lone alpha values
+    if ( !_StoreScanline( pDest, count * sizeof(uint32_t), DXGI_FORMAT_R8G8B8A8_UNORM, pSource, count ) )
+        memset( pDest, 0, count * sizeof(uint32_t) );
+}
 
-static void EncodeBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
-                      _In_ bool bColorKey, _In_ float alphaRef, _In_ DWORD flags)
+inline static void DecodeBC1RGBA8( _Out_writes_(NUM_PIXELS_PER_BLOCK) uint32_t *pColor, _In_ const D3DX_BC1 *pBC, _In_ bool isbc1 )
 {
-    assert( pBC && pColor );
+    assert( pColor && pBC );
+
+    XMVECTOR palette[4];
+    DecodeBC1Palette( palette, pBC, isbc1 );
+
+    uint32_t clr[4];
+    StoreRGBA8( clr, palette, 4 );
+
+    uint32_t dw = pBC->bitmap;
+
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 2)
+    {
+        pColor[i] = clr[ dw & 3 ];
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// Returns the number of color steps to encode with, or 0 if the block was entirely
+// color-keyed and has already been written out
+static size_t QuantizeBC1(_Out_ D3DX_BC1 *pBC, _Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA *Color,
+                          _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
+                          _In_ bool bColorKey, _In_ float alphaRef, _In_ DWORD flags)
+{
+    assert( pBC && Color && pColor );
     static_assert( sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes" );
 
     // Determine if we need to colorkey this block
@@ -393,7 +709,7 @@ static void EncodeBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) cons
             pBC->rgb[0] = 0x0000;
             pBC->rgb[1] = 0xffff;
             pBC->bitmap = 0xffffffff;
-            return;
+            return 0;
         }
 
         uSteps = (uColorKey > 0) ? 3 : 4;
@@ -406,7 +722,6 @@ static void EncodeBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) cons
     // Quantize block to R56B5, using Floyd Stienberg error diffusion.  This 
     // increases the chance that colors will map directly to the quantized 
     // axis endpoints.
-    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
     HDRColorA Error[NUM_PIXELS_PER_BLOCK];
 
     if (flags & BC_FLAGS_DITHER_RGB)
@@ -485,11 +800,24 @@ static void EncodeBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) cons
         }
     }
 
-    // Perform 6D root finding function to find two endpoints of color axis.
-    // Then quantize and sort the endpoints depending on mode.
-    HDRColorA ColorA, ColorB, ColorC, ColorD;
+    return uSteps;
+}
 
-    OptimizeRGB(&ColorA, &ColorB, Color, uSteps, flags);
+
+//-------------------------------------------------------------------------------------
+// Quantizes and sorts the endpoints found by OptimizeRGB depending on mode, then
+// writes the color indices
+static void EncodeBC1Indices(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
+                             _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *Color, _In_ size_t uSteps,
+                             _In_ const HDRColorA& EndPointA, _In_ const HDRColorA& EndPointB,
+                             _In_ float alphaRef, _In_ DWORD flags)
+{
+    assert( pBC && pColor && Color );
+    assert( uSteps == 3 || uSteps == 4 );
+
+    HDRColorA ColorA = EndPointA;
+    HDRColorA ColorB = EndPointB;
+    HDRColorA ColorC, ColorD;
 
     if ( flags & BC_FLAGS_UNIFORM )
     {
@@ -591,10 +919,11 @@ static void EncodeBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) cons
 
     // Encode colors
     uint32_t dw = 0;
+    HDRColorA Error[NUM_PIXELS_PER_BLOCK];
     if (flags & BC_FLAGS_DITHER_RGB)
         memset(Error, 0x00, NUM_PIXELS_PER_BLOCK * sizeof(HDRColorA));
 
-    for(i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
         if((3 == uSteps) && (pColor[i].a < alphaRef))
         {
@@ -676,6 +1005,86 @@ static void EncodeBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) cons
     pBC->bitmap = dw;
 }
 
+
+//-------------------------------------------------------------------------------------
+static void EncodeBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor,
+                      _In_ bool bColorKey, _In_ float alphaRef, _In_ DWORD flags)
+{
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+
+    size_t uSteps = QuantizeBC1(pBC, Color, pColor, bColorKey, alphaRef, flags);
+    if (!uSteps)
+        return;
+
+    // Perform 6D root finding function to find two endpoints of color axis.
+    HDRColorA ColorA, ColorB;
+
+    OptimizeRGB(&ColorA, &ColorB, Color, uSteps, flags);
+
+    EncodeBC1Indices(pBC, pColor, Color, uSteps, ColorA, ColorB, alphaRef, flags);
+}
+
+
+//-------------------------------------------------------------------------------------
+// Encodes four blocks at once, one per SIMD lane for the endpoint search. Produces
+// the same output as calling EncodeBC1 on each block in turn.
+static void EncodeBC1x4(_In_reads_(nBlocks) D3DX_BC1 *const *ppBC, _In_reads_(nBlocks) const HDRColorA *const *ppColor,
+                        _In_range_(1,4) size_t nBlocks, _In_ bool bColorKey, _In_ float alphaRef, _In_ DWORD flags)
+{
+    assert( ppBC && ppColor );
+    assert( nBlocks > 0 && nBlocks <= 4 );
+
+    HDRColorA Color[4][NUM_PIXELS_PER_BLOCK];
+    const HDRColorA *pPoints[4];
+    size_t uSteps[4];
+
+    size_t nActive = 0;
+    for(size_t iBlock = 0; iBlock < nBlocks; ++iBlock)
+    {
+        uSteps[iBlock] = QuantizeBC1(ppBC[iBlock], Color[iBlock], ppColor[iBlock], bColorKey, alphaRef, flags);
+        if (uSteps[iBlock])
+            ++nActive;
+    }
+
+    if (!nActive)
+        return;
+
+    size_t iFirst = 0;
+    while (!uSteps[iFirst])
+        ++iFirst;
+
+    if (nActive == 1)
+    {
+        // Not worth transposing for a single block
+        HDRColorA ColorA, ColorB;
+
+        OptimizeRGB(&ColorA, &ColorB, Color[iFirst], uSteps[iFirst], flags);
+
+        EncodeBC1Indices(ppBC[iFirst], ppColor[iFirst], Color[iFirst], uSteps[iFirst], ColorA, ColorB, alphaRef, flags);
+        return;
+    }
+
+    // Unused lanes duplicate an active block; their results are discarded
+
+    size_t uLaneSteps[4];
+    for(size_t iLane = 0; iLane < 4; ++iLane)
+    {
+        bool bActive = (iLane < nBlocks) && (uSteps[iLane] != 0);
+        pPoints[iLane] = bActive ? Color[iLane] : Color[iFirst];
+        uLaneSteps[iLane] = bActive ? uSteps[iLane] : uSteps[iFirst];
+    }
+
+    HDRColorA ColorA[4], ColorB[4];
+
+    OptimizeRGBx4(ColorA, ColorB, pPoints, uLaneSteps, flags);
+
+    for(size_t iBlock = 0; iBlock < nBlocks; ++iBlock)
+    {
+        if (uSteps[iBlock])
+            EncodeBC1Indices(ppBC[iBlock], ppColor[iBlock], Color[iBlock], uSteps[iBlock], ColorA[iBlock], ColorB[iBlock], alphaRef, flags);
+    }
+}
+
 //-------------------------------------------------------------------------------------
 #ifdef COLOR_WEIGHTS
 static void EncodeSolidBC1(_Out_ D3DX_BC1 *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *pColor)
@@ -726,12 +1135,18 @@ void D3DXDecodeBC1(XMVECTOR *pColor, const uint8_t *pBC)
 }
 
 _Use_decl_annotations_
-void D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float alphaRef, DWORD flags)
+void D3DXDecodeBC1RGBA8(uint8_t *pColor, const uint8_t *pBC)
 {
-    assert( pBC && pColor );
+    assert( pColor && pBC );
 
-    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    uint32_t clr[NUM_PIXELS_PER_BLOCK];
+    DecodeBC1RGBA8( clr, reinterpret_cast<const D3DX_BC1 *>(pBC), true );
 
+    memcpy( pColor, clr, sizeof(clr) );
+}
+
+static void LoadBC1(_Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA *Color, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags)
+{
     if (flags & BC_FLAGS_DITHER_A)
     {
         float fError[NUM_PIXELS_PER_BLOCK];
@@ -781,11 +1196,53 @@ void D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float alphaRef, DWORD f
             XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[i] ), pColor[i] );
         }
     }
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC1(uint8_t *pBC, const XMVECTOR *pColor, float alphaRef, DWORD flags)
+{
+    assert( pBC && pColor );
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    LoadBC1(Color, pColor, flags);
 
     auto pBC1 = reinterpret_cast<D3DX_BC1 *>(pBC);
     EncodeBC1(pBC1, Color, true, alphaRef, flags);
 }
 
+_Use_decl_annotations_
+void D3DXEncodeBC1Batch(uint8_t *pBC, const XMVECTOR *pColor, size_t nBlocks, float alphaRef, DWORD flags)
+{
+    assert( pBC && pColor );
+
+#ifdef COLOR_WEIGHTS
+    // The four-wide endpoint search does not implement the alpha-weighted variant
+    for(size_t iBlock = 0; iBlock < nBlocks; ++iBlock)
+    {
+        D3DXEncodeBC1(pBC + iBlock * 8, pColor + iBlock * NUM_PIXELS_PER_BLOCK, alphaRef, flags);
+    }
+#else
+    HDRColorA Color[4][NUM_PIXELS_PER_BLOCK];
+    D3DX_BC1 *pBlocks[4];
+    const HDRColorA *pColors[4];
+
+    for(size_t iBlock = 0; iBlock < nBlocks; iBlock += 4)
+    {
+        size_t nLanes = std::min<size_t>(4, nBlocks - iBlock);
+
+        for(size_t iLane = 0; iLane < nLanes; ++iLane)
+        {
+            LoadBC1(Color[iLane], pColor + (iBlock + iLane) * NUM_PIXELS_PER_BLOCK, flags);
+
+            pBlocks[iLane] = reinterpret_cast<D3DX_BC1 *>(pBC + (iBlock + iLane) * 8);
+            pColors[iLane] = Color[iLane];
+        }
+
+        EncodeBC1x4(pBlocks, pColors, nLanes, true, alphaRef, flags);
+    }
+#endif // COLOR_WEIGHTS
+}
+
 
 //-------------------------------------------------------------------------------------
 // BC2 Compression
@@ -816,6 +1273,43 @@ void D3DXDecodeBC2(XMVECTOR *pColor, const uint8_t *pBC)
         pColor[i] = XMVectorSetW( pColor[i], (float) (dw & 0xf) * (1.0f / 15.0f) );
 }
 
+_Use_decl_annotations_
+void D3DXDecodeBC2RGBA8(uint8_t *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC2) == 16, "D3DX_BC2 should be 16 bytes" );
+
+    auto pBC2 = reinterpret_cast<const D3DX_BC2 *>(pBC);
+
+    // RGB part
+    uint32_t clr[NUM_PIXELS_PER_BLOCK];
+    DecodeBC1RGBA8(clr, &pBC2->bc1, false);
+
+    // 4-bit alpha part, four texels per vector
+    float fAlpha[NUM_PIXELS_PER_BLOCK];
+    DWORD dw = pBC2->bitmap[0];
+
+    for(size_t i = 0; i < 8; ++i, dw >>= 4)
+        fAlpha[i] = (float) (dw & 0xf) * (1.0f / 15.0f);
+
+    dw = pBC2->bitmap[1];
+
+    for(size_t i = 8; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 4)
+        fAlpha[i] = (float) (dw & 0xf) * (1.0f / 15.0f);
+
+    XMVECTOR vAlpha[4];
+    for(size_t i = 0; i < 4; ++i)
+        vAlpha[i] = XMLoadFloat4( reinterpret_cast<const XMFLOAT4*>( &fAlpha[i * 4] ) );
+
+    uint8_t uAlpha[NUM_PIXELS_PER_BLOCK];
+    StoreRGBA8( uAlpha, vAlpha, 4 );
+
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        clr[i] = (clr[i] & 0x00ffffff) | (uint32_t(uAlpha[i]) << 24);
+
+    memcpy( pColor, clr, sizeof(clr) );
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC2(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
@@ -881,7 +1375,7 @@ void D3DXEncodeBC2(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 #ifdef COLOR_WEIGHTS
     if(!pBC2->bitmap[0] && !pBC2->bitmap[1])
     {
-        EncodeSolidBC1(pBC2->dxt1, Color);
+        EncodeSolidBC1(&pBC2->bc1, Color);
         return;
     }
 #endif // COLOR_WEIGHTS
@@ -936,19 +1430,60 @@ void D3DXDecodeBC3(XMVECTOR *pColor, const uint8_t *pBC)
 }
 
 _Use_decl_annotations_
-void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
+void D3DXDecodeBC3RGBA8(uint8_t *pColor, const uint8_t *pBC)
 {
-    assert( pBC && pColor );
+    assert( pColor && pBC );
     static_assert( sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes" );
 
-    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
-    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    auto pBC3 = reinterpret_cast<const D3DX_BC3 *>(pBC);
+
+    // RGB part
+    uint32_t clr[NUM_PIXELS_PER_BLOCK];
+    DecodeBC1RGBA8(clr, &pBC3->bc1, false);
+
+    // Adaptive 3-bit alpha part, with the palette computed as D3DXDecodeBC3 does
+    float fAlpha[8];
+
+    fAlpha[0] = ((float) pBC3->alpha[0]) * (1.0f / 255.0f);
+    fAlpha[1] = ((float) pBC3->alpha[1]) * (1.0f / 255.0f);
+
+    if(pBC3->alpha[0] > pBC3->alpha[1]) 
     {
-        XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[i] ), pColor[i] );
+        for(size_t i = 1; i < 7; ++i)
+            fAlpha[i + 1] = (fAlpha[0] * (7 - i) + fAlpha[1] * i) * (1.0f / 7.0f);
     }
+    else 
+    {
+        for(size_t i = 1; i < 5; ++i)
+            fAlpha[i + 1] = (fAlpha[0] * (5 - i) + fAlpha[1] * i) * (1.0f / 5.0f);
 
-    auto pBC3 = reinterpret_cast<D3DX_BC3 *>(pBC);
+        fAlpha[6] = 0.0f;
+        fAlpha[7] = 1.0f;
+    }
+
+    XMVECTOR vAlpha[2];
+    vAlpha[0] = XMLoadFloat4( reinterpret_cast<const XMFLOAT4*>( &fAlpha[0] ) );
+    vAlpha[1] = XMLoadFloat4( reinterpret_cast<const XMFLOAT4*>( &fAlpha[4] ) );
+
+    uint8_t uAlpha[8];
+    StoreRGBA8( uAlpha, vAlpha, 2 );
+
+    DWORD dw = pBC3->bitmap[0] | (pBC3->bitmap[1] << 8) | (pBC3->bitmap[2] << 16);
+
+    for(size_t i = 0; i < 8; ++i, dw >>= 3)
+        clr[i] = (clr[i] & 0x00ffffff) | (uint32_t(uAlpha[dw & 0x7]) << 24);
 
+    dw = pBC3->bitmap[3] | (pBC3->bitmap[4] << 8) | (pBC3->bitmap[5] << 16);
+
+    for(size_t i = 8; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 3)
+        clr[i] = (clr[i] & 0x00ffffff) | (uint32_t(uAlpha[dw & 0x7]) << 24);
+
+    memcpy( pColor, clr, sizeof(clr) );
+}
+
+// Returns the largest alpha of the block after quantizing it to A8
+static float EncodeBC3Alpha(_Out_ D3DX_BC3 *pBC3, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA *Color, _In_ DWORD flags)
+{
     // Quantize block to A8, using Floyd Stienberg error diffusion.  This 
     // increases the chance that colors will map directly to the quantized 
     // axis endpoints.
@@ -1002,26 +1537,12 @@ void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
         }
     }
 
-#ifdef COLOR_WEIGHTS
-    if(0.0f == fMaxAlpha)
-    {
-        EncodeSolidBC1(&pBC3->dxt1, Color);
-        pBC3->alpha[0] = 0x00;
-        pBC3->alpha[1] = 0x00;
-        memset(pBC3->bitmap, 0x00, 6);
-    }
-#endif
-
-    // RGB part
-    EncodeBC1(&pBC3->bc1, Color, false, 0.f, flags);
-
-    // Alpha part
     if(1.0f == fMinAlpha)
     {
         pBC3->alpha[0] = 0xff;
         pBC3->alpha[1] = 0xff;
         memset(pBC3->bitmap, 0x00, 6);
-        return;
+        return fMaxAlpha;
     }
 
     // Optimize and Quantize Min and Max values
@@ -1042,7 +1563,7 @@ void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
         pBC3->alpha[0] = bAlphaA;
         pBC3->alpha[1] = bAlphaB;
         memset(pBC3->bitmap, 0x00, 6);
-        return;
+        return fMaxAlpha;
     }
 
     static const size_t pSteps6[] = { 0, 2, 3, 4, 5, 1 };
@@ -1136,6 +1657,84 @@ void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
         pBC3->bitmap[1 + iSet * 3] = ((uint8_t *) &dw)[1];
         pBC3->bitmap[2 + iSet * 3] = ((uint8_t *) &dw)[2];
     }
+
+    return fMaxAlpha;
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
+{
+    assert( pBC && pColor );
+    static_assert( sizeof(D3DX_BC3) == 16, "D3DX_BC3 should be 16 bytes" );
+
+    HDRColorA Color[NUM_PIXELS_PER_BLOCK];
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[i] ), pColor[i] );
+    }
+
+    auto pBC3 = reinterpret_cast<D3DX_BC3 *>(pBC);
+
+    // Alpha part
+#ifdef COLOR_WEIGHTS
+    if(0.0f == EncodeBC3Alpha(pBC3, Color, flags))
+    {
+        EncodeSolidBC1(&pBC3->bc1, Color);
+        pBC3->alpha[0] = 0x00;
+        pBC3->alpha[1] = 0x00;
+        memset(pBC3->bitmap, 0x00, 6);
+        return;
+    }
+#else
+    EncodeBC3Alpha(pBC3, Color, flags);
+#endif // COLOR_WEIGHTS
+
+    // RGB part
+    EncodeBC1(&pBC3->bc1, Color, false, 0.f, flags);
+}
+
+_Use_decl_annotations_
+void D3DXEncodeBC3Batch(uint8_t *pBC, const XMVECTOR *pColor, size_t nBlocks, DWORD flags)
+{
+    assert( pBC && pColor );
+
+#ifdef COLOR_WEIGHTS
+    // The four-wide endpoint search does not implement the alpha-weighted variant
+    for(size_t iBlock = 0; iBlock < nBlocks; ++iBlock)
+    {
+        D3DXEncodeBC3(pBC + iBlock * 16, pColor + iBlock * NUM_PIXELS_PER_BLOCK, flags);
+    }
+#else
+    HDRColorA Color[4][NUM_PIXELS_PER_BLOCK];
+    D3DX_BC1 *pBlocks[4];
+    const HDRColorA *pColors[4];
+
+    for(size_t iBlock = 0; iBlock < nBlocks; iBlock += 4)
+    {
+        size_t nLanes = std::min<size_t>(4, nBlocks - iBlock);
+
+        for(size_t iLane = 0; iLane < nLanes; ++iLane)
+        {
+            const XMVECTOR *pSrc = pColor + (iBlock + iLane) * NUM_PIXELS_PER_BLOCK;
+            for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                XMStoreFloat4( reinterpret_cast<XMFLOAT4*>( &Color[iLane][i] ), pSrc[i] );
+            }
+
+            pBlocks[iLane] = &reinterpret_cast<D3DX_BC3 *>(pBC + (iBlock + iLane) * 16)->bc1;
+            pColors[iLane] = Color[iLane];
+        }
+
+        // RGB part
+        EncodeBC1x4(pBlocks, pColors, nLanes, false, 0.f, flags);
+
+        // Alpha part
+        for(size_t iLane = 0; iLane < nLanes; ++iLane)
+        {
+            EncodeBC3Alpha(reinterpret_cast<D3DX_BC3 *>(pBC + (iBlock + iLane) * 16), Color[iLane], flags);
+        }
+    }
+#endif // COLOR_WEIGHTS
 }
 
 } // namespace
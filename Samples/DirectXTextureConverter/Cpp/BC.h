@@ -48,6 +48,7 @@ const size_t BC6H_MAX_SHAPES = 32;
 
 const size_t BC7_NUM_CHANNELS = 4;
 const size_t BC7_MAX_SHAPES = 64;
+const size_t BC7_FAST_ITEMS = 2;    // Shapes refined per mode with BC_FLAGS_BC7_FAST
 
 const int32_t BC67_WEIGHT_MAX = 64;
 const uint32_t BC67_WEIGHT_SHIFT = 6;
@@ -63,6 +64,8 @@ enum BC_FLAGS
     BC_FLAGS_DITHER_RGB = 0x10000,  // Enables dithering for RGB colors for BC1-3
     BC_FLAGS_DITHER_A   = 0x20000,  // Enables dithering for Alpha channel for BC1-3
     BC_FLAGS_UNIFORM    = 0x40000,  // By default, uses perceptual weighting for BC1-3; this flag makes it a uniform weighting
+    BC_FLAGS_BC7_FAST   = 0x100000, // Only refines the few BC7 partitions with the lowest rough error estimate
+    BC_FLAGS_BC7_MAX    = 0x200000, // Refines every BC7 partition rather than the best quarter
 };
 
 //-------------------------------------------------------------------------------------
@@ -523,6 +526,7 @@ class D3DX_BC6H : private CBits< 16 >
 {
 public:
     void Decode(_In_ bool bSigned, _Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut) const;
+    void Decode(_In_ bool bSigned, _Out_writes_(NUM_PIXELS_PER_BLOCK) PackedVector::XMHALF4* pOut) const;
     void Encode(_In_ bool bSigned, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn);
 
 private:
@@ -624,7 +628,8 @@ class D3DX_BC7 : private CBits< 16 >
 {
 public:
     void Decode(_Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut) const;
-    void Encode(_In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn);
+    void Decode(_Out_writes_(NUM_PIXELS_PER_BLOCK) LDRColorA* pOut) const;
+    void Encode(_In_ DWORD flags, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn);
 
 private:
     struct ModeInfo
@@ -875,6 +880,17 @@ void D3DXDecodeBC6HU(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_re
 void D3DXDecodeBC6HS(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 void D3DXDecodeBC7(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 
+// Decoders that write the block's texels in row order straight to R8G8B8A8_UNORM (64 bytes)
+// or R16G16B16A16_FLOAT (128 bytes), without the round trip through XMVECTOR
+typedef void (*BC_DECODE_PACKED)(uint8_t *pColor, const uint8_t *pBC);
+
+void D3DXDecodeBC1RGBA8(_Out_writes_bytes_(64) uint8_t *pColor, _In_reads_(8) const uint8_t *pBC);
+void D3DXDecodeBC2RGBA8(_Out_writes_bytes_(64) uint8_t *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC3RGBA8(_Out_writes_bytes_(64) uint8_t *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC6HURGBA16F(_Out_writes_bytes_(128) uint8_t *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC6HSRGBA16F(_Out_writes_bytes_(128) uint8_t *pColor, _In_reads_(16) const uint8_t *pBC);
+void D3DXDecodeBC7RGBA8(_Out_writes_bytes_(64) uint8_t *pColor, _In_reads_(16) const uint8_t *pBC);
+
 void D3DXEncodeBC1(_Out_writes_(8) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ float alphaRef, _In_ DWORD flags);
     // BC1 requires one additional parameter, so it doesn't match signature of BC_ENCODE above
 
@@ -888,4 +904,11 @@ void D3DXEncodeBC6HU(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BL
 void D3DXEncodeBC6HS(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 void D3DXEncodeBC7(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ DWORD flags);
 
+// Batched encoders for a contiguous run of blocks, which run the endpoint search for
+// several blocks at once across SIMD lanes. Output matches the single-block encoders.
+void D3DXEncodeBC1Batch(_Out_writes_(nBlocks * 8) uint8_t *pBC, _In_reads_(nBlocks * NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor,
+                        _In_ size_t nBlocks, _In_ float alphaRef, _In_ DWORD flags);
+void D3DXEncodeBC3Batch(_Out_writes_(nBlocks * 16) uint8_t *pBC, _In_reads_(nBlocks * NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor,
+                        _In_ size_t nBlocks, _In_ DWORD flags);
+
 }; // namespace
@@ -1056,16 +1056,33 @@ static float ComputeError(_Inout_ const LDRColorA& pixel, _In_reads_(1 << uIndex
 }
 
 
-inline static void FillWithErrorColors( _Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut )
+static const HALF g_HalfZero = 0x0000;   // 0.0f
+static const HALF g_HalfOne = 0x3C00;    // 1.0f
+
+inline static void FillWithErrorColors( _Out_writes_(NUM_PIXELS_PER_BLOCK) XMHALF4* pOut )
+{
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+#ifdef _DEBUG
+        // Use Magenta in debug as a highly-visible error color
+        pOut[i] = XMHALF4(g_HalfOne, g_HalfZero, g_HalfOne, g_HalfOne);
+#else
+        // In production use, default to black
+        pOut[i] = XMHALF4(g_HalfZero, g_HalfZero, g_HalfZero, g_HalfOne);
+#endif
+    }
+}
+
+inline static void FillWithErrorColors( _Out_writes_(NUM_PIXELS_PER_BLOCK) LDRColorA* pOut )
 {
     for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
 #ifdef _DEBUG
         // Use Magenta in debug as a highly-visible error color
-        pOut[i] = HDRColorA(1.0f, 0.0f, 1.0f, 1.0f);
+        pOut[i] = LDRColorA(255, 0, 255, 255);
 #else
         // In production use, default to black
-        pOut[i] = HDRColorA(0.0f, 0.0f, 0.0f, 1.0f);
+        pOut[i] = LDRColorA(0, 0, 0, 255);
 #endif
     }
 }
@@ -1076,6 +1093,23 @@ inline static void FillWithErrorColors( _Out_writes_(NUM_PIXELS_PER_BLOCK) HDRCo
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
 void D3DX_BC6H::Decode(bool bSigned, HDRColorA* pOut) const
+{
+    assert( pOut );
+
+    XMHALF4 aHalf[NUM_PIXELS_PER_BLOCK];
+    Decode(bSigned, aHalf);
+
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        pOut[i].r = XMConvertHalfToFloat( aHalf[i].x );
+        pOut[i].g = XMConvertHalfToFloat( aHalf[i].y );
+        pOut[i].b = XMConvertHalfToFloat( aHalf[i].z );
+        pOut[i].a = XMConvertHalfToFloat( aHalf[i].w );
+    }
+}
+
+_Use_decl_annotations_
+void D3DX_BC6H::Decode(bool bSigned, XMHALF4* pOut) const
 {
     assert(pOut );
 
@@ -1208,10 +1242,7 @@ void D3DX_BC6H::Decode(bool bSigned, HDRColorA* pOut) const
             HALF rgb[3];
             fc.ToF16(rgb, bSigned);
 
-            pOut[i].r = XMConvertHalfToFloat( rgb[0] );
-            pOut[i].g = XMConvertHalfToFloat( rgb[1] );
-            pOut[i].b = XMConvertHalfToFloat( rgb[2] );
-            pOut[i].a = 1.0f;
+            pOut[i] = XMHALF4( rgb[0], rgb[1], rgb[2], g_HalfOne );
         }
     }
     else
@@ -1230,7 +1261,7 @@ void D3DX_BC6H::Decode(bool bSigned, HDRColorA* pOut) const
         // Per the BC6H format spec, we must return opaque black
         for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
         {
-            pOut[i] = HDRColorA(0.0f, 0.0f, 0.0f, 1.0f);
+            pOut[i] = XMHALF4(g_HalfZero, g_HalfZero, g_HalfZero, g_HalfOne);
         }
     }
 }
@@ -1939,6 +1970,20 @@ void D3DX_BC7::Decode(HDRColorA* pOut) const
 {
     assert( pOut );
 
+    LDRColorA aLDR[NUM_PIXELS_PER_BLOCK];
+    Decode(aLDR);
+
+    for(size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+    {
+        pOut[i] = HDRColorA(aLDR[i]);
+    }
+}
+
+_Use_decl_annotations_
+void D3DX_BC7::Decode(LDRColorA* pOut) const
+{
+    assert( pOut );
+
     size_t uFirst = 0;
     while(uFirst < 128 && !GetBit(uFirst)) {}
     uint8_t uMode = uint8_t(uFirst - 1);
@@ -2130,7 +2175,7 @@ void D3DX_BC7::Decode(HDRColorA* pOut) const
             case 3: std::swap(outPixel.b, outPixel.a); break;
             }
 
-            pOut[i] = HDRColorA(outPixel);
+            pOut[i] = outPixel;
         }
     }
     else
@@ -2139,12 +2184,12 @@ void D3DX_BC7::Decode(HDRColorA* pOut) const
         OutputDebugStringA( "BC7: Reserved mode 8 encountered during decoding\n" );
 #endif
         // Per the BC7 format spec, we must return transparent black
-        memset( pOut, 0, sizeof(HDRColorA) * NUM_PIXELS_PER_BLOCK );
+        memset( pOut, 0, sizeof(LDRColorA) * NUM_PIXELS_PER_BLOCK );
     }
 }
 
 _Use_decl_annotations_
-void D3DX_BC7::Encode(const HDRColorA* const pIn)
+void D3DX_BC7::Encode(DWORD flags, const HDRColorA* const pIn)
 {
     assert( pIn );
 
@@ -2170,7 +2215,11 @@ void D3DX_BC7::Encode(const HDRColorA* const pIn)
         const size_t uNumIdxMode = size_t(1) << ms_aInfo[EP.uMode].uIndexModeBits;
         // Number of rough cases to look at. reasonable values of this are 1, uShapes/4, and uShapes
         // uShapes/4 gets nearly all the cases; you can increase that a bit (say by 3 or 4) if you really want to squeeze the last bit out
-        const size_t uItems = std::max<size_t>(1, uShapes >> 2);
+        size_t uItems = std::max<size_t>(1, uShapes >> 2);
+        if (flags & BC_FLAGS_BC7_MAX)
+            uItems = uShapes;
+        else if (flags & BC_FLAGS_BC7_FAST)
+            uItems = std::min<size_t>(uShapes, BC7_FAST_ITEMS);
         float afRoughMSE[BC7_MAX_SHAPES];
         size_t auShape[BC7_MAX_SHAPES];
 
@@ -2207,6 +2256,11 @@ void D3DX_BC7::Encode(const HDRColorA* const pIn)
 
                 for(size_t i = 0; i < uItems && fMSEBest > 0; i++)
                 {
+                    // The rough estimates are sorted, so once they pass twice the best refined error
+                    // the remaining shapes are very unlikely to win after refinement
+                    if ((flags & BC_FLAGS_BC7_FAST) && afRoughMSE[i] > fMSEBest * 2.0f)
+                        break;
+
                     float fMSE = Refine(&EP, auShape[i], r, im);
                     if(fMSE < fMSEBest)
                     {
@@ -2829,6 +2883,24 @@ void D3DXDecodeBC6HS(XMVECTOR *pColor, const uint8_t *pBC)
     reinterpret_cast< const D3DX_BC6H* >( pBC )->Decode(true, reinterpret_cast<HDRColorA*>(pColor));
 }
 
+_Use_decl_annotations_
+void D3DXDecodeBC6HURGBA16F(uint8_t *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC6H) == 16, "D3DX_BC6H should be 16 bytes" );
+    static_assert( sizeof(XMHALF4) == 8, "XMHALF4 should be 8 bytes" );
+    reinterpret_cast< const D3DX_BC6H* >( pBC )->Decode(false, reinterpret_cast<XMHALF4*>(pColor));
+}
+
+_Use_decl_annotations_
+void D3DXDecodeBC6HSRGBA16F(uint8_t *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC6H) == 16, "D3DX_BC6H should be 16 bytes" );
+    static_assert( sizeof(XMHALF4) == 8, "XMHALF4 should be 8 bytes" );
+    reinterpret_cast< const D3DX_BC6H* >( pBC )->Decode(true, reinterpret_cast<XMHALF4*>(pColor));
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC6HU(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
@@ -2859,13 +2931,21 @@ void D3DXDecodeBC7(XMVECTOR *pColor, const uint8_t *pBC)
     reinterpret_cast< const D3DX_BC7* >( pBC )->Decode(reinterpret_cast<HDRColorA*>(pColor));
 }
 
+_Use_decl_annotations_
+void D3DXDecodeBC7RGBA8(uint8_t *pColor, const uint8_t *pBC)
+{
+    assert( pColor && pBC );
+    static_assert( sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes" );
+    static_assert( sizeof(LDRColorA) == 4, "LDRColorA should be 4 bytes" );
+    reinterpret_cast< const D3DX_BC7* >( pBC )->Decode(reinterpret_cast<LDRColorA*>(pColor));
+}
+
 _Use_decl_annotations_
 void D3DXEncodeBC7(uint8_t *pBC, const XMVECTOR *pColor, DWORD flags)
 {
-    UNREFERENCED_PARAMETER(flags);
     assert( pBC && pColor );
     static_assert( sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes" );
-    reinterpret_cast< D3DX_BC7* >( pBC )->Encode(reinterpret_cast<const HDRColorA*>(pColor));
+    reinterpret_cast< D3DX_BC7* >( pBC )->Encode(flags, reinterpret_cast<const HDRColorA*>(pColor));
 }
 
 } // namespace
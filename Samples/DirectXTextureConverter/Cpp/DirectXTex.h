@@ -252,6 +252,44 @@ namespace DirectX
         ScratchImage& operator=( const ScratchImage& );
     };
 
+    //---------------------------------------------------------------------------------
+    // Read-only view of a DDS file mapped into memory
+    class TexView
+    {
+    public:
+        TexView() : _hFile(0), _hMapping(0), _view(0), _convFlags(0), _pal8(0), _nimages(0), _image(0), _source(0) {}
+        ~TexView() { Release(); }
+
+        HRESULT InitializeFromDDSFile( _In_z_ LPCWSTR szFile, _In_ DWORD flags );
+
+        void Release();
+
+        const TexMetadata& GetMetadata() const { return _metadata; }
+        const Image* GetImage(_In_ size_t mip, _In_ size_t item, _In_ size_t slice);
+            // Images point directly into the read-only file mapping unless the file uses a legacy format that needs
+            // conversion, in which case the image is converted into a private copy the first time it is requested.
+            // Not safe to call from multiple threads at once
+
+        size_t GetImageCount() const { return _nimages; }
+
+        bool IsZeroCopy() const;
+
+    private:
+        HANDLE          _hFile;
+        HANDLE          _hMapping;
+        uint8_t*        _view;
+        DWORD           _convFlags;
+        const uint32_t* _pal8;
+        size_t          _nimages;
+        TexMetadata     _metadata;
+        Image*          _image;
+        Image*          _source;
+
+        // Hide copy constructor and assignment operator
+        TexView( const TexView& );
+        TexView& operator=( const TexView& );
+    };
+
     //---------------------------------------------------------------------------------
     // Memory blob (allocated buffer pointer is always 16-byte aligned)
     class Blob
@@ -397,6 +435,11 @@ namespace DirectX
 
         TEX_FILTER_FORCE_WIC        = 0x20000000,
             // Forces use of the WIC path even when logic would have picked a non-WIC path when both are an option
+
+        TEX_FILTER_PARALLEL         = 0x40000000,
+            // Mipmap generation is free to use multithreading (by default it does not). This never changes which filter
+            // is used: WIC mip levels are scaled on separate threads, and the custom box and linear filters split each
+            // level into bands, so the result is the same with or without this flag
     };
 
     HRESULT Resize( _In_ const Image& srcImage, _In_ size_t width, _In_ size_t height, _In_ DWORD filter,
@@ -446,15 +489,39 @@ namespace DirectX
         TEX_COMPRESS_UNIFORM        = 0x40000,
             // Uniform color weighting for BC1-3 compression; by default uses perceptual weighting
 
+        TEX_COMPRESS_BC7_FAST       = 0x100000,
+            // Fast BC7 compression; only refines the few best partitions of each mode as ranked by a rough error estimate
+
+        TEX_COMPRESS_BC7_MAX        = 0x200000,
+            // Exhaustive BC7 compression; refines every partition of every mode (by default refines the best quarter)
+
         TEX_COMPRESS_PARALLEL       = 0x10000000,
             // Compress is free to use multithreading to improve performance (by default it does not use multithreading)
     };
 
     HRESULT Compress( _In_ const Image& srcImage, _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef,
-                      _Out_ ScratchImage& cImage );
+                      _Out_ ScratchImage& cImage, _In_opt_ std::function<bool( size_t, size_t, size_t )> progress = nullptr );
     HRESULT Compress( _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
-                      _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef, _Out_ ScratchImage& cImages );
+                      _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef, _Out_ ScratchImage& cImages,
+                      _In_opt_ std::function<bool( size_t, size_t, size_t )> progress = nullptr );
         // Note that alphaRef is only used by BC1. 0.5f is a typical value to use
+        // progress( index, blocksDone, blocksTotal ) is called as each image's blocks complete; returning false cancels
+        // the compression with E_ABORT. With TEX_COMPRESS_PARALLEL it is called from worker threads, but never concurrently
+
+    HRESULT CompressDDSFile( _In_z_ LPCWSTR szSrcFile, _In_ DWORD flags, _In_z_ LPCWSTR szDestFile,
+                             _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef );
+    HRESULT CompressTGAFile( _In_z_ LPCWSTR szSrcFile, _In_z_ LPCWSTR szDestFile,
+                             _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef );
+        // Streams the first image of the source file through the compressor one row of blocks at a time and writes
+        // the result directly to a DDS file, so neither the source nor the compressed image is ever fully in memory
+        // If reading, compressing or writing fails once the destination has been created, it is deleted
+
+    HRESULT GenerateCompressedMipMaps( _In_ const Image& baseImage, _In_ DWORD filter, _In_ size_t levels,
+                                       _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef, _Out_ ScratchImage& cImages );
+        // Box filters and compresses a mip chain a row of blocks at a time without building the uncompressed chain.
+        // Each level is the library's own 2x2 average of the level above, so the result matches GenerateMipMaps with
+        // TEX_FILTER_BOX | TEX_FILTER_FORCE_NON_WIC followed by Compress. Plain TEX_FILTER_BOX may use the WIC Fant
+        // scaler instead (for non-sRGB formats), which rounds differently. Requires power-of-2 dimensions
 
     HRESULT Decompress( _In_ const Image& cImage, _In_ DXGI_FORMAT format, _Out_ ScratchImage& image );
     HRESULT Decompress( _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
@@ -21,6 +21,8 @@
 #endif
 
 #include "bc.h"
+#include "dds.h"
+#include "filters.h"
 
 
 namespace DirectX
@@ -32,7 +34,9 @@ inline static DWORD _GetBCFlags( _In_ DWORD compress )
     static_assert( TEX_COMPRESS_A_DITHER == BC_FLAGS_DITHER_A, "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
     static_assert( TEX_COMPRESS_DITHER == (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A), "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
     static_assert( TEX_COMPRESS_UNIFORM == BC_FLAGS_UNIFORM, "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
-    return ( compress & (BC_FLAGS_DITHER_RGB|BC_FLAGS_DITHER_A|BC_FLAGS_UNIFORM) );
+    static_assert( TEX_COMPRESS_BC7_FAST == BC_FLAGS_BC7_FAST, "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
+    static_assert( TEX_COMPRESS_BC7_MAX == BC_FLAGS_BC7_MAX, "TEX_COMPRESS_* flags should match BC_FLAGS_*"  );
+    return ( compress & (BC_FLAGS_DITHER_RGB|BC_FLAGS_DITHER_A|BC_FLAGS_UNIFORM|BC_FLAGS_BC7_FAST|BC_FLAGS_BC7_MAX) );
 }
 
 inline static bool _DetermineEncoderSettings( _In_ DXGI_FORMAT format, _Out_ BC_ENCODE& pfEncode, _Out_ size_t& blocksize, _Out_ DWORD& cflags )
@@ -59,6 +63,43 @@ inline static bool _DetermineEncoderSettings( _In_ DXGI_FORMAT format, _Out_ BC_
     return true;
 }
 
+// Number of blocks gathered per encoder call; BC1 and BC3 encode these across SIMD lanes
+#define BC_BATCH_BLOCKS 8
+
+inline static void _EncodeBlocks( _In_ DXGI_FORMAT format, _In_opt_ BC_ENCODE pfEncode, _In_ size_t blocksize,
+                                  _Out_writes_(nBlocks * blocksize) uint8_t* pDest, _In_reads_(nBlocks * NUM_PIXELS_PER_BLOCK) const XMVECTOR* pColor,
+                                  _In_ size_t nBlocks, _In_ DWORD bcflags, _In_ float alphaRef )
+{
+    switch(format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+        D3DXEncodeBC1Batch( pDest, pColor, nBlocks, alphaRef, bcflags );
+        break;
+
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+        D3DXEncodeBC3Batch( pDest, pColor, nBlocks, bcflags );
+        break;
+
+    default:
+        assert( pfEncode != 0 );
+        for( size_t i = 0; i < nBlocks; ++i )
+        {
+            pfEncode( pDest + i*blocksize, pColor + i*NUM_PIXELS_PER_BLOCK, bcflags );
+        }
+        break;
+    }
+}
+
+inline static size_t _CountBlocks( _In_ const Image& image )
+{
+    return std::max<size_t>( 1, ( image.width + 3 ) / 4 ) * std::max<size_t>( 1, ( image.height + 3 ) / 4 );
+}
+
+// Images with fewer blocks than this are decompressed on the calling thread
+#define BC_DECODE_PARALLEL_BLOCKS 1024
+
 
 //-------------------------------------------------------------------------------------
 static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
@@ -93,29 +134,32 @@ static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _
     if ( !_DetermineEncoderSettings( result.format, pfEncode, blocksize, cflags ) )
         return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
 
-    XMVECTOR temp[16];
+    XMVECTOR temp[NUM_PIXELS_PER_BLOCK * BC_BATCH_BLOCKS];
     const uint8_t *pSrc = image.pixels;
     const size_t rowPitch = image.rowPitch;
     for( size_t h=0; h < image.height; h += 4 )
     {
         const uint8_t *sptr = pSrc;
         uint8_t* dptr = pDest;
+        size_t nBatch = 0;
         for( size_t count = 0; count < rowPitch; count += sbpp*4 )
         {
-            if ( !_LoadScanline( &temp[0], 4, sptr, rowPitch, format ) )
+            XMVECTOR* block = &temp[ nBatch * NUM_PIXELS_PER_BLOCK ];
+
+            if ( !_LoadScanline( &block[0], 4, sptr, rowPitch, format ) )
                 return E_FAIL;
 
             if ( image.height > 1 )
             {
-                if ( !_LoadScanline( &temp[4], 4, sptr + rowPitch, rowPitch, format ) )
+                if ( !_LoadScanline( &block[4], 4, sptr + rowPitch, rowPitch, format ) )
                     return E_FAIL;
 
                 if ( image.height > 2 )
                 {
-                    if ( !_LoadScanline( &temp[8], 4, sptr + rowPitch*2, rowPitch, format ) )
+                    if ( !_LoadScanline( &block[8], 4, sptr + rowPitch*2, rowPitch, format ) )
                         return E_FAIL;
 
-                    if ( !_LoadScanline( &temp[12], 4, sptr + rowPitch*3, rowPitch, format ) )
+                    if ( !_LoadScanline( &block[12], 4, sptr + rowPitch*3, rowPitch, format ) )
                         return E_FAIL;
                 }
             }
@@ -131,7 +175,7 @@ static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _
                     {
                         for( size_t s = image.width; s < 4; ++s )
                         {
-                            temp[ t*4 + s ] = temp[ t*4 + uSrc[s] ]; 
+                            block[ t*4 + s ] = block[ t*4 + uSrc[s] ]; 
                         }
                     }
                 }
@@ -142,21 +186,28 @@ static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _
                     {
                         for( size_t s =0; s < 4; ++s )
                         {
-                            temp[ t*4 + s ] = temp[ uSrc[t]*4 + s ]; 
+                            block[ t*4 + s ] = block[ uSrc[t]*4 + s ]; 
                         }
                     }
                 }
             }
 
-            _ConvertScanline( temp, 16, result.format, format, cflags );
-            
-            if ( pfEncode )
-                pfEncode( dptr, temp, bcflags );
-            else
-                D3DXEncodeBC1( dptr, temp, alphaRef, bcflags );
-
             sptr += sbpp*4;
-            dptr += blocksize;
+
+            if ( ++nBatch == BC_BATCH_BLOCKS )
+            {
+                _ConvertScanline( temp, nBatch * NUM_PIXELS_PER_BLOCK, result.format, format, cflags );
+                _EncodeBlocks( result.format, pfEncode, blocksize, dptr, temp, nBatch, bcflags, alphaRef );
+
+                dptr += blocksize * nBatch;
+                nBatch = 0;
+            }
+        }
+
+        if ( nBatch > 0 )
+        {
+            _ConvertScanline( temp, nBatch * NUM_PIXELS_PER_BLOCK, result.format, format, cflags );
+            _EncodeBlocks( result.format, pfEncode, blocksize, dptr, temp, nBatch, bcflags, alphaRef );
         }
 
         pSrc += rowPitch*4;
@@ -169,8 +220,24 @@ static HRESULT _CompressBC( _In_ const Image& image, _In_ const Image& result, _
 
 //-------------------------------------------------------------------------------------
 #ifdef _OPENMP
-static HRESULT _CompressBC_Parallel( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
-                                     _In_ float alphaRef )
+
+// Per-image state for the parallel encoder; the batches of every image are numbered in one
+// combined range so that a single dynamically scheduled loop covers a whole mip chain or array
+struct BC_PARALLEL_IMAGE
+{
+    size_t          index;          // Image index reported to the progress callback
+    const Image*    image;
+    const Image*    result;
+    size_t          sbpp;
+    size_t          nbWidth;
+    size_t          nbTotal;
+    size_t          nBatchesPerRow;
+    size_t          firstBatch;
+    volatile LONG   completed;      // Blocks encoded so far
+};
+
+static HRESULT _SetupParallelImage( _In_ const Image& image, _In_ const Image& result, _In_ size_t index,
+                                    _In_ size_t firstBatch, _Out_ BC_PARALLEL_IMAGE& job, _Out_ size_t& nBatches )
 {
     if ( !image.pixels || !result.pixels )
         return E_POINTER;
@@ -181,8 +248,7 @@ static HRESULT _CompressBC_Parallel( _In_ const Image& image, _In_ const Image&
     assert( image.width == result.width );
     assert( image.height == result.height );
 
-    const DXGI_FORMAT format = image.format;
-    size_t sbpp = BitsPerPixel( format );
+    size_t sbpp = BitsPerPixel( image.format );
     if ( !sbpp )
         return E_FAIL;
 
@@ -192,63 +258,244 @@ static HRESULT _CompressBC_Parallel( _In_ const Image& image, _In_ const Image&
         return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
     }
 
-    // Round to bytes
-    sbpp = ( sbpp + 7 ) / 8;
+    const size_t nbWidth = std::max<size_t>(1, image.width / 4);
+    const size_t nbHeight = std::max<size_t>(1, image.height / 4);
+
+    job.index = index;
+    job.image = &image;
+    job.result = &result;
+    job.sbpp = ( sbpp + 7 ) / 8;    // Round to bytes
+    job.nbWidth = nbWidth;
+    job.nbTotal = nbWidth * nbHeight;
+    job.nBatchesPerRow = ( nbWidth + BC_BATCH_BLOCKS - 1 ) / BC_BATCH_BLOCKS;
+    job.firstBatch = firstBatch;
+    job.completed = 0;
+
+    nBatches = job.nBatchesPerRow * nbHeight;
+
+    return S_OK;
+}
+
+static HRESULT _CompressBC_Parallel( _Inout_updates_(njobs) BC_PARALLEL_IMAGE* jobs, _In_ size_t njobs, _In_ size_t nBatches,
+                                     _In_ DWORD bcflags, _In_ float alphaRef,
+                                     _In_ const std::function<bool( size_t, size_t, size_t )>& progress )
+{
+    assert( jobs && njobs > 0 );
 
     // Determine BC format encoder
     BC_ENCODE pfEncode;
     size_t blocksize;
     DWORD cflags;
-    if ( !_DetermineEncoderSettings( result.format, pfEncode, blocksize, cflags ) )
+    if ( !_DetermineEncoderSettings( jobs[0].result->format, pfEncode, blocksize, cflags ) )
         return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
 
-    // Refactored version of loop to support parallel independance
-    const size_t nBlocks = std::max<size_t>(1, image.width / 4) * std::max<size_t>(1, image.height / 4);
-
+    // Each iteration encodes a run of up to BC_BATCH_BLOCKS blocks from the same row of blocks of one
+    // image. Encode cost varies greatly from block to block (especially for BC6H/BC7), so iterations
+    // are handed out one at a time rather than in fixed chunks per thread
     bool fail = false;
+    volatile bool cancel = false;
 
-#pragma omp parallel for
-    for( int nb=0; nb < static_cast<int>( nBlocks ); ++nb )
+#pragma omp parallel for schedule(dynamic)
+    for( int nb=0; nb < static_cast<int>( nBatches ); ++nb )
     {
-        const size_t nbWidth = std::max<size_t>(1, image.width / 4);
+        if ( cancel )
+            continue;
+
+        BC_PARALLEL_IMAGE& job = *( std::upper_bound( jobs, jobs + njobs, static_cast<size_t>( nb ),
+                                                      []( size_t n, const BC_PARALLEL_IMAGE& j ) { return n < j.firstBatch; } ) - 1 );
+
+        const Image& image = *job.image;
+        const Image& result = *job.result;
+        const DXGI_FORMAT format = image.format;
 
-        const size_t y = nb / nbWidth;
-        const size_t x = nb - (y*nbWidth);
+        const size_t b = nb - job.firstBatch;
+        const size_t y = b / job.nBatchesPerRow;
+        const size_t x = ( b - (y*job.nBatchesPerRow) ) * BC_BATCH_BLOCKS;
+        const size_t nBlocks = std::min<size_t>( BC_BATCH_BLOCKS, job.nbWidth - x );
 
-        assert( x < image.width && y < image.height );
+        assert( x < job.nbWidth && (y * job.nbWidth) < job.nbTotal );
 
         size_t rowPitch = image.rowPitch;
-        const uint8_t *pSrc = image.pixels + (y*4*rowPitch) + (x*4*sbpp);
+        const uint8_t *pSrc = image.pixels + (y*4*rowPitch) + (x*4*job.sbpp);
 
-        uint8_t *pDest = result.pixels + (nb*blocksize);
+        uint8_t *pDest = result.pixels + (y*result.rowPitch) + (x*blocksize);
 
-        XMVECTOR temp[16];
-        if ( !_LoadScanline( &temp[0], 4, pSrc, rowPitch, format ) )
-            fail = true;
+        XMVECTOR temp[NUM_PIXELS_PER_BLOCK * BC_BATCH_BLOCKS];
+        for( size_t i = 0; i < nBlocks; ++i )
+        {
+            XMVECTOR* block = &temp[ i * NUM_PIXELS_PER_BLOCK ];
+            const uint8_t *sptr = pSrc + i*4*job.sbpp;
 
-        if ( !_LoadScanline( &temp[4], 4, pSrc + rowPitch, rowPitch, format ) )
-            fail = true;
+            if ( !_LoadScanline( &block[0], 4, sptr, rowPitch, format ) )
+                fail = true;
 
-        if ( !_LoadScanline( &temp[8], 4, pSrc + rowPitch*2, rowPitch, format ) )
-            fail = true;
+            if ( !_LoadScanline( &block[4], 4, sptr + rowPitch, rowPitch, format ) )
+                fail = true;
 
-        if ( !_LoadScanline( &temp[12], 4, pSrc + rowPitch*3, rowPitch, format ) )
-            fail = true;
+            if ( !_LoadScanline( &block[8], 4, sptr + rowPitch*2, rowPitch, format ) )
+                fail = true;
 
-        _ConvertScanline( temp, 16, result.format, format, cflags );
-            
-        if ( pfEncode )
-            pfEncode( pDest, temp, bcflags );
-        else
-            D3DXEncodeBC1( pDest, temp, alphaRef, bcflags );
+            if ( !_LoadScanline( &block[12], 4, sptr + rowPitch*3, rowPitch, format ) )
+                fail = true;
+        }
+
+        _ConvertScanline( temp, nBlocks * NUM_PIXELS_PER_BLOCK, result.format, format, cflags );
+
+        _EncodeBlocks( result.format, pfEncode, blocksize, pDest, temp, nBlocks, bcflags, alphaRef );
+
+        if ( progress )
+        {
+            // Report each time another row's worth of blocks has completed
+            size_t done = static_cast<size_t>( InterlockedExchangeAdd( &job.completed, static_cast<LONG>( nBlocks ) ) );
+            size_t now = done + nBlocks;
+
+            if ( ( done / job.nbWidth ) != ( now / job.nbWidth ) || now == job.nbTotal )
+            {
+#pragma omp critical
+                {
+                    if ( !cancel && !progress( job.index, now, job.nbTotal ) )
+                        cancel = true;
+                }
+            }
+        }
     }
 
+    if ( cancel )
+        return E_ABORT;
+
     return (fail) ? E_FAIL : S_OK;
 }
 
+static HRESULT _CompressBC_Parallel( _In_ const Image& image, _In_ const Image& result, _In_ DWORD bcflags,
+                                     _In_ float alphaRef )
+{
+    BC_PARALLEL_IMAGE job;
+    size_t nBatches;
+    HRESULT hr = _SetupParallelImage( image, result, 0, 0, job, nBatches );
+    if ( FAILED(hr) )
+        return hr;
+
+    return _CompressBC_Parallel( &job, 1, nBatches, bcflags, alphaRef, nullptr );
+}
+
 #endif // _OPENMP
 
 
+//-------------------------------------------------------------------------------------
+// Fused box-filter mip-map generation and compression
+//-------------------------------------------------------------------------------------
+struct MIP_STRIP
+{
+    ScratchImage    rows;       // The current row of blocks of this level in the source format
+    const Image*    strip;
+    const Image*    dest;       // Compressed level
+    size_t          y;          // Number of rows generated so far
+};
+
+static HRESULT _CompressMipStrip( _In_ const MIP_STRIP& level, _In_ DWORD compress, _In_ float alphaRef )
+{
+    const Image& strip = *level.strip;
+    const Image& dest = *level.dest;
+
+    assert( level.y > 0 );
+    const size_t by = ( level.y - 1 ) / 4;
+
+    // Compress into the matching row of blocks of the destination level
+    Image result = dest;
+    result.height = strip.height;
+    result.pixels = dest.pixels + by * dest.rowPitch;
+    result.slicePitch = dest.rowPitch;
+
+    bool degenerate = ( dest.width < 4 ) || ( dest.height < 4 );
+
+    if ( (compress & TEX_COMPRESS_PARALLEL) && !degenerate )
+    {
+#ifdef _OPENMP
+        return _CompressBC_Parallel( strip, result, _GetBCFlags( compress ), alphaRef );
+#else
+        return E_NOTIMPL;
+#endif // _OPENMP
+    }
+    else
+    {
+        return _CompressBC( strip, result, _GetBCFlags( compress ), alphaRef, degenerate );
+    }
+}
+
+// Box filters one or two source rows into the next row of the given level, then passes the new row on
+// to the level below once it has a pair of rows, and compresses the level's strip once it is full
+static HRESULT _GenerateMipRow( _Inout_updates_(nlevels) MIP_STRIP* levels, _In_ size_t nlevels, _In_ size_t level,
+                                _In_reads_bytes_(rowPitch) const uint8_t* pRow0, _In_opt_ const uint8_t* pRow1, _In_ size_t rowPitch,
+                                _In_ DXGI_FORMAT format, _In_ size_t width, _In_ DWORD filter, _In_ DWORD compress, _In_ float alphaRef,
+                                _Inout_updates_all_(width*3) XMVECTOR* scanline )
+{
+    assert( level > 0 && level < nlevels );
+
+    MIP_STRIP& mip = levels[ level ];
+    const Image& strip = *mip.strip;
+
+    XMVECTOR* target = scanline;
+    XMVECTOR* urow0 = target + width;
+    XMVECTOR* urow1 = ( pRow1 ) ? ( target + width*2 ) : urow0;
+
+    const XMVECTOR* urow2 = ( width > 1 ) ? ( urow0 + 1 ) : urow0;
+    const XMVECTOR* urow3 = ( width > 1 ) ? ( urow1 + 1 ) : urow1;
+
+    if ( !_LoadScanlineLinear( urow0, width, pRow0, rowPitch, format, filter ) )
+        return E_FAIL;
+
+    if ( pRow1 )
+    {
+        if ( !_LoadScanlineLinear( urow1, width, pRow1, rowPitch, format, filter ) )
+            return E_FAIL;
+    }
+
+    size_t nwidth = (width > 1) ? (width >> 1) : 1;
+
+    for( size_t x = 0; x < nwidth; ++x )
+    {
+        size_t x2 = x << 1;
+
+        AVERAGE4( target[ x ], urow0[ x2 ], urow1[ x2 ], urow2[ x2 ], urow3[ x2 ] );
+    }
+
+    const size_t y = mip.y++;
+    uint8_t* pDest = strip.pixels + ( y % strip.height ) * strip.rowPitch;
+
+    if ( !_StoreScanlineLinear( pDest, strip.rowPitch, format, target, nwidth, filter ) )
+        return E_FAIL;
+
+    // Feed the next level once a pair of rows is available (or every row once this level is a single row high)
+    if ( level + 1 < nlevels )
+    {
+        const size_t height = mip.dest->height;
+
+        if ( height <= 1 )
+        {
+            HRESULT hr = _GenerateMipRow( levels, nlevels, level + 1, pDest, nullptr, strip.rowPitch,
+                                          format, nwidth, filter, compress, alphaRef, scanline );
+            if ( FAILED(hr) )
+                return hr;
+        }
+        else if ( y & 1 )
+        {
+            HRESULT hr = _GenerateMipRow( levels, nlevels, level + 1, pDest - strip.rowPitch, pDest, strip.rowPitch,
+                                          format, nwidth, filter, compress, alphaRef, scanline );
+            if ( FAILED(hr) )
+                return hr;
+        }
+    }
+
+    if ( ( ( y + 1 ) % strip.height ) == 0 )
+    {
+        return _CompressMipStrip( mip, compress, alphaRef );
+    }
+
+    return S_OK;
+}
+
+
+
 //-------------------------------------------------------------------------------------
 static DXGI_FORMAT _DefaultDecompress( _In_ DXGI_FORMAT format )
 {
@@ -376,45 +623,87 @@ static HRESULT _DecompressBC( _In_ const Image& cImage, _In_ const Image& result
         return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
     }
 
-    XMVECTOR temp[16];
+    // Decoders that write the destination format directly skip the XMVECTOR conversion
+    BC_DECODE_PACKED pfDecodePacked = nullptr;
+    switch( format )
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        if ( IsSRGB( format ) == IsSRGB( cformat ) )
+        {
+            switch( cformat )
+            {
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecodePacked = D3DXDecodeBC1RGBA8; break;
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecodePacked = D3DXDecodeBC2RGBA8; break;
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecodePacked = D3DXDecodeBC3RGBA8; break;
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:    pfDecodePacked = D3DXDecodeBC7RGBA8; break;
+            }
+        }
+        break;
+
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        if ( cformat == DXGI_FORMAT_BC6H_UF16 )
+            pfDecodePacked = D3DXDecodeBC6HURGBA16F;
+        else if ( cformat == DXGI_FORMAT_BC6H_SF16 )
+            pfDecodePacked = D3DXDecodeBC6HSRGBA16F;
+        break;
+    }
+
     const uint8_t *pSrc = cImage.pixels;
     const size_t rowPitch = result.rowPitch;
-    for( size_t h=0; h < cImage.height; h += 4 )
+    const size_t nBlockRows = ( height + 3 ) / 4;
+    bool fail = false;
+
+    // Each row of blocks writes its own four rows of the result
+#ifdef _OPENMP
+    #pragma omp parallel for if ( _CountBlocks( cImage ) >= BC_DECODE_PARALLEL_BLOCKS )
+#endif
+    for( int row = 0; row < static_cast<int>( nBlockRows ); ++row )
     {
-        const uint8_t *sptr = pSrc;
-        uint8_t* dptr = pDest;
-        for( size_t count = 0; count < cImage.rowPitch; count += sbpp )
+        const uint8_t *sptr = pSrc + size_t(row) * cImage.rowPitch;
+        uint8_t *dptr = pDest + size_t(row) * rowPitch * 4;
+        const size_t nrows = std::min<size_t>( 4, height - size_t(row) * 4 );
+
+        if ( pfDecodePacked )
         {
-            pfDecode( temp, sptr );
-            _ConvertScanline( temp, 16, format, cformat, 0 );
+            uint8_t block[ NUM_PIXELS_PER_BLOCK * 8 ];
+            for( size_t x = 0; x < width; x += 4 )
+            {
+                pfDecodePacked( block, sptr );
 
-            if ( !_StoreScanline( dptr, rowPitch, format, &temp[0], 4 ) )
-                return E_FAIL;
+                const size_t nbytes = std::min<size_t>( 4, width - x ) * dbpp;
+                for( size_t y = 0; y < nrows; ++y )
+                {
+                    memcpy( dptr + y * rowPitch + x * dbpp, block + y * 4 * dbpp, nbytes );
+                }
 
-            if ( result.height > 1 )
+                sptr += sbpp;
+            }
+        }
+        else
+        {
+            XMVECTOR temp[16];
+            for( size_t x = 0; x < width; x += 4 )
             {
-                if ( !_StoreScanline( dptr + rowPitch, rowPitch, format, &temp[4], 4 ) )
-                    return E_FAIL;
+                pfDecode( temp, sptr );
+                _ConvertScanline( temp, 16, format, cformat, 0 );
 
-                if ( result.height > 2 )
+                for( size_t y = 0; y < nrows; ++y )
                 {
-                    if ( !_StoreScanline( dptr + rowPitch*2, rowPitch, format, &temp[8], 4 ) )
-                        return E_FAIL;
-
-                    if ( !_StoreScanline( dptr + rowPitch*3, rowPitch, format, &temp[12], 4 ) )
-                        return E_FAIL;
+                    if ( !_StoreScanline( dptr + y * rowPitch + x * dbpp, rowPitch - x * dbpp, format, &temp[y * 4], 4 ) )
+                        fail = true;
                 }
-            }
 
-            sptr += sbpp;
-            dptr += dbpp*4;
+                sptr += sbpp;
+            }
         }
-
-        pSrc += cImage.rowPitch;
-        pDest += rowPitch*4;
     }
 
-    return S_OK;
+    return fail ? E_FAIL : S_OK;
 }
 
 
@@ -497,6 +786,154 @@ bool _IsAlphaAllOpaqueBC( _In_ const Image& cImage )
 }
 
 
+//-------------------------------------------------------------------------------------
+// Compresses an image supplied one row of blocks at a time directly to a DDS file
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT _CompressStrips( const TexMetadata& metadata, DXGI_FORMAT format, DWORD compress, float alphaRef,
+                         LPCWSTR szFile, STRIP_READER readStrip )
+{
+    if ( !szFile || !readStrip )
+        return E_INVALIDARG;
+
+    if ( IsCompressed(metadata.format) || !IsCompressed(format) || IsTypeless(format) )
+        return E_INVALIDARG;
+
+    // Image size must be a multiple of 4 (degenerate cases are allowed)
+    bool degenerate = false;
+
+    size_t width = metadata.width;
+    if ( (width % 4) != 0 )
+    {
+        if ( width != 1 && width != 2 )
+            return E_INVALIDARG;
+
+        degenerate = true;
+    }
+
+    size_t height = metadata.height;
+    if ( (height % 4) != 0 )
+    {
+        if ( height != 1 && height != 2 )
+            return E_INVALIDARG;
+
+        degenerate = true;
+    }
+
+#ifndef _OPENMP
+    if ( (compress & TEX_COMPRESS_PARALLEL) && !degenerate )
+        return E_NOTIMPL;
+#endif
+
+    // Only one row of blocks of source and compressed data is resident at a time
+    const size_t stripHeight = std::min<size_t>( 4, height );
+
+    ScratchImage source;
+    HRESULT hr = source.Initialize2D( metadata.format, width, stripHeight, 1, 1 );
+    if ( FAILED(hr) )
+        return hr;
+
+    ScratchImage blocks;
+    hr = blocks.Initialize2D( format, width, stripHeight, 1, 1 );
+    if ( FAILED(hr) )
+        return hr;
+
+    const Image* strip = source.GetImage( 0, 0, 0 );
+    const Image* cstrip = blocks.GetImage( 0, 0, 0 );
+    if ( !strip || !cstrip )
+        return E_POINTER;
+
+    // Create DDS Header
+    TexMetadata mdata;
+    memset( &mdata, 0, sizeof(mdata) );
+    mdata.width = width;
+    mdata.height = height;
+    mdata.depth = mdata.arraySize = mdata.mipLevels = 1;
+    mdata.format = format;
+    mdata.dimension = TEX_DIMENSION_TEXTURE2D;
+
+    const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+    uint8_t header[MAX_HEADER_SIZE];
+    size_t required;
+    hr = _EncodeDDSHeader( mdata, DDS_FLAGS_NONE, header, MAX_HEADER_SIZE, required );
+    if ( FAILED(hr) )
+        return hr;
+
+    // Create file and write header
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile( safe_handle( CreateFile2( szFile, GENERIC_WRITE, 0, CREATE_ALWAYS, 0 ) ) );
+#else
+    ScopedHandle hFile( safe_handle( CreateFileW( szFile, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0 ) ) );
+#endif
+    if ( !hFile )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    // Compress and write each row of blocks.  Once the file exists, a failure
+    // deletes it rather than leave a partly written DDS behind.
+    auto writeStrips = [&]() -> HRESULT
+    {
+        DWORD bytesWritten;
+        if ( !WriteFile( hFile.get(), header, static_cast<DWORD>( required ), &bytesWritten, 0 ) )
+        {
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+
+        if ( bytesWritten != required )
+        {
+            return E_FAIL;
+        }
+
+        const DWORD bcflags = _GetBCFlags( compress );
+
+        for( size_t y = 0; y < height; y += stripHeight )
+        {
+            hr = readStrip( y, *strip );
+            if ( FAILED(hr) )
+                return hr;
+
+            if ( (compress & TEX_COMPRESS_PARALLEL) && !degenerate )
+            {
+#ifdef _OPENMP
+                hr = _CompressBC_Parallel( *strip, *cstrip, bcflags, alphaRef );
+#endif // _OPENMP
+            }
+            else
+            {
+                hr = _CompressBC( *strip, *cstrip, bcflags, alphaRef, degenerate );
+            }
+
+            if ( FAILED(hr) )
+                return hr;
+
+            size_t pixsize = cstrip->slicePitch;
+
+            if ( !WriteFile( hFile.get(), cstrip->pixels, static_cast<DWORD>( pixsize ), &bytesWritten, 0 ) )
+            {
+                return HRESULT_FROM_WIN32( GetLastError() );
+            }
+
+            if ( bytesWritten != pixsize )
+            {
+                return E_FAIL;
+            }
+        }
+
+        return S_OK;
+    };
+
+    hr = writeStrips();
+    if ( FAILED(hr) )
+    {
+        hFile.reset();
+        DeleteFileW( szFile );
+    }
+
+    return hr;
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -505,7 +942,8 @@ bool _IsAlphaAllOpaqueBC( _In_ const Image& cImage )
 // Compression
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
-HRESULT Compress( const Image& srcImage, DXGI_FORMAT format, DWORD compress, float alphaRef, ScratchImage& image )
+HRESULT Compress( const Image& srcImage, DXGI_FORMAT format, DWORD compress, float alphaRef, ScratchImage& image,
+                  std::function<bool( size_t, size_t, size_t )> progress )
 {
     if ( IsCompressed(srcImage.format) || !IsCompressed(format) || IsTypeless(format) )
         return E_INVALIDARG;
@@ -549,12 +987,25 @@ HRESULT Compress( const Image& srcImage, DXGI_FORMAT format, DWORD compress, flo
 #ifndef _OPENMP
         return E_NOTIMPL;
 #else
-        hr = _CompressBC_Parallel( srcImage, *img, _GetBCFlags( compress ), alphaRef );
+        BC_PARALLEL_IMAGE job;
+        size_t nBatches;
+        hr = _SetupParallelImage( srcImage, *img, 0, 0, job, nBatches );
+        if ( SUCCEEDED(hr) )
+        {
+            hr = _CompressBC_Parallel( &job, 1, nBatches, _GetBCFlags( compress ), alphaRef, progress );
+        }
 #endif // _OPENMP
     }
     else
     {
         hr = _CompressBC( srcImage, *img, _GetBCFlags( compress ), alphaRef, degenerate );
+
+        if ( SUCCEEDED(hr) && progress )
+        {
+            size_t nbTotal = _CountBlocks( srcImage );
+            if ( !progress( 0, nbTotal, nbTotal ) )
+                hr = E_ABORT;
+        }
     }
 
     if ( FAILED(hr) )
@@ -565,7 +1016,8 @@ HRESULT Compress( const Image& srcImage, DXGI_FORMAT format, DWORD compress, flo
 
 _Use_decl_annotations_
 HRESULT Compress( const Image* srcImages, size_t nimages, const TexMetadata& metadata,
-                  DXGI_FORMAT format, DWORD compress, float alphaRef, ScratchImage& cImages )
+                  DXGI_FORMAT format, DWORD compress, float alphaRef, ScratchImage& cImages,
+                  std::function<bool( size_t, size_t, size_t )> progress )
 {
     if ( !srcImages || !nimages )
         return E_INVALIDARG;
@@ -609,6 +1061,22 @@ HRESULT Compress( const Image* srcImages, size_t nimages, const TexMetadata& met
         return E_POINTER;
     }
 
+#ifdef _OPENMP
+    // With multithreading, every block of every full-size image goes into one work list
+    std::unique_ptr<BC_PARALLEL_IMAGE[]> jobs;
+    size_t njobs = 0;
+    size_t nBatches = 0;
+    if ( compress & TEX_COMPRESS_PARALLEL )
+    {
+        jobs.reset( new (std::nothrow) BC_PARALLEL_IMAGE[ nimages ] );
+        if ( !jobs )
+        {
+            cImages.Release();
+            return E_OUTOFMEMORY;
+        }
+    }
+#endif // _OPENMP
+
     for( size_t index=0; index < nimages; ++index )
     {
         assert( dest[ index ].format == format );
@@ -630,15 +1098,16 @@ HRESULT Compress( const Image* srcImages, size_t nimages, const TexMetadata& met
 #ifndef _OPENMP
             return E_NOTIMPL;
 #else
-            if ( compress & TEX_COMPRESS_PARALLEL )
+            size_t count;
+            hr = _SetupParallelImage( src, dest[ index ], index, nBatches, jobs[ njobs ], count );
+            if ( FAILED(hr) )
             {
-                hr = _CompressBC_Parallel( src, dest[ index ], _GetBCFlags( compress ), alphaRef );
-                if ( FAILED(hr) )
-                {
-                    cImages.Release();
-                    return  hr;
-                }
+                cImages.Release();
+                return hr;
             }
+
+            ++njobs;
+            nBatches += count;
 #endif // _OPENMP
         }
         else
@@ -649,7 +1118,152 @@ HRESULT Compress( const Image* srcImages, size_t nimages, const TexMetadata& met
                 cImages.Release();
                 return hr;
             }
+
+            if ( progress )
+            {
+                size_t nbTotal = _CountBlocks( src );
+                if ( !progress( index, nbTotal, nbTotal ) )
+                {
+                    cImages.Release();
+                    return E_ABORT;
+                }
+            }
+        }
+    }
+
+#ifdef _OPENMP
+    if ( njobs > 0 )
+    {
+        hr = _CompressBC_Parallel( jobs.get(), njobs, nBatches, _GetBCFlags( compress ), alphaRef, progress );
+        if ( FAILED(hr) )
+        {
+            cImages.Release();
+            return hr;
+        }
+    }
+#endif // _OPENMP
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Fused mip-map generation and compression
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT GenerateCompressedMipMaps( const Image& baseImage, DWORD filter, size_t levels,
+                                   DXGI_FORMAT format, DWORD compress, float alphaRef, ScratchImage& cImages )
+{
+    if ( !IsValid( baseImage.format ) || !IsCompressed(format) || IsTypeless(format) )
+        return E_INVALIDARG;
+
+    if ( !baseImage.pixels )
+        return E_POINTER;
+
+    if ( IsCompressed( baseImage.format ) || IsVideo( baseImage.format ) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    // Only the box filter can be computed a pair of rows at a time, which requires power-of-2 dimensions
+    DWORD filter_select = ( filter & TEX_FILTER_MASK );
+    if ( filter_select && filter_select != TEX_FILTER_BOX )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    size_t width = baseImage.width;
+    size_t height = baseImage.height;
+
+    if ( ( width & ( width - 1 ) ) || ( height & ( height - 1 ) ) )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    HRESULT hr = cImages.Initialize2D( format, width, height, 1, levels );
+    if ( FAILED(hr) )
+        return hr;
+
+    levels = cImages.GetMetadata().mipLevels;
+
+    // Compress the base level directly from the source image
+    const Image* dest = cImages.GetImage( 0, 0, 0 );
+    if ( !dest )
+    {
+        cImages.Release();
+        return E_POINTER;
+    }
+
+    bool degenerate = ( width < 4 ) || ( height < 4 );
+
+    if ( (compress & TEX_COMPRESS_PARALLEL) && !degenerate )
+    {
+#ifndef _OPENMP
+        hr = E_NOTIMPL;
+#else
+        hr = _CompressBC_Parallel( baseImage, *dest, _GetBCFlags( compress ), alphaRef );
+#endif // _OPENMP
+    }
+    else
+    {
+        hr = _CompressBC( baseImage, *dest, _GetBCFlags( compress ), alphaRef, degenerate );
+    }
+
+    if ( FAILED(hr) || levels <= 1 )
+    {
+        if ( FAILED(hr) )
+            cImages.Release();
+        return hr;
+    }
+
+    // Each lower level only keeps one row of blocks in the source format
+    std::unique_ptr<MIP_STRIP[]> strips( new (std::nothrow) MIP_STRIP[ levels ] );
+    if ( !strips )
+    {
+        cImages.Release();
+        return E_OUTOFMEMORY;
+    }
+
+    for( size_t level = 1; level < levels; ++level )
+    {
+        MIP_STRIP& mip = strips[ level ];
+
+        mip.dest = cImages.GetImage( level, 0, 0 );
+        if ( !mip.dest )
+        {
+            cImages.Release();
+            return E_POINTER;
+        }
+
+        hr = mip.rows.Initialize2D( baseImage.format, mip.dest->width, std::min<size_t>( mip.dest->height, 4 ), 1, 1 );
+        if ( FAILED(hr) )
+        {
+            cImages.Release();
+            return hr;
         }
+
+        mip.strip = mip.rows.GetImage( 0, 0, 0 );
+        mip.y = 0;
+    }
+
+    // Allocate temporary space (3 scanlines)
+    ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*3), 16 ) ) );
+    if ( !scanline )
+    {
+        cImages.Release();
+        return E_OUTOFMEMORY;
+    }
+
+    const uint8_t* pSrc = baseImage.pixels;
+    size_t rowPitch = baseImage.rowPitch;
+
+    for( size_t y = 0; y < height; y += 2 )
+    {
+        const uint8_t* pRow1 = ( height > 1 ) ? ( pSrc + rowPitch ) : nullptr;
+
+        hr = _GenerateMipRow( strips.get(), levels, 1, pSrc, pRow1, rowPitch,
+                              baseImage.format, width, filter, compress, alphaRef, scanline.get() );
+        if ( FAILED(hr) )
+        {
+            cImages.Release();
+            return hr;
+        }
+
+        pSrc += rowPitch * 2;
     }
 
     return S_OK;
@@ -15,6 +15,11 @@
 
 #include "directxtexp.h"
 
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
 using namespace DirectX::PackedVector;
 
 #if DIRECTX_MATH_VERSION < 306
@@ -493,6 +498,178 @@ bool _ExpandScanline( LPVOID pDestination, size_t outSize, DXGI_FORMAT outFormat
 }
 
 
+//-------------------------------------------------------------------------------------
+// Vectorized scanline kernels for the most common formats
+//-------------------------------------------------------------------------------------
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+
+// F16C needs both CPU support and OS support for saving the AVX register state
+static bool _IsF16CSupported()
+{
+    int CPUInfo[4] = {-1};
+    __cpuid( CPUInfo, 0 );
+    if ( CPUInfo[0] < 1 )
+        return false;
+
+    __cpuid( CPUInfo, 1 );
+
+    // OSXSAVE (bit 27), AVX (bit 28), F16C (bit 29)
+    if ( (CPUInfo[2] & 0x38000000) != 0x38000000 )
+        return false;
+
+    return ( _xgetbv( 0 ) & 0x6 ) == 0x6;
+}
+
+static const bool s_F16C = _IsF16CSupported();
+
+// Converts the 4 RGBA8 pixels in v (one per 32-bit lane) to float with the given swizzle/opaque fix-ups
+#define UBYTEN4_TO_VECTOR( res, v, bgr, opaque )\
+        {\
+            res = XMVectorMultiply( _mm_cvtepi32_ps( v ), s_Scale );\
+            if ( bgr ) res = XM_PERMUTE_PS( res, _MM_SHUFFLE(3,0,1,2) );\
+            if ( opaque ) res = XMVectorSelect( g_XMIdentityR3, res, g_XMSelect1110 );\
+        }
+
+static void _LoadUByteN4( _Out_writes_(count) XMVECTOR* pDestination, _In_reads_(count) const uint32_t* pSource, _In_ size_t count,
+                          _In_ bool bgr, _In_ bool opaque )
+{
+    static const XMVECTORF32 s_Scale = { 1.f/255.f, 1.f/255.f, 1.f/255.f, 1.f/255.f };
+
+    const __m128i zero = _mm_setzero_si128();
+
+    XMVECTOR* __restrict dPtr = pDestination;
+
+    size_t i = 0;
+    for( ; i + 4 <= count; i += 4, dPtr += 4 )
+    {
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + i ) );
+        __m128i lo = _mm_unpacklo_epi8( v, zero );
+        __m128i hi = _mm_unpackhi_epi8( v, zero );
+
+        UBYTEN4_TO_VECTOR( dPtr[0], _mm_unpacklo_epi16( lo, zero ), bgr, opaque );
+        UBYTEN4_TO_VECTOR( dPtr[1], _mm_unpackhi_epi16( lo, zero ), bgr, opaque );
+        UBYTEN4_TO_VECTOR( dPtr[2], _mm_unpacklo_epi16( hi, zero ), bgr, opaque );
+        UBYTEN4_TO_VECTOR( dPtr[3], _mm_unpackhi_epi16( hi, zero ), bgr, opaque );
+    }
+
+    for( ; i < count; ++i, ++dPtr )
+    {
+        __m128i v = _mm_cvtsi32_si128( static_cast<int>( pSource[ i ] ) );
+        v = _mm_unpacklo_epi16( _mm_unpacklo_epi8( v, zero ), zero );
+
+        UBYTEN4_TO_VECTOR( *dPtr, v, bgr, opaque );
+    }
+}
+
+#undef UBYTEN4_TO_VECTOR
+
+// Saturates, scales, and rounds one pixel to integers in 0..255
+#define VECTOR_TO_UBYTE4( res, v, bgr, opaque )\
+        {\
+            XMVECTOR t = v;\
+            if ( bgr ) t = XM_PERMUTE_PS( t, _MM_SHUFFLE(3,0,1,2) );\
+            if ( opaque ) t = XMVectorSelect( g_XMIdentityR3, t, g_XMSelect1110 );\
+            t = _mm_min_ps( _mm_max_ps( t, g_XMZero ), g_XMOne );\
+            res = _mm_cvtps_epi32( XMVectorMultiply( t, s_Scale ) );\
+        }
+
+static void _StoreUByteN4( _Out_writes_(count) uint32_t* pDestination, _In_reads_(count) const XMVECTOR* pSource, _In_ size_t count,
+                           _In_ bool bgr, _In_ bool opaque )
+{
+    static const XMVECTORF32 s_Scale = { 255.f, 255.f, 255.f, 255.f };
+
+    const XMVECTOR* __restrict sPtr = pSource;
+
+    size_t i = 0;
+    for( ; i + 4 <= count; i += 4, sPtr += 4 )
+    {
+        __m128i v0, v1, v2, v3;
+        VECTOR_TO_UBYTE4( v0, sPtr[0], bgr, opaque );
+        VECTOR_TO_UBYTE4( v1, sPtr[1], bgr, opaque );
+        VECTOR_TO_UBYTE4( v2, sPtr[2], bgr, opaque );
+        VECTOR_TO_UBYTE4( v3, sPtr[3], bgr, opaque );
+
+        __m128i v = _mm_packus_epi16( _mm_packs_epi32( v0, v1 ), _mm_packs_epi32( v2, v3 ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( pDestination + i ), v );
+    }
+
+    for( ; i < count; ++i, ++sPtr )
+    {
+        __m128i v;
+        VECTOR_TO_UBYTE4( v, *sPtr, bgr, opaque );
+
+        v = _mm_packs_epi32( v, v );
+        pDestination[ i ] = static_cast<uint32_t>( _mm_cvtsi128_si32( _mm_packus_epi16( v, v ) ) );
+    }
+}
+
+#undef VECTOR_TO_UBYTE4
+
+static void _LoadUDecN4( _Out_writes_(count) XMVECTOR* pDestination, _In_reads_(count) const uint32_t* pSource, _In_ size_t count )
+{
+    static const XMVECTORI32 s_MaskRGB = { 0x3FF, 0x3FF << 10, 0x3FF << 20, 0 };
+    static const XMVECTORI32 s_MaskA = { 0, 0, 0, -1 };
+    static const XMVECTORF32 s_Scale = { 1.f/1023.f, 1.f/(1023.f*1024.f), 1.f/(1023.f*1024.f*1024.f), 1.f/3.f };
+
+    XMVECTOR* __restrict dPtr = pDestination;
+
+    for( size_t i = 0; i < count; ++i, ++dPtr )
+    {
+        __m128i v = _mm_set1_epi32( static_cast<int>( pSource[ i ] ) );
+
+        // RGB are masked in place and the scale undoes their shift; the 2-bit alpha is shifted down so it can't go negative
+        v = _mm_or_si128( _mm_and_si128( v, s_MaskRGB ), _mm_and_si128( _mm_srli_epi32( v, 30 ), s_MaskA ) );
+
+        *dPtr = XMVectorMultiply( _mm_cvtepi32_ps( v ), s_Scale );
+    }
+}
+
+static void _StoreUDecN4( _Out_writes_(count) uint32_t* pDestination, _In_reads_(count) const XMVECTOR* pSource, _In_ size_t count )
+{
+    static const XMVECTORF32 s_Scale = { 1023.f, 1023.f, 1023.f, 3.f };
+
+    const XMVECTOR* __restrict sPtr = pSource;
+
+    for( size_t i = 0; i < count; ++i, ++sPtr )
+    {
+        XMVECTOR t = _mm_min_ps( _mm_max_ps( *sPtr, g_XMZero ), g_XMOne );
+        __m128i v = _mm_cvtps_epi32( XMVectorMultiply( t, s_Scale ) );
+
+        // Lane 0 becomes R | G << 10 and lane 2 becomes B | A << 10, then lane 2 is merged in above bit 20
+        v = _mm_or_si128( v, _mm_srli_epi64( v, 22 ) );
+        v = _mm_or_si128( v, _mm_slli_epi32( _mm_srli_si128( v, 8 ), 20 ) );
+
+        pDestination[ i ] = static_cast<uint32_t>( _mm_cvtsi128_si32( v ) );
+    }
+}
+
+static void _LoadHalf4_F16C( _Out_writes_(count) XMVECTOR* pDestination, _In_reads_(count) const XMHALF4* pSource, _In_ size_t count )
+{
+    assert( s_F16C );
+
+    XMVECTOR* __restrict dPtr = pDestination;
+
+    for( size_t i = 0; i < count; ++i, ++dPtr )
+    {
+        *dPtr = _mm_cvtph_ps( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pSource + i ) ) );
+    }
+}
+
+static void _StoreHalf4_F16C( _Out_writes_(count) XMHALF4* pDestination, _In_reads_(count) const XMVECTOR* pSource, _In_ size_t count )
+{
+    assert( s_F16C );
+
+    const XMVECTOR* __restrict sPtr = pSource;
+
+    for( size_t i = 0; i < count; ++i, ++sPtr )
+    {
+        _mm_storel_epi64( reinterpret_cast<__m128i*>( pDestination + i ), _mm_cvtps_ph( *sPtr, 0 /* round to nearest even */ ) );
+    }
+}
+
+#endif // _XM_SSE_INTRINSICS_
+
+
 //-------------------------------------------------------------------------------------
 // Loads an image row into standard RGBA XMVECTOR (aligned) array
 //-------------------------------------------------------------------------------------
@@ -576,6 +753,17 @@ bool _LoadScanline( XMVECTOR* pDestination, size_t count,
         LOAD_SCANLINE3( XMINT3, XMLoadSInt3, g_XMIdentityR3 )
 
     case DXGI_FORMAT_R16G16B16A16_FLOAT:
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        if ( s_F16C )
+        {
+            if ( size >= sizeof(XMHALF4) )
+            {
+                _LoadHalf4_F16C( dPtr, reinterpret_cast<const XMHALF4*>(pSource), std::min<size_t>( count, size / sizeof(XMHALF4) ) );
+                return true;
+            }
+            return false;
+        }
+#endif
         LOAD_SCANLINE( XMHALF4, XMLoadHalf4 )
 
     case DXGI_FORMAT_R16G16B16A16_UNORM:
@@ -653,7 +841,16 @@ bool _LoadScanline( XMVECTOR* pDestination, size_t count,
         return false;
 
     case DXGI_FORMAT_R10G10B10A2_UNORM:
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        if ( size >= sizeof(XMUDECN4) )
+        {
+            _LoadUDecN4( dPtr, reinterpret_cast<const uint32_t*>(pSource), std::min<size_t>( count, size / sizeof(XMUDECN4) ) );
+            return true;
+        }
+        return false;
+#else
         LOAD_SCANLINE( XMUDECN4, XMLoadUDecN4 );
+#endif
 
     case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
 #if DIRECTX_MATH_VERSION >= 306
@@ -694,7 +891,16 @@ bool _LoadScanline( XMVECTOR* pDestination, size_t count,
 
     case DXGI_FORMAT_R8G8B8A8_UNORM:
     case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        if ( size >= sizeof(XMUBYTEN4) )
+        {
+            _LoadUByteN4( dPtr, reinterpret_cast<const uint32_t*>(pSource), std::min<size_t>( count, size / sizeof(XMUBYTEN4) ), false, false );
+            return true;
+        }
+        return false;
+#else
         LOAD_SCANLINE( XMUBYTEN4, XMLoadUByteN4 )
+#endif
 
     case DXGI_FORMAT_R8G8B8A8_UINT:
         LOAD_SCANLINE( XMUBYTE4, XMLoadUByte4 )
@@ -1071,6 +1277,9 @@ bool _LoadScanline( XMVECTOR* pDestination, size_t count,
     case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
         if ( size >= sizeof(XMUBYTEN4) )
         {
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+            _LoadUByteN4( dPtr, reinterpret_cast<const uint32_t*>(pSource), std::min<size_t>( count, size / sizeof(XMUBYTEN4) ), true, false );
+#else
             const XMUBYTEN4 * __restrict sPtr = reinterpret_cast<const XMUBYTEN4*>(pSource);
             for( size_t icount = 0; icount < ( size - sizeof(XMUBYTEN4) + 1 ); icount += sizeof(XMUBYTEN4) )
             {
@@ -1078,6 +1287,7 @@ bool _LoadScanline( XMVECTOR* pDestination, size_t count,
                 if ( dPtr >= ePtr ) break;
                 *(dPtr++) = XMVectorSwizzle<2, 1, 0, 3>( v );
             }
+#endif
             return true;
         }
         return false;
@@ -1086,6 +1296,9 @@ bool _LoadScanline( XMVECTOR* pDestination, size_t count,
     case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
         if ( size >= sizeof(XMUBYTEN4) )
         {
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+            _LoadUByteN4( dPtr, reinterpret_cast<const uint32_t*>(pSource), std::min<size_t>( count, size / sizeof(XMUBYTEN4) ), true, true );
+#else
             const XMUBYTEN4 * __restrict sPtr = reinterpret_cast<const XMUBYTEN4*>(pSource);
             for( size_t icount = 0; icount < ( size - sizeof(XMUBYTEN4) + 1 ); icount += sizeof(XMUBYTEN4) )
             {
@@ -1094,6 +1307,7 @@ bool _LoadScanline( XMVECTOR* pDestination, size_t count,
                 if ( dPtr >= ePtr ) break;
                 *(dPtr++) = XMVectorSelect( g_XMIdentityR3, v, g_XMSelect1110 );
             }
+#endif
             return true;
         }
         return false;
@@ -1159,7 +1373,13 @@ bool _StoreScanline( LPVOID pDestination, size_t size, DXGI_FORMAT format,
     switch( format )
     {
     case DXGI_FORMAT_R32G32B32A32_FLOAT:
-        STORE_SCANLINE( XMFLOAT4, XMStoreFloat4 )
+        if ( size >= sizeof(XMFLOAT4) )
+        {
+            size_t msize = (size > (sizeof(XMVECTOR)*count)) ? (sizeof(XMVECTOR)*count) : size;
+            memcpy_s( pDestination, size, sPtr, msize );
+            return true;
+        }
+        return false;
 
     case DXGI_FORMAT_R32G32B32A32_UINT:
         STORE_SCANLINE( XMUINT4, XMStoreUInt4 )
@@ -1177,6 +1397,17 @@ bool _StoreScanline( LPVOID pDestination, size_t size, DXGI_FORMAT format,
         STORE_SCANLINE( XMINT3, XMStoreSInt3 )
 
     case DXGI_FORMAT_R16G16B16A16_FLOAT:
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        if ( s_F16C )
+        {
+            if ( size >= sizeof(XMHALF4) )
+            {
+                _StoreHalf4_F16C( reinterpret_cast<XMHALF4*>(pDestination), sPtr, std::min<size_t>( count, size / sizeof(XMHALF4) ) );
+                return true;
+            }
+            return false;
+        }
+#endif
         STORE_SCANLINE( XMHALF4, XMStoreHalf4 )
 
     case DXGI_FORMAT_R16G16B16A16_UNORM:
@@ -1223,7 +1454,16 @@ bool _StoreScanline( LPVOID pDestination, size_t size, DXGI_FORMAT format,
         return false;
 
     case DXGI_FORMAT_R10G10B10A2_UNORM:
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        if ( size >= sizeof(XMUDECN4) )
+        {
+            _StoreUDecN4( reinterpret_cast<uint32_t*>(pDestination), sPtr, std::min<size_t>( count, size / sizeof(XMUDECN4) ) );
+            return true;
+        }
+        return false;
+#else
         STORE_SCANLINE( XMUDECN4, XMStoreUDecN4 );
+#endif
 
     case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
 #if DIRECTX_MATH_VERSION >= 306
@@ -1265,7 +1505,16 @@ bool _StoreScanline( LPVOID pDestination, size_t size, DXGI_FORMAT format,
 
     case DXGI_FORMAT_R8G8B8A8_UNORM:
     case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+        if ( size >= sizeof(XMUBYTEN4) )
+        {
+            _StoreUByteN4( reinterpret_cast<uint32_t*>(pDestination), sPtr, std::min<size_t>( count, size / sizeof(XMUBYTEN4) ), false, false );
+            return true;
+        }
+        return false;
+#else
         STORE_SCANLINE( XMUBYTEN4, XMStoreUByteN4 )
+#endif
 
     case DXGI_FORMAT_R8G8B8A8_UINT:
         STORE_SCANLINE( XMUBYTE4, XMStoreUByte4 )
@@ -1654,6 +1903,9 @@ bool _StoreScanline( LPVOID pDestination, size_t size, DXGI_FORMAT format,
     case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
         if ( size >= sizeof(XMUBYTEN4) )
         {
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+            _StoreUByteN4( reinterpret_cast<uint32_t*>(pDestination), sPtr, std::min<size_t>( count, size / sizeof(XMUBYTEN4) ), true, false );
+#else
             XMUBYTEN4 * __restrict dPtr = reinterpret_cast<XMUBYTEN4*>(pDestination);
             for( size_t icount = 0; icount < ( size - sizeof(XMUBYTEN4) + 1 ); icount += sizeof(XMUBYTEN4) )
             {
@@ -1661,6 +1913,7 @@ bool _StoreScanline( LPVOID pDestination, size_t size, DXGI_FORMAT format,
                 XMVECTOR v = XMVectorSwizzle<2, 1, 0, 3>( *sPtr++ );
                 XMStoreUByteN4( dPtr++, v );
             }
+#endif
             return true;
         }
         return false;
@@ -1669,6 +1922,9 @@ bool _StoreScanline( LPVOID pDestination, size_t size, DXGI_FORMAT format,
     case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
         if ( size >= sizeof(XMUBYTEN4) )
         {
+#if defined(_XM_SSE_INTRINSICS_) && !defined(_XM_NO_INTRINSICS_)
+            _StoreUByteN4( reinterpret_cast<uint32_t*>(pDestination), sPtr, std::min<size_t>( count, size / sizeof(XMUBYTEN4) ), true, true );
+#else
             XMUBYTEN4 * __restrict dPtr = reinterpret_cast<XMUBYTEN4*>(pDestination);
             for( size_t icount = 0; icount < ( size - sizeof(XMUBYTEN4) + 1 ); icount += sizeof(XMUBYTEN4) )
             {
@@ -1676,6 +1932,7 @@ bool _StoreScanline( LPVOID pDestination, size_t size, DXGI_FORMAT format,
                 XMVECTOR v = XMVectorPermute<2, 1, 0, 7>( *sPtr++, g_XMIdentityR3 );
                 XMStoreUByteN4( dPtr++, v );
             }
+#endif
             return true;
         }
         return false;
@@ -1983,6 +2240,35 @@ static inline XMVECTOR XMColorSRGBToRGB( FXMVECTOR srgb )
 }
 #endif
 
+// 8-bit sRGB values only have 256 possible linear results, so they are computed once rather than per pixel
+static const struct SRGBToLinearTable
+{
+    float values[256];
+
+    SRGBToLinearTable()
+    {
+        for( size_t i = 0; i < 256; ++i )
+        {
+            values[ i ] = XMVectorGetX( XMColorSRGBToRGB( XMVectorReplicate( float(i) / 255.f ) ) );
+        }
+    }
+} s_sRGBToLinear;
+
+static void _LoadUByteN4SRGB( _Out_writes_(count) XMVECTOR* pDestination, _In_reads_(count) const uint8_t* pSource, _In_ size_t count,
+                              _In_ bool bgr, _In_ bool opaque )
+{
+    const float* table = s_sRGBToLinear.values;
+
+    const size_t ir = ( bgr ) ? 2 : 0;
+    const size_t ib = ( bgr ) ? 0 : 2;
+
+    for( size_t i = 0; i < count; ++i, pSource += 4 )
+    {
+        pDestination[ i ] = XMVectorSet( table[ pSource[ ir ] ], table[ pSource[ 1 ] ], table[ pSource[ ib ] ],
+                                         ( opaque ) ? 1.f : float( pSource[ 3 ] ) / 255.f );
+    }
+}
+
 _Use_decl_annotations_
 bool _LoadScanlineLinear( XMVECTOR* pDestination, size_t count,
                           LPCVOID pSource, size_t size, DXGI_FORMAT format, DWORD flags )
@@ -2030,6 +2316,32 @@ bool _LoadScanlineLinear( XMVECTOR* pDestination, size_t count,
         break;
     }
 
+    if ( flags & TEX_FILTER_SRGB_IN )
+    {
+        // 8-bit sRGB input is converted with a table lookup
+        switch( format )
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            if ( size >= sizeof(uint32_t) )
+            {
+                bool bgr = ( format != DXGI_FORMAT_R8G8B8A8_UNORM && format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB );
+                bool opaque = ( format == DXGI_FORMAT_B8G8R8X8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB );
+                _LoadUByteN4SRGB( pDestination, reinterpret_cast<const uint8_t*>(pSource), std::min<size_t>( count, size / sizeof(uint32_t) ),
+                                  bgr, opaque );
+                return true;
+            }
+            return false;
+
+        default:
+            break;
+        }
+    }
+
     if ( _LoadScanline( pDestination, count, pSource, size, format ) )
     {
         // sRGB input processing (sRGB -> Linear RGB)
@@ -1012,6 +1012,62 @@ static bool _LegacyExpandScanline( _Out_writes_bytes_(outSize) LPVOID pDestinati
 }
 
 
+//-------------------------------------------------------------------------------------
+// Returns the CP_FLAGS_*BPP override for the source data of a legacy expansion format
+//-------------------------------------------------------------------------------------
+static DWORD _GetLegacyPitchFlags( _In_ DWORD convFlags )
+{
+    if ( convFlags & CONV_FLAGS_EXPAND )
+    {
+        if ( convFlags & CONV_FLAGS_888 )
+            return CP_FLAGS_24BPP;
+        else if ( convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444 | CONV_FLAGS_8332 | CONV_FLAGS_A8P8 | CONV_FLAGS_L16 | CONV_FLAGS_A8L8) )
+            return CP_FLAGS_16BPP;
+        else if ( convFlags & (CONV_FLAGS_44 | CONV_FLAGS_332 | CONV_FLAGS_PAL8 | CONV_FLAGS_L8) )
+            return CP_FLAGS_8BPP;
+    }
+
+    return CP_FLAGS_NONE;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Converts or copies a single row of uncompressed image data
+//-------------------------------------------------------------------------------------
+static bool _CopyImageScanline( _Out_writes_bytes_(outSize) LPVOID pDestination, _In_ size_t outSize,
+                                _In_reads_bytes_(inSize) LPCVOID pSource, _In_ size_t inSize,
+                                _In_ DXGI_FORMAT format, _In_ DWORD convFlags, _In_reads_opt_(256) const uint32_t *pal8, _In_ DWORD tflags )
+{
+    if ( convFlags & CONV_FLAGS_EXPAND )
+    {
+        if ( convFlags & (CONV_FLAGS_565|CONV_FLAGS_5551|CONV_FLAGS_4444) )
+        {
+            return _ExpandScanline( pDestination, outSize, DXGI_FORMAT_R8G8B8A8_UNORM,
+                                    pSource, inSize,
+                                    (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
+                                    tflags );
+        }
+        else
+        {
+            TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat( convFlags );
+            return _LegacyExpandScanline( pDestination, outSize, format,
+                                          pSource, inSize, lformat, pal8,
+                                          tflags );
+        }
+    }
+    else if ( convFlags & CONV_FLAGS_SWIZZLE )
+    {
+        _SwizzleScanline( pDestination, outSize, pSource, inSize, format, tflags );
+    }
+    else
+    {
+        _CopyScanline( pDestination, outSize, pSource, inSize, format, tflags );
+    }
+
+    return true;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Converts or copies image data from pPixels into scratch image data
 //-------------------------------------------------------------------------------------
@@ -1024,15 +1080,7 @@ static HRESULT _CopyImage( _In_reads_bytes_(size) const void* pPixels, _In_ size
     if ( !size )
         return E_FAIL;
      
-    if ( convFlags & CONV_FLAGS_EXPAND )
-    {
-        if ( convFlags & CONV_FLAGS_888 )
-            cpFlags |= CP_FLAGS_24BPP;
-        else if ( convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444 | CONV_FLAGS_8332 | CONV_FLAGS_A8P8 | CONV_FLAGS_L16 | CONV_FLAGS_A8L8) )
-            cpFlags |= CP_FLAGS_16BPP;
-        else if ( convFlags & (CONV_FLAGS_44 | CONV_FLAGS_332 | CONV_FLAGS_PAL8 | CONV_FLAGS_L8) )
-            cpFlags |= CP_FLAGS_8BPP;
-    }
+    cpFlags |= _GetLegacyPitchFlags( convFlags );
 
     size_t pixelSize, nimages;
     _DetermineImageArray( metadata, cpFlags, nimages, pixelSize );
@@ -1105,35 +1153,8 @@ static HRESULT _CopyImage( _In_reads_bytes_(size) const void* pPixels, _In_ size
                     {
                         for( size_t h = 0; h < images[ index ].height; ++h )
                         {
-                            if ( convFlags & CONV_FLAGS_EXPAND )
-                            {
-                                if ( convFlags & (CONV_FLAGS_565|CONV_FLAGS_5551|CONV_FLAGS_4444) )
-                                {
-                                    if ( !_ExpandScanline( pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                                           pSrc, spitch,
-                                                           (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                                           tflags ) )
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat( convFlags );
-                                    if ( !_LegacyExpandScanline( pDest, dpitch, metadata.format,
-                                                                 pSrc, spitch, lformat, pal8,
-                                                                 tflags ) )
-                                        return E_FAIL;
-                                }
-                            }
-                            else if ( convFlags & CONV_FLAGS_SWIZZLE )
-                            {
-                                _SwizzleScanline( pDest, dpitch, pSrc, spitch,
-                                                  metadata.format, tflags );
-                            }
-                            else
-                            {
-                                _CopyScanline( pDest, dpitch, pSrc, spitch,
-                                               metadata.format, tflags );
-                            }
+                            if ( !_CopyImageScanline( pDest, dpitch, pSrc, spitch, metadata.format, convFlags, pal8, tflags ) )
+                                return E_FAIL;
 
                             pSrc += spitch;
                             pDest += dpitch;
@@ -1179,33 +1200,8 @@ static HRESULT _CopyImage( _In_reads_bytes_(size) const void* pPixels, _In_ size
                     {
                         for( size_t h = 0; h < images[ index ].height; ++h )
                         {
-                            if ( convFlags & CONV_FLAGS_EXPAND )
-                            {
-                                if ( convFlags & (CONV_FLAGS_565|CONV_FLAGS_5551|CONV_FLAGS_4444) )
-                                {
-                                    if ( !_ExpandScanline( pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                                           pSrc, spitch,
-                                                           (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                                           tflags ) )
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    TEXP_LEGACY_FORMAT lformat = _FindLegacyFormat( convFlags );
-                                    if ( !_LegacyExpandScanline( pDest, dpitch, metadata.format,
-                                                                 pSrc, spitch, lformat, pal8,
-                                                                 tflags ) )
-                                        return E_FAIL;
-                                }
-                            }
-                            else if ( convFlags & CONV_FLAGS_SWIZZLE )
-                            {
-                                _SwizzleScanline( pDest, dpitch, pSrc, spitch, metadata.format, tflags );
-                            }
-                            else
-                            {
-                                _CopyScanline( pDest, dpitch, pSrc, spitch, metadata.format, tflags );
-                            }
+                            if ( !_CopyImageScanline( pDest, dpitch, pSrc, spitch, metadata.format, convFlags, pal8, tflags ) )
+                                return E_FAIL;
 
                             pSrc += spitch;
                             pDest += dpitch;
@@ -1576,6 +1572,417 @@ HRESULT LoadFromDDSFile( LPCWSTR szFile, DWORD flags, TexMetadata* metadata, Scr
 }
 
 
+//-------------------------------------------------------------------------------------
+// Map a DDS file from disk into a read-only view
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT TexView::InitializeFromDDSFile( LPCWSTR szFile, DWORD flags )
+{
+    if ( !szFile )
+        return E_INVALIDARG;
+
+    Release();
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile( safe_handle( CreateFile2( szFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, 0 ) ) );
+#else
+    ScopedHandle hFile( safe_handle( CreateFileW( szFile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                                                  FILE_FLAG_RANDOM_ACCESS, 0 ) ) );
+#endif
+    if ( !hFile )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    // Get the file size
+    LARGE_INTEGER fileSize = {0};
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_VISTA)
+    FILE_STANDARD_INFO fileInfo;
+    if ( !GetFileInformationByHandleEx( hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo) ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+    fileSize = fileInfo.EndOfFile;
+#else
+    if ( !GetFileSizeEx( hFile.get(), &fileSize ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+#endif
+
+    // The whole file is mapped, so it must fit in the address space (only an issue for 32-bit)
+    if ( static_cast<uint64_t>( fileSize.QuadPart ) > SIZE_MAX )
+    {
+        return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+    }
+
+    // Need at least enough data to fill the standard header and magic number to be a valid DDS
+    size_t size = static_cast<size_t>( fileSize.QuadPart );
+    if ( size < ( sizeof(DDS_HEADER) + sizeof(uint32_t) ) )
+    {
+        return E_FAIL;
+    }
+
+    // Mapping the file only reserves address space; pages are read in as images are touched
+    ScopedHandle hMapping( CreateFileMappingW( hFile.get(), 0, PAGE_READONLY, 0, 0, 0 ) );
+    if ( !hMapping )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    auto pView = reinterpret_cast<uint8_t*>( MapViewOfFile( hMapping.get(), FILE_MAP_READ, 0, 0, 0 ) );
+    if ( !pView )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    _hFile = hFile.release();
+    _hMapping = hMapping.release();
+    _view = pView;
+
+    HRESULT hr = _DecodeDDSHeader( pView, size, flags, _metadata, _convFlags );
+    if ( FAILED(hr) )
+    {
+        Release();
+        return hr;
+    }
+
+    size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    if ( _convFlags & CONV_FLAGS_DX10 )
+        offset += sizeof(DDS_HEADER_DXT10);
+
+    assert( offset <= size );
+
+    if ( _convFlags & CONV_FLAGS_PAL8 )
+    {
+        _pal8 = reinterpret_cast<const uint32_t*>( pView + offset );
+        offset += ( 256 * sizeof(uint32_t) );
+        if ( size < offset )
+        {
+            Release();
+            return E_FAIL;
+        }
+    }
+
+    // Lay out the images as stored in the file
+    DWORD cpFlags = ( flags & DDS_FLAGS_LEGACY_DWORD ) ? CP_FLAGS_LEGACY_DWORD : CP_FLAGS_NONE;
+    cpFlags |= _GetLegacyPitchFlags( _convFlags );
+
+    size_t pixelSize, nimages;
+    _DetermineImageArray( _metadata, cpFlags, nimages, pixelSize );
+    if ( !nimages || pixelSize > ( size - offset ) )
+    {
+        Release();
+        return E_FAIL;
+    }
+
+    _source = new (std::nothrow) Image[ nimages ];
+    if ( !_source )
+    {
+        Release();
+        return E_OUTOFMEMORY;
+    }
+    _nimages = nimages;
+
+    if ( !_SetupImageArray( pView + offset, size - offset, _metadata, cpFlags, _source, nimages ) )
+    {
+        Release();
+        return E_FAIL;
+    }
+
+    if ( !( flags & DDS_FLAGS_LEGACY_DWORD ) && !( _convFlags & (CONV_FLAGS_EXPAND|CONV_FLAGS_SWIZZLE|CONV_FLAGS_NOALPHA) ) )
+    {
+        // Images can be used in place
+        _image = _source;
+        _source = nullptr;
+    }
+    else
+    {
+        // Images are converted on first access
+        _image = new (std::nothrow) Image[ nimages ];
+        if ( !_image )
+        {
+            Release();
+            return E_OUTOFMEMORY;
+        }
+
+        for( size_t index = 0; index < nimages; ++index )
+        {
+            Image& img = _image[ index ];
+            img.width = _source[ index ].width;
+            img.height = _source[ index ].height;
+            img.format = _metadata.format;
+            ComputePitch( img.format, img.width, img.height, img.rowPitch, img.slicePitch, CP_FLAGS_NONE );
+            img.pixels = nullptr;
+        }
+    }
+
+    return S_OK;
+}
+
+void TexView::Release()
+{
+    if ( _source )
+    {
+        // Only the converted images own their pixels
+        for( size_t index = 0; index < _nimages; ++index )
+        {
+            if ( _image && _image[ index ].pixels )
+                _aligned_free( _image[ index ].pixels );
+        }
+
+        delete [] _source;
+        _source = 0;
+    }
+
+    if ( _image )
+    {
+        delete [] _image;
+        _image = 0;
+    }
+
+    _nimages = 0;
+    _convFlags = 0;
+    _pal8 = 0;
+
+    if ( _view )
+    {
+        UnmapViewOfFile( _view );
+        _view = 0;
+    }
+
+    if ( _hMapping )
+    {
+        CloseHandle( _hMapping );
+        _hMapping = 0;
+    }
+
+    if ( _hFile )
+    {
+        CloseHandle( _hFile );
+        _hFile = 0;
+    }
+
+    memset(&_metadata, 0, sizeof(_metadata));
+}
+
+_Use_decl_annotations_
+const Image* TexView::GetImage( size_t mip, size_t item, size_t slice )
+{
+    if ( !_image )
+        return nullptr;
+
+    size_t index = _metadata.ComputeIndex( mip, item, slice );
+    if ( index >= _nimages )
+        return nullptr;
+
+    Image& img = _image[ index ];
+    if ( img.pixels || !_source )
+        return &img;
+
+    // Convert the legacy image data on first access
+    const Image& src = _source[ index ];
+
+    auto pDest = reinterpret_cast<uint8_t*>( _aligned_malloc( img.slicePitch, 16 ) );
+    if ( !pDest )
+        return nullptr;
+
+    if ( IsCompressed( _metadata.format ) )
+    {
+        size_t csize = std::min<size_t>( img.slicePitch, src.slicePitch );
+        memcpy_s( pDest, img.slicePitch, src.pixels, csize );
+    }
+    else
+    {
+        DWORD tflags = (_convFlags & CONV_FLAGS_NOALPHA) ? TEXP_SCANLINE_SETALPHA : 0;
+        if ( _convFlags & CONV_FLAGS_SWIZZLE )
+            tflags |= TEXP_SCANLINE_LEGACY;
+
+        const uint8_t* pSrc = src.pixels;
+        uint8_t* pRow = pDest;
+
+        for( size_t h = 0; h < img.height; ++h )
+        {
+            if ( !_CopyImageScanline( pRow, img.rowPitch, pSrc, src.rowPitch, _metadata.format, _convFlags, _pal8, tflags ) )
+            {
+                _aligned_free( pDest );
+                return nullptr;
+            }
+
+            pSrc += src.rowPitch;
+            pRow += img.rowPitch;
+        }
+    }
+
+    img.pixels = pDest;
+    return &img;
+}
+
+bool TexView::IsZeroCopy() const
+{
+    return ( _image && !_source );
+}
+
+
+//-------------------------------------------------------------------------------------
+// Compress a DDS file from disk to disk without loading the whole image
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CompressDDSFile( LPCWSTR szSrcFile, DWORD flags, LPCWSTR szDestFile, DXGI_FORMAT format, DWORD compress, float alphaRef )
+{
+    if ( !szSrcFile || !szDestFile )
+        return E_INVALIDARG;
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile( safe_handle ( CreateFile2( szSrcFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, 0 ) ) );
+#else
+    ScopedHandle hFile( safe_handle ( CreateFileW( szSrcFile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                                                   FILE_FLAG_SEQUENTIAL_SCAN, 0 ) ) );
+#endif
+
+    if ( !hFile )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    // Get the file size
+    LARGE_INTEGER fileSize = {0};
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_VISTA)
+    FILE_STANDARD_INFO fileInfo;
+    if ( !GetFileInformationByHandleEx( hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo) ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+    fileSize = fileInfo.EndOfFile;
+#else
+    if ( !GetFileSizeEx( hFile.get(), &fileSize ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+#endif
+
+    // Need at least enough data to fill the standard header and magic number to be a valid DDS
+    if ( fileSize.QuadPart < static_cast<LONGLONG>( sizeof(DDS_HEADER) + sizeof(uint32_t) ) )
+    {
+        return E_FAIL;
+    }
+
+    // Read the header in (including extended header if present)
+    const size_t MAX_HEADER_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+    uint8_t header[MAX_HEADER_SIZE];
+
+    DWORD bytesRead = 0;
+    if ( !ReadFile( hFile.get(), header, MAX_HEADER_SIZE, &bytesRead, 0 ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    DWORD convFlags = 0;
+    TexMetadata mdata;
+    HRESULT hr = _DecodeDDSHeader( header, bytesRead, flags, mdata, convFlags );
+    if ( FAILED(hr) )
+        return hr;
+
+    if ( IsCompressed( mdata.format ) )
+        return E_INVALIDARG;
+
+    uint64_t offset = ( convFlags & CONV_FLAGS_DX10 ) ? MAX_HEADER_SIZE : ( sizeof(uint32_t) + sizeof(DDS_HEADER) );
+
+    std::unique_ptr<uint32_t[]> pal8;
+    if ( convFlags & CONV_FLAGS_PAL8 )
+    {
+        pal8.reset( new (std::nothrow) uint32_t[256] );
+        if ( !pal8 )
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        LARGE_INTEGER filePos;
+        filePos.QuadPart = static_cast<LONGLONG>( offset );
+        if ( !SetFilePointerEx( hFile.get(), filePos, 0, FILE_BEGIN ) )
+        {
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+
+        if ( !ReadFile( hFile.get(), pal8.get(), 256 * sizeof(uint32_t), &bytesRead, 0 ) )
+        {
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+
+        if ( bytesRead != (256 * sizeof(uint32_t)) )
+        {
+            return E_FAIL;
+        }
+
+        offset += ( 256 * sizeof(uint32_t) );
+    }
+
+    // Only the first image (mip 0 of item 0, or slice 0 of a volume) is compressed
+    DWORD cpFlags = ( flags & DDS_FLAGS_LEGACY_DWORD ) ? CP_FLAGS_LEGACY_DWORD : CP_FLAGS_NONE;
+    cpFlags |= _GetLegacyPitchFlags( convFlags );
+
+    size_t spitch, sslice;
+    ComputePitch( mdata.format, mdata.width, mdata.height, spitch, sslice, cpFlags );
+
+    if ( static_cast<uint64_t>( fileSize.QuadPart ) < offset + uint64_t( spitch ) * mdata.height )
+    {
+        return E_FAIL;
+    }
+
+    mdata.depth = mdata.arraySize = mdata.mipLevels = 1;
+    mdata.miscFlags = 0;
+    mdata.dimension = TEX_DIMENSION_TEXTURE2D;
+
+    std::unique_ptr<uint8_t[]> temp( new (std::nothrow) uint8_t[ spitch * std::min<size_t>( 4, mdata.height ) ] );
+    if ( !temp )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    DWORD tflags = (convFlags & CONV_FLAGS_NOALPHA) ? TEXP_SCANLINE_SETALPHA : 0;
+    if ( convFlags & CONV_FLAGS_SWIZZLE )
+        tflags |= TEXP_SCANLINE_LEGACY;
+
+    return _CompressStrips( mdata, format, compress, alphaRef, szDestFile,
+        [&]( size_t y, const Image& strip ) -> HRESULT
+        {
+            LARGE_INTEGER filePos;
+            filePos.QuadPart = static_cast<LONGLONG>( offset + uint64_t( spitch ) * y );
+            if ( !SetFilePointerEx( hFile.get(), filePos, 0, FILE_BEGIN ) )
+            {
+                return HRESULT_FROM_WIN32( GetLastError() );
+            }
+
+            DWORD bytesToRead = static_cast<DWORD>( spitch * strip.height );
+            DWORD bytesRead;
+            if ( !ReadFile( hFile.get(), temp.get(), bytesToRead, &bytesRead, 0 ) )
+            {
+                return HRESULT_FROM_WIN32( GetLastError() );
+            }
+
+            if ( bytesRead != bytesToRead )
+            {
+                return E_FAIL;
+            }
+
+            const uint8_t *pSrc = temp.get();
+            uint8_t *pDest = strip.pixels;
+            for( size_t h = 0; h < strip.height; ++h )
+            {
+                if ( !_CopyImageScanline( pDest, strip.rowPitch, pSrc, spitch, strip.format, convFlags, pal8.get(), tflags ) )
+                    return E_FAIL;
+
+                pSrc += spitch;
+                pDest += strip.rowPitch;
+            }
+
+            return S_OK;
+        } );
+}
+
+
 //-------------------------------------------------------------------------------------
 // Save a DDS file to memory
 //-------------------------------------------------------------------------------------
@@ -15,6 +15,11 @@
 
 #include "directxtexp.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 6993)
+#endif
+
 #include "filters.h"
 
 namespace DirectX
@@ -427,6 +432,58 @@ static bool _UseWICFiltering( _In_ DXGI_FORMAT format, _In_ DWORD filter )
 }
 
 
+//--- Resizes the base image to one mip level using WIC ---
+static HRESULT _ResizeMipLevelUsingWIC( _In_ IWICImagingFactory* pWIC, _In_ IWICBitmap* source, _In_ const WICPixelFormatGUID& pfGUID,
+                                        _In_ DWORD filter, _In_ BOOL supportsTransparency, _In_opt_ const Image* img )
+{
+    if ( !img )
+        return E_POINTER;
+
+    if ( (filter & TEX_FILTER_SEPARATE_ALPHA) && supportsTransparency )
+        return _ResizeSeparateColorAndAlpha( pWIC, source, img->width, img->height, filter, img );
+
+    ScopedObject<IWICBitmapScaler> scaler;
+    HRESULT hr = pWIC->CreateBitmapScaler( &scaler );
+    if ( FAILED(hr) )
+        return hr;
+
+    hr = scaler->Initialize( source, static_cast<UINT>( img->width ), static_cast<UINT>( img->height ), _GetWICInterp( filter ) );
+    if ( FAILED(hr) )
+        return hr;
+
+    WICPixelFormatGUID pfScaler;
+    hr = scaler->GetPixelFormat( &pfScaler );
+    if ( FAILED(hr) )
+        return hr;
+
+    if ( memcmp( &pfScaler, &pfGUID, sizeof(WICPixelFormatGUID) ) == 0 )
+    {
+        hr = scaler->CopyPixels( 0, static_cast<UINT>( img->rowPitch ), static_cast<UINT>( img->slicePitch ), img->pixels );
+        if ( FAILED(hr) )
+            return hr;
+    }
+    else
+    {
+        // The WIC bitmap scaler is free to return a different pixel format than the source image, so here we
+        // convert it back
+        ScopedObject<IWICFormatConverter> FC;
+        hr = pWIC->CreateFormatConverter( &FC );
+        if ( FAILED(hr) )
+            return hr;
+
+        hr = FC->Initialize( scaler.Get(), pfGUID, _GetWICDither( filter ), 0, 0, WICBitmapPaletteTypeCustom );
+        if ( FAILED(hr) )
+            return hr;
+
+        hr = FC->CopyPixels( 0, static_cast<UINT>( img->rowPitch ), static_cast<UINT>( img->slicePitch ), img->pixels );  
+        if ( FAILED(hr) )
+            return hr;
+    }
+
+    return S_OK;
+}
+
+
 //--- mipmap (1D/2D) generation using WIC image scalar ---
 static HRESULT _GenerateMipMapsUsingWIC( _In_ const Image& baseImage, _In_ DWORD filter, _In_ size_t levels,
                                          _In_ const WICPixelFormatGUID& pfGUID, _In_ const ScratchImage& mipChain, _In_ size_t item )
@@ -443,13 +500,6 @@ static HRESULT _GenerateMipMapsUsingWIC( _In_ const Image& baseImage, _In_ DWORD
     size_t width = baseImage.width;
     size_t height = baseImage.height;
 
-    ScopedObject<IWICBitmap> source;
-    HRESULT hr = pWIC->CreateBitmapFromMemory( static_cast<UINT>( width ), static_cast<UINT>( height ), pfGUID,
-                                               static_cast<UINT>( baseImage.rowPitch ), static_cast<UINT>( baseImage.slicePitch ),
-                                               baseImage.pixels, &source );
-    if ( FAILED(hr) )
-        return hr;
-
     // Copy base image to top miplevel
     const Image *img0 = mipChain.GetImage( 0, item, 0 );
     if ( !img0 )
@@ -469,7 +519,7 @@ static HRESULT _GenerateMipMapsUsingWIC( _In_ const Image& baseImage, _In_ DWORD
     }
 
     ScopedObject<IWICComponentInfo> componentInfo;
-    hr = pWIC->CreateComponentInfo( pfGUID, &componentInfo );
+    HRESULT hr = pWIC->CreateComponentInfo( pfGUID, &componentInfo );
     if ( FAILED(hr) )
         return hr;
 
@@ -483,67 +533,53 @@ static HRESULT _GenerateMipMapsUsingWIC( _In_ const Image& baseImage, _In_ DWORD
     if ( FAILED(hr) )
         return hr;
 
-    // Resize base image to each target mip level
-    for( size_t level = 1; level < levels; ++level )
+    // Resize base image to each target mip level. Each level is scaled from the base image on its own, so
+    // with TEX_FILTER_PARALLEL the levels are scaled on different threads, each with its own copy of the source
+#ifdef _OPENMP
+    if ( filter & TEX_FILTER_PARALLEL )
     {
-        const Image *img = mipChain.GetImage( level, item, 0 );
-        if ( !img )
-            return E_POINTER;
+        HRESULT hrLevels = S_OK;
 
-        if ( height > 1 )
-            height >>= 1;
-
-        if ( width > 1 )
-            width >>= 1;
-
-        assert( img->width == width && img->height == height && img->format == baseImage.format );
-
-        if ( (filter & TEX_FILTER_SEPARATE_ALPHA) && supportsTransparency )
-        {
-            hr = _ResizeSeparateColorAndAlpha( pWIC, source.Get(), width, height, filter, img );
-            if ( FAILED(hr) )
-                return hr;
-        }
-        else
+#pragma omp parallel
         {
-            ScopedObject<IWICBitmapScaler> scaler;
-            hr = pWIC->CreateBitmapScaler( &scaler );
-            if ( FAILED(hr) )
-                return hr;
-
-            hr = scaler->Initialize( source.Get(), static_cast<UINT>( width ), static_cast<UINT>( height ), _GetWICInterp( filter ) );
-            if ( FAILED(hr) )
-                return hr;
+            ScopedObject<IWICBitmap> threadSource;
+            HRESULT hrThread = pWIC->CreateBitmapFromMemory( static_cast<UINT>( width ), static_cast<UINT>( height ), pfGUID,
+                                                             static_cast<UINT>( baseImage.rowPitch ), static_cast<UINT>( baseImage.slicePitch ),
+                                                             baseImage.pixels, &threadSource );
 
-            WICPixelFormatGUID pfScaler;
-            hr = scaler->GetPixelFormat( &pfScaler );
-            if ( FAILED(hr) )
-                return hr;
-
-            if ( memcmp( &pfScaler, &pfGUID, sizeof(WICPixelFormatGUID) ) == 0 )
+#pragma omp for schedule(dynamic)
+            for( int level = 1; level < static_cast<int>( levels ); ++level )
             {
-                hr = scaler->CopyPixels( 0, static_cast<UINT>( img->rowPitch ), static_cast<UINT>( img->slicePitch ), img->pixels );
-                if ( FAILED(hr) )
-                    return hr;
+                if ( SUCCEEDED(hrThread) )
+                {
+                    hrThread = _ResizeMipLevelUsingWIC( pWIC, threadSource.Get(), pfGUID, filter, supportsTransparency,
+                                                        mipChain.GetImage( level, item, 0 ) );
+                }
             }
-            else
-            {
-                // The WIC bitmap scaler is free to return a different pixel format than the source image, so here we
-                // convert it back
-                ScopedObject<IWICFormatConverter> FC;
-                hr = pWIC->CreateFormatConverter( &FC );
-                if ( FAILED(hr) )
-                    return hr;
 
-                hr = FC->Initialize( scaler.Get(), pfGUID, _GetWICDither( filter ), 0, 0, WICBitmapPaletteTypeCustom );
-                if ( FAILED(hr) )
-                    return hr;
-
-                hr = FC->CopyPixels( 0, static_cast<UINT>( img->rowPitch ), static_cast<UINT>( img->slicePitch ), img->pixels );  
-                if ( FAILED(hr) )
-                    return hr;
+            if ( FAILED(hrThread) )
+            {
+#pragma omp critical
+                hrLevels = hrThread;
             }
         }
+
+        return hrLevels;
+    }
+#endif // _OPENMP
+
+    ScopedObject<IWICBitmap> source;
+    hr = pWIC->CreateBitmapFromMemory( static_cast<UINT>( width ), static_cast<UINT>( height ), pfGUID,
+                                       static_cast<UINT>( baseImage.rowPitch ), static_cast<UINT>( baseImage.slicePitch ),
+                                       baseImage.pixels, &source );
+    if ( FAILED(hr) )
+        return hr;
+
+    for( size_t level = 1; level < levels; ++level )
+    {
+        hr = _ResizeMipLevelUsingWIC( pWIC, source.Get(), pfGUID, filter, supportsTransparency, mipChain.GetImage( level, item, 0 ) );
+        if ( FAILED(hr) )
+            return hr;
     }
 
     return S_OK;
@@ -689,9 +725,457 @@ static HRESULT _Generate2DMipsPointFilter( _In_ size_t levels, _In_ const Scratc
 }
 
 
+//--- Row filters ---
+// Each produces one destination row from the source level, so rows can be filtered independently
+
+// Box filters row y of dest from rows 2y and 2y+1 of src (scanline must hold 3 rows of src)
+static bool _BoxFilterRow( _In_ const Image& src, _In_ const Image& dest, _In_ size_t y, _In_ DWORD filter,
+                           _Inout_updates_all_(src.width*3) XMVECTOR* scanline )
+{
+    size_t width = src.width;
+
+    XMVECTOR* target = scanline;
+
+    XMVECTOR* urow0 = target + width;
+    XMVECTOR* urow1 = ( src.height > 1 ) ? ( target + width*2 ) : urow0;
+
+    const XMVECTOR* urow2 = ( width > 1 ) ? ( urow0 + 1 ) : urow0;
+    const XMVECTOR* urow3 = ( width > 1 ) ? ( urow1 + 1 ) : urow1;
+
+    const uint8_t* pSrc = src.pixels + src.rowPitch * ( ( src.height > 1 ) ? ( y * 2 ) : 0 );
+
+    if ( !_LoadScanlineLinear( urow0, width, pSrc, src.rowPitch, src.format, filter ) )
+        return false;
+
+    if ( urow0 != urow1 )
+    {
+        if ( !_LoadScanlineLinear( urow1, width, pSrc + src.rowPitch, src.rowPitch, src.format, filter ) )
+            return false;
+    }
+
+    for( size_t x = 0; x < dest.width; ++x )
+    {
+        size_t x2 = x << 1;
+
+        AVERAGE4( target[ x ], urow0[ x2 ], urow1[ x2 ], urow2[ x2 ], urow3[ x2 ] );
+    }
+
+    return _StoreScanlineLinear( dest.pixels + dest.rowPitch * y, dest.rowPitch, dest.format, target, dest.width, filter );
+}
+
+// Box filters row y of dest from rows 2y and 2y+1 of two source slices (scanline must hold 5 rows of src)
+static bool _BoxFilterRow3D( _In_ const Image& srca, _In_ const Image& srcb, _In_ const Image& dest, _In_ size_t y, _In_ DWORD filter,
+                             _Inout_updates_all_(srca.width*5) XMVECTOR* scanline )
+{
+    size_t width = srca.width;
+
+    XMVECTOR* target = scanline;
+
+    XMVECTOR* urow0 = target + width;
+    XMVECTOR* urow1 = ( srca.height > 1 ) ? ( target + width*2 ) : urow0;
+    XMVECTOR* vrow0 = target + width*3;
+    XMVECTOR* vrow1 = ( srca.height > 1 ) ? ( target + width*4 ) : vrow0;
+
+    const XMVECTOR* urow2 = ( width > 1 ) ? ( urow0 + 1 ) : urow0;
+    const XMVECTOR* urow3 = ( width > 1 ) ? ( urow1 + 1 ) : urow1;
+    const XMVECTOR* vrow2 = ( width > 1 ) ? ( vrow0 + 1 ) : vrow0;
+    const XMVECTOR* vrow3 = ( width > 1 ) ? ( vrow1 + 1 ) : vrow1;
+
+    size_t sy = ( srca.height > 1 ) ? ( y * 2 ) : 0;
+    const uint8_t* pSrc1 = srca.pixels + srca.rowPitch * sy;
+    const uint8_t* pSrc2 = srcb.pixels + srcb.rowPitch * sy;
+
+    if ( !_LoadScanlineLinear( urow0, width, pSrc1, srca.rowPitch, srca.format, filter )
+         || !_LoadScanlineLinear( vrow0, width, pSrc2, srcb.rowPitch, srcb.format, filter ) )
+        return false;
+
+    if ( urow0 != urow1 )
+    {
+        if ( !_LoadScanlineLinear( urow1, width, pSrc1 + srca.rowPitch, srca.rowPitch, srca.format, filter )
+             || !_LoadScanlineLinear( vrow1, width, pSrc2 + srcb.rowPitch, srcb.rowPitch, srcb.format, filter ) )
+            return false;
+    }
+
+    for( size_t x = 0; x < dest.width; ++x )
+    {
+        size_t x2 = x << 1;
+
+        AVERAGE8( target[x], urow0[ x2 ], urow1[ x2 ], urow2[ x2 ], urow3[ x2 ],
+                             vrow0[ x2 ], vrow1[ x2 ], vrow2[ x2 ], vrow3[ x2 ] );
+    }
+
+    return _StoreScanlineLinear( dest.pixels + dest.rowPitch * y, dest.rowPitch, dest.format, target, dest.width, filter );
+}
+
+// Linear filters row y of dest using precomputed X/Y weights (scanline must hold 3 rows of src)
+static bool _LinearFilterRow( _In_ const Image& src, _In_ const Image& dest, _In_ size_t y, _In_ DWORD filter,
+                              _In_reads_(dest.width) const LinearFilter* lfX, _In_ const LinearFilter& toY,
+                              _Inout_updates_all_(src.width*3) XMVECTOR* scanline )
+{
+    size_t width = src.width;
+
+    XMVECTOR* target = scanline;
+
+    XMVECTOR* row0 = target + width;
+    XMVECTOR* row1 = target + width*2;
+
+    if ( !_LoadScanlineLinear( row0, width, src.pixels + (src.rowPitch * toY.u0), src.rowPitch, src.format, filter )
+         || !_LoadScanlineLinear( row1, width, src.pixels + (src.rowPitch * toY.u1), src.rowPitch, src.format, filter ) )
+        return false;
+
+    for( size_t x = 0; x < dest.width; ++x )
+    {
+        auto& toX = lfX[ x ];
+
+        BILINEAR_INTERPOLATE( target[x], toX, toY, row0, row1 );
+    }
+
+    return _StoreScanlineLinear( dest.pixels + dest.rowPitch * y, dest.rowPitch, dest.format, target, dest.width, filter );
+}
+
+// Linear filters row y of dest from two source slices using precomputed X/Y/Z weights (scanline must hold 5 rows of src)
+static bool _LinearFilterRow3D( _In_ const Image& srca, _In_ const Image& srcb, _In_ const Image& dest, _In_ size_t y, _In_ DWORD filter,
+                                _In_reads_(dest.width) const LinearFilter* lfX, _In_ const LinearFilter& toY, _In_ const LinearFilter& toZ,
+                                _Inout_updates_all_(srca.width*5) XMVECTOR* scanline )
+{
+    size_t width = srca.width;
+
+    XMVECTOR* target = scanline;
+
+    XMVECTOR* urow0 = target + width;
+    XMVECTOR* urow1 = target + width*2;
+    XMVECTOR* vrow0 = target + width*3;
+    XMVECTOR* vrow1 = target + width*4;
+
+    if ( !_LoadScanlineLinear( urow0, width, srca.pixels + (srca.rowPitch * toY.u0), srca.rowPitch, srca.format, filter )
+         || !_LoadScanlineLinear( vrow0, width, srcb.pixels + (srcb.rowPitch * toY.u0), srcb.rowPitch, srcb.format, filter )
+         || !_LoadScanlineLinear( urow1, width, srca.pixels + (srca.rowPitch * toY.u1), srca.rowPitch, srca.format, filter )
+         || !_LoadScanlineLinear( vrow1, width, srcb.pixels + (srcb.rowPitch * toY.u1), srcb.rowPitch, srcb.format, filter ) )
+        return false;
+
+    for( size_t x = 0; x < dest.width; ++x )
+    {
+        auto& toX = lfX[ x ];
+
+        TRILINEAR_INTERPOLATE( target[x], toX, toY, toZ, urow0, urow1, vrow0, vrow1 );
+    }
+
+    return _StoreScanlineLinear( dest.pixels + dest.rowPitch * y, dest.rowPitch, dest.format, target, dest.width, filter );
+}
+
+
+#ifdef _OPENMP
+
+//--- 2D Box Filter (parallel) ---
+// Splits the rows of the last of a group of levels into bands; each band then box filters all the levels of the
+// group in turn from just its own source rows, which are still in cache from producing the level above
+const size_t MIP_FUSED_LEVELS = 4;
+
+static HRESULT _Generate2DMipsBoxFilterParallel( _In_ size_t levels, _In_ DWORD filter, _In_ const ScratchImage& mipChain, _In_ size_t item )
+{
+    if ( !mipChain.GetImages() )
+        return E_INVALIDARG;
+
+    assert( levels > 1 );
+
+    size_t width = mipChain.GetMetadata().width;
+    size_t height = mipChain.GetMetadata().height;
+
+    if ( !ispow2(width) || !ispow2(height) )
+        return E_FAIL;
+
+    for( size_t level=1; level < levels; level += MIP_FUSED_LEVELS )
+    {
+        size_t last = std::min<size_t>( level + MIP_FUSED_LEVELS, levels ) - 1;
+
+        const Image* top = mipChain.GetImage( level-1, item, 0 );
+        const Image* bottom = mipChain.GetImage( last, item, 0 );
+        if ( !top || !bottom )
+            return E_POINTER;
+
+        const size_t nbands = bottom->height;
+        const size_t swidth = top->width;
+
+        bool fail = false;
+
+#pragma omp parallel
+        {
+            ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*swidth*3), 16 ) ) );
+            if ( !scanline )
+                fail = true;
+
+#pragma omp for
+            for( int band = 0; band < static_cast<int>( nbands ); ++band )
+            {
+                if ( !scanline )
+                    continue;
+
+                for( size_t l = level; l <= last; ++l )
+                {
+                    const Image* src = mipChain.GetImage( l-1, item, 0 );
+                    const Image* dest = mipChain.GetImage( l, item, 0 );
+
+                    // Heights are powers of 2, so each band covers the same whole number of rows at every level
+                    size_t rows = dest->height / nbands;
+
+                    for( size_t y = band * rows; y < ( band + 1 ) * rows; ++y )
+                    {
+                        if ( !_BoxFilterRow( *src, *dest, y, filter, scanline.get() ) )
+                            fail = true;
+                    }
+                }
+            }
+        }
+
+        if ( fail )
+            return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+
+//--- 2D Linear Filter (parallel) ---
+static HRESULT _Generate2DMipsLinearFilterParallel( _In_ size_t levels, _In_ DWORD filter, _In_ const ScratchImage& mipChain, _In_ size_t item )
+{
+    if ( !mipChain.GetImages() )
+        return E_INVALIDARG;
+
+    assert( levels > 1 );
+
+    size_t width = mipChain.GetMetadata().width;
+    size_t height = mipChain.GetMetadata().height;
+
+    std::unique_ptr<LinearFilter[]> lf( new (std::nothrow) LinearFilter[ width+height ] );
+    if ( !lf )
+        return E_OUTOFMEMORY;
+
+    LinearFilter* lfX = lf.get();
+    LinearFilter* lfY = lf.get() + width;
+
+    for( size_t level=1; level < levels; ++level )
+    {
+        const Image* src = mipChain.GetImage( level-1, item, 0 );
+        const Image* dest = mipChain.GetImage( level, item, 0 );
+
+        if ( !src || !dest )
+            return E_POINTER;
+
+        size_t nwidth = (width > 1) ? (width >> 1) : 1;
+        _CreateLinearFilter( width, nwidth, (filter & TEX_FILTER_WRAP_U) != 0, lfX );
+
+        size_t nheight = (height > 1) ? (height >> 1) : 1;
+        _CreateLinearFilter( height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, lfY );
+
+        bool fail = false;
+
+#pragma omp parallel
+        {
+            ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*3), 16 ) ) );
+            if ( !scanline )
+                fail = true;
+
+#pragma omp for
+            for( int y = 0; y < static_cast<int>( nheight ); ++y )
+            {
+                if ( !scanline )
+                    continue;
+
+                if ( !_LinearFilterRow( *src, *dest, y, filter, lfX, lfY[ y ], scanline.get() ) )
+                    fail = true;
+            }
+        }
+
+        if ( fail )
+            return E_FAIL;
+
+        if ( height > 1 )
+            height >>= 1;
+
+        if ( width > 1 )
+            width >>= 1;
+    }
+
+    return S_OK;
+}
+
+
+//--- 3D Box Filter (parallel) ---
+static HRESULT _Generate3DMipsBoxFilterParallel( _In_ size_t depth, _In_ size_t levels, _In_ DWORD filter, _In_ const ScratchImage& mipChain )
+{
+    if ( !depth || !mipChain.GetImages() )
+        return E_INVALIDARG;
+
+    assert( levels > 1 );
+
+    size_t width = mipChain.GetMetadata().width;
+    size_t height = mipChain.GetMetadata().height;
+
+    if ( !ispow2(width) || !ispow2(height) || !ispow2(depth) )
+        return E_FAIL;
+
+    for( size_t level=1; level < levels; ++level )
+    {
+        // Work items are the rows of every slice of the level
+        size_t ndepth = (depth > 1) ? (depth >> 1) : 1;
+        size_t nheight = (height > 1) ? (height >> 1) : 1;
+
+        bool fail = false;
+
+#pragma omp parallel
+        {
+            ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*5), 16 ) ) );
+            if ( !scanline )
+                fail = true;
+
+#pragma omp for
+            for( int i = 0; i < static_cast<int>( ndepth * nheight ); ++i )
+            {
+                if ( !scanline )
+                    continue;
+
+                size_t slice = i / nheight;
+                size_t y = i - ( slice * nheight );
+
+                const Image* dest = mipChain.GetImage( level, 0, slice );
+
+                if ( depth > 1 )
+                {
+                    size_t slicea = std::min<size_t>( slice * 2, depth-1 );
+                    size_t sliceb = std::min<size_t>( slicea + 1, depth-1 );
+
+                    const Image* srca = mipChain.GetImage( level-1, 0, slicea );
+                    const Image* srcb = mipChain.GetImage( level-1, 0, sliceb );
+
+                    if ( !srca || !srcb || !dest || !_BoxFilterRow3D( *srca, *srcb, *dest, y, filter, scanline.get() ) )
+                        fail = true;
+                }
+                else
+                {
+                    const Image* src = mipChain.GetImage( level-1, 0, 0 );
+
+                    if ( !src || !dest || !_BoxFilterRow( *src, *dest, y, filter, scanline.get() ) )
+                        fail = true;
+                }
+            }
+        }
+
+        if ( fail )
+            return E_FAIL;
+
+        if ( height > 1 )
+            height >>= 1;
+
+        if ( width > 1 )
+            width >>= 1;
+
+        if ( depth > 1 )
+            depth >>= 1;
+    }
+
+    return S_OK;
+}
+
+
+//--- 3D Linear Filter (parallel) ---
+static HRESULT _Generate3DMipsLinearFilterParallel( _In_ size_t depth, _In_ size_t levels, _In_ DWORD filter, _In_ const ScratchImage& mipChain )
+{
+    if ( !depth || !mipChain.GetImages() )
+        return E_INVALIDARG;
+
+    assert( levels > 1 );
+
+    size_t width = mipChain.GetMetadata().width;
+    size_t height = mipChain.GetMetadata().height;
+
+    std::unique_ptr<LinearFilter[]> lf( new (std::nothrow) LinearFilter[ width+height+depth ] );
+    if ( !lf )
+        return E_OUTOFMEMORY;
+
+    LinearFilter* lfX = lf.get();
+    LinearFilter* lfY = lf.get() + width;
+    LinearFilter* lfZ = lf.get() + width + height;
+
+    for( size_t level=1; level < levels; ++level )
+    {
+        size_t nwidth = (width > 1) ? (width >> 1) : 1;
+        _CreateLinearFilter( width, nwidth, (filter & TEX_FILTER_WRAP_U) != 0, lfX );
+
+        size_t nheight = (height > 1) ? (height >> 1) : 1;
+        _CreateLinearFilter( height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, lfY );
+
+        size_t ndepth = (depth > 1) ? (depth >> 1) : 1;
+        if ( depth > 1 )
+        {
+            _CreateLinearFilter( depth, ndepth, (filter & TEX_FILTER_WRAP_W) != 0, lfZ );
+        }
+
+        bool fail = false;
+
+#pragma omp parallel
+        {
+            ScopedAlignedArrayXMVECTOR scanline( reinterpret_cast<XMVECTOR*>( _aligned_malloc( (sizeof(XMVECTOR)*width*5), 16 ) ) );
+            if ( !scanline )
+                fail = true;
+
+#pragma omp for
+            for( int i = 0; i < static_cast<int>( ndepth * nheight ); ++i )
+            {
+                if ( !scanline )
+                    continue;
+
+                size_t slice = i / nheight;
+                size_t y = i - ( slice * nheight );
+
+                const Image* dest = mipChain.GetImage( level, 0, slice );
+
+                if ( depth > 1 )
+                {
+                    auto& toZ = lfZ[ slice ];
+
+                    const Image* srca = mipChain.GetImage( level-1, 0, toZ.u0 );
+                    const Image* srcb = mipChain.GetImage( level-1, 0, toZ.u1 );
+
+                    if ( !srca || !srcb || !dest || !_LinearFilterRow3D( *srca, *srcb, *dest, y, filter, lfX, lfY[ y ], toZ, scanline.get() ) )
+                        fail = true;
+                }
+                else
+                {
+                    const Image* src = mipChain.GetImage( level-1, 0, 0 );
+
+                    if ( !src || !dest || !_LinearFilterRow( *src, *dest, y, filter, lfX, lfY[ y ], scanline.get() ) )
+                        fail = true;
+                }
+            }
+        }
+
+        if ( fail )
+            return E_FAIL;
+
+        if ( height > 1 )
+            height >>= 1;
+
+        if ( width > 1 )
+            width >>= 1;
+
+        if ( depth > 1 )
+            depth >>= 1;
+    }
+
+    return S_OK;
+}
+
+#endif // _OPENMP
+
+
 //--- 2D Box Filter ---
 static HRESULT _Generate2DMipsBoxFilter( _In_ size_t levels, _In_ DWORD filter, _In_ const ScratchImage& mipChain, _In_ size_t item )
 {
+#ifdef _OPENMP
+    if ( filter & TEX_FILTER_PARALLEL )
+        return _Generate2DMipsBoxFilterParallel( levels, filter, mipChain, item );
+#endif
+
     if ( !mipChain.GetImages() )
         return E_INVALIDARG;
 
@@ -786,6 +1270,11 @@ static HRESULT _Generate2DMipsBoxFilter( _In_ size_t levels, _In_ DWORD filter,
 //--- 2D Linear Filter ---
 static HRESULT _Generate2DMipsLinearFilter( _In_ size_t levels, _In_ DWORD filter, _In_ const ScratchImage& mipChain, _In_ size_t item )
 {
+#ifdef _OPENMP
+    if ( filter & TEX_FILTER_PARALLEL )
+        return _Generate2DMipsLinearFilterParallel( levels, filter, mipChain, item );
+#endif
+
     if ( !mipChain.GetImages() )
         return E_INVALIDARG;
 
@@ -1494,6 +1983,11 @@ static HRESULT _Generate3DMipsPointFilter( _In_ size_t depth, _In_ size_t levels
 //--- 3D Box Filter ---
 static HRESULT _Generate3DMipsBoxFilter( _In_ size_t depth, _In_ size_t levels, _In_ DWORD filter, _In_ const ScratchImage& mipChain )
 {
+#ifdef _OPENMP
+    if ( filter & TEX_FILTER_PARALLEL )
+        return _Generate3DMipsBoxFilterParallel( depth, levels, filter, mipChain );
+#endif
+
     if ( !depth || !mipChain.GetImages() )
         return E_INVALIDARG;
 
@@ -1666,6 +2160,11 @@ static HRESULT _Generate3DMipsBoxFilter( _In_ size_t depth, _In_ size_t levels,
 //--- 3D Linear Filter ---
 static HRESULT _Generate3DMipsLinearFilter( _In_ size_t depth, _In_ size_t levels, _In_ DWORD filter, _In_ const ScratchImage& mipChain )
 {
+#ifdef _OPENMP
+    if ( filter & TEX_FILTER_PARALLEL )
+        return _Generate3DMipsLinearFilterParallel( depth, levels, filter, mipChain );
+#endif
+
     if ( !depth || !mipChain.GetImages() )
         return E_INVALIDARG;
 
@@ -105,6 +105,7 @@ enum CONVERSION_FLAGS
     CONV_FLAGS_INVERTX  = 0x2,      // If set, scanlines are right-to-left
     CONV_FLAGS_INVERTY  = 0x4,      // If set, scanlines are top-to-bottom
     CONV_FLAGS_RLE      = 0x8,      // Source data is RLE compressed
+    CONV_FLAGS_KEEPALPHA = 0x10,    // Alpha is in use elsewhere in the image, so never force it to opaque
 
     CONV_FLAGS_SWIZZLE  = 0x10000,  // Swizzle BGR<->RGB data
     CONV_FLAGS_888      = 0x20000,  // 24bpp format
@@ -655,7 +656,7 @@ static HRESULT _CopyPixels( _In_reads_bytes_(size) LPCVOID pSource, size_t size,
             }
 
             // If there are no non-zero alpha channel entries, we'll assume alpha is not used and force it to opaque
-            if ( !nonzeroa )
+            if ( !nonzeroa && !(convFlags & CONV_FLAGS_KEEPALPHA) )
             {
                 HRESULT hr = _SetAlphaChannelToOpaque( image );
                 if ( FAILED(hr) )
@@ -715,7 +716,7 @@ static HRESULT _CopyPixels( _In_reads_bytes_(size) LPCVOID pSource, size_t size,
             }
 
             // If there are no non-zero alpha channel entries, we'll assume alpha is not used and force it to opaque
-            if ( !nonzeroa )
+            if ( !nonzeroa && !(convFlags & CONV_FLAGS_KEEPALPHA) )
             {
                 HRESULT hr = _SetAlphaChannelToOpaque( image );
                 if ( FAILED(hr) )
@@ -1209,6 +1210,171 @@ HRESULT LoadFromTGAFile( LPCWSTR szFile, TexMetadata* metadata, ScratchImage& im
 }
 
 
+//-------------------------------------------------------------------------------------
+// Compress a TGA file from disk to disk without loading the whole image
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT CompressTGAFile( LPCWSTR szSrcFile, LPCWSTR szDestFile, DXGI_FORMAT format, DWORD compress, float alphaRef )
+{
+    if ( !szSrcFile || !szDestFile )
+        return E_INVALIDARG;
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    ScopedHandle hFile( safe_handle( CreateFile2( szSrcFile, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, 0 ) ) );
+#else
+    ScopedHandle hFile( safe_handle( CreateFileW( szSrcFile, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                                                  FILE_FLAG_SEQUENTIAL_SCAN, 0 ) ) );
+#endif
+    if ( !hFile )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    // Get the file size
+    LARGE_INTEGER fileSize = {0};
+
+#if (_WIN32_WINNT >= _WIN32_WINNT_VISTA)
+    FILE_STANDARD_INFO fileInfo;
+    if ( !GetFileInformationByHandleEx( hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo) ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+    fileSize = fileInfo.EndOfFile;
+#else
+    if ( !GetFileSizeEx( hFile.get(), &fileSize ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+#endif
+
+    // Need at least enough data to fill the header to be a valid TGA
+    if ( fileSize.QuadPart < static_cast<LONGLONG>( sizeof(TGA_HEADER) ) )
+    {
+        return E_FAIL;
+    }
+
+    // Read the header
+    uint8_t header[sizeof(TGA_HEADER)];
+    DWORD bytesRead = 0;
+    if ( !ReadFile( hFile.get(), header, sizeof(TGA_HEADER), &bytesRead, 0 ) )
+    {
+        return HRESULT_FROM_WIN32( GetLastError() );
+    }
+
+    size_t offset;
+    DWORD convFlags = 0;
+    TexMetadata mdata;
+    HRESULT hr = _DecodeTGAHeader( header, bytesRead, mdata, offset, &convFlags );
+    if ( FAILED(hr) )
+        return hr;
+
+    // RLE data can't be addressed by row, so it has to go through LoadFromTGAFile
+    if ( convFlags & CONV_FLAGS_RLE )
+        return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
+
+    // Compute TGA image data pitch
+    size_t spitch;
+    if ( convFlags & CONV_FLAGS_EXPAND )
+    {
+        spitch = mdata.width * 3;
+    }
+    else
+    {
+        size_t slicePitch;
+        ComputePitch( mdata.format, mdata.width, mdata.height, spitch, slicePitch, CP_FLAGS_NONE );
+    }
+
+    if ( static_cast<uint64_t>( fileSize.QuadPart ) < offset + uint64_t( spitch ) * mdata.height )
+    {
+        return E_FAIL;
+    }
+
+    const size_t stripHeight = std::min<size_t>( 4, mdata.height );
+
+    std::unique_ptr<uint8_t[]> temp( new (std::nothrow) uint8_t[ spitch * stripHeight ] );
+    if ( !temp )
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    // Reads 'count' rows into temp, starting at row 'row' in file order
+    auto readRows = [&]( size_t row, size_t count ) -> HRESULT
+    {
+        LARGE_INTEGER filePos;
+        filePos.QuadPart = static_cast<LONGLONG>( offset + uint64_t( spitch ) * row );
+        if ( !SetFilePointerEx( hFile.get(), filePos, 0, FILE_BEGIN ) )
+        {
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+
+        DWORD bytesToRead = static_cast<DWORD>( spitch * count );
+        DWORD bytesRead;
+        if ( !ReadFile( hFile.get(), temp.get(), bytesToRead, &bytesRead, 0 ) )
+        {
+            return HRESULT_FROM_WIN32( GetLastError() );
+        }
+
+        return ( bytesRead != bytesToRead ) ? E_FAIL : S_OK;
+    };
+
+    // Alpha is only forced to opaque if it is zero across the whole image, not just within a strip
+    if ( !(convFlags & CONV_FLAGS_EXPAND)
+         && ( mdata.format == DXGI_FORMAT_R8G8B8A8_UNORM || mdata.format == DXGI_FORMAT_B5G5R5A1_UNORM ) )
+    {
+        bool nonzeroa = false;
+        for( size_t y = 0; y < mdata.height && !nonzeroa; y += stripHeight )
+        {
+            size_t count = std::min<size_t>( stripHeight, mdata.height - y );
+
+            hr = readRows( y, count );
+            if ( FAILED(hr) )
+                return hr;
+
+            const uint8_t* endPtr = temp.get() + spitch * count;
+
+            if ( mdata.format == DXGI_FORMAT_R8G8B8A8_UNORM )
+            {
+                for( const uint8_t* sPtr = temp.get() + 3; sPtr < endPtr; sPtr += 4 )
+                {
+                    if ( *sPtr )
+                    {
+                        nonzeroa = true;
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                for( const uint8_t* sPtr = temp.get() + 1; sPtr < endPtr; sPtr += 2 )
+                {
+                    if ( *sPtr & 0x80 )
+                    {
+                        nonzeroa = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if ( nonzeroa )
+            convFlags |= CONV_FLAGS_KEEPALPHA;
+    }
+
+    return _CompressStrips( mdata, format, compress, alphaRef, szDestFile,
+        [&]( size_t y, const Image& strip ) -> HRESULT
+        {
+            // Bottom-up files hold the rows of a strip in reverse order, which _CopyPixels undoes
+            size_t row = ( convFlags & CONV_FLAGS_INVERTY ) ? y : ( mdata.height - y - strip.height );
+
+            HRESULT hr = readRows( row, strip.height );
+            if ( FAILED(hr) )
+                return hr;
+
+            return _CopyPixels( temp.get(), spitch * strip.height, &strip, convFlags );
+        } );
+}
+
+
 //-------------------------------------------------------------------------------------
 // Save a TGA file to memory
 //-------------------------------------------------------------------------------------
@@ -204,4 +204,12 @@ namespace DirectX
     HRESULT _EncodeDDSHeader( _In_ const TexMetadata& metadata, DWORD flags,
                               _Out_writes_bytes_to_opt_(maxsize, required) LPVOID pDestination, _In_ size_t maxsize, _Out_ size_t& required );
 
+    //---------------------------------------------------------------------------------
+    // Compression helper functions
+    typedef std::function<HRESULT( size_t y, const Image& strip )> STRIP_READER;
+        // Fills 'strip' with source rows y through y + strip.height - 1
+
+    HRESULT _CompressStrips( _In_ const TexMetadata& metadata, _In_ DXGI_FORMAT format, _In_ DWORD compress, _In_ float alphaRef,
+                             _In_z_ LPCWSTR szFile, _In_ STRIP_READER readStrip );
+
 }; // namespace
@@ -8,12 +8,23 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <assert.h>
+#include <math.h>
+
+#include <map>
+#include <string>
+#include <vector>
 
 #include <dxgiformat.h>
 
 #include "directxtex.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 6993)
+#endif
+
 using namespace DirectX;
 
 enum OPTIONS    // Note: dwOptions below assumes 32 or less options.
@@ -43,6 +54,12 @@ enum OPTIONS    // Note: dwOptions below assumes 32 or less options.
     OPT_TA_WRAP,
     OPT_TA_MIRROR,
     OPT_FORCE_SINGLEPROC,
+    OPT_TIMING,
+    OPT_COMPRESS_FAST,
+    OPT_COMPRESS_MAX,
+    OPT_BATCH,
+    OPT_REPORT,
+    OPT_STREAM,
 };
 
 struct SConversion
@@ -53,6 +70,49 @@ struct SConversion
     SConversion *pNext;
 };
 
+struct SSettings
+{
+    size_t width;
+    size_t height;
+    size_t mipLevels;
+    DXGI_FORMAT format;
+    DWORD dwFilter;
+    DWORD dwSRGB;
+    DWORD dwFilterOpts;
+    DWORD FileType;
+    DWORD dwOptions;
+    bool verbose;
+
+    WCHAR szPrefix[MAX_PATH];
+    WCHAR szSuffix[MAX_PATH];
+};
+
+enum JOB_STATUS
+{
+    JOB_OK = 0,
+    JOB_SKIPPED,    // Output is up to date with the source and settings
+    JOB_FAILED,     // Move on to the next file
+    JOB_ERROR,      // Stop processing the file list (batch mode reports it as failed and continues)
+};
+
+struct SJobReport
+{
+    JOB_STATUS status;
+    HRESULT hr;
+    LPCWSTR pszStage;
+    bool nonpow2;
+    uint64_t hash;
+    uint64_t bytesIn;
+
+    // Milliseconds spent in each stage
+    double msRead;
+    double msLoad;
+    double msConvert;
+    double msMips;
+    double msCompress;
+    double msSave;
+};
+
 struct SValue
 {
     LPCWSTR pName;
@@ -90,6 +150,12 @@ SValue g_pOptions[] =
     { L"wrap",          OPT_TA_WRAP },
     { L"mirror",        OPT_TA_MIRROR },
     { L"singleproc",    OPT_FORCE_SINGLEPROC },
+    { L"timing",        OPT_TIMING },
+    { L"bcquick",       OPT_COMPRESS_FAST },
+    { L"bcmax",         OPT_COMPRESS_MAX },
+    { L"batch",         OPT_BATCH },
+    { L"report",        OPT_REPORT },
+    { L"stream",        OPT_STREAM },
     { nullptr,          0             }
 };
 
@@ -184,6 +250,7 @@ SValue g_pFilters[] =
     { L"FANT",                      TEX_FILTER_FANT },
     { L"BOX",                       TEX_FILTER_BOX },
     { L"TRIANGLE",                  TEX_FILTER_TRIANGLE },
+    { L"BOX_NON_WIC",               TEX_FILTER_BOX | TEX_FILTER_FORCE_NON_WIC },
     { L"POINT_DITHER",              TEX_FILTER_POINT  | TEX_FILTER_DITHER },
     { L"LINEAR_DITHER",             TEX_FILTER_LINEAR | TEX_FILTER_DITHER },
     { L"CUBIC_DITHER",              TEX_FILTER_CUBIC  | TEX_FILTER_DITHER },
@@ -366,9 +433,20 @@ void PrintUsage()
     wprintf( L"\n                       (DDS output only)\n");
     wprintf( L"   -dx10               Force use of 'DX10' extended header\n");
     wprintf( L"\n   -nologo             suppress copyright message\n");
+    wprintf( L"   -timing             report (de)compression time, throughput, and PSNR\n");
+    wprintf( L"   -bcquick            fast BC7 compression (only best ranked partitions)\n");
+    wprintf( L"   -bcmax              exhaustive BC7 compression (all partitions)\n");
 #ifdef _OPENMP
-    wprintf( L"   -singleproc         Do not use multi-threaded compression\n");
+    wprintf( L"   -singleproc         Do not use multi-threaded compression or mipmap generation\n");
 #endif
+    wprintf( L"\n   -batch <file>       convert the jobs listed in <file>, one 'source [dest]' per line,\n");
+    wprintf( L"                       in parallel, skipping outputs that are already up to date\n");
+    wprintf( L"   -report <file>      write per-job timings (read/load/convert/mips/compress/save) as JSON\n");
+    wprintf( L"\n   -stream             compress a DDS or TGA file one row of blocks at a time, without\n");
+    wprintf( L"                       loading the whole image (BC <format>, top-level image only)\n");
+    wprintf( L"                       With -m, box filter (as BOX_NON_WIC) and compress the mips of a\n");
+    wprintf( L"                       power-of-2 2D image a row of blocks at a time instead, without\n");
+    wprintf( L"                       building the uncompressed mip chain\n");
 
     wprintf( L"\n");
     wprintf( L"   <format>: ");
@@ -385,699 +463,658 @@ void PrintUsage()
 
 
 //--------------------------------------------------------------------------------------
-// Entry-point
+// Per-file conversion
 //--------------------------------------------------------------------------------------
-#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+static LARGE_INTEGER g_qpcFreq;
 
-int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+// Returns the milliseconds since qpcMark and moves the mark to now
+double ElapsedMs( _Inout_ LARGE_INTEGER& qpcMark )
 {
-    // Parameters and defaults
-    HRESULT hr;
-    INT nReturn;
-
-    size_t width = 0;
-    size_t height = 0; 
-    size_t mipLevels = 0;
-    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-    DWORD dwFilter = TEX_FILTER_DEFAULT;
-    DWORD dwSRGB = 0;
-    DWORD dwFilterOpts = 0;
-    DWORD FileType = CODEC_DDS;
-
-    WCHAR szPrefix   [MAX_PATH];
-    WCHAR szSuffix   [MAX_PATH];
-    WCHAR szOutputDir[MAX_PATH];
-
-    szPrefix[0]    = 0;
-    szSuffix[0]    = 0;
-    szOutputDir[0] = 0;
-
-    // Initialize COM (needed for WIC)
-    if( FAILED( hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED) ) )
-    {
-        wprintf( L"Failed to initialize COM (%08X)\n", hr);
-        return 1;
-    }
-
-    // Process command line
-    DWORD dwOptions = 0;
-    SConversion *pConversion = nullptr;
-    SConversion **ppConversion = &pConversion;
-
-    for(int iArg = 1; iArg < argc; iArg++)
-    {
-        PWSTR pArg = argv[iArg];
-
-        if(('-' == pArg[0]) || ('/' == pArg[0]))
-        {
-            pArg++;
-            PWSTR pValue;
-
-            for(pValue = pArg; *pValue && (':' != *pValue); pValue++);
+    LARGE_INTEGER qpcNow;
+    QueryPerformanceCounter( &qpcNow );
 
-            if(*pValue)
-                *pValue++ = 0;
-
-            DWORD dwOption = LookupByName(pArg, g_pOptions);
+    double ms = double( qpcNow.QuadPart - qpcMark.QuadPart ) * 1000.0 / double( g_qpcFreq.QuadPart );
+    qpcMark = qpcNow;
+    return ms;
+}
 
-            if(!dwOption || (dwOptions & (1 << dwOption)))
-            {
-                PrintUsage();
-                return 1;
-            }
+double TotalMs( const SJobReport& report )
+{
+    return report.msRead + report.msLoad + report.msConvert + report.msMips + report.msCompress + report.msSave;
+}
 
-            dwOptions |= 1 << dwOption;
+void JobPrint( const SSettings& s, _In_z_ _Printf_format_string_ LPCWSTR format, ... )
+{
+    if ( !s.verbose )
+        return;
 
-            if( (OPT_NOLOGO != dwOption) && (OPT_TYPELESS_UNORM != dwOption) && (OPT_TYPELESS_FLOAT != dwOption)
-                && (OPT_SEPALPHA != dwOption) && (OPT_PREMUL_ALPHA != dwOption) && (OPT_EXPAND_LUMINANCE != dwOption)
-                && (OPT_TA_WRAP != dwOption) && (OPT_TA_MIRROR != dwOption)
-                && (OPT_FORCE_SINGLEPROC != dwOption)
-                && (OPT_SRGB != dwOption) && (OPT_SRGBI != dwOption) && (OPT_SRGBO != dwOption)
-                && (OPT_HFLIP != dwOption) && (OPT_VFLIP != dwOption)
-                && (OPT_DDS_DWORD_ALIGN != dwOption) && (OPT_USE_DX10 != dwOption) )
-            {
-                if(!*pValue)
-                {
-                    if((iArg + 1 >= argc))
-                    {
-                        PrintUsage();
-                        return 1;
-                    }
+    va_list args;
+    va_start( args, format );
+    vwprintf( format, args );
+    va_end( args );
 
-                    iArg++;
-                    pValue = argv[iArg];
-                }
-            }
+    fflush(stdout);
+}
 
-            switch(dwOption)
-            {
-            case OPT_WIDTH:
-                if (swscanf_s(pValue, L"%Iu", &width) != 1)
-                {
-                    wprintf( L"Invalid value specified with -w (%s)\n", pValue);
-                    wprintf( L"\n");
-                    PrintUsage();
-                    return 1;
-                }
-                break;
+JOB_STATUS JobFailed( SJobReport& report, LPCWSTR pszStage, HRESULT hr, JOB_STATUS status )
+{
+    report.status = status;
+    report.hr = hr;
+    report.pszStage = pszStage;
+    return status;
+}
 
-            case OPT_HEIGHT:
-                if (swscanf_s(pValue, L"%Iu", &height) != 1)
-                {
-                    wprintf( L"Invalid value specified with -h (%s)\n", pValue);
-                    printf("\n");
-                    PrintUsage();
-                    return 1;
-                }
-                break;
+JOB_STATUS JobOutOfMemory( const SSettings& s, SJobReport& report )
+{
+    JobPrint( s, L" ERROR: Memory allocation failed\n" );
+    return JobFailed( report, L"memory", E_OUTOFMEMORY, JOB_ERROR );
+}
 
-            case OPT_MIPLEVELS:
-                if (swscanf_s(pValue, L"%Iu", &mipLevels) != 1)
-                {
-                    wprintf( L"Invalid value specified with -m (%s)\n", pValue);
-                    wprintf( L"\n");
-                    PrintUsage();
-                    return 1;
-                }
-                break;
+DWORD GetDDSFlags( DWORD dwOptions )
+{
+    DWORD ddsFlags = DDS_FLAGS_NONE;
+    if ( dwOptions & (1 << OPT_DDS_DWORD_ALIGN) )
+        ddsFlags |= DDS_FLAGS_LEGACY_DWORD;
+    if ( dwOptions & (1 << OPT_EXPAND_LUMINANCE) )
+        ddsFlags |= DDS_FLAGS_EXPAND_LUMINANCE;
+    return ddsFlags;
+}
 
-            case OPT_FORMAT:
-                format = (DXGI_FORMAT) LookupByName(pValue, g_pFormats);
-                if ( !format )
-                {
-                    wprintf( L"Invalid value specified with -f (%s)\n", pValue);
-                    wprintf( L"\n");
-                    PrintUsage();
-                    return 1;
-                }
-                break;
+DWORD GetCompressFlags( DWORD dwOptions, DXGI_FORMAT format )
+{
+    DWORD cflags = TEX_COMPRESS_DEFAULT;
+    if ( dwOptions & (1 << OPT_COMPRESS_MAX) )
+        cflags |= TEX_COMPRESS_BC7_MAX;
+    else if ( dwOptions & (1 << OPT_COMPRESS_FAST) )
+        cflags |= TEX_COMPRESS_BC7_FAST;
 
-            case OPT_FILTER:
-                dwFilter = LookupByName(pValue, g_pFilters);
-                if ( !dwFilter )
-                {
-                    wprintf( L"Invalid value specified with -if (%s)\n", pValue);
-                    wprintf( L"\n");
-                    PrintUsage();
-                    return 1;
-                }
-                break;
+#ifdef _OPENMP
+    switch( format )
+    {
+    case DXGI_FORMAT_BC6H_TYPELESS:
+    case DXGI_FORMAT_BC6H_UF16:
+    case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_TYPELESS:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        if ( !(dwOptions & (1 << OPT_FORCE_SINGLEPROC) ) )
+        {
+            cflags |= TEX_COMPRESS_PARALLEL;
+        }
+        break;
+    }
+#else
+    UNREFERENCED_PARAMETER( format );
+#endif
 
-            case OPT_SRGBI:
-                dwSRGB |= TEX_FILTER_SRGB_IN;
-                break;
+    return cflags;
+}
 
-            case OPT_SRGBO:
-                dwSRGB |= TEX_FILTER_SRGB_OUT;
-                break;
+void BuildDestName( SConversion* pConv, const SSettings& s )
+{
+    // Batch manifests can name the destination explicitly
+    if ( pConv->szDest[0] )
+        return;
 
-            case OPT_SRGB:
-                dwSRGB |= TEX_FILTER_SRGB;
-                break;
+    WCHAR *pchSlash, *pchDot;
 
-            case OPT_SEPALPHA:
-                dwFilterOpts |= TEX_FILTER_SEPARATE_ALPHA;
-                break;
+    wcscpy_s(pConv->szDest, MAX_PATH, s.szPrefix);
 
-            case OPT_PREFIX:
-                wcscpy_s(szPrefix, MAX_PATH, pValue);
-                break;
+    pchSlash = wcsrchr(pConv->szSrc, L'\\');
+    if(pchSlash != 0)
+        wcscat_s(pConv->szDest, MAX_PATH, pchSlash + 1);
+    else
+        wcscat_s(pConv->szDest, MAX_PATH, pConv->szSrc);
 
-            case OPT_SUFFIX:
-                wcscpy_s(szSuffix, MAX_PATH, pValue);
-                break;
+    pchSlash = wcsrchr(pConv->szDest, '\\');
+    pchDot = wcsrchr(pConv->szDest, '.');
 
-            case OPT_OUTPUTDIR:
-                wcscpy_s(szOutputDir, MAX_PATH, pValue);
-                break;
+    if(pchDot > pchSlash)
+        *pchDot = 0;
 
-            case OPT_FILETYPE:
-                FileType = LookupByName(pValue, g_pSaveFileTypes);
-                if ( !FileType )
-                {
-                    wprintf( L"Invalid value specified with -ft (%s)\n", pValue);
-                    wprintf( L"\n");
-                    PrintUsage();
-                    return 1;
-                }
-                break;
+    wcscat_s(pConv->szDest, MAX_PATH, s.szSuffix);
+}
 
-            case OPT_TA_WRAP:
-                if ( dwFilterOpts & TEX_FILTER_MIRROR )
-                {
-                    wprintf( L"Can't use -wrap and -mirror at same time\n\n");
-                    PrintUsage();
-                    return 1;
-                }
-                dwFilterOpts |= TEX_FILTER_WRAP;
-                break;
+//--------------------------------------------------------------------------------------
+// Compresses the top-level image of a DDS or TGA file straight to a DDS file, reading
+// and writing one row of blocks at a time (-stream)
+//--------------------------------------------------------------------------------------
+JOB_STATUS StreamFile( const SConversion* pConv, const SSettings& s, SJobReport& report )
+{
+    HRESULT hr;
 
-            case OPT_TA_MIRROR:
-                if ( dwFilterOpts & TEX_FILTER_WRAP )
-                {
-                    wprintf( L"Can't use -wrap and -mirror at same time\n\n");
-                    PrintUsage();
-                    return 1;
-                }
-                dwFilterOpts |= TEX_FILTER_MIRROR;
-                break;
-            }
-        }
-        else
-        {         
-            SConversion *pConv = new SConversion;
-            if ( !pConv )
-                return 1;
+    LARGE_INTEGER qpcMark;
+    QueryPerformanceCounter( &qpcMark );
 
-            wcscpy_s(pConv->szSrc, MAX_PATH, pArg);
+    JobPrint( s, L"streaming %s to %s", pConv->szSrc, pConv->szDest );
 
-            pConv->szDest[0] = 0;
-            pConv->pNext = nullptr;
+    WCHAR ext[_MAX_EXT];
+    _wsplitpath_s( pConv->szSrc, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT );
 
-            *ppConversion = pConv;
-            ppConversion = &pConv->pNext;
-        }
-    }
+    DWORD cflags = GetCompressFlags( s.dwOptions, s.format );
 
-    if(!pConversion)
+    if ( _wcsicmp( ext, L".dds" ) == 0 )
     {
-        PrintUsage();
-        return 0;
+        hr = CompressDDSFile( pConv->szSrc, GetDDSFlags( s.dwOptions ), pConv->szDest, s.format, cflags, 0.5f );
     }
-
-    if(~dwOptions & (1 << OPT_NOLOGO))
-        PrintLogo();
-
-    // Work out out filename prefix and suffix
-    if(szOutputDir[0] && (L'\\' != szOutputDir[wcslen(szOutputDir) - 1]))
-        wcscat_s( szOutputDir, MAX_PATH, L"\\" );
-
-    if(szPrefix[0])
-        wcscat_s(szOutputDir, MAX_PATH, szPrefix);
-
-    wcscpy_s(szPrefix, MAX_PATH, szOutputDir);
-
-    const WCHAR* fileTypeName = LookupByValue(FileType, g_pSaveFileTypes);
-
-    if (fileTypeName)
+    else if ( _wcsicmp( ext, L".tga" ) == 0 )
     {
-        wcscat_s(szSuffix, MAX_PATH, L".");
-        wcscat_s(szSuffix, MAX_PATH, fileTypeName);
+        hr = CompressTGAFile( pConv->szSrc, pConv->szDest, s.format, cflags, 0.5f );
     }
     else
     {
-        wcscat_s(szSuffix, MAX_PATH, L".unknown");
+        JobPrint( s, L" FAILED (only DDS and TGA files can be streamed)\n" );
+        return JobFailed( report, L"stream", HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED ), JOB_FAILED );
     }
 
-    if (FileType != CODEC_DDS)
+    if ( FAILED(hr) )
     {
-        mipLevels = 1;
+        JobPrint( s, L" FAILED (%x)\n", hr );
+        return JobFailed( report, L"stream", hr, JOB_FAILED );
     }
 
-    // Convert images
-    bool nonpow2warn = false;
-    SConversion *pConv;
-
-    for(pConv = pConversion; pConv; pConv = pConv->pNext)
-    {
-        // Load source image
-        if(pConv != pConversion)
-            wprintf( L"\n");
+    report.msCompress = ElapsedMs( qpcMark );
 
-        wprintf( L"reading %s", pConv->szSrc );
-        fflush(stdout);
+    if ( s.dwOptions & (1 << OPT_TIMING) )
+        JobPrint( s, L" [%.1f ms]", report.msCompress );
 
-        WCHAR ext[_MAX_EXT];
-        WCHAR fname[_MAX_FNAME];
-        _wsplitpath_s( pConv->szSrc, nullptr, 0, nullptr, 0, fname, _MAX_FNAME, ext, _MAX_EXT );
+    JobPrint( s, L"\n" );
 
-        TexMetadata info;
-        ScratchImage *image = new ScratchImage;
+    return JOB_OK;
+}
 
-        if ( !image )
-        {
-            wprintf( L" ERROR: Memory allocation failed\n" );
-            goto LError;
-        }
+//--------------------------------------------------------------------------------------
+// Loads, converts, and saves a single file. If pSource is not null it holds the contents
+// of the source file, otherwise the file is read from disk.
+//--------------------------------------------------------------------------------------
+JOB_STATUS ConvertFile( const SConversion* pConv, const SSettings& s,
+                        _In_reads_bytes_opt_(cbSource) LPCVOID pSource, size_t cbSource,
+                        SJobReport& report )
+{
+    HRESULT hr;
+    const DWORD dwOptions = s.dwOptions;
 
-        if ( _wcsicmp( ext, L".dds" ) == 0 )
-        {
-            DWORD ddsFlags = DDS_FLAGS_NONE;
-            if ( dwOptions & (1 << OPT_DDS_DWORD_ALIGN) )
-                ddsFlags |= DDS_FLAGS_LEGACY_DWORD;
-            if ( dwOptions & (1 << OPT_EXPAND_LUMINANCE) )
-                ddsFlags |= DDS_FLAGS_EXPAND_LUMINANCE;
+    if ( ( dwOptions & (1 << OPT_STREAM) ) && !( dwOptions & (1 << OPT_MIPLEVELS) ) )
+        return StreamFile( pConv, s, report );
+
+    LARGE_INTEGER qpcMark;
+    QueryPerformanceCounter( &qpcMark );
+
+    // Load source image
+    JobPrint( s, L"reading %s", pConv->szSrc );
+
+    WCHAR ext[_MAX_EXT];
+    _wsplitpath_s( pConv->szSrc, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT );
 
+    TexMetadata info;
+    ScratchImage *image = new ScratchImage;
+
+    if ( !image )
+        return JobOutOfMemory( s, report );
+
+    if ( _wcsicmp( ext, L".dds" ) == 0 )
+    {
+        DWORD ddsFlags = GetDDSFlags( dwOptions );
+
+        if ( pSource )
+            hr = LoadFromDDSMemory( pSource, cbSource, ddsFlags, &info, *image );
+        else
             hr = LoadFromDDSFile( pConv->szSrc, ddsFlags, &info, *image );
-            if ( FAILED(hr) )
+        if ( FAILED(hr) )
+        {
+            JobPrint( s, L" FAILED (%x)\n", hr);
+            delete image;
+            return JobFailed( report, L"load", hr, JOB_FAILED );
+        }
+
+        if ( IsTypeless( info.format ) )
+        {
+            if ( dwOptions & (1 << OPT_TYPELESS_UNORM) )
             {
-                wprintf( L" FAILED (%x)\n", hr);
-                delete image;
-                continue;
+                info.format = MakeTypelessUNORM( info.format );
+            }
+            else if ( dwOptions & (1 << OPT_TYPELESS_FLOAT) )
+            {
+                info.format = MakeTypelessFLOAT( info.format );
             }
 
             if ( IsTypeless( info.format ) )
             {
-                if ( dwOptions & (1 << OPT_TYPELESS_UNORM) )
-                {
-                    info.format = MakeTypelessUNORM( info.format );
-                }
-                else if ( dwOptions & (1 << OPT_TYPELESS_FLOAT) )
-                {
-                    info.format = MakeTypelessFLOAT( info.format );
-                }
-
-                if ( IsTypeless( info.format ) )
-                {
-                    wprintf( L" FAILED due to Typeless format %d\n", info.format );
-                    delete image;
-                    continue;
-                }
-
-                image->OverrideFormat( info.format );
+                JobPrint( s, L" FAILED due to Typeless format %d\n", info.format );
+                delete image;
+                return JobFailed( report, L"load", HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED ), JOB_FAILED );
             }
+
+            image->OverrideFormat( info.format );
         }
-        else if ( _wcsicmp( ext, L".tga" ) == 0 )
-        {
+    }
+    else if ( _wcsicmp( ext, L".tga" ) == 0 )
+    {
+        if ( pSource )
+            hr = LoadFromTGAMemory( pSource, cbSource, &info, *image );
+        else
             hr = LoadFromTGAFile( pConv->szSrc, &info, *image );
-            if ( FAILED(hr) )
-            {
-                wprintf( L" FAILED (%x)\n", hr);
-                delete image;
-                continue;
-            }
+        if ( FAILED(hr) )
+        {
+            JobPrint( s, L" FAILED (%x)\n", hr);
+            delete image;
+            return JobFailed( report, L"load", hr, JOB_FAILED );
         }
+    }
+    else
+    {
+        // WIC shares the same filter values for mode and dither
+        static_assert( WIC_FLAGS_DITHER == TEX_FILTER_DITHER, "WIC_FLAGS_* & TEX_FILTER_* should match" );
+        static_assert( WIC_FLAGS_DITHER_DIFFUSION == TEX_FILTER_DITHER_DIFFUSION, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
+        static_assert( WIC_FLAGS_FILTER_POINT == TEX_FILTER_POINT, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
+        static_assert( WIC_FLAGS_FILTER_LINEAR == TEX_FILTER_LINEAR, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
+        static_assert( WIC_FLAGS_FILTER_CUBIC == TEX_FILTER_CUBIC, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
+        static_assert( WIC_FLAGS_FILTER_FANT == TEX_FILTER_FANT, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
+
+        if ( pSource )
+            hr = LoadFromWICMemory( pSource, cbSource, s.dwFilter, &info, *image );
         else
+            hr = LoadFromWICFile( pConv->szSrc, s.dwFilter, &info, *image );
+        if ( FAILED(hr) )
         {
-            // WIC shares the same filter values for mode and dither
-            static_assert( WIC_FLAGS_DITHER == TEX_FILTER_DITHER, "WIC_FLAGS_* & TEX_FILTER_* should match" );
-            static_assert( WIC_FLAGS_DITHER_DIFFUSION == TEX_FILTER_DITHER_DIFFUSION, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
-            static_assert( WIC_FLAGS_FILTER_POINT == TEX_FILTER_POINT, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
-            static_assert( WIC_FLAGS_FILTER_LINEAR == TEX_FILTER_LINEAR, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
-            static_assert( WIC_FLAGS_FILTER_CUBIC == TEX_FILTER_CUBIC, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
-            static_assert( WIC_FLAGS_FILTER_FANT == TEX_FILTER_FANT, "WIC_FLAGS_* & TEX_FILTER_* should match"  );
-
-            hr = LoadFromWICFile( pConv->szSrc, dwFilter, &info, *image );
-            if ( FAILED(hr) )
-            {
-                wprintf( L" FAILED (%x)\n", hr);
-                delete image;
-                continue;
-            }
+            JobPrint( s, L" FAILED (%x)\n", hr);
+            delete image;
+            return JobFailed( report, L"load", hr, JOB_FAILED );
         }
+    }
 
-        PrintInfo( info );
-
-        size_t twidth = ( !width ) ? info.width : width;
-        size_t theight = ( !height ) ? info.height : height;
-        size_t tMips = ( !mipLevels && info.mipLevels > 1 ) ? info.mipLevels : mipLevels;
-        DXGI_FORMAT tformat = ( format == DXGI_FORMAT_UNKNOWN ) ? info.format : format;
-
-        // Convert texture
-        wprintf( L" as");
-        fflush(stdout);
+    report.msLoad = ElapsedMs( qpcMark );
 
-        // --- Decompress --------------------------------------------------------------
-        if ( IsCompressed( info.format ) )
-        {
-            const Image* img = image->GetImage(0,0,0);
-            assert( img );
-            size_t nimg = image->GetImageCount();
+    if ( s.verbose )
+        PrintInfo( info );
 
-            ScratchImage *timage = new ScratchImage;
-            if ( !timage )
-            {
-                wprintf( L" ERROR: Memory allocation failed\n" );
-                delete image;
-                goto LError;
-            }
+    size_t twidth = ( !s.width ) ? info.width : s.width;
+    size_t theight = ( !s.height ) ? info.height : s.height;
+    size_t tMips = ( !s.mipLevels && info.mipLevels > 1 ) ? info.mipLevels : s.mipLevels;
+    DXGI_FORMAT tformat = ( s.format == DXGI_FORMAT_UNKNOWN ) ? info.format : s.format;
 
-            hr = Decompress( img, nimg, info, DXGI_FORMAT_UNKNOWN /* picks good default */, *timage );
-            if ( FAILED(hr) )
-            {
-                wprintf( L" FAILED [decompress] (%x)\n", hr);
-                delete timage;
-                delete image;
-                continue;
-            }
+    // Convert texture
+    JobPrint( s, L" as");
 
-            const TexMetadata& tinfo = timage->GetMetadata();
+    // --- Decompress --------------------------------------------------------------
+    if ( IsCompressed( info.format ) )
+    {
+        const Image* img = image->GetImage(0,0,0);
+        assert( img );
+        size_t nimg = image->GetImageCount();
 
-            info.format = tinfo.format;
+        ScratchImage *timage = new ScratchImage;
+        if ( !timage )
+        {
+            delete image;
+            return JobOutOfMemory( s, report );
+        }
 
-            assert( info.width == tinfo.width );
-            assert( info.height == tinfo.height );
-            assert( info.depth == tinfo.depth );
-            assert( info.arraySize == tinfo.arraySize );
-            assert( info.mipLevels == tinfo.mipLevels );
-            assert( info.miscFlags == tinfo.miscFlags );
-            assert( info.miscFlags2 == tinfo.miscFlags2 );
-            assert( info.dimension == tinfo.dimension );
+        LARGE_INTEGER qpcDecompress;
+        QueryPerformanceCounter( &qpcDecompress );
 
+        hr = Decompress( img, nimg, info, DXGI_FORMAT_UNKNOWN /* picks good default */, *timage );
+        if ( FAILED(hr) )
+        {
+            JobPrint( s, L" FAILED [decompress] (%x)\n", hr);
+            delete timage;
             delete image;
-            image = timage;
+            return JobFailed( report, L"decompress", hr, JOB_FAILED );
         }
 
-        // --- Flip/Rotate -------------------------------------------------------------
-        if ( dwOptions & ( (1 << OPT_HFLIP) | (1 << OPT_VFLIP) ) )
+        if ( dwOptions & (1 << OPT_TIMING) )
         {
-            ScratchImage *timage = new ScratchImage;
-            if ( !timage )
-            {
-                wprintf( L" ERROR: Memory allocation failed\n" );
-                delete image;
-                goto LError;
-            }
+            double ms = ElapsedMs( qpcDecompress );
+            double mbytes = double( timage->GetPixelsSize() ) / ( 1024.0 * 1024.0 );
 
-            DWORD dwFlags = 0;
+            JobPrint( s, L" [decompress %.1f ms, %.1f MB/s]", ms, ( ms > 0 ) ? mbytes * 1000.0 / ms : 0.0 );
+        }
 
-            if ( dwOptions & (1 << OPT_HFLIP) )
-                dwFlags |= TEX_FR_FLIP_HORIZONTAL;
+        const TexMetadata& tinfo = timage->GetMetadata();
 
-            if ( dwOptions & (1 << OPT_VFLIP) )
-                dwFlags |= TEX_FR_FLIP_VERTICAL;
+        info.format = tinfo.format;
 
-            assert( dwFlags != 0 );
+        assert( info.width == tinfo.width );
+        assert( info.height == tinfo.height );
+        assert( info.depth == tinfo.depth );
+        assert( info.arraySize == tinfo.arraySize );
+        assert( info.mipLevels == tinfo.mipLevels );
+        assert( info.miscFlags == tinfo.miscFlags );
+        assert( info.miscFlags2 == tinfo.miscFlags2 );
+        assert( info.dimension == tinfo.dimension );
 
-            hr = FlipRotate( image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFlags, *timage );
-            if ( FAILED(hr) )
-            {
-                wprintf( L" FAILED [fliprotate] (%x)\n", hr);
-                delete timage;
-                delete image;
-                goto LError;
-            }
+        delete image;
+        image = timage;
+    }
 
-            const TexMetadata& tinfo = timage->GetMetadata();
+    // --- Flip/Rotate -------------------------------------------------------------
+    if ( dwOptions & ( (1 << OPT_HFLIP) | (1 << OPT_VFLIP) ) )
+    {
+        ScratchImage *timage = new ScratchImage;
+        if ( !timage )
+        {
+            delete image;
+            return JobOutOfMemory( s, report );
+        }
 
-            assert( tinfo.width == twidth && tinfo.height == theight );
+        DWORD dwFlags = 0;
 
-            info.width = tinfo.width;
-            info.height = tinfo.height;
+        if ( dwOptions & (1 << OPT_HFLIP) )
+            dwFlags |= TEX_FR_FLIP_HORIZONTAL;
 
-            assert( info.depth == tinfo.depth );
-            assert( info.arraySize == tinfo.arraySize );
-            assert( info.mipLevels == tinfo.mipLevels );
-            assert( info.miscFlags == tinfo.miscFlags );
-            assert( info.miscFlags2 == tinfo.miscFlags2 );
-            assert( info.format == tinfo.format );
-            assert( info.dimension == tinfo.dimension );
+        if ( dwOptions & (1 << OPT_VFLIP) )
+            dwFlags |= TEX_FR_FLIP_VERTICAL;
+
+        assert( dwFlags != 0 );
 
+        hr = FlipRotate( image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFlags, *timage );
+        if ( FAILED(hr) )
+        {
+            JobPrint( s, L" FAILED [fliprotate] (%x)\n", hr);
+            delete timage;
             delete image;
-            image = timage;
+            return JobFailed( report, L"fliprotate", hr, JOB_ERROR );
         }
 
-        // --- Resize ------------------------------------------------------------------
-        if ( info.width != twidth || info.height != theight )
-        {
-            ScratchImage *timage = new ScratchImage;
-            if ( !timage )
-            {
-                wprintf( L" ERROR: Memory allocation failed\n" );
-                delete image;
-                goto LError;
-            }
+        const TexMetadata& tinfo = timage->GetMetadata();
 
-            hr = Resize( image->GetImages(), image->GetImageCount(), image->GetMetadata(), twidth, theight, dwFilter | dwFilterOpts, *timage );
-            if ( FAILED(hr) )
-            {
-                wprintf( L" FAILED [resize] (%x)\n", hr);
-                delete timage;
-                delete image;
-                goto LError;
-            }
+        assert( tinfo.width == twidth && tinfo.height == theight );
 
-            const TexMetadata& tinfo = timage->GetMetadata();
+        info.width = tinfo.width;
+        info.height = tinfo.height;
 
-            assert( tinfo.width == twidth && tinfo.height == theight && tinfo.mipLevels == 1 );
-            info.width = tinfo.width;
-            info.height = tinfo.height;
-            info.mipLevels = 1;
+        assert( info.depth == tinfo.depth );
+        assert( info.arraySize == tinfo.arraySize );
+        assert( info.mipLevels == tinfo.mipLevels );
+        assert( info.miscFlags == tinfo.miscFlags );
+        assert( info.miscFlags2 == tinfo.miscFlags2 );
+        assert( info.format == tinfo.format );
+        assert( info.dimension == tinfo.dimension );
 
-            assert( info.depth == tinfo.depth );
-            assert( info.arraySize == tinfo.arraySize );
-            assert( info.miscFlags == tinfo.miscFlags );
-            assert( info.miscFlags2 == tinfo.miscFlags2 );
-            assert( info.format == tinfo.format );
-            assert( info.dimension == tinfo.dimension );
+        delete image;
+        image = timage;
+    }
 
+    // --- Resize ------------------------------------------------------------------
+    if ( info.width != twidth || info.height != theight )
+    {
+        ScratchImage *timage = new ScratchImage;
+        if ( !timage )
+        {
             delete image;
-            image = timage;
+            return JobOutOfMemory( s, report );
         }
 
-        // --- Convert -----------------------------------------------------------------
-        if ( info.format != tformat && !IsCompressed( tformat ) )
+        hr = Resize( image->GetImages(), image->GetImageCount(), image->GetMetadata(), twidth, theight, s.dwFilter | s.dwFilterOpts, *timage );
+        if ( FAILED(hr) )
         {
-            ScratchImage *timage = new ScratchImage;
-            if ( !timage )
-            {
-                wprintf( L" ERROR: Memory allocation failed\n" );
-                delete image;
-                goto LError;
-            }
+            JobPrint( s, L" FAILED [resize] (%x)\n", hr);
+            delete timage;
+            delete image;
+            return JobFailed( report, L"resize", hr, JOB_ERROR );
+        }
 
-            hr = Convert( image->GetImages(), image->GetImageCount(), image->GetMetadata(), tformat, dwFilter | dwFilterOpts | dwSRGB, 0.5f, *timage );
-            if ( FAILED(hr) )
-            {
-                wprintf( L" FAILED [convert] (%x)\n", hr);
-                delete timage;
-                delete image;
-                goto LError;
-            }
+        const TexMetadata& tinfo = timage->GetMetadata();
 
-            const TexMetadata& tinfo = timage->GetMetadata();
+        assert( tinfo.width == twidth && tinfo.height == theight && tinfo.mipLevels == 1 );
+        info.width = tinfo.width;
+        info.height = tinfo.height;
+        info.mipLevels = 1;
 
-            assert( tinfo.format == tformat );
-            info.format = tinfo.format;
+        assert( info.depth == tinfo.depth );
+        assert( info.arraySize == tinfo.arraySize );
+        assert( info.miscFlags == tinfo.miscFlags );
+        assert( info.miscFlags2 == tinfo.miscFlags2 );
+        assert( info.format == tinfo.format );
+        assert( info.dimension == tinfo.dimension );
 
-            assert( info.width == tinfo.width );
-            assert( info.height == tinfo.height );
-            assert( info.depth == tinfo.depth );
-            assert( info.arraySize == tinfo.arraySize );
-            assert( info.mipLevels == tinfo.mipLevels );
-            assert( info.miscFlags == tinfo.miscFlags );
-            assert( info.miscFlags2 == tinfo.miscFlags2 );
-            assert( info.dimension == tinfo.dimension );
+        delete image;
+        image = timage;
+    }
 
+    // --- Convert -----------------------------------------------------------------
+    if ( info.format != tformat && !IsCompressed( tformat ) )
+    {
+        ScratchImage *timage = new ScratchImage;
+        if ( !timage )
+        {
             delete image;
-            image = timage;
+            return JobOutOfMemory( s, report );
         }
 
-        // --- Generate mips -----------------------------------------------------------
-        if ( !ispow2(info.width) || !ispow2(info.height) || !ispow2(info.depth) )
+        hr = Convert( image->GetImages(), image->GetImageCount(), image->GetMetadata(), tformat, s.dwFilter | s.dwFilterOpts | s.dwSRGB, 0.5f, *timage );
+        if ( FAILED(hr) )
         {
-            if ( info.dimension == TEX_DIMENSION_TEXTURE3D )
-            {
-                if ( !tMips )
-                {
-                    tMips = 1;
-                }
-                else
-                {
-                    wprintf( L" ERROR: Cannot generate mips for non-power-of-2 volume textures\n" );
-                    delete image;
-                    goto LError;
-                }
-            }
-            else if ( !tMips || info.mipLevels != 1 )
-            {
-                nonpow2warn = true;
-            }
+            JobPrint( s, L" FAILED [convert] (%x)\n", hr);
+            delete timage;
+            delete image;
+            return JobFailed( report, L"convert", hr, JOB_ERROR );
         }
 
-        if ( (!tMips || info.mipLevels != tMips) && ( info.mipLevels != 1 ) )
-        {
-            // Mips generation only works on a single base image, so strip off existing mip levels
-            ScratchImage *timage = new ScratchImage;
-            if ( !timage )
-            {
-                wprintf( L" ERROR: Memory allocation failed\n" );
-                delete image;
-                goto LError;
-            }
+        const TexMetadata& tinfo = timage->GetMetadata();
 
-            TexMetadata mdata = info;
-            mdata.mipLevels = 1;
-            hr = timage->Initialize( mdata );
-            if ( FAILED(hr) )
-            {
-                wprintf( L" FAILED [copy to single level] (%x)\n", hr);
-                delete timage;
-                delete image;
-                goto LError;
-            }
+        assert( tinfo.format == tformat );
+        info.format = tinfo.format;
 
-            if ( info.dimension == TEX_DIMENSION_TEXTURE3D )
-            {
-                for( size_t d = 0; d < info.depth; ++d )
-                {
-                    hr = CopyRectangle( *image->GetImage( 0, 0, d ), Rect( 0, 0, info.width, info.height ),
-                                        *timage->GetImage( 0, 0, d ), TEX_FILTER_DEFAULT, 0, 0 );
-                    if ( FAILED(hr) )
-                    {
-                        wprintf( L" FAILED [copy to single level] (%x)\n", hr);
-                        delete timage;
-                        delete image;
-                        goto LError;
-                    }
-                }
-            }
-            else
-            {
-                for( size_t i = 0; i < info.arraySize; ++i )
-                {
-                    hr = CopyRectangle( *image->GetImage( 0, i, 0 ), Rect( 0, 0, info.width, info.height ),
-                                        *timage->GetImage( 0, i, 0 ), TEX_FILTER_DEFAULT, 0, 0 );
-                    if ( FAILED(hr) )
-                    {
-                        wprintf( L" FAILED [copy to single level] (%x)\n", hr);
-                        delete timage;
-                        delete image;
-                        goto LError;
-                    }
-                }
-            }
+        assert( info.width == tinfo.width );
+        assert( info.height == tinfo.height );
+        assert( info.depth == tinfo.depth );
+        assert( info.arraySize == tinfo.arraySize );
+        assert( info.mipLevels == tinfo.mipLevels );
+        assert( info.miscFlags == tinfo.miscFlags );
+        assert( info.miscFlags2 == tinfo.miscFlags2 );
+        assert( info.dimension == tinfo.dimension );
 
-            delete image;
-            image = timage;
+        delete image;
+        image = timage;
+    }
 
-            const TexMetadata& tinfo = timage->GetMetadata();
-            info.mipLevels = tinfo.mipLevels;
-        }
+    report.msConvert += ElapsedMs( qpcMark );
 
-        if ( !tMips || info.mipLevels != tMips )
+    // --- Generate mips -----------------------------------------------------------
+    if ( !ispow2(info.width) || !ispow2(info.height) || !ispow2(info.depth) )
+    {
+        if ( info.dimension == TEX_DIMENSION_TEXTURE3D )
         {
-            ScratchImage *timage = new ScratchImage;
-            if ( !timage )
-            {
-                wprintf( L" ERROR: Memory allocation failed\n" );
-                delete image;
-                goto LError;
-            }
-
-            if ( info.dimension == TEX_DIMENSION_TEXTURE3D )
+            if ( !tMips )
             {
-                hr = GenerateMipMaps3D( image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFilter | dwFilterOpts, tMips, *timage );
+                tMips = 1;
             }
             else
             {
-                hr = GenerateMipMaps( image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFilter | dwFilterOpts, tMips, *timage );
-            }
-            if ( FAILED(hr) )
-            {
-                wprintf( L" FAILED [mipmaps] (%x)\n", hr);
-                delete timage;
+                JobPrint( s, L" ERROR: Cannot generate mips for non-power-of-2 volume textures\n" );
                 delete image;
-                goto LError;
+                return JobFailed( report, L"mipmaps", HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED ), JOB_ERROR );
             }
+        }
+        else if ( !tMips || info.mipLevels != 1 )
+        {
+            report.nonpow2 = true;
+        }
+    }
 
-            const TexMetadata& tinfo = timage->GetMetadata();
-            info.mipLevels = tinfo.mipLevels;
-
-            assert( info.width == tinfo.width );
-            assert( info.height == tinfo.height );
-            assert( info.depth == tinfo.depth );
-            assert( info.arraySize == tinfo.arraySize );
-            assert( info.mipLevels == tinfo.mipLevels );
-            assert( info.miscFlags == tinfo.miscFlags );
-            assert( info.miscFlags2 == tinfo.miscFlags2 );
-            assert( info.dimension == tinfo.dimension );
+    if ( (!tMips || info.mipLevels != tMips) && ( info.mipLevels != 1 ) )
+    {
+        // Mips generation only works on a single base image, so strip off existing mip levels
+        ScratchImage *timage = new ScratchImage;
+        if ( !timage )
+        {
+            delete image;
+            return JobOutOfMemory( s, report );
+        }
 
+        TexMetadata mdata = info;
+        mdata.mipLevels = 1;
+        hr = timage->Initialize( mdata );
+        if ( FAILED(hr) )
+        {
+            JobPrint( s, L" FAILED [copy to single level] (%x)\n", hr);
+            delete timage;
             delete image;
-            image = timage;
+            return JobFailed( report, L"copy to single level", hr, JOB_ERROR );
         }
 
-        // --- Premultiplied alpha (if requested) --------------------------------------
-        if ( ( dwOptions & (1 << OPT_PREMUL_ALPHA) )
-             && HasAlpha( info.format )
-             && info.format != DXGI_FORMAT_A8_UNORM )
+        if ( info.dimension == TEX_DIMENSION_TEXTURE3D )
         {
-            if ( info.IsPMAlpha() )
+            for( size_t d = 0; d < info.depth; ++d )
             {
-                printf("WARNING: Image is already using premultiplied alpha\n");
-            }
-            else
-            {
-                const Image* img = image->GetImage(0,0,0);
-                assert( img );
-                size_t nimg = image->GetImageCount();
-
-                ScratchImage *timage = new ScratchImage;
-                if ( !timage )
+                hr = CopyRectangle( *image->GetImage( 0, 0, d ), Rect( 0, 0, info.width, info.height ),
+                                    *timage->GetImage( 0, 0, d ), TEX_FILTER_DEFAULT, 0, 0 );
+                if ( FAILED(hr) )
                 {
-                    wprintf( L" ERROR: Memory allocation failed\n" );
+                    JobPrint( s, L" FAILED [copy to single level] (%x)\n", hr);
+                    delete timage;
                     delete image;
-                    goto LError;
+                    return JobFailed( report, L"copy to single level", hr, JOB_ERROR );
                 }
-
-                hr = PremultiplyAlpha( img, nimg, info, *timage );
+            }
+        }
+        else
+        {
+            for( size_t i = 0; i < info.arraySize; ++i )
+            {
+                hr = CopyRectangle( *image->GetImage( 0, i, 0 ), Rect( 0, 0, info.width, info.height ),
+                                    *timage->GetImage( 0, i, 0 ), TEX_FILTER_DEFAULT, 0, 0 );
                 if ( FAILED(hr) )
                 {
-                    wprintf( L" FAILED [premultiply alpha] (%x)\n", hr);
+                    JobPrint( s, L" FAILED [copy to single level] (%x)\n", hr);
                     delete timage;
                     delete image;
-                    continue;
+                    return JobFailed( report, L"copy to single level", hr, JOB_ERROR );
                 }
+            }
+        }
 
-                const TexMetadata& tinfo = timage->GetMetadata();
-                info.miscFlags2 = tinfo.miscFlags2;
- 
-                assert( info.width == tinfo.width );
-                assert( info.height == tinfo.height );
-                assert( info.depth == tinfo.depth );
-                assert( info.arraySize == tinfo.arraySize );
-                assert( info.mipLevels == tinfo.mipLevels );
-                assert( info.miscFlags == tinfo.miscFlags );
-                assert( info.miscFlags2 == tinfo.miscFlags2 );
-                assert( info.dimension == tinfo.dimension );
+        delete image;
+        image = timage;
 
-                delete image;
-                image = timage;
-            }
+        const TexMetadata& tinfo = timage->GetMetadata();
+        info.mipLevels = tinfo.mipLevels;
+    }
+
+    // With -stream the mips are box filtered and compressed together (see GenerateCompressedMipMaps)
+    bool bMipsCompressed = false;
+
+    if ( ( dwOptions & (1 << OPT_STREAM) ) && ( !tMips || info.mipLevels != tMips ) )
+    {
+        if ( info.dimension != TEX_DIMENSION_TEXTURE2D || info.arraySize != 1 || info.depth != 1
+             || !ispow2(info.width) || !ispow2(info.height) )
+        {
+            JobPrint( s, L" ERROR: -stream can only generate mips for a single power-of-2 2D image\n" );
+            delete image;
+            return JobFailed( report, L"mipmaps", HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED ), JOB_ERROR );
         }
 
-        // --- Compress ----------------------------------------------------------------
-        if ( IsCompressed( tformat ) && (FileType == CODEC_DDS) )
+        ScratchImage *timage = new ScratchImage;
+        if ( !timage )
+        {
+            delete image;
+            return JobOutOfMemory( s, report );
+        }
+
+        DWORD cflags = GetCompressFlags( dwOptions, tformat );
+
+        hr = GenerateCompressedMipMaps( *image->GetImage( 0, 0, 0 ), s.dwFilter | s.dwFilterOpts, tMips, tformat, cflags, 0.5f, *timage );
+        if ( FAILED(hr) )
+        {
+            JobPrint( s, L" FAILED [mipmaps+compress] (%x)\n", hr);
+            delete timage;
+            delete image;
+            return JobFailed( report, L"mipmaps+compress", hr, JOB_FAILED );
+        }
+
+        report.msCompress += ElapsedMs( qpcMark );
+
+        if ( s.verbose && ( dwOptions & (1 << OPT_TIMING) ) )
+        {
+            double seconds = report.msCompress / 1000.0;
+            double mbytes = double( image->GetPixelsSize() ) / ( 1024.0 * 1024.0 );
+
+            wprintf( L" [mips+compress %.1f ms, %.1f MB/s]", report.msCompress, ( seconds > 0 ) ? mbytes / seconds : 0.0 );
+        }
+
+        const TexMetadata& tinfo = timage->GetMetadata();
+        info.format = tinfo.format;
+        info.mipLevels = tinfo.mipLevels;
+
+        assert( info.width == tinfo.width );
+        assert( info.height == tinfo.height );
+        assert( info.depth == tinfo.depth );
+        assert( info.arraySize == tinfo.arraySize );
+        assert( info.miscFlags == tinfo.miscFlags );
+        assert( info.miscFlags2 == tinfo.miscFlags2 );
+        assert( info.dimension == tinfo.dimension );
+
+        delete image;
+        image = timage;
+        bMipsCompressed = true;
+    }
+    else if ( !tMips || info.mipLevels != tMips )
+    {
+        ScratchImage *timage = new ScratchImage;
+        if ( !timage )
+        {
+            delete image;
+            return JobOutOfMemory( s, report );
+        }
+
+        DWORD dwMipFilter = s.dwFilter | s.dwFilterOpts;
+#ifdef _OPENMP
+        if ( !(dwOptions & (1 << OPT_FORCE_SINGLEPROC) ) )
+        {
+            dwMipFilter |= TEX_FILTER_PARALLEL;
+        }
+#endif
+
+        if ( info.dimension == TEX_DIMENSION_TEXTURE3D )
+        {
+            hr = GenerateMipMaps3D( image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwMipFilter, tMips, *timage );
+        }
+        else
+        {
+            hr = GenerateMipMaps( image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwMipFilter, tMips, *timage );
+        }
+        if ( FAILED(hr) )
+        {
+            JobPrint( s, L" FAILED [mipmaps] (%x)\n", hr);
+            delete timage;
+            delete image;
+            return JobFailed( report, L"mipmaps", hr, JOB_ERROR );
+        }
+
+        report.msMips += ElapsedMs( qpcMark );
+
+        if ( s.verbose && ( dwOptions & (1 << OPT_TIMING) ) )
+            wprintf( L" [mips %.1f ms]", report.msMips );
+
+        const TexMetadata& tinfo = timage->GetMetadata();
+        info.mipLevels = tinfo.mipLevels;
+
+        assert( info.width == tinfo.width );
+        assert( info.height == tinfo.height );
+        assert( info.depth == tinfo.depth );
+        assert( info.arraySize == tinfo.arraySize );
+        assert( info.mipLevels == tinfo.mipLevels );
+        assert( info.miscFlags == tinfo.miscFlags );
+        assert( info.miscFlags2 == tinfo.miscFlags2 );
+        assert( info.dimension == tinfo.dimension );
+
+        delete image;
+        image = timage;
+    }
+
+    report.msMips += ElapsedMs( qpcMark );
+
+    // --- Premultiplied alpha (if requested) --------------------------------------
+    if ( ( dwOptions & (1 << OPT_PREMUL_ALPHA) )
+         && HasAlpha( info.format )
+         && info.format != DXGI_FORMAT_A8_UNORM )
+    {
+        if ( info.IsPMAlpha() )
+        {
+            JobPrint( s, L"WARNING: Image is already using premultiplied alpha\n" );
+        }
+        else
         {
             const Image* img = image->GetImage(0,0,0);
             assert( img );
@@ -1086,41 +1123,22 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             ScratchImage *timage = new ScratchImage;
             if ( !timage )
             {
-                wprintf( L" ERROR: Memory allocation failed\n" );
                 delete image;
-                goto LError;
-            }
-
-            DWORD cflags = TEX_COMPRESS_DEFAULT;
-#ifdef _OPENMP
-            switch( tformat )
-            {
-            case DXGI_FORMAT_BC6H_TYPELESS:
-            case DXGI_FORMAT_BC6H_UF16:
-            case DXGI_FORMAT_BC6H_SF16:
-            case DXGI_FORMAT_BC7_TYPELESS:
-            case DXGI_FORMAT_BC7_UNORM:
-            case DXGI_FORMAT_BC7_UNORM_SRGB:
-                if ( !(dwOptions & (1 << OPT_FORCE_SINGLEPROC) ) )
-                {
-                    cflags |= TEX_COMPRESS_PARALLEL;
-                }
-                break;
+                return JobOutOfMemory( s, report );
             }
-#endif
 
-            hr = Compress( img, nimg, info, tformat, cflags, 0.5f, *timage );
+            hr = PremultiplyAlpha( img, nimg, info, *timage );
             if ( FAILED(hr) )
             {
-                wprintf( L" FAILED [compress] (%x)\n", hr);
+                JobPrint( s, L" FAILED [premultiply alpha] (%x)\n", hr);
                 delete timage;
                 delete image;
-                continue;
+                return JobFailed( report, L"premultiply alpha", hr, JOB_FAILED );
             }
 
             const TexMetadata& tinfo = timage->GetMetadata();
-
-            info.format = tinfo.format;
+            info.miscFlags2 = tinfo.miscFlags2;
+ 
             assert( info.width == tinfo.width );
             assert( info.height == tinfo.height );
             assert( info.depth == tinfo.depth );
@@ -1133,109 +1151,1006 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             delete image;
             image = timage;
         }
+    }
 
-        // --- Set alpha mode ----------------------------------------------------------
-        if ( HasAlpha( info.format )
-             && info.format != DXGI_FORMAT_A8_UNORM )
+    report.msConvert += ElapsedMs( qpcMark );
+
+    // --- Compress ----------------------------------------------------------------
+    if ( IsCompressed( tformat ) && (s.FileType == CODEC_DDS) && !bMipsCompressed )
+    {
+        const Image* img = image->GetImage(0,0,0);
+        assert( img );
+        size_t nimg = image->GetImageCount();
+
+        ScratchImage *timage = new ScratchImage;
+        if ( !timage )
         {
-            if ( image->IsAlphaAllOpaque() )
-            {
-                info.SetAlphaMode(TEX_ALPHA_MODE_OPAQUE);
-            }
-            else if ( info.IsPMAlpha() )
-            {
-                // Aleady set TEX_ALPHA_MODE_PREMULTIPLIED
-            }
-            else if ( dwOptions & (1 << OPT_SEPALPHA) )
-            {
-                info.SetAlphaMode(TEX_ALPHA_MODE_CUSTOM);
-            }
-            else
+            delete image;
+            return JobOutOfMemory( s, report );
+        }
+
+        DWORD cflags = GetCompressFlags( dwOptions, tformat );
+
+        hr = Compress( img, nimg, info, tformat, cflags, 0.5f, *timage );
+        if ( FAILED(hr) )
+        {
+            JobPrint( s, L" FAILED [compress] (%x)\n", hr);
+            delete timage;
+            delete image;
+            return JobFailed( report, L"compress", hr, JOB_FAILED );
+        }
+
+        report.msCompress += ElapsedMs( qpcMark );
+
+        if ( s.verbose && ( dwOptions & (1 << OPT_TIMING) ) )
+        {
+            double seconds = report.msCompress / 1000.0;
+            double mbytes = double( image->GetPixelsSize() ) / ( 1024.0 * 1024.0 );
+
+            wprintf( L" [compress %.1f ms, %.1f MB/s]", report.msCompress, ( seconds > 0 ) ? mbytes / seconds : 0.0 );
+
+            // Quality of the top-level image, for comparing compression settings
+            float mse = 0;
+            if ( SUCCEEDED( ComputeMSE( img[0], *timage->GetImage( 0, 0, 0 ), mse, nullptr ) ) )
             {
-                info.SetAlphaMode(TEX_ALPHA_MODE_STRAIGHT);
+                if ( mse > 0 )
+                    wprintf( L" [PSNR %.2f dB]", 10.0 * log10( 1.0 / mse ) );
+                else
+                    wprintf( L" [PSNR inf]" );
             }
+
+            // Don't count reporting against the next stage
+            QueryPerformanceCounter( &qpcMark );
+        }
+
+        const TexMetadata& tinfo = timage->GetMetadata();
+
+        info.format = tinfo.format;
+        assert( info.width == tinfo.width );
+        assert( info.height == tinfo.height );
+        assert( info.depth == tinfo.depth );
+        assert( info.arraySize == tinfo.arraySize );
+        assert( info.mipLevels == tinfo.mipLevels );
+        assert( info.miscFlags == tinfo.miscFlags );
+        assert( info.miscFlags2 == tinfo.miscFlags2 );
+        assert( info.dimension == tinfo.dimension );
+
+        delete image;
+        image = timage;
+    }
+
+    // --- Set alpha mode ----------------------------------------------------------
+    if ( HasAlpha( info.format )
+         && info.format != DXGI_FORMAT_A8_UNORM )
+    {
+        if ( image->IsAlphaAllOpaque() )
+        {
+            info.SetAlphaMode(TEX_ALPHA_MODE_OPAQUE);
+        }
+        else if ( info.IsPMAlpha() )
+        {
+            // Aleady set TEX_ALPHA_MODE_PREMULTIPLIED
+        }
+        else if ( dwOptions & (1 << OPT_SEPALPHA) )
+        {
+            info.SetAlphaMode(TEX_ALPHA_MODE_CUSTOM);
         }
         else
         {
-            info.miscFlags2 &= ~TEX_MISC2_ALPHA_MODE_MASK;
+            info.SetAlphaMode(TEX_ALPHA_MODE_STRAIGHT);
         }
+    }
+    else
+    {
+        info.miscFlags2 &= ~TEX_MISC2_ALPHA_MODE_MASK;
+    }
 
-        // --- Save result -------------------------------------------------------------
-        {
-            const Image* img = image->GetImage(0,0,0);
-            assert( img );
-            size_t nimg = image->GetImageCount();
+    report.msConvert += ElapsedMs( qpcMark );
+
+    // --- Save result -------------------------------------------------------------
+    {
+        const Image* img = image->GetImage(0,0,0);
+        assert( img );
+        size_t nimg = image->GetImageCount();
 
+        if ( s.verbose )
             PrintInfo( info );
-            wprintf( L"\n");
+        JobPrint( s, L"\n");
 
-            // Figure out dest filename
-            WCHAR *pchSlash, *pchDot;
+        // Write texture
+        JobPrint( s, L"writing %s", pConv->szDest);
 
-            wcscpy_s(pConv->szDest, MAX_PATH, szPrefix);
+        switch( s.FileType )
+        {
+        case CODEC_DDS:
+            hr = SaveToDDSFile( img, nimg, info,
+                                (dwOptions & (1 << OPT_USE_DX10) ) ? (DDS_FLAGS_FORCE_DX10_EXT|DDS_FLAGS_FORCE_DX10_EXT_MISC2) : DDS_FLAGS_NONE, 
+                                pConv->szDest );
+            break;
 
-            pchSlash = wcsrchr(pConv->szSrc, L'\\');
-            if(pchSlash != 0)
-                wcscat_s(pConv->szDest, MAX_PATH, pchSlash + 1);
-            else
-                wcscat_s(pConv->szDest, MAX_PATH, pConv->szSrc);
+        case CODEC_TGA:
+            hr = SaveToTGAFile( img[0], pConv->szDest );
+            break;
 
-            pchSlash = wcsrchr(pConv->szDest, '\\');
-            pchDot = wcsrchr(pConv->szDest, '.');
+        default:
+            hr = SaveToWICFile( img, nimg, WIC_FLAGS_ALL_FRAMES, GetWICCodec( static_cast<WICCodecs>(s.FileType) ), pConv->szDest );
+            break;
+        }
 
-            if(pchDot > pchSlash)
-                *pchDot = 0;
+        if(FAILED(hr))
+        {
+            JobPrint( s, L" FAILED (%x)\n", hr);
+            delete image;
+            return JobFailed( report, L"save", hr, JOB_FAILED );
+        }
+        JobPrint( s, L"\n");
+    }
 
-            wcscat_s(pConv->szDest, MAX_PATH, szSuffix);
+    delete image;
 
-            // Write texture
-            wprintf( L"writing %s", pConv->szDest);
-            fflush(stdout);
+    report.msSave = ElapsedMs( qpcMark );
 
-            switch( FileType )
-            {
-            case CODEC_DDS:
-                hr = SaveToDDSFile( img, nimg, info,
-                                    (dwOptions & (1 << OPT_USE_DX10) ) ? (DDS_FLAGS_FORCE_DX10_EXT|DDS_FLAGS_FORCE_DX10_EXT_MISC2) : DDS_FLAGS_NONE, 
-                                    pConv->szDest );
-                break;
+    return JOB_OK;
+}
 
-            case CODEC_TGA:
-                hr = SaveToTGAFile( img[0], pConv->szDest );
-                break;
 
-            default:
-                hr = SaveToWICFile( img, nimg, WIC_FLAGS_ALL_FRAMES, GetWICCodec( static_cast<WICCodecs>(FileType) ), pConv->szDest );
-                break;
-            }
+//--------------------------------------------------------------------------------------
+// Batch mode
+//--------------------------------------------------------------------------------------
+typedef std::map<std::wstring, uint64_t> HashCache;
 
-            if(FAILED(hr))
-            {
-                wprintf( L" FAILED (%x)\n", hr);
-                delete image;
-                continue;
-            }
-            wprintf( L"\n");
+#define FNV1A_64_OFFSET 14695981039346656037ULL
+#define FNV1A_64_PRIME  1099511628211ULL
+
+uint64_t HashBytes( _In_reads_bytes_(size) const void* pData, size_t size, uint64_t hash )
+{
+    auto pBytes = reinterpret_cast<const uint8_t*>( pData );
+    for( size_t i = 0; i < size; ++i )
+    {
+        hash ^= pBytes[ i ];
+        hash *= FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
+uint64_t HashSettings( const SSettings& s )
+{
+    // Options that don't change the output don't invalidate existing files
+    const DWORD dwIgnore = (1 << OPT_NOLOGO) | (1 << OPT_TIMING) | (1 << OPT_FORCE_SINGLEPROC)
+                           | (1 << OPT_PREFIX) | (1 << OPT_SUFFIX) | (1 << OPT_OUTPUTDIR)
+                           | (1 << OPT_BATCH) | (1 << OPT_REPORT);
+
+    const uint64_t values[] =
+    {
+        DIRECTX_TEX_VERSION,
+        s.width, s.height, s.mipLevels, s.format,
+        s.dwFilter, s.dwSRGB, s.dwFilterOpts, s.FileType,
+        s.dwOptions & ~dwIgnore,
+    };
+
+    return HashBytes( values, sizeof(values), FNV1A_64_OFFSET );
+}
+
+std::wstring HashKey( _In_z_ LPCWSTR szFile )
+{
+    std::wstring key( szFile );
+    for( auto it = key.begin(); it != key.end(); ++it )
+        *it = towlower( *it );
+    return key;
+}
+
+void LoadHashCache( _In_z_ LPCWSTR szFile, HashCache& cache )
+{
+    FILE* fp = nullptr;
+    if ( _wfopen_s( &fp, szFile, L"rt, ccs=UTF-8" ) != 0 || !fp )
+        return;
+
+    WCHAR line[MAX_PATH + 32];
+    while ( fgetws( line, _countof(line), fp ) )
+    {
+        uint64_t hash;
+        WCHAR dest[MAX_PATH];
+        if ( swscanf_s( line, L"%I64x %[^\n]", &hash, dest, static_cast<unsigned>( _countof(dest) ) ) == 2 )
+        {
+            cache[ HashKey( dest ) ] = hash;
         }
+    }
 
-        delete image;
+    fclose( fp );
+}
+
+void SaveHashCache( _In_z_ LPCWSTR szFile, const HashCache& cache )
+{
+    FILE* fp = nullptr;
+    if ( _wfopen_s( &fp, szFile, L"wt, ccs=UTF-8" ) != 0 || !fp )
+    {
+        wprintf( L"WARNING: Failed to write %s\n", szFile );
+        return;
+    }
+
+    for( auto it = cache.cbegin(); it != cache.cend(); ++it )
+    {
+        fwprintf( fp, L"%016I64x %s\n", it->second, it->first.c_str() );
     }
 
-    if ( nonpow2warn )
-        wprintf( L"\n WARNING: Not all feature levels support non-power-of-2 textures with mipmaps\n" );
+    fclose( fp );
+}
 
-    nReturn = 0;
+PWSTR NextToken( PWSTR& pch )
+{
+    while ( iswspace( *pch ) )
+        ++pch;
+
+    if ( !*pch )
+        return nullptr;
+
+    PWSTR pToken;
+    if ( *pch == L'"' )
+    {
+        pToken = ++pch;
+        while ( *pch && *pch != L'"' )
+            ++pch;
+    }
+    else
+    {
+        pToken = pch;
+        while ( *pch && !iswspace( *pch ) )
+            ++pch;
+    }
+
+    if ( *pch )
+        *pch++ = 0;
+
+    return pToken;
+}
+
+// Manifest lines are 'source [dest]', with paths containing spaces in double quotes.
+// Blank lines and lines starting with # are ignored.
+HRESULT LoadManifest( _In_z_ LPCWSTR szFile, SConversion**& ppConversion )
+{
+    FILE* fp = nullptr;
+    if ( _wfopen_s( &fp, szFile, L"rt, ccs=UTF-8" ) != 0 || !fp )
+        return HRESULT_FROM_WIN32( ERROR_FILE_NOT_FOUND );
+
+    WCHAR line[MAX_PATH * 2 + 8];
+    while ( fgetws( line, _countof(line), fp ) )
+    {
+        PWSTR pch = line;
+        PWSTR pSrc = NextToken( pch );
+        if ( !pSrc || *pSrc == L'#' )
+            continue;
+
+        PWSTR pDest = NextToken( pch );
+
+        if ( wcslen( pSrc ) >= MAX_PATH || ( pDest && wcslen( pDest ) >= MAX_PATH ) )
+        {
+            fclose( fp );
+            return HRESULT_FROM_WIN32( ERROR_FILENAME_EXCED_RANGE );
+        }
+
+        SConversion *pConv = new SConversion;
+        if ( !pConv )
+        {
+            fclose( fp );
+            return E_OUTOFMEMORY;
+        }
+
+        wcscpy_s( pConv->szSrc, MAX_PATH, pSrc );
+
+        if ( pDest )
+            wcscpy_s( pConv->szDest, MAX_PATH, pDest );
+        else
+            pConv->szDest[0] = 0;
+
+        pConv->pNext = nullptr;
+
+        *ppConversion = pConv;
+        ppConversion = &pConv->pNext;
+    }
+
+    fclose( fp );
+    return S_OK;
+}
+
+HRESULT ReadSourceFile( _In_z_ LPCWSTR szFile, Blob& blob )
+{
+    HANDLE hFile = CreateFileW( szFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+    if ( hFile == INVALID_HANDLE_VALUE )
+        return HRESULT_FROM_WIN32( GetLastError() );
 
-    goto LDone;
+    HRESULT hr = S_OK;
 
-LError:
-    nReturn = 1;
+    LARGE_INTEGER fileSize;
+    DWORD bytesRead = 0;
+    if ( !GetFileSizeEx( hFile, &fileSize ) )
+    {
+        hr = HRESULT_FROM_WIN32( GetLastError() );
+    }
+    else if ( fileSize.HighPart > 0 )
+    {
+        hr = HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+    }
+    else if ( SUCCEEDED( hr = blob.Initialize( fileSize.LowPart ) ) )
+    {
+        if ( !ReadFile( hFile, blob.GetBufferPointer(), fileSize.LowPart, &bytesRead, nullptr ) )
+        {
+            hr = HRESULT_FROM_WIN32( GetLastError() );
+        }
+        else if ( bytesRead != fileSize.LowPart )
+        {
+            hr = E_FAIL;
+        }
+    }
+
+    CloseHandle( hFile );
+    return hr;
+}
+
+//--------------------------------------------------------------------------------------
+// Bounds the memory used by the jobs in flight. Jobs reserve their estimated working set
+// before reading the source, and wait while the reservations would exceed the limit. A
+// job is always admitted when nothing else is in flight, so oversized files still run.
+//--------------------------------------------------------------------------------------
+struct SMemoryBudget
+{
+    CRITICAL_SECTION    cs;
+    CONDITION_VARIABLE  cv;
+    uint64_t            limit;
+    uint64_t            inUse;
+};
+
+void InitializeBudget( SMemoryBudget& budget )
+{
+    InitializeCriticalSection( &budget.cs );
+    InitializeConditionVariable( &budget.cv );
+
+    MEMORYSTATUSEX status = { sizeof(MEMORYSTATUSEX) };
+    budget.limit = GlobalMemoryStatusEx( &status ) ? ( status.ullAvailPhys / 2 ) : 0;
+    budget.limit = std::max<uint64_t>( budget.limit, 256 * 1024 * 1024 );
+    budget.inUse = 0;
+}
+
+void AcquireBudget( SMemoryBudget& budget, uint64_t bytes )
+{
+    EnterCriticalSection( &budget.cs );
+
+    while ( budget.inUse > 0 && ( budget.inUse + bytes ) > budget.limit )
+    {
+        SleepConditionVariableCS( &budget.cv, &budget.cs, INFINITE );
+    }
+
+    budget.inUse += bytes;
+
+    LeaveCriticalSection( &budget.cs );
+}
+
+void ReleaseBudget( SMemoryBudget& budget, uint64_t bytes )
+{
+    EnterCriticalSection( &budget.cs );
+    budget.inUse -= bytes;
+    LeaveCriticalSection( &budget.cs );
+
+    WakeAllConditionVariable( &budget.cv );
+}
+
+uint64_t EstimateWorkingSet( const SConversion* pConv, const SSettings& s )
+{
+    uint64_t fileSize = 0;
+
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    if ( GetFileAttributesExW( pConv->szSrc, GetFileExInfoStandard, &fad ) )
+        fileSize = ( uint64_t( fad.nFileSizeHigh ) << 32 ) | fad.nFileSizeLow;
+
+    WCHAR ext[_MAX_EXT];
+    _wsplitpath_s( pConv->szSrc, nullptr, 0, nullptr, 0, nullptr, 0, ext, _MAX_EXT );
+
+    // Only the header is read here
+    HRESULT hr;
+    TexMetadata info;
+    if ( _wcsicmp( ext, L".dds" ) == 0 )
+        hr = GetMetadataFromDDSFile( pConv->szSrc, GetDDSFlags( s.dwOptions ), info );
+    else if ( _wcsicmp( ext, L".tga" ) == 0 )
+        hr = GetMetadataFromTGAFile( pConv->szSrc, info );
+    else
+        hr = GetMetadataFromWICFile( pConv->szSrc, s.dwFilter, info );
+
+    if ( FAILED(hr) )
+        return fileSize;
+
+    uint64_t pixels = uint64_t( std::max<size_t>( info.width, s.width ) ) * std::max<size_t>( info.height, s.height ) * info.depth * info.arraySize;
+
+    // Decompressed or converted images are at least 32 bpp
+    size_t bpp = std::max<size_t>( BitsPerPixel( info.format ), 32 );
+    if ( s.format != DXGI_FORMAT_UNKNOWN )
+        bpp = std::max<size_t>( bpp, BitsPerPixel( s.format ) );
+
+    // Each stage keeps its source and result alive, and either may carry a mip chain
+    return fileSize + ( pixels * bpp / 8 ) * 8 / 3;
+}
+
+JOB_STATUS RunJob( const SConversion* pConv, const SSettings& s, uint64_t settingsHash,
+                   const HashCache& cache, SMemoryBudget& budget, SJobReport& report )
+{
+    uint64_t reserved = EstimateWorkingSet( pConv, s );
+    AcquireBudget( budget, reserved );
+
+    LARGE_INTEGER qpcMark;
+    QueryPerformanceCounter( &qpcMark );
+
+    JOB_STATUS status;
+
+    Blob source;
+    HRESULT hr = ReadSourceFile( pConv->szSrc, source );
+    if ( FAILED(hr) )
+    {
+        status = JobFailed( report, L"read", hr, JOB_FAILED );
+    }
+    else
+    {
+        report.bytesIn = source.GetBufferSize();
+        report.hash = HashBytes( source.GetBufferPointer(), source.GetBufferSize(), settingsHash );
+        report.msRead = ElapsedMs( qpcMark );
+
+        auto it = cache.find( HashKey( pConv->szDest ) );
+        if ( it != cache.end() && it->second == report.hash
+             && GetFileAttributesW( pConv->szDest ) != INVALID_FILE_ATTRIBUTES )
+        {
+            report.status = status = JOB_SKIPPED;
+        }
+        else
+        {
+            status = ConvertFile( pConv, s, source.GetBufferPointer(), source.GetBufferSize(), report );
+        }
+    }
+
+    source.Release();
+    ReleaseBudget( budget, reserved );
+
+    return status;
+}
+
+//--------------------------------------------------------------------------------------
+// Runs every job across a pool of worker threads. Reading, converting, and writing of
+// different files overlap, as each worker takes the next job as soon as it's done.
+// Outputs whose source content and settings hash matches the cache file are skipped.
+//--------------------------------------------------------------------------------------
+void RunBatch( const std::vector<SConversion*>& jobs, const SSettings& settings, _In_z_ LPCWSTR szHashFile,
+               std::vector<SJobReport>& reports )
+{
+    SSettings s = settings;
+    s.verbose = false;
+
+#ifdef _OPENMP
+    // The jobs already keep every core busy, so don't nest threads per image
+    s.dwOptions |= (1 << OPT_FORCE_SINGLEPROC);
+#endif
+
+    const uint64_t settingsHash = HashSettings( s );
+
+    HashCache cache;
+    LoadHashCache( szHashFile, cache );
+
+    SMemoryBudget budget;
+    InitializeBudget( budget );
+
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+        // WIC needs COM on each worker thread
+        HRESULT hrCOM = CoInitializeEx( nullptr, COINIT_MULTITHREADED );
+
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic,1)
+#endif
+        for( int index = 0; index < static_cast<int>( jobs.size() ); ++index )
+        {
+            const SConversion* pConv = jobs[ index ];
+            SJobReport& report = reports[ index ];
+
+            switch( RunJob( pConv, s, settingsHash, cache, budget, report ) )
+            {
+            case JOB_OK:
+                wprintf( L"%s -> %s (%.1f ms)\n", pConv->szSrc, pConv->szDest, TotalMs( report ) );
+                break;
+
+            case JOB_SKIPPED:
+                wprintf( L"%s -> %s up to date\n", pConv->szSrc, pConv->szDest );
+                break;
+
+            default:
+                wprintf( L"%s FAILED [%s] (%x)\n", pConv->szSrc, report.pszStage, report.hr );
+                break;
+            }
+        }
+
+        if ( SUCCEEDED(hrCOM) )
+            CoUninitialize();
+    }
+
+    DeleteCriticalSection( &budget.cs );
+
+    // Failed jobs are dropped from the cache so they're retried next time
+    for( size_t index = 0; index < jobs.size(); ++index )
+    {
+        if ( reports[ index ].status == JOB_OK || reports[ index ].status == JOB_SKIPPED )
+            cache[ HashKey( jobs[ index ]->szDest ) ] = reports[ index ].hash;
+        else
+            cache.erase( HashKey( jobs[ index ]->szDest ) );
+    }
+
+    SaveHashCache( szHashFile, cache );
+}
+
+void WriteJSONString( FILE* fp, _In_opt_z_ LPCWSTR str )
+{
+    if ( !str )
+    {
+        fputs( "null", fp );
+        return;
+    }
+
+    char utf8[ MAX_PATH * 3 + 1 ];
+    if ( !WideCharToMultiByte( CP_UTF8, 0, str, -1, utf8, sizeof(utf8), nullptr, nullptr ) )
+        utf8[0] = 0;
+
+    fputc( '"', fp );
+    for( const char* pch = utf8; *pch; ++pch )
+    {
+        if ( *pch == '"' || *pch == '\\' )
+            fprintf( fp, "\\%c", *pch );
+        else if ( static_cast<unsigned char>( *pch ) < 0x20 )
+            fprintf( fp, "\\u%04x", *pch );
+        else
+            fputc( *pch, fp );
+    }
+    fputc( '"', fp );
+}
+
+HRESULT WriteReport( _In_z_ LPCWSTR szFile, const std::vector<SConversion*>& jobs, const std::vector<SJobReport>& reports,
+                     size_t count, double msElapsed )
+{
+    static const char* s_status[] = { "ok", "skipped", "failed", "failed" };
+
+    FILE* fp = nullptr;
+    if ( _wfopen_s( &fp, szFile, L"wb" ) != 0 || !fp )
+        return HRESULT_FROM_WIN32( ERROR_CANNOT_MAKE );
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+
+    fprintf( fp, "{\n  \"threads\": %d,\n  \"elapsed\": %.3f,\n  \"jobs\": [\n", threads, msElapsed );
+
+    for( size_t index = 0; index < count; ++index )
+    {
+        const SJobReport& report = reports[ index ];
+
+        fputs( "    { \"source\": ", fp );
+        WriteJSONString( fp, jobs[ index ]->szSrc );
+        fputs( ", \"dest\": ", fp );
+        WriteJSONString( fp, jobs[ index ]->szDest );
+        fprintf( fp, ", \"status\": \"%s\", \"hr\": \"0x%08x\", \"stage\": ", s_status[ report.status ], report.hr );
+        WriteJSONString( fp, report.pszStage );
+        fprintf( fp, ",\n      \"bytes\": %I64u, \"hash\": \"%016I64x\", \"read\": %.3f, \"load\": %.3f, \"convert\": %.3f, \"mips\": %.3f, \"compress\": %.3f, \"save\": %.3f, \"total\": %.3f }%s\n",
+                 report.bytesIn, report.hash, report.msRead, report.msLoad, report.msConvert, report.msMips, report.msCompress, report.msSave,
+                 TotalMs( report ), ( index + 1 < count ) ? "," : "" );
+    }
+
+    fputs( "  ]\n}\n", fp );
+
+    HRESULT hr = ferror( fp ) ? E_FAIL : S_OK;
+    fclose( fp );
+    return hr;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Entry-point
+//--------------------------------------------------------------------------------------
+#pragma prefast(disable : 28198, "Command-line tool, frees all memory on exit")
+
+int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
+{
+    // Parameters and defaults
+    HRESULT hr;
+    INT nReturn;
+
+    size_t width = 0;
+    size_t height = 0; 
+    size_t mipLevels = 0;
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    DWORD dwFilter = TEX_FILTER_DEFAULT;
+    DWORD dwSRGB = 0;
+    DWORD dwFilterOpts = 0;
+    DWORD FileType = CODEC_DDS;
+
+    WCHAR szPrefix   [MAX_PATH];
+    WCHAR szSuffix   [MAX_PATH];
+    WCHAR szOutputDir[MAX_PATH];
+    WCHAR szManifest [MAX_PATH];
+    WCHAR szReport   [MAX_PATH];
+
+    szPrefix[0]    = 0;
+    szSuffix[0]    = 0;
+    szOutputDir[0] = 0;
+    szManifest[0]  = 0;
+    szReport[0]    = 0;
+
+    // Initialize COM (needed for WIC)
+    if( FAILED( hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED) ) )
+    {
+        wprintf( L"Failed to initialize COM (%08X)\n", hr);
+        return 1;
+    }
+
+    // Process command line
+    DWORD dwOptions = 0;
+    SConversion *pConversion = nullptr;
+    SConversion **ppConversion = &pConversion;
+
+    for(int iArg = 1; iArg < argc; iArg++)
+    {
+        PWSTR pArg = argv[iArg];
+
+        if(('-' == pArg[0]) || ('/' == pArg[0]))
+        {
+            pArg++;
+            PWSTR pValue;
+
+            for(pValue = pArg; *pValue && (':' != *pValue); pValue++);
+
+            if(*pValue)
+                *pValue++ = 0;
+
+            DWORD dwOption = LookupByName(pArg, g_pOptions);
+
+            if(!dwOption || (dwOptions & (1 << dwOption)))
+            {
+                PrintUsage();
+                return 1;
+            }
+
+            dwOptions |= 1 << dwOption;
+
+            if( (OPT_NOLOGO != dwOption) && (OPT_TYPELESS_UNORM != dwOption) && (OPT_TYPELESS_FLOAT != dwOption)
+                && (OPT_SEPALPHA != dwOption) && (OPT_PREMUL_ALPHA != dwOption) && (OPT_EXPAND_LUMINANCE != dwOption)
+                && (OPT_TA_WRAP != dwOption) && (OPT_TA_MIRROR != dwOption)
+                && (OPT_FORCE_SINGLEPROC != dwOption) && (OPT_TIMING != dwOption)
+                && (OPT_COMPRESS_FAST != dwOption) && (OPT_COMPRESS_MAX != dwOption)
+                && (OPT_SRGB != dwOption) && (OPT_SRGBI != dwOption) && (OPT_SRGBO != dwOption)
+                && (OPT_HFLIP != dwOption) && (OPT_VFLIP != dwOption)
+                && (OPT_DDS_DWORD_ALIGN != dwOption) && (OPT_USE_DX10 != dwOption)
+                && (OPT_STREAM != dwOption) )
+            {
+                if(!*pValue)
+                {
+                    if((iArg + 1 >= argc))
+                    {
+                        PrintUsage();
+                        return 1;
+                    }
+
+                    iArg++;
+                    pValue = argv[iArg];
+                }
+            }
+
+            switch(dwOption)
+            {
+            case OPT_WIDTH:
+                if (swscanf_s(pValue, L"%Iu", &width) != 1)
+                {
+                    wprintf( L"Invalid value specified with -w (%s)\n", pValue);
+                    wprintf( L"\n");
+                    PrintUsage();
+                    return 1;
+                }
+                break;
+
+            case OPT_HEIGHT:
+                if (swscanf_s(pValue, L"%Iu", &height) != 1)
+                {
+                    wprintf( L"Invalid value specified with -h (%s)\n", pValue);
+                    printf("\n");
+                    PrintUsage();
+                    return 1;
+                }
+                break;
+
+            case OPT_MIPLEVELS:
+                if (swscanf_s(pValue, L"%Iu", &mipLevels) != 1)
+                {
+                    wprintf( L"Invalid value specified with -m (%s)\n", pValue);
+                    wprintf( L"\n");
+                    PrintUsage();
+                    return 1;
+                }
+                break;
+
+            case OPT_FORMAT:
+                format = (DXGI_FORMAT) LookupByName(pValue, g_pFormats);
+                if ( !format )
+                {
+                    wprintf( L"Invalid value specified with -f (%s)\n", pValue);
+                    wprintf( L"\n");
+                    PrintUsage();
+                    return 1;
+                }
+                break;
+
+            case OPT_FILTER:
+                dwFilter = LookupByName(pValue, g_pFilters);
+                if ( !dwFilter )
+                {
+                    wprintf( L"Invalid value specified with -if (%s)\n", pValue);
+                    wprintf( L"\n");
+                    PrintUsage();
+                    return 1;
+                }
+                break;
+
+            case OPT_SRGBI:
+                dwSRGB |= TEX_FILTER_SRGB_IN;
+                break;
+
+            case OPT_SRGBO:
+                dwSRGB |= TEX_FILTER_SRGB_OUT;
+                break;
+
+            case OPT_SRGB:
+                dwSRGB |= TEX_FILTER_SRGB;
+                break;
+
+            case OPT_SEPALPHA:
+                dwFilterOpts |= TEX_FILTER_SEPARATE_ALPHA;
+                break;
+
+            case OPT_PREFIX:
+                wcscpy_s(szPrefix, MAX_PATH, pValue);
+                break;
+
+            case OPT_SUFFIX:
+                wcscpy_s(szSuffix, MAX_PATH, pValue);
+                break;
+
+            case OPT_OUTPUTDIR:
+                wcscpy_s(szOutputDir, MAX_PATH, pValue);
+                break;
+
+            case OPT_BATCH:
+                wcscpy_s(szManifest, MAX_PATH, pValue);
+                break;
+
+            case OPT_REPORT:
+                wcscpy_s(szReport, MAX_PATH, pValue);
+                break;
+
+            case OPT_FILETYPE:
+                FileType = LookupByName(pValue, g_pSaveFileTypes);
+                if ( !FileType )
+                {
+                    wprintf( L"Invalid value specified with -ft (%s)\n", pValue);
+                    wprintf( L"\n");
+                    PrintUsage();
+                    return 1;
+                }
+                break;
+
+            case OPT_TA_WRAP:
+                if ( dwFilterOpts & TEX_FILTER_MIRROR )
+                {
+                    wprintf( L"Can't use -wrap and -mirror at same time\n\n");
+                    PrintUsage();
+                    return 1;
+                }
+                dwFilterOpts |= TEX_FILTER_WRAP;
+                break;
+
+            case OPT_TA_MIRROR:
+                if ( dwFilterOpts & TEX_FILTER_WRAP )
+                {
+                    wprintf( L"Can't use -wrap and -mirror at same time\n\n");
+                    PrintUsage();
+                    return 1;
+                }
+                dwFilterOpts |= TEX_FILTER_MIRROR;
+                break;
+            }
+        }
+        else
+        {         
+            SConversion *pConv = new SConversion;
+            if ( !pConv )
+                return 1;
+
+            wcscpy_s(pConv->szSrc, MAX_PATH, pArg);
+
+            pConv->szDest[0] = 0;
+            pConv->pNext = nullptr;
+
+            *ppConversion = pConv;
+            ppConversion = &pConv->pNext;
+        }
+    }
+
+    if(szManifest[0])
+    {
+        hr = LoadManifest(szManifest, ppConversion);
+        if(FAILED(hr))
+        {
+            wprintf( L"Failed to read manifest %s (%x)\n", szManifest, hr);
+            return 1;
+        }
+    }
+
+    if(!pConversion)
+    {
+        PrintUsage();
+        return 0;
+    }
+
+    if(~dwOptions & (1 << OPT_NOLOGO))
+        PrintLogo();
+
+    // Work out out filename prefix and suffix
+    if(szOutputDir[0] && (L'\\' != szOutputDir[wcslen(szOutputDir) - 1]))
+        wcscat_s( szOutputDir, MAX_PATH, L"\\" );
+
+    if(szPrefix[0])
+        wcscat_s(szOutputDir, MAX_PATH, szPrefix);
+
+    wcscpy_s(szPrefix, MAX_PATH, szOutputDir);
+
+    const WCHAR* fileTypeName = LookupByValue(FileType, g_pSaveFileTypes);
+
+    if (fileTypeName)
+    {
+        wcscat_s(szSuffix, MAX_PATH, L".");
+        wcscat_s(szSuffix, MAX_PATH, fileTypeName);
+    }
+    else
+    {
+        wcscat_s(szSuffix, MAX_PATH, L".unknown");
+    }
+
+    if (FileType != CODEC_DDS)
+    {
+        mipLevels = 1;
+    }
+
+    if (dwOptions & (1 << OPT_STREAM))
+    {
+        // Streaming writes the compressed top-level image as it's read, so there's no
+        // whole image to resize, flip, or premultiply. With -m the image is loaded, but
+        // each row of blocks of the mips is compressed as soon as it's box filtered
+        const DWORD dwNoStream = (1 << OPT_WIDTH) | (1 << OPT_HEIGHT) | (1 << OPT_HFLIP) | (1 << OPT_VFLIP)
+                                 | (1 << OPT_PREMUL_ALPHA) | (1 << OPT_BATCH);
+
+        if (!IsCompressed(format) || FileType != CODEC_DDS || (dwOptions & dwNoStream))
+        {
+            wprintf( L"-stream needs a BC -f format and DDS output, and can't be used with -w, -h, -hflip, -vflip, -pmalpha, or -batch\n\n");
+            PrintUsage();
+            return 1;
+        }
+
+        DWORD dwBoxFilter = dwFilter & ~TEX_FILTER_FORCE_NON_WIC;
+        if ((dwOptions & (1 << OPT_MIPLEVELS)) && dwBoxFilter != TEX_FILTER_DEFAULT && dwBoxFilter != TEX_FILTER_BOX)
+        {
+            wprintf( L"-stream can only generate mips with the BOX or BOX_NON_WIC filter\n\n");
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    SSettings settings;
+    settings.width = width;
+    settings.height = height;
+    settings.mipLevels = mipLevels;
+    settings.format = format;
+    settings.dwFilter = dwFilter;
+    settings.dwSRGB = dwSRGB;
+    settings.dwFilterOpts = dwFilterOpts;
+    settings.FileType = FileType;
+    settings.dwOptions = dwOptions;
+    settings.verbose = true;
+    wcscpy_s(settings.szPrefix, MAX_PATH, szPrefix);
+    wcscpy_s(settings.szSuffix, MAX_PATH, szSuffix);
+
+    // Convert images
+    std::vector<SConversion*> jobs;
+    for( SConversion *pConv = pConversion; pConv; pConv = pConv->pNext )
+    {
+        BuildDestName( pConv, settings );
+        jobs.push_back( pConv );
+    }
+
+    std::vector<SJobReport> reports( jobs.size() );
+    size_t nJobs = 0;
+
+    QueryPerformanceFrequency( &g_qpcFreq );
+
+    LARGE_INTEGER qpcStart;
+    QueryPerformanceCounter( &qpcStart );
+
+    nReturn = 0;
+
+    if ( szManifest[0] )
+    {
+        WCHAR szHashFile[MAX_PATH];
+        if ( wcslen( szManifest ) + 7 >= MAX_PATH )
+        {
+            wprintf( L"Manifest path is too long (%s)\n", szManifest );
+            nReturn = 1;
+            goto LDone;
+        }
+
+        wcscpy_s( szHashFile, MAX_PATH, szManifest );
+        wcscat_s( szHashFile, MAX_PATH, L".hash" );
+
+        RunBatch( jobs, settings, szHashFile, reports );
+        nJobs = jobs.size();
+
+        size_t converted = 0, skipped = 0, failed = 0;
+        for( size_t index = 0; index < nJobs; ++index )
+        {
+            switch( reports[ index ].status )
+            {
+            case JOB_OK:        ++converted; break;
+            case JOB_SKIPPED:   ++skipped; break;
+            default:            ++failed; break;
+            }
+        }
+
+        wprintf( L"\n%Iu converted, %Iu up to date, %Iu failed\n", converted, skipped, failed );
+
+        if ( failed > 0 )
+            nReturn = 1;
+    }
+    else
+    {
+        for( ; nJobs < jobs.size(); ++nJobs )
+        {
+            if ( nJobs > 0 )
+                wprintf( L"\n");
+
+            if ( ConvertFile( jobs[ nJobs ], settings, nullptr, 0, reports[ nJobs ] ) == JOB_ERROR )
+            {
+                ++nJobs;
+                nReturn = 1;
+                break;
+            }
+        }
+    }
+
+    for( size_t index = 0; index < nJobs; ++index )
+    {
+        if ( reports[ index ].nonpow2 )
+        {
+            wprintf( L"\n WARNING: Not all feature levels support non-power-of-2 textures with mipmaps\n" );
+            break;
+        }
+    }
+
+    if ( szReport[0] )
+    {
+        LARGE_INTEGER qpcEnd = qpcStart;
+        double msElapsed = ElapsedMs( qpcEnd );
+
+        hr = WriteReport( szReport, jobs, reports, nJobs, msElapsed );
+        if ( FAILED(hr) )
+        {
+            wprintf( L"Failed to write report %s (%x)\n", szReport, hr );
+            nReturn = 1;
+        }
+    }
 
 LDone:
 
     while(pConversion)
     {
-        pConv = pConversion;
+        SConversion *pConv = pConversion;
         pConversion = pConversion->pNext;
         delete pConv;
     }
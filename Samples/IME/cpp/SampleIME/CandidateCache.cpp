@@ -0,0 +1,568 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+
+#include "Private.h"
+#include "CandidateCache.h"
+#include "RegKey.h"
+#include "Define.h"
+
+//+---------------------------------------------------------------------------
+//
+// ctor
+//
+//----------------------------------------------------------------------------
+
+CCandidateCache::CCandidateCache(LCID locale)
+{
+    _locale = locale;
+    _pKeyCode = nullptr;
+    _keyCodeLength = 0;
+    _isFrequencyChanged = FALSE;
+    _unsavedChoiceCount = 0;
+    _lastSaveTime = GetTickCount64();
+}
+
+//+---------------------------------------------------------------------------
+//
+// dtor
+//
+//----------------------------------------------------------------------------
+
+CCandidateCache::~CCandidateCache()
+{
+    Clear();
+    ClearFrequency();
+}
+
+//+---------------------------------------------------------------------------
+//
+// FindNarrowed
+//
+//----------------------------------------------------------------------------
+
+BOOL CCandidateCache::FindNarrowed(_In_ CStringRange *pKeyCode, _Inout_ CSampleImeArray<CCandidateListItem> *pItemList)
+{
+    if (_pKeyCode == nullptr || pKeyCode->GetLength() < _keyCodeLength)
+    {
+        return FALSE;
+    }
+
+    CStringRange keyCodePrefix;
+    CStringRange cachedKeyCode;
+    keyCodePrefix.Set(pKeyCode->Get(), _keyCodeLength);
+    cachedKeyCode.Set(_pKeyCode, _keyCodeLength);
+    if (CStringRange::CompareKeyCode(&keyCodePrefix, &cachedKeyCode) != CSTR_EQUAL)
+    {
+        return FALSE;
+    }
+
+    CSampleImeArray<CCandidateListItem> narrowedList;
+    for (UINT index = 0; index < _itemList.Count(); index++)
+    {
+        CCandidateListItem* pItem = _itemList.GetAt(index);
+        if (pItem->_FindKeyCode.GetLength() < pKeyCode->GetLength())
+        {
+            continue;
+        }
+
+        CStringRange findKeyCodePrefix;
+        findKeyCodePrefix.Set(pItem->_FindKeyCode.Get(), pKeyCode->GetLength());
+        if (CStringRange::CompareKeyCode(&findKeyCodePrefix, pKeyCode) != CSTR_EQUAL)
+        {
+            continue;
+        }
+
+        CCandidateListItem* pLI = narrowedList.Append();
+        if (pLI)
+        {
+            *pLI = *pItem;
+        }
+    }
+
+    // The narrowed list is what the next key narrows further.
+    Set(pKeyCode, &narrowedList);
+
+    for (UINT index = 0; index < _itemList.Count(); index++)
+    {
+        CCandidateListItem* pLI = pItemList->Append();
+        if (pLI)
+        {
+            *pLI = *_itemList.GetAt(index);
+        }
+    }
+
+    return TRUE;
+}
+
+//+---------------------------------------------------------------------------
+//
+// Set
+//
+//----------------------------------------------------------------------------
+
+VOID CCandidateCache::Set(_In_ CStringRange *pKeyCode, _In_ CSampleImeArray<CCandidateListItem> *pItemList)
+{
+    WCHAR* pNewKeyCode = new (std::nothrow) WCHAR[pKeyCode->GetLength() + 1];
+    if (!pNewKeyCode)
+    {
+        Clear();
+        return;
+    }
+    StringCchCopyN(pNewKeyCode, pKeyCode->GetLength() + 1, pKeyCode->Get(), pKeyCode->GetLength());
+
+    if (pItemList != &_itemList)
+    {
+        _itemList.Clear();
+        _itemList.reserve(pItemList->Count());
+        for (UINT index = 0; index < pItemList->Count(); index++)
+        {
+            CCandidateListItem* pLI = _itemList.Append();
+            if (pLI)
+            {
+                *pLI = *pItemList->GetAt(index);
+            }
+        }
+    }
+
+    if (_pKeyCode)
+    {
+        delete [] _pKeyCode;
+    }
+    _pKeyCode = pNewKeyCode;
+    _keyCodeLength = pKeyCode->GetLength();
+}
+
+//+---------------------------------------------------------------------------
+//
+// Clear
+//
+//----------------------------------------------------------------------------
+
+VOID CCandidateCache::Clear()
+{
+    if (_pKeyCode)
+    {
+        delete [] _pKeyCode;
+        _pKeyCode = nullptr;
+    }
+    _keyCodeLength = 0;
+    _itemList.Clear();
+}
+
+//+---------------------------------------------------------------------------
+//
+// LoadFrequency
+//
+// The table is kept under HKCU as a REG_BINARY blob of entries, each a
+// DWORD count, a DWORD length and that many WCHARs, in item string order.
+//
+//----------------------------------------------------------------------------
+
+BOOL CCandidateCache::LoadFrequency()
+{
+    CRegKey key;
+    DWORD cbData = 0;
+
+    ClearFrequency();
+
+    if (key.Open(HKEY_CURRENT_USER, TEXTSERVICE_USER_KEY, KEY_READ) != ERROR_SUCCESS)
+    {
+        return FALSE;
+    }
+    if (key.QueryDWORDValue(TEXTSERVICE_FREQUENCY_SIZE_VALUE, cbData) != ERROR_SUCCESS || cbData == 0)
+    {
+        return FALSE;
+    }
+
+    BYTE* pData = new (std::nothrow) BYTE[cbData];
+    if (!pData)
+    {
+        return FALSE;
+    }
+
+    if (key.QueryBinaryValue(TEXTSERVICE_FREQUENCY_VALUE, pData, cbData) != ERROR_SUCCESS)
+    {
+        delete [] pData;
+        return FALSE;
+    }
+
+    DWORD offset = 0;
+    while (cbData - offset >= 2 * sizeof(DWORD) && _frequencyList.Count() < FREQUENCY_MAX_ENTRIES)
+    {
+        DWORD count = *(DWORD*)(pData + offset);
+        DWORD itemLength = *(DWORD*)(pData + offset + sizeof(DWORD));
+        offset += 2 * sizeof(DWORD);
+
+        if (itemLength == 0 || itemLength > (cbData - offset) / sizeof(WCHAR))
+        {
+            break;
+        }
+
+        CStringRange itemString;
+        itemString.Set((WCHAR*)(pData + offset), itemLength);
+        offset += itemLength * sizeof(WCHAR);
+
+        // Entries were saved in order, so this always appends, but a damaged
+        // value must not break the sort order that lookups depend on.
+        UINT index = 0;
+        if (FindFrequency(&itemString, &index))
+        {
+            continue;
+        }
+
+        _CANDIDATE_FREQUENCY* pEntry = _frequencyList.Append();
+        if (!pEntry)
+        {
+            break;
+        }
+        pEntry->pItemString = new (std::nothrow) WCHAR[itemLength];
+        if (!pEntry->pItemString)
+        {
+            _frequencyList.RemoveAt(_frequencyList.Count() - 1);
+            break;
+        }
+        memcpy(pEntry->pItemString, itemString.Get(), itemLength * sizeof(WCHAR));
+        pEntry->itemLength = itemLength;
+        pEntry->count = (count < FREQUENCY_MAX_COUNT) ? count : FREQUENCY_MAX_COUNT;
+
+        // move it into place if the saved order was wrong
+        for (UINT move = _frequencyList.Count() - 1; move > index; move--)
+        {
+            _CANDIDATE_FREQUENCY entry = *_frequencyList.GetAt(move);
+            *_frequencyList.GetAt(move) = *_frequencyList.GetAt(move - 1);
+            *_frequencyList.GetAt(move - 1) = entry;
+        }
+    }
+
+    delete [] pData;
+    _isFrequencyChanged = FALSE;
+    return TRUE;
+}
+
+//+---------------------------------------------------------------------------
+//
+// SaveFrequency
+//
+//----------------------------------------------------------------------------
+
+BOOL CCandidateCache::SaveFrequency()
+{
+    if (!_isFrequencyChanged)
+    {
+        return TRUE;
+    }
+
+    DWORD cbData = 0;
+    for (UINT index = 0; index < _frequencyList.Count(); index++)
+    {
+        cbData += 2 * sizeof(DWORD) + _frequencyList.GetAt(index)->itemLength * sizeof(WCHAR);
+    }
+
+    BYTE* pData = new (std::nothrow) BYTE[cbData ? cbData : 1];
+    if (!pData)
+    {
+        return FALSE;
+    }
+
+    DWORD offset = 0;
+    for (UINT index = 0; index < _frequencyList.Count(); index++)
+    {
+        const _CANDIDATE_FREQUENCY* pEntry = _frequencyList.GetAt(index);
+        *(DWORD*)(pData + offset) = pEntry->count;
+        *(DWORD*)(pData + offset + sizeof(DWORD)) = pEntry->itemLength;
+        offset += 2 * sizeof(DWORD);
+        memcpy(pData + offset, pEntry->pItemString, pEntry->itemLength * sizeof(WCHAR));
+        offset += pEntry->itemLength * sizeof(WCHAR);
+    }
+
+    BOOL ret = FALSE;
+    CRegKey key;
+    if (key.Create(HKEY_CURRENT_USER, TEXTSERVICE_USER_KEY) == ERROR_SUCCESS)
+    {
+        // Write the data before its size, so a reader never sees a size larger than the data.
+        if (key.SetDWORDValue(TEXTSERVICE_FREQUENCY_SIZE_VALUE, 0) == ERROR_SUCCESS &&
+            key.SetBinaryValue(TEXTSERVICE_FREQUENCY_VALUE, pData, cbData) == ERROR_SUCCESS &&
+            key.SetDWORDValue(TEXTSERVICE_FREQUENCY_SIZE_VALUE, cbData) == ERROR_SUCCESS)
+        {
+            _isFrequencyChanged = FALSE;
+            _unsavedChoiceCount = 0;
+            _lastSaveTime = GetTickCount64();
+            ret = TRUE;
+        }
+    }
+
+    delete [] pData;
+    return ret;
+}
+
+//+---------------------------------------------------------------------------
+//
+// SaveFrequencyIfDue
+//
+// The table is otherwise only written when the IME is deactivated, so a
+// process that crashes would lose every choice made since it started. Save
+// once enough choices, or enough time, have gone by since the last save,
+// which keeps registry writes rare while typing.
+//
+//----------------------------------------------------------------------------
+
+BOOL CCandidateCache::SaveFrequencyIfDue()
+{
+    if (_unsavedChoiceCount < FREQUENCY_SAVE_CHOICES &&
+        GetTickCount64() - _lastSaveTime < FREQUENCY_SAVE_INTERVAL)
+    {
+        return TRUE;
+    }
+
+    return SaveFrequency();
+}
+
+//+---------------------------------------------------------------------------
+//
+// AddFrequency
+//
+//----------------------------------------------------------------------------
+
+VOID CCandidateCache::AddFrequency(_In_ CStringRange *pItemString)
+{
+    if (pItemString->GetLength() == 0 || pItemString->GetLength() > DWORD_MAX)
+    {
+        return;
+    }
+
+    _unsavedChoiceCount++;
+
+    UINT index = 0;
+    if (FindFrequency(pItemString, &index))
+    {
+        _CANDIDATE_FREQUENCY* pEntry = _frequencyList.GetAt(index);
+        pEntry->count++;
+
+        // Once any count reaches the cap, halve them all rather than let it
+        // stick there: the order between entries is kept, and later choices
+        // can still overtake it.
+        if (pEntry->count >= FREQUENCY_MAX_COUNT)
+        {
+            AgeFrequency();
+        }
+        _isFrequencyChanged = TRUE;
+        return;
+    }
+
+    if (_frequencyList.Count() >= FREQUENCY_MAX_ENTRIES)
+    {
+        AgeFrequency();
+        if (_frequencyList.Count() >= FREQUENCY_MAX_ENTRIES)
+        {
+            return;
+        }
+        FindFrequency(pItemString, &index);
+    }
+
+    _CANDIDATE_FREQUENCY* pEntry = _frequencyList.Append();
+    if (!pEntry)
+    {
+        return;
+    }
+    pEntry->pItemString = new (std::nothrow) WCHAR[pItemString->GetLength()];
+    if (!pEntry->pItemString)
+    {
+        _frequencyList.RemoveAt(_frequencyList.Count() - 1);
+        return;
+    }
+    memcpy(pEntry->pItemString, pItemString->Get(), pItemString->GetLength() * sizeof(WCHAR));
+    pEntry->itemLength = (DWORD)pItemString->GetLength();
+    pEntry->count = 1;
+
+    for (UINT move = _frequencyList.Count() - 1; move > index; move--)
+    {
+        _CANDIDATE_FREQUENCY entry = *_frequencyList.GetAt(move);
+        *_frequencyList.GetAt(move) = *_frequencyList.GetAt(move - 1);
+        *_frequencyList.GetAt(move - 1) = entry;
+    }
+
+    _isFrequencyChanged = TRUE;
+}
+
+//+---------------------------------------------------------------------------
+//
+// RankByFrequency
+//
+// Only the few candidates the user has chosen before are ordered, by
+// insertion into a short top list; the rest of the list is not sorted.
+//
+//----------------------------------------------------------------------------
+
+VOID CCandidateCache::RankByFrequency(_Inout_ CSampleImeArray<CCandidateListItem> *pItemList)
+{
+    if (_frequencyList.Count() == 0 || pItemList->Count() < 2)
+    {
+        return;
+    }
+
+    UINT topIndex[FREQUENCY_TOP_COUNT];
+    DWORD topCount[FREQUENCY_TOP_COUNT];
+    UINT topTotal = 0;
+
+    for (UINT index = 0; index < pItemList->Count(); index++)
+    {
+        UINT frequencyIndex = 0;
+        if (!FindFrequency(&pItemList->GetAt(index)->_ItemString, &frequencyIndex))
+        {
+            continue;
+        }
+        DWORD count = _frequencyList.GetAt(frequencyIndex)->count;
+
+        // keep the list in descending count; equal counts keep list order
+        UINT insert = topTotal;
+        while (insert > 0 && topCount[insert - 1] < count)
+        {
+            insert--;
+        }
+        if (insert >= FREQUENCY_TOP_COUNT)
+        {
+            continue;
+        }
+        if (topTotal < FREQUENCY_TOP_COUNT)
+        {
+            topTotal++;
+        }
+        for (UINT move = topTotal - 1; move > insert; move--)
+        {
+            topIndex[move] = topIndex[move - 1];
+            topCount[move] = topCount[move - 1];
+        }
+        topIndex[insert] = index;
+        topCount[insert] = count;
+    }
+
+    if (topTotal == 0)
+    {
+        return;
+    }
+
+    CSampleImeArray<CCandidateListItem> rankedList;
+    rankedList.reserve(pItemList->Count());
+
+    for (UINT top = 0; top < topTotal; top++)
+    {
+        CCandidateListItem* pLI = rankedList.Append();
+        if (pLI)
+        {
+            *pLI = *pItemList->GetAt(topIndex[top]);
+        }
+    }
+    for (UINT index = 0; index < pItemList->Count(); index++)
+    {
+        BOOL isRanked = FALSE;
+        for (UINT top = 0; top < topTotal; top++)
+        {
+            if (topIndex[top] == index)
+            {
+                isRanked = TRUE;
+                break;
+            }
+        }
+        if (isRanked)
+        {
+            continue;
+        }
+        CCandidateListItem* pLI = rankedList.Append();
+        if (pLI)
+        {
+            *pLI = *pItemList->GetAt(index);
+        }
+    }
+
+    for (UINT index = 0; index < rankedList.Count() && index < pItemList->Count(); index++)
+    {
+        *pItemList->GetAt(index) = *rankedList.GetAt(index);
+    }
+}
+
+//+---------------------------------------------------------------------------
+//
+// FindFrequency
+//
+// Binary search of the frequency table.
+// returns
+//     TRUE if found, with *pIndex its index; otherwise FALSE, with *pIndex
+//     the index it would be inserted at.
+//
+//----------------------------------------------------------------------------
+
+BOOL CCandidateCache::FindFrequency(_In_ CStringRange *pItemString, _Out_ UINT *pIndex)
+{
+    UINT low = 0;
+    UINT high = _frequencyList.Count();
+
+    while (low < high)
+    {
+        UINT mid = low + (high - low) / 2;
+        const _CANDIDATE_FREQUENCY* pEntry = _frequencyList.GetAt(mid);
+
+        int result = CompareStringOrdinal(pEntry->pItemString, pEntry->itemLength,
+            pItemString->Get(), (int)pItemString->GetLength(), FALSE);
+        if (result == CSTR_EQUAL)
+        {
+            *pIndex = mid;
+            return TRUE;
+        }
+        if (result == CSTR_LESS_THAN)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    *pIndex = low;
+    return FALSE;
+}
+
+//+---------------------------------------------------------------------------
+//
+// AgeFrequency
+//
+// Halve every count and drop entries that reach zero, so the table stays
+// bounded and recent choices outweigh old ones.
+//
+//----------------------------------------------------------------------------
+
+VOID CCandidateCache::AgeFrequency()
+{
+    for (UINT index = 0; index < _frequencyList.Count();)
+    {
+        _CANDIDATE_FREQUENCY* pEntry = _frequencyList.GetAt(index);
+        pEntry->count /= 2;
+        if (pEntry->count == 0)
+        {
+            delete [] pEntry->pItemString;
+            _frequencyList.RemoveAt(index);
+            continue;
+        }
+        index++;
+    }
+    _isFrequencyChanged = TRUE;
+}
+
+//+---------------------------------------------------------------------------
+//
+// ClearFrequency
+//
+//----------------------------------------------------------------------------
+
+VOID CCandidateCache::ClearFrequency()
+{
+    for (UINT index = 0; index < _frequencyList.Count(); index++)
+    {
+        delete [] _frequencyList.GetAt(index)->pItemString;
+    }
+    _frequencyList.Clear();
+}
@@ -0,0 +1,79 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+
+
+#pragma once
+
+#include "SampleIMEBaseStructure.h"
+
+//////////////////////////////////////////////////////////////////////
+//
+// CCandidateCache declaration.
+//
+// Keeps the candidates found for the last incremental search. Typing one
+// more key only ever removes candidates, so the next search narrows this
+// list instead of asking the dictionary engine again.
+//
+// Also keeps a per-user table of how often each candidate string has been
+// chosen, used to move the most used candidates to the top of the list.
+//
+//////////////////////////////////////////////////////////////////////
+
+class CCandidateCache
+{
+public:
+    CCandidateCache(LCID locale);
+    virtual ~CCandidateCache();
+
+    // Narrow the cached candidates to those whose key code starts with pKeyCode.
+    // returns
+    //     FALSE if pKeyCode does not extend the cached key code; pItemList is unchanged.
+    BOOL FindNarrowed(_In_ CStringRange *pKeyCode, _Inout_ CSampleImeArray<CCandidateListItem> *pItemList);
+
+    // Remember the candidates found for pKeyCode. pItemList's key codes must not have been trimmed yet.
+    VOID Set(_In_ CStringRange *pKeyCode, _In_ CSampleImeArray<CCandidateListItem> *pItemList);
+    VOID Clear();
+
+    // Frequency table
+    BOOL LoadFrequency();
+    BOOL SaveFrequency();
+    BOOL SaveFrequencyIfDue();
+    VOID AddFrequency(_In_ CStringRange *pItemString);
+
+    // Move up to FREQUENCY_TOP_COUNT of the most used candidates to the top,
+    // most used first; the others keep their order.
+    VOID RankByFrequency(_Inout_ CSampleImeArray<CCandidateListItem> *pItemList);
+
+private:
+    struct _CANDIDATE_FREQUENCY
+    {
+        WCHAR* pItemString;     // not zero terminated
+        DWORD itemLength;
+        DWORD count;
+    };
+
+    BOOL FindFrequency(_In_ CStringRange *pItemString, _Out_ UINT *pIndex);
+    VOID AgeFrequency();
+    VOID ClearFrequency();
+
+    LCID _locale;
+
+    WCHAR* _pKeyCode;           // key code of the cached candidates; nullptr if none.
+    DWORD_PTR _keyCodeLength;
+    CSampleImeArray<CCandidateListItem> _itemList;
+
+    CSampleImeArray<_CANDIDATE_FREQUENCY> _frequencyList;  // sorted by item string
+    BOOL _isFrequencyChanged;
+    UINT _unsavedChoiceCount;       // candidates chosen since the table was last saved
+    ULONGLONG _lastSaveTime;        // GetTickCount64() of the last save
+
+    static const UINT FREQUENCY_TOP_COUNT = 9;
+    static const UINT FREQUENCY_MAX_ENTRIES = 4096;
+    static const DWORD FREQUENCY_MAX_COUNT = 0xffff;
+    static const UINT FREQUENCY_SAVE_CHOICES = 16;
+    static const ULONGLONG FREQUENCY_SAVE_INTERVAL = 60 * 1000;    // in milliseconds
+};
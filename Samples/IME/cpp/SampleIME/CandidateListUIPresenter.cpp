@@ -52,6 +52,8 @@ HRESULT CSampleIME::_HandleCandidateFinalize(TfEditCookie ec, _In_ ITfContext *p
         {
             return hr;
         }
+
+        _pCompositionProcessorEngine->AddCandidateFrequency(&candidateString);
     }
 
 NoPresenter:
@@ -172,6 +174,8 @@ HRESULT CSampleIME::_HandleCandidateWorker(TfEditCookie ec, _In_ ITfContext *pCo
 
         if (hrReturn == S_OK)
         {
+            _pCompositionProcessorEngine->AddCandidateFrequency(&candidateString);
+
             // copy temp candidate
             _pCandidateListUIPresenter = pTempCandListUIPresenter;
 
@@ -100,6 +100,10 @@ CCompositionProcessorEngine::CCompositionProcessorEngine()
 {
     _pTableDictionaryEngine = nullptr;
     _pDictionaryFile = nullptr;
+    _dictionaryLastWriteTime.dwLowDateTime = 0;
+    _dictionaryLastWriteTime.dwHighDateTime = 0;
+    _dictionaryFileSize.QuadPart = 0;
+    _pCandidateCache = nullptr;
 
     _langid = 0xffff;
     _guidProfile = GUID_NULL;
@@ -121,6 +125,7 @@ CCompositionProcessorEngine::CCompositionProcessorEngine()
     _isDisableWildcardAtFirst = FALSE;
     _hasMakePhraseFromText = FALSE;
     _isKeystrokeSort = FALSE;
+    _isSecureMode = FALSE;
 
     _candidateListPhraseModifier = 0;
 
@@ -143,6 +148,13 @@ CCompositionProcessorEngine::~CCompositionProcessorEngine()
         _pTableDictionaryEngine = nullptr;
     }
 
+    if (_pCandidateCache)
+    {
+        SaveCandidateFrequency();
+        delete _pCandidateCache;
+        _pCandidateCache = nullptr;
+    }
+
     if (_pLanguageBar_IMEMode)
     {
         _pLanguageBar_IMEMode->CleanUp();
@@ -225,6 +237,7 @@ BOOL CCompositionProcessorEngine::SetupLanguageProfile(LANGID langid, REFGUID gu
     }
 
     _isComLessMode = isComLessMode;
+    _isSecureMode = isSecureMode;
     _langid = langid;
     _guidProfile = guidLanguageProfile;
     _tfClientId = tfClientId;
@@ -237,6 +250,15 @@ BOOL CCompositionProcessorEngine::SetupLanguageProfile(LANGID langid, REFGUID gu
     SetupConfiguration();
     SetupDictionaryFile();
 
+    if (_pCandidateCache == nullptr)
+    {
+        _pCandidateCache = new (std::nothrow) CCandidateCache(GetLocale());
+        if (_pCandidateCache && !_isSecureMode)
+        {
+            _pCandidateCache->LoadFrequency();
+        }
+    }
+
 Exit:
     return ret;
 }
@@ -262,6 +284,14 @@ BOOL CCompositionProcessorEngine::AddVirtualKey(WCHAR wch)
     // append one keystroke in buffer.
     //
     DWORD_PTR srgKeystrokeBufLen = _keystrokeBuffer.GetLength();
+
+    if (srgKeystrokeBufLen == 0)
+    {
+        // No candidates from the last composition are in use, so this is
+        // the time to pick up a replaced dictionary.
+        RefreshDictionaryFile();
+    }
+
     PWCHAR pwch = new (std::nothrow) WCHAR[ srgKeystrokeBufLen + 1 ];
     if (!pwch)
     {
@@ -431,16 +461,39 @@ void CCompositionProcessorEngine::GetCandidateList(_Inout_ CSampleImeArray<CCand
             return;
         }
 
-        _pTableDictionaryEngine->CollectWordForWildcard(&wildcardSearch, pCandidateList);
+        // Another key appended to the keystrokes only removes candidates, so narrow
+        // the last keystroke's list rather than search the dictionary again.
+        if (isFindWildcard || !_pCandidateCache || !_pCandidateCache->FindNarrowed(&_keystrokeBuffer, pCandidateList))
+        {
+            _pTableDictionaryEngine->CollectWordForWildcard(&wildcardSearch, pCandidateList);
+
+            if (IsKeystrokeSort())
+            {
+                _pTableDictionaryEngine->SortListItemByFindKeyCode(pCandidateList);
+            }
+
+            if (_pCandidateCache)
+            {
+                if (isFindWildcard)
+                {
+                    _pCandidateCache->Clear();
+                }
+                else
+                {
+                    _pCandidateCache->Set(&_keystrokeBuffer, pCandidateList);
+                }
+            }
+        }
 
         if (0 >= pCandidateList->Count())
         {
+            delete [] pwch;
             return;
         }
 
-        if (IsKeystrokeSort())
+        if (_pCandidateCache)
         {
-            _pTableDictionaryEngine->SortListItemByFindKeyCode(pCandidateList);
+            _pCandidateCache->RankByFrequency(pCandidateList);
         }
 
         // Incremental search would show keystroke data from all candidate list items
@@ -466,13 +519,21 @@ void CCompositionProcessorEngine::GetCandidateList(_Inout_ CSampleImeArray<CCand
 
         delete [] pwch;
     }
-    else if (isWildcardSearch)
-    {
-        _pTableDictionaryEngine->CollectWordForWildcard(&_keystrokeBuffer, pCandidateList);
-    }
     else
     {
-        _pTableDictionaryEngine->CollectWord(&_keystrokeBuffer, pCandidateList);
+        if (isWildcardSearch)
+        {
+            _pTableDictionaryEngine->CollectWordForWildcard(&_keystrokeBuffer, pCandidateList);
+        }
+        else
+        {
+            _pTableDictionaryEngine->CollectWord(&_keystrokeBuffer, pCandidateList);
+        }
+
+        if (_pCandidateCache)
+        {
+            _pCandidateCache->RankByFrequency(pCandidateList);
+        }
     }
 
     for (UINT index = 0; index < pCandidateList->Count();)
@@ -532,6 +593,40 @@ void CCompositionProcessorEngine::GetCandidateStringInConverted(CStringRange &se
     delete [] pwch;
 }
 
+//+---------------------------------------------------------------------------
+//
+// AddCandidateFrequency
+//
+//----------------------------------------------------------------------------
+
+void CCompositionProcessorEngine::AddCandidateFrequency(_In_ CStringRange *pCandidateString)
+{
+    if (_pCandidateCache)
+    {
+        _pCandidateCache->AddFrequency(pCandidateString);
+
+        if (!_isSecureMode)
+        {
+            _pCandidateCache->SaveFrequencyIfDue();
+        }
+    }
+}
+
+//+---------------------------------------------------------------------------
+//
+// SaveCandidateFrequency
+//
+//----------------------------------------------------------------------------
+
+void CCompositionProcessorEngine::SaveCandidateFrequency()
+{
+    // Nothing the user types on the secure desktop is remembered.
+    if (_pCandidateCache && !_isSecureMode)
+    {
+        _pCandidateCache->SaveFrequency();
+    }
+}
+
 //+---------------------------------------------------------------------------
 //
 // IsPunctuation
@@ -1011,17 +1106,32 @@ BOOL CCompositionProcessorEngine::SetupDictionaryFile()
             goto ErrorExit;
         }
     }
-    if (!(_pDictionaryFile)->CreateFile(pwszFileName, GENERIC_READ, OPEN_EXISTING, FILE_SHARE_READ))
+    // The file stays mapped while the IME is loaded. Share it for write and delete
+    // so the dictionary can still be updated or replaced; RefreshDictionaryFile
+    // maps the new file at the start of the next composition.
+    if (!(_pDictionaryFile)->CreateFile(pwszFileName, GENERIC_READ, OPEN_EXISTING, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE))
     {
         goto ErrorExit;
     }
 
+    WIN32_FILE_ATTRIBUTE_DATA fileData;
+    if (GetFileAttributesEx(pwszFileName, GetFileExInfoStandard, &fileData))
+    {
+        _dictionaryLastWriteTime = fileData.ftLastWriteTime;
+        _dictionaryFileSize.LowPart = fileData.nFileSizeLow;
+        _dictionaryFileSize.HighPart = fileData.nFileSizeHigh;
+    }
+
     _pTableDictionaryEngine = new (std::nothrow) CTableDictionaryEngine(GetLocale(), _pDictionaryFile);
     if (!_pTableDictionaryEngine)
     {
         goto ErrorExit;
     }
 
+    // Index key codes once here rather than scanning the dictionary on every keystroke.
+    // If this fails, searches fall back to scanning.
+    _pTableDictionaryEngine->SetupIndex();
+
     delete []pwszFileName;
     return TRUE;
 ErrorExit:
@@ -1032,6 +1142,53 @@ ErrorExit:
     return FALSE;
 }
 
+//+---------------------------------------------------------------------------
+//
+// RefreshDictionaryFile
+//
+// If the dictionary file has been written or replaced since it was mapped,
+// drop the old mapping and its index and set up the new file. Candidate
+// strings point into the mapped view, so this must only be called when no
+// candidate list is in use.
+//
+//----------------------------------------------------------------------------
+
+void CCompositionProcessorEngine::RefreshDictionaryFile()
+{
+    if (!_pDictionaryFile || !_pDictionaryFile->GetFileName())
+    {
+        return;
+    }
+
+    WIN32_FILE_ATTRIBUTE_DATA fileData;
+    if (!GetFileAttributesEx(_pDictionaryFile->GetFileName(), GetFileExInfoStandard, &fileData))
+    {
+        // Missing, or part way through being replaced: keep the old mapping.
+        return;
+    }
+
+    if ((CompareFileTime(&fileData.ftLastWriteTime, &_dictionaryLastWriteTime) == 0) &&
+        (fileData.nFileSizeLow == _dictionaryFileSize.LowPart) &&
+        (fileData.nFileSizeHigh == _dictionaryFileSize.HighPart))
+    {
+        return;
+    }
+
+    if (_pCandidateCache)
+    {
+        _pCandidateCache->Clear();
+    }
+    if (_pTableDictionaryEngine)
+    {
+        delete _pTableDictionaryEngine;
+        _pTableDictionaryEngine = nullptr;
+    }
+    delete _pDictionaryFile;
+    _pDictionaryFile = nullptr;
+
+    SetupDictionaryFile();
+}
+
 //+---------------------------------------------------------------------------
 //
 // GetDictionaryFile
@@ -10,6 +10,7 @@
 
 #include "sal.h"
 #include "TableDictionaryEngine.h"
+#include "CandidateCache.h"
 #include "KeyHandlerEditSession.h"
 #include "SampleIMEBaseStructure.h"
 #include "FileMapping.h"
@@ -49,6 +50,10 @@ public:
     void GetCandidateList(_Inout_ CSampleImeArray<CCandidateListItem> *pCandidateList, BOOL isIncrementalWordSearch, BOOL isWildcardSearch);
     void GetCandidateStringInConverted(CStringRange &searchString, _In_ CSampleImeArray<CCandidateListItem> *pCandidateList);
 
+    // Count a candidate the user chose, so it ranks higher in later candidate lists.
+    void AddCandidateFrequency(_In_ CStringRange *pCandidateString);
+    void SaveCandidateFrequency();
+
     // Preserved key handler
     void OnPreservedKey(REFGUID rguid, _Out_ BOOL *pIsEaten, _In_ ITfThreadMgr *pThreadMgr, TfClientId tfClientId);
 
@@ -111,6 +116,7 @@ private:
 
     
     BOOL SetupDictionaryFile();
+    void RefreshDictionaryFile();
     CFile* GetDictionaryFile();
 
 private:
@@ -132,6 +138,8 @@ private:
     CTableDictionaryEngine* _pTableDictionaryEngine;
     CStringRange _keystrokeBuffer;
 
+    CCandidateCache* _pCandidateCache;
+
     BOOL _hasWildcardIncludedInKeystrokeBuffer;
 
     LANGID _langid;
@@ -184,11 +192,14 @@ private:
     BOOL _hasMakePhraseFromText : 1;
     BOOL _isKeystrokeSort : 1;
     BOOL _isComLessMode : 1;
+    BOOL _isSecureMode : 1;
     CCandidateRange _candidateListIndexRange;
     UINT _candidateListPhraseModifier;
     UINT _candidateWndWidth;
 
     CFileMapping* _pDictionaryFile;
+    FILETIME _dictionaryLastWriteTime;  // of _pDictionaryFile when it was mapped
+    ULARGE_INTEGER _dictionaryFileSize;
 
     static const int OUT_OF_FILE_INDEX = -1;
 };
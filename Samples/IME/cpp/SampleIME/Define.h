@@ -12,6 +12,9 @@
 #define TEXTSERVICE_LANGID       MAKELANGID(LANG_CHINESE, SUBLANG_CHINESE_SIMPLIFIED)
 #define TEXTSERVICE_ICON_INDEX   -IDIS_SAMPLEIME
 #define TEXTSERVICE_DIC L"SampleIMESimplifiedQuanPin.txt"
+#define TEXTSERVICE_USER_KEY                L"Software\\Microsoft\\SampleIME"
+#define TEXTSERVICE_FREQUENCY_VALUE         L"CandidateFrequency"
+#define TEXTSERVICE_FREQUENCY_SIZE_VALUE    L"CandidateFrequencySize"
 
 #define IME_MODE_ON_ICON_INDEX      IDI_IME_MODE_ON
 #define IME_MODE_OFF_ICON_INDEX     IDI_IME_MODE_OFF
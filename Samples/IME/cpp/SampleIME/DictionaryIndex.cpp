@@ -0,0 +1,242 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+
+#include "Private.h"
+#include "DictionaryIndex.h"
+#include "SampleIMEBaseStructure.h"
+#include <algorithm>
+
+//+---------------------------------------------------------------------------
+//
+// ctor
+//
+//----------------------------------------------------------------------------
+
+CDictionaryIndex::CDictionaryIndex(LCID locale) : CDictionaryParser(locale)
+{
+    _pReadBuffer = nullptr;
+}
+
+//+---------------------------------------------------------------------------
+//
+// dtor
+//
+//----------------------------------------------------------------------------
+
+CDictionaryIndex::~CDictionaryIndex()
+{
+}
+
+//+---------------------------------------------------------------------------
+//
+// Clear
+//
+//----------------------------------------------------------------------------
+
+VOID CDictionaryIndex::Clear()
+{
+    _entries.Clear();
+    _pReadBuffer = nullptr;
+}
+
+//+---------------------------------------------------------------------------
+//
+// Build
+//
+// Walk the dictionary file once, recording where each line and its key code
+// are, then sort by key code. Lines with the same key code keep their file
+// order, so candidates come out in the order the dictionary lists them.
+// The shipped dictionary is already sorted by key code, in which case the
+// sort is skipped.
+//
+//----------------------------------------------------------------------------
+
+BOOL CDictionaryIndex::Build(_In_ CFile *pFile)
+{
+    Clear();
+
+    const WCHAR *pwch = pFile->GetReadBufferPointer();
+    if (pwch == nullptr)
+    {
+        return FALSE;
+    }
+
+    DWORD_PTR dwTotalBufLen = pFile->GetFileSize() / sizeof(WCHAR);     // in char
+    if (dwTotalBufLen == 0 || dwTotalBufLen > DWORD_MAX)
+    {
+        return FALSE;
+    }
+
+    DWORD_PTR indexTrace = 0;     // in char
+    BOOL isSorted = TRUE;
+
+    while (indexTrace < dwTotalBufLen)
+    {
+        if (pwch[indexTrace] == L'\r' || pwch[indexTrace] == L'\n' || pwch[indexTrace] == L'\0')
+        {
+            indexTrace++;
+            continue;
+        }
+
+        DWORD_PTR bufLenOneLine = GetOneLine(&pwch[indexTrace], dwTotalBufLen - indexTrace);
+        if (bufLenOneLine == 0)
+        {
+            indexTrace++;
+            continue;
+        }
+
+        // Lines without a key code (no keyword delimiter) can never match a search.
+        CParserStringRange keyword;
+        if (ParseLine(&pwch[indexTrace], bufLenOneLine, &keyword))
+        {
+            _DICTIONARY_INDEX_ENTRY* pEntry = _entries.Append();
+            if (!pEntry)
+            {
+                _entries.Clear();
+                return FALSE;
+            }
+            pEntry->lineOffset = (DWORD)indexTrace;
+            pEntry->lineLength = (DWORD)bufLenOneLine;
+            pEntry->keyOffset = (DWORD)(keyword.Get() - pwch);
+            pEntry->keyLength = (DWORD)keyword.GetLength();
+
+            if (isSorted && _entries.Count() > 1)
+            {
+                const _DICTIONARY_INDEX_ENTRY* pPrev = _entries.GetAt(_entries.Count() - 2);
+                CStringRange prevKeyCode;
+                prevKeyCode.Set(&pwch[pPrev->keyOffset], pPrev->keyLength);
+                if (CStringRange::CompareKeyCode(&prevKeyCode, &keyword) == CSTR_GREATER_THAN)
+                {
+                    isSorted = FALSE;
+                }
+            }
+        }
+
+        indexTrace += bufLenOneLine;
+    }
+
+    if (_entries.Count() == 0)
+    {
+        return FALSE;
+    }
+
+    if (!isSorted)
+    {
+        _DICTIONARY_INDEX_ENTRY* pBegin = _entries.GetAt(0);
+        std::stable_sort(pBegin, pBegin + _entries.Count(),
+            [pwch](const _DICTIONARY_INDEX_ENTRY& entry1, const _DICTIONARY_INDEX_ENTRY& entry2)
+            {
+                CStringRange keyCode1;
+                CStringRange keyCode2;
+                keyCode1.Set(&pwch[entry1.keyOffset], entry1.keyLength);
+                keyCode2.Set(&pwch[entry2.keyOffset], entry2.keyLength);
+                return CStringRange::CompareKeyCode(&keyCode1, &keyCode2) == CSTR_LESS_THAN;
+            });
+    }
+
+    _pReadBuffer = pwch;
+    return TRUE;
+}
+
+//+---------------------------------------------------------------------------
+//
+// FindRange
+//
+// Two binary searches: the first entry not less than the key code, and the
+// first entry greater than it. For a prefix search entries are compared on
+// their first pKeyCode->GetLength() characters only, which keeps them in
+// the same order since keys are sorted character by character.
+//
+//----------------------------------------------------------------------------
+
+VOID CDictionaryIndex::FindRange(_In_ CStringRange *pKeyCode, BOOL isPrefixSearch, _Out_ UINT *pFirst, _Out_ UINT *pLast)
+{
+    UINT low = 0;
+    UINT high = _entries.Count();
+
+    *pFirst = 0;
+    *pLast = 0;
+
+    if (!IsBuilt())
+    {
+        return;
+    }
+
+    // lower bound
+    while (low < high)
+    {
+        UINT mid = low + (high - low) / 2;
+        if (CompareKeyCode(_entries.GetAt(mid), pKeyCode, isPrefixSearch) < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    *pFirst = low;
+
+    // upper bound
+    high = _entries.Count();
+    while (low < high)
+    {
+        UINT mid = low + (high - low) / 2;
+        if (CompareKeyCode(_entries.GetAt(mid), pKeyCode, isPrefixSearch) <= 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    *pLast = low;
+}
+
+//+---------------------------------------------------------------------------
+//
+// GetLine
+// GetKeyCode
+//
+//----------------------------------------------------------------------------
+
+VOID CDictionaryIndex::GetLine(UINT index, _Out_ CStringRange *pLine)
+{
+    const _DICTIONARY_INDEX_ENTRY* pEntry = _entries.GetAt(index);
+    pLine->Set(&_pReadBuffer[pEntry->lineOffset], pEntry->lineLength);
+}
+
+VOID CDictionaryIndex::GetKeyCode(UINT index, _Out_ CStringRange *pKeyCode)
+{
+    const _DICTIONARY_INDEX_ENTRY* pEntry = _entries.GetAt(index);
+    pKeyCode->Set(&_pReadBuffer[pEntry->keyOffset], pEntry->keyLength);
+}
+
+//+---------------------------------------------------------------------------
+//
+// CompareKeyCode
+//
+// returns <0, 0 or >0 as the entry's key code sorts before, equal to or
+// after pKeyCode.
+//
+//----------------------------------------------------------------------------
+
+int CDictionaryIndex::CompareKeyCode(const _DICTIONARY_INDEX_ENTRY *pEntry, _In_ CStringRange *pKeyCode, BOOL isPrefixSearch)
+{
+    DWORD keyLength = pEntry->keyLength;
+
+    if (isPrefixSearch && keyLength > pKeyCode->GetLength())
+    {
+        keyLength = (DWORD)pKeyCode->GetLength();
+    }
+
+    CStringRange entryKeyCode;
+    entryKeyCode.Set(&_pReadBuffer[pEntry->keyOffset], keyLength);
+
+    return CStringRange::CompareKeyCode(&entryKeyCode, pKeyCode) - CSTR_EQUAL;
+}
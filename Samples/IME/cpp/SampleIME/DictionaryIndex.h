@@ -0,0 +1,70 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+
+
+#pragma once
+
+#include "File.h"
+#include "DictionaryParser.h"
+#include "SampleIMEBaseStructure.h"
+
+//////////////////////////////////////////////////////////////////////
+//
+// _DICTIONARY_INDEX_ENTRY
+//
+// One dictionary line. Offsets and lengths are in characters from the
+// start of the dictionary file's read buffer, so the index holds no copy
+// of the text: keys and values are read straight from the mapped file.
+//
+//////////////////////////////////////////////////////////////////////
+
+struct _DICTIONARY_INDEX_ENTRY
+{
+    DWORD lineOffset;
+    DWORD lineLength;
+    DWORD keyOffset;
+    DWORD keyLength;
+};
+
+//////////////////////////////////////////////////////////////////////
+//
+// CDictionaryIndex declaration.
+//
+// Array of the dictionary's lines sorted by key code (ordinal, ignoring
+// case). Built once when the dictionary file is set up; after that a key
+// code or the literal prefix of a wildcard is found by binary search
+// instead of by scanning every line of the file.
+//
+//////////////////////////////////////////////////////////////////////
+
+class CDictionaryIndex : CDictionaryParser
+{
+public:
+    CDictionaryIndex(LCID locale);
+    virtual ~CDictionaryIndex();
+
+    BOOL Build(_In_ CFile *pFile);
+    BOOL IsBuilt() { return _pReadBuffer ? TRUE : FALSE; }
+    VOID Clear();
+
+    // Find the entries whose key code equals (isPrefixSearch FALSE) or starts
+    // with (isPrefixSearch TRUE) pKeyCode.
+    // returns
+    //     [out] pFirst, pLast - entries [pFirst, pLast) match.
+    VOID FindRange(_In_ CStringRange *pKeyCode, BOOL isPrefixSearch, _Out_ UINT *pFirst, _Out_ UINT *pLast);
+
+    UINT Count() { return _entries.Count(); }
+
+    VOID GetLine(UINT index, _Out_ CStringRange *pLine);
+    VOID GetKeyCode(UINT index, _Out_ CStringRange *pKeyCode);
+
+private:
+    int CompareKeyCode(const _DICTIONARY_INDEX_ENTRY *pEntry, _In_ CStringRange *pKeyCode, BOOL isPrefixSearch);
+
+    CSampleImeArray<_DICTIONARY_INDEX_ENTRY> _entries;
+    const WCHAR *_pReadBuffer;     // dictionary file's read buffer; nullptr if not built.
+};
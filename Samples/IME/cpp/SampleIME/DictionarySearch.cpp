@@ -15,11 +15,15 @@
 //
 //----------------------------------------------------------------------------
 
-CDictionarySearch::CDictionarySearch(LCID locale, _In_ CFile *pFile, _In_ CStringRange *pSearchKeyCode) : CDictionaryParser(locale)
+CDictionarySearch::CDictionarySearch(LCID locale, _In_ CFile *pFile, _In_ CStringRange *pSearchKeyCode, _In_opt_ CDictionaryIndex *pIndex) : CDictionaryParser(locale)
 {
     _pFile = pFile;
     _pSearchKeyCode = pSearchKeyCode;
     _charIndex = 0;
+    _pIndex = pIndex;
+    _isIndexRangeSet = FALSE;
+    _indexTrace = 0;
+    _indexEnd = 0;
 }
 
 //+---------------------------------------------------------------------------
@@ -73,6 +77,11 @@ BOOL CDictionarySearch::FindConvertedStringForWildcard(CDictionaryResult **ppdre
 
 BOOL CDictionarySearch::FindWorker(BOOL isTextSearch, _Out_ CDictionaryResult **ppdret, BOOL isWildcardSearch)
 {
+    if (!isTextSearch && _pIndex && _pIndex->IsBuilt())
+    {
+        return FindInIndex(ppdret, isWildcardSearch);
+    }
+
     DWORD_PTR dwTotalBufLen = GetBufferInWCharLength();        // in char
     if (dwTotalBufLen == 0)
     {
@@ -107,7 +116,7 @@ TryAgain:
             // Compare Dictionary key code and input key code
             if (!isWildcardSearch)
             {
-                if (CStringRange::Compare(_locale, &keyword, _pSearchKeyCode) != CSTR_EQUAL)
+                if (CStringRange::CompareKeyCode(&keyword, _pSearchKeyCode) != CSTR_EQUAL)
                 {
                     if (bufLen)
                     {
@@ -119,7 +128,7 @@ TryAgain:
             else
             {
                 // Wildcard search
-                if (!CStringRange::WildcardCompare(_locale, _pSearchKeyCode, &keyword))
+                if (!CStringRange::WildcardCompareKeyCode(_pSearchKeyCode, &keyword))
                 {
                     if (bufLen)
                     {
@@ -248,3 +257,110 @@ FindNextLine:
 
     goto TryAgain;
 }
+
+//+---------------------------------------------------------------------------
+//
+// FindInIndex
+//
+// Key code search using the sorted index. Only the entries whose key code
+// equals the search key code, or starts with the characters before its first
+// wildcard, are compared; the comparison itself is the same as FindWorker's.
+//
+//----------------------------------------------------------------------------
+
+BOOL CDictionarySearch::FindInIndex(_Out_ CDictionaryResult **ppdret, BOOL isWildcardSearch)
+{
+    *ppdret = nullptr;
+
+    if (!_isIndexRangeSet)
+    {
+        CStringRange keyCode;
+        keyCode = *_pSearchKeyCode;
+
+        if (isWildcardSearch)
+        {
+            DWORD_PTR prefixLength = 0;
+            while (prefixLength < _pSearchKeyCode->GetLength())
+            {
+                WCHAR wch = *(_pSearchKeyCode->Get() + prefixLength);
+                if (wch == L'*' || wch == L'?')
+                {
+                    break;
+                }
+                prefixLength++;
+            }
+            keyCode.Set(_pSearchKeyCode->Get(), prefixLength);
+        }
+
+        _pIndex->FindRange(&keyCode, isWildcardSearch, &_indexTrace, &_indexEnd);
+        _isIndexRangeSet = TRUE;
+    }
+
+    while (_indexTrace < _indexEnd)
+    {
+        UINT index = _indexTrace++;
+
+        CStringRange keyword;
+        _pIndex->GetKeyCode(index, &keyword);
+
+        if (!isWildcardSearch)
+        {
+            if (CStringRange::CompareKeyCode(&keyword, _pSearchKeyCode) != CSTR_EQUAL)
+            {
+                continue;
+            }
+        }
+        else
+        {
+            if (!CStringRange::WildcardCompareKeyCode(_pSearchKeyCode, &keyword))
+            {
+                continue;
+            }
+        }
+
+        CStringRange line;
+        _pIndex->GetLine(index, &line);
+
+        return CreateResult(line.Get(), line.GetLength(), ppdret);
+    }
+
+    return FALSE;
+}
+
+//+---------------------------------------------------------------------------
+//
+// CreateResult
+//
+//----------------------------------------------------------------------------
+
+BOOL CDictionarySearch::CreateResult(_In_reads_(dwBufLen) LPCWSTR pwszLine, DWORD_PTR dwBufLen, _Out_ CDictionaryResult **ppdret)
+{
+    *ppdret = new (std::nothrow) CDictionaryResult();
+    if (!*ppdret)
+    {
+        return FALSE;
+    }
+
+    CParserStringRange keyword;
+    CSampleImeArray<CParserStringRange> valueStrings;
+    if (!ParseLine(pwszLine, dwBufLen, &keyword, &valueStrings))
+    {
+        delete *ppdret;
+        *ppdret = nullptr;
+        return FALSE;
+    }
+
+    (*ppdret)->_FindKeyCode = keyword;
+    (*ppdret)->_SearchKeyCode = *_pSearchKeyCode;
+
+    for (UINT i = 0; i < valueStrings.Count(); i++)
+    {
+        CStringRange* findPhrase = (*ppdret)->_FindPhraseList.Append();
+        if (findPhrase)
+        {
+            *findPhrase = *valueStrings.GetAt(i);
+        }
+    }
+
+    return TRUE;
+}
@@ -10,6 +10,7 @@
 
 #include "File.h"
 #include "DictionaryParser.h"
+#include "DictionaryIndex.h"
 #include "SampleIMEBaseStructure.h"
 
 class CDictionaryResult;
@@ -23,7 +24,7 @@ class CDictionaryResult;
 class CDictionarySearch : CDictionaryParser
 {
 public:
-    CDictionarySearch(LCID locale, _In_ CFile *pFile, _In_ CStringRange *pSearchKeyCode);
+    CDictionarySearch(LCID locale, _In_ CFile *pFile, _In_ CStringRange *pSearchKeyCode, _In_opt_ CDictionaryIndex *pIndex = nullptr);
     virtual ~CDictionarySearch();
 
     BOOL FindPhrase(_Out_ CDictionaryResult **ppdret);
@@ -37,6 +38,8 @@ public:
 
 private:
     BOOL FindWorker(BOOL isTextSearch, _Out_ CDictionaryResult **ppdret, BOOL isWildcardSearch);
+    BOOL FindInIndex(_Out_ CDictionaryResult **ppdret, BOOL isWildcardSearch);
+    BOOL CreateResult(_In_reads_(dwBufLen) LPCWSTR pwszLine, DWORD_PTR dwBufLen, _Out_ CDictionaryResult **ppdret);
 
     DWORD_PTR GetBufferInWCharLength()
     {
@@ -49,6 +52,11 @@ private:
     }
 
     CFile* _pFile;
+
+    CDictionaryIndex* _pIndex;  // sorted key codes; nullptr to scan the file.
+    BOOL _isIndexRangeSet;
+    UINT _indexTrace;           // next entry of _pIndex to compare.
+    UINT _indexEnd;             // end of the entries that can match.
 };
 
 //////////////////////////////////////////////////////////////////////
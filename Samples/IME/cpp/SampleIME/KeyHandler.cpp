@@ -300,6 +300,8 @@ HRESULT CSampleIME::_HandleCompositionFinalize(TfEditCookie ec, _In_ ITfContext
             {
                 return hr;
             }
+
+            _pCompositionProcessorEngine->AddCandidateFrequency(&candidateString);
         }
     }
     else
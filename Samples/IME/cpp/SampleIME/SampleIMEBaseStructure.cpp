@@ -196,7 +196,26 @@ int CStringRange::Compare(LCID locale, _In_ CStringRange* pString1, _In_ CString
         (DWORD)pString2->GetLength());
 }
 
+int CStringRange::CompareKeyCode(_In_ CStringRange* pString1, _In_ CStringRange* pString2)
+{
+    return CompareStringOrdinal(pString1->Get(),
+        (int)pString1->GetLength(),
+        pString2->Get(),
+        (int)pString2->GetLength(),
+        TRUE);
+}
+
 BOOL CStringRange::WildcardCompare(LCID locale, _In_ CStringRange* stringWithWildcard, _In_ CStringRange* targetString)
+{
+    return WildcardCompareWorker(locale, FALSE, stringWithWildcard, targetString);
+}
+
+BOOL CStringRange::WildcardCompareKeyCode(_In_ CStringRange* stringWithWildcard, _In_ CStringRange* targetString)
+{
+    return WildcardCompareWorker(LOCALE_INVARIANT, TRUE, stringWithWildcard, targetString);
+}
+
+BOOL CStringRange::WildcardCompareWorker(LCID locale, BOOL isOrdinal, _In_ CStringRange* stringWithWildcard, _In_ CStringRange* targetString)
 {
     if (stringWithWildcard->GetLength() == 0)
     {
@@ -210,22 +229,30 @@ BOOL CStringRange::WildcardCompare(LCID locale, _In_ CStringRange* stringWithWil
 
     if (*stringWithWildcard->Get() == L'*')
     {
-        return WildcardCompare(locale, &stringWithWildcard_next, targetString) || ((targetString->GetLength() != 0) && WildcardCompare(locale, stringWithWildcard, &targetString_next));
+        return WildcardCompareWorker(locale, isOrdinal, &stringWithWildcard_next, targetString) || ((targetString->GetLength() != 0) && WildcardCompareWorker(locale, isOrdinal, stringWithWildcard, &targetString_next));
     }
     if (*stringWithWildcard->Get() == L'?')
     {
-        return ((targetString->GetLength() != 0) && WildcardCompare(locale, &stringWithWildcard_next, &targetString_next));
+        return ((targetString->GetLength() != 0) && WildcardCompareWorker(locale, isOrdinal, &stringWithWildcard_next, &targetString_next));
     }
 
     BOOL isSurrogate1 = (IS_HIGH_SURROGATE(*stringWithWildcard->Get()) || IS_LOW_SURROGATE(*stringWithWildcard->Get()));
     BOOL isSurrogate2 = (IS_HIGH_SURROGATE(*targetString->Get()) || IS_LOW_SURROGATE(*targetString->Get()));
 
-    return ((CompareString(locale,
+    int result = isOrdinal ?
+        CompareStringOrdinal(stringWithWildcard->Get(),
+        (isSurrogate1 ? 2 : 1),
+        targetString->Get(),
+        (isSurrogate2 ? 2 : 1),
+        TRUE) :
+        CompareString(locale,
         NORM_IGNORECASE,
         stringWithWildcard->Get(),
         (isSurrogate1 ? 2 : 1),
         targetString->Get(),
-        (isSurrogate2 ? 2 : 1)) == CSTR_EQUAL) && WildcardCompare(locale, &stringWithWildcard_next, &targetString_next));
+        (isSurrogate2 ? 2 : 1));
+
+    return ((result == CSTR_EQUAL) && WildcardCompareWorker(locale, isOrdinal, &stringWithWildcard_next, &targetString_next));
 }
 
 CCandidateRange::CCandidateRange(void)
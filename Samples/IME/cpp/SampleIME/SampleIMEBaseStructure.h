@@ -220,7 +220,16 @@ public:
     static int Compare(LCID locale, _In_ CStringRange* pString1, _In_ CStringRange* pString2);
     static BOOL WildcardCompare(LCID locale, _In_ CStringRange* stringWithWildcard, _In_ CStringRange* targetString);
 
+    // Key codes compare ordinally, ignoring case, one character at a time.
+    // The dictionary index is sorted in this order, so every lookup of a key
+    // code has to match with these rather than the linguistic Compare.
+    static int CompareKeyCode(_In_ CStringRange* pString1, _In_ CStringRange* pString2);
+    static BOOL WildcardCompareKeyCode(_In_ CStringRange* stringWithWildcard, _In_ CStringRange* targetString);
+
 protected:
+    static BOOL WildcardCompareWorker(LCID locale, BOOL isOrdinal, _In_ CStringRange* stringWithWildcard, _In_ CStringRange* targetString);
+
+
     DWORD_PTR _stringBufLen;         // Length is in character count.
     const WCHAR *_pStringBuf;    // Buffer which is not add zero terminate.
 };
@@ -18,7 +18,7 @@
 VOID CTableDictionaryEngine::CollectWord(_In_ CStringRange *pKeyCode, _Inout_ CSampleImeArray<CStringRange> *pWordStrings)
 {
     CDictionaryResult* pdret = nullptr;
-    CDictionarySearch dshSearch(_locale, _pDictionaryFile, pKeyCode);
+    CDictionarySearch dshSearch(_locale, _pDictionaryFile, pKeyCode, &_index);
 
     while (dshSearch.FindPhrase(&pdret))
     {
@@ -40,7 +40,7 @@ VOID CTableDictionaryEngine::CollectWord(_In_ CStringRange *pKeyCode, _Inout_ CS
 VOID CTableDictionaryEngine::CollectWord(_In_ CStringRange *pKeyCode, _Inout_ CSampleImeArray<CCandidateListItem> *pItemList)
 {
     CDictionaryResult* pdret = nullptr;
-    CDictionarySearch dshSearch(_locale, _pDictionaryFile, pKeyCode);
+    CDictionarySearch dshSearch(_locale, _pDictionaryFile, pKeyCode, &_index);
 
     while (dshSearch.FindPhrase(&pdret))
     {
@@ -69,7 +69,7 @@ VOID CTableDictionaryEngine::CollectWord(_In_ CStringRange *pKeyCode, _Inout_ CS
 VOID CTableDictionaryEngine::CollectWordForWildcard(_In_ CStringRange *pKeyCode, _Inout_ CSampleImeArray<CCandidateListItem> *pItemList)
 {
     CDictionaryResult* pdret = nullptr;
-    CDictionarySearch dshSearch(_locale, _pDictionaryFile, pKeyCode);
+    CDictionarySearch dshSearch(_locale, _pDictionaryFile, pKeyCode, &_index);
 
     while (dshSearch.FindPhraseForWildcard(&pdret))
     {
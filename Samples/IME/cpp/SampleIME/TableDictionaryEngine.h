@@ -8,13 +8,18 @@
 #pragma once
 
 #include "BaseDictionaryEngine.h"
+#include "DictionaryIndex.h"
 
 class CTableDictionaryEngine : public CBaseDictionaryEngine
 {
 public:
-    CTableDictionaryEngine(LCID locale, _In_ CFile *pDictionaryFile) : CBaseDictionaryEngine(locale, pDictionaryFile) { }
+    CTableDictionaryEngine(LCID locale, _In_ CFile *pDictionaryFile) : CBaseDictionaryEngine(locale, pDictionaryFile), _index(locale) { }
     virtual ~CTableDictionaryEngine() { }
 
+    // Build the sorted key code index used by CollectWord and CollectWordForWildcard.
+    // Without it (or if building fails) they scan the whole dictionary file.
+    BOOL SetupIndex() { return _index.Build(_pDictionaryFile); }
+
     // Collect word from phrase string.
     // param
     //     [in] psrgKeyCode - Specified key code pointer
@@ -27,4 +32,7 @@ public:
     VOID CollectWordForWildcard(_In_ CStringRange *psrgKeyCode, _Inout_ CSampleImeArray<CCandidateListItem> *pItemList);
 
     VOID CollectWordFromConvertedStringForWildcard(_In_ CStringRange *pString, _Inout_ CSampleImeArray<CCandidateListItem> *pItemList);
+
+private:
+    CDictionaryIndex _index;
 };
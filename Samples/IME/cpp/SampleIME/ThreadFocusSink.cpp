@@ -44,6 +44,13 @@ STDAPI CSampleIME::OnSetThreadFocus()
 
 STDAPI CSampleIME::OnKillThreadFocus()
 {
+    // The user is switching to another thread, which may be in another
+    // process: keep the candidates chosen so far.
+    if (_pCompositionProcessorEngine)
+    {
+        _pCompositionProcessorEngine->SaveCandidateFrequency();
+    }
+
     if (_pCandidateListUIPresenter)
     {
         ITfDocumentMgr* pCandidateListDocumentMgr = nullptr;
@@ -0,0 +1,268 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+
+//////////////////////////////////////////////////////////////////////
+//
+// SampleIMEBench
+//
+// Keystroke latency of SampleIME's dictionary lookup.
+//
+//     SampleIMEBench [entries]
+//
+// Writes a dictionary of the given number of entries (default 1000000)
+// in SampleIME's "KEY"="phrase" format to a temporary file, in random
+// key order, and opens it with the IME's own CFileMapping and
+// CTableDictionaryEngine. It then types the key codes of a sample of
+// entries one character at a time, doing for each keystroke the
+// incremental "KEY*" search CCompositionProcessorEngine::GetCandidateList
+// does, and reports the latency distribution: first through the sorted
+// key code index, then through the old scan of the whole file.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "Private.h"
+#include "Globals.h"
+#include "FileMapping.h"
+#include "TableDictionaryEngine.h"
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// The dictionary code only needs these from Globals.cpp, which brings in
+// the whole text service.
+namespace Global {
+extern const WCHAR UnicodeByteOrderMark = 0xFEFF;
+extern const WCHAR KeywordDelimiter = L'=';
+extern const WCHAR StringDelimiter  = L'\"';
+}
+
+static const UINT DEFAULT_ENTRY_COUNT = 1000000;
+static const UINT INDEXED_WORD_COUNT = 500;     // words typed through the index
+static const UINT SCANNED_WORD_COUNT = 5;       // words typed through the scan
+
+static const LPCWSTR Syllables[] = {
+    L"A", L"AI", L"AN", L"ANG", L"BA", L"BAI", L"BAN", L"BAO", L"BEI", L"BEN",
+    L"BI", L"BIAN", L"BU", L"CAI", L"CHANG", L"CHE", L"CHENG", L"CHI", L"CHU", L"DA",
+    L"DAN", L"DAO", L"DE", L"DENG", L"DI", L"DIAN", L"DONG", L"DU", L"E", L"ER",
+    L"FA", L"FAN", L"FANG", L"FEN", L"FU", L"GAN", L"GAO", L"GE", L"GONG", L"GUO",
+    L"HAI", L"HAO", L"HE", L"HONG", L"HUA", L"HUI", L"JI", L"JIA", L"JIAN", L"JING",
+    L"KAI", L"KAN", L"LAI", L"LI", L"LIANG", L"LU", L"MA", L"MEI", L"MING", L"NAN",
+    L"NI", L"PENG", L"QI", L"QIAN", L"REN", L"SHANG", L"SHI", L"SHUI", L"TA", L"TIAN",
+    L"WANG", L"WEI", L"WO", L"XI", L"XIAN", L"XIN", L"YANG", L"YI", L"ZHONG", L"ZI",
+};
+
+static ULONG randomSeed = 1;
+
+// Small linear congruential generator, so runs are repeatable.
+static UINT BenchRandom()
+{
+    randomSeed = randomSeed * 1103515245 + 12345;
+    return (randomSeed >> 8) & 0xffffff;
+}
+
+//+---------------------------------------------------------------------------
+//
+// WriteDictionary
+//
+// Write entryCount lines of one to three syllables and one to three CJK
+// ideographs as UTF-16 with a byte order mark. The key codes written are
+// also returned, in file order.
+//
+//----------------------------------------------------------------------------
+
+static BOOL WriteDictionary(_In_ PCWSTR pFileName, UINT entryCount, _Inout_ std::vector<std::wstring> *pKeyCodes)
+{
+    HANDLE fileHandle = ::CreateFile(pFileName, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return FALSE;
+    }
+
+    std::wstring buffer;
+    buffer.reserve(64 * 1024);
+    buffer.push_back(Global::UnicodeByteOrderMark);
+
+    BOOL isOK = TRUE;
+    for (UINT entry = 0; entry < entryCount && isOK; entry++)
+    {
+        std::wstring keyCode;
+        UINT syllableCount = 1 + BenchRandom() % 3;
+        for (UINT syllable = 0; syllable < syllableCount; syllable++)
+        {
+            keyCode += Syllables[BenchRandom() % ARRAYSIZE(Syllables)];
+        }
+        pKeyCodes->push_back(keyCode);
+
+        buffer += Global::StringDelimiter;
+        buffer += keyCode;
+        buffer += Global::StringDelimiter;
+        buffer += Global::KeywordDelimiter;
+        buffer += Global::StringDelimiter;
+        UINT phraseLength = 1 + BenchRandom() % 3;
+        for (UINT ch = 0; ch < phraseLength; ch++)
+        {
+            buffer += (WCHAR)(0x4E00 + BenchRandom() % 0x51A6);
+        }
+        buffer += Global::StringDelimiter;
+        buffer += L"\r\n";
+
+        if (buffer.size() >= 60 * 1024 || entry + 1 == entryCount)
+        {
+            DWORD bytesWritten = 0;
+            DWORD bytesToWrite = (DWORD)(buffer.size() * sizeof(WCHAR));
+            isOK = WriteFile(fileHandle, buffer.c_str(), bytesToWrite, &bytesWritten, nullptr) && bytesWritten == bytesToWrite;
+            buffer.clear();
+        }
+    }
+
+    CloseHandle(fileHandle);
+    return isOK;
+}
+
+static double ElapsedMicroseconds(LARGE_INTEGER start, LARGE_INTEGER frequency)
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (double)(now.QuadPart - start.QuadPart) * 1000000.0 / (double)frequency.QuadPart;
+}
+
+//+---------------------------------------------------------------------------
+//
+// TypeWords
+//
+// Type each key code one character at a time, doing the incremental search
+// for each keystroke, and print the latency percentiles.
+//
+//----------------------------------------------------------------------------
+
+static void TypeWords(_In_ PCWSTR pName, _In_ CTableDictionaryEngine *pEngine, _In_ const std::vector<std::wstring> &keyCodes, UINT wordCount)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+
+    std::vector<double> latencies;
+    ULONGLONG candidateTotal = 0;
+
+    for (UINT word = 0; word < wordCount; word++)
+    {
+        const std::wstring &keyCode = keyCodes[BenchRandom() % keyCodes.size()];
+
+        for (size_t typed = 1; typed <= keyCode.size(); typed++)
+        {
+            std::wstring search = keyCode.substr(0, typed) + L"*";
+            CStringRange wildcardSearch;
+            wildcardSearch.Set(search.c_str(), search.size());
+
+            CSampleImeArray<CCandidateListItem> candidateList;
+
+            LARGE_INTEGER start;
+            QueryPerformanceCounter(&start);
+            pEngine->CollectWordForWildcard(&wildcardSearch, &candidateList);
+            latencies.push_back(ElapsedMicroseconds(start, frequency));
+
+            candidateTotal += candidateList.Count();
+        }
+    }
+
+    if (latencies.empty())
+    {
+        return;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t count = latencies.size();
+
+    wprintf(L"%-8s %10Iu %12.1f %10.1f %10.1f %10.1f %12.1f\n",
+        pName, count,
+        (double)candidateTotal / count,
+        latencies[count / 2],
+        latencies[count * 95 / 100],
+        latencies[count * 99 / 100],
+        latencies[count - 1]);
+}
+
+int __cdecl wmain(int argc, _In_reads_(argc) WCHAR *argv[])
+{
+    UINT entryCount = DEFAULT_ENTRY_COUNT;
+    if (argc > 1)
+    {
+        entryCount = (UINT)_wtoi(argv[1]);
+    }
+    if (entryCount == 0)
+    {
+        wprintf(L"usage: SampleIMEBench [entries]\n");
+        return 1;
+    }
+
+    WCHAR tempPath[MAX_PATH];
+    WCHAR fileName[MAX_PATH];
+    if (!GetTempPath(ARRAYSIZE(tempPath), tempPath) ||
+        !GetTempFileName(tempPath, L"ime", 0, fileName))
+    {
+        wprintf(L"cannot make a temporary file name\n");
+        return 1;
+    }
+
+    std::vector<std::wstring> keyCodes;
+    keyCodes.reserve(entryCount);
+
+    wprintf(L"writing %u entries to %s\n", entryCount, fileName);
+    if (!WriteDictionary(fileName, entryCount, &keyCodes))
+    {
+        wprintf(L"cannot write the dictionary\n");
+        DeleteFile(fileName);
+        return 1;
+    }
+
+    int result = 1;
+    CFileMapping *pDictionaryFile = new (std::nothrow) CFileMapping();
+    if (pDictionaryFile && pDictionaryFile->CreateFile(fileName, GENERIC_READ, OPEN_EXISTING, FILE_SHARE_READ))
+    {
+        CTableDictionaryEngine *pIndexedEngine = new (std::nothrow) CTableDictionaryEngine(LOCALE_INVARIANT, pDictionaryFile);
+        CTableDictionaryEngine *pScanEngine = new (std::nothrow) CTableDictionaryEngine(LOCALE_INVARIANT, pDictionaryFile);
+
+        if (pIndexedEngine && pScanEngine)
+        {
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER start;
+            QueryPerformanceFrequency(&frequency);
+
+            // map the file first, so the index build time does not include it
+            pDictionaryFile->GetReadBufferPointer();
+
+            QueryPerformanceCounter(&start);
+            BOOL isIndexed = pIndexedEngine->SetupIndex();
+            wprintf(L"index build: %.1f ms%s\n\n", ElapsedMicroseconds(start, frequency) / 1000.0,
+                isIndexed ? L"" : L" (failed: searches scan)");
+
+            wprintf(L"%-8s %10s %12s %10s %10s %10s %12s\n",
+                L"search", L"keys", L"candidates", L"p50 us", L"p95 us", L"p99 us", L"max us");
+
+            randomSeed = 2;
+            TypeWords(L"index", pIndexedEngine, keyCodes, INDEXED_WORD_COUNT);
+            randomSeed = 2;
+            TypeWords(L"scan", pScanEngine, keyCodes, SCANNED_WORD_COUNT);
+            result = 0;
+        }
+        else
+        {
+            wprintf(L"out of memory\n");
+        }
+
+        delete pScanEngine;
+        delete pIndexedEngine;
+    }
+    else
+    {
+        wprintf(L"cannot open the dictionary\n");
+    }
+
+    delete pDictionaryFile;
+    DeleteFile(fileName);
+    return result;
+}
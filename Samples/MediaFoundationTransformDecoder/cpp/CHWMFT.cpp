@@ -107,6 +107,8 @@ CHWMFT::CHWMFT(void)
     m_dwStatus              = 0;
     m_dwNeedInputCount      = 0;
     m_dwHaveOutputCount     = 0;
+    m_dwFramesInProgress    = 0;
+    m_bNeedInputHeld        = FALSE;
     m_dwDecodeWorkQueueID   = 0;
     m_llCurrentSampleTime   = 0;
     m_bShutdown             = FALSE;
@@ -140,6 +142,8 @@ CHWMFT::~CHWMFT(void)
     SAFERELEASE(m_pOutputSampleQueue);
     DeleteCriticalSection(&m_csLock);
 
+    CDecodeTask::TracePoolStatistics();
+
     TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Exit", __FUNCTION__);
 
     if(InterlockedCompareExchange(&m_ulNumObjects, 1, 1) == 1)
@@ -571,8 +575,9 @@ HRESULT CHWMFT::OnMarker(
 HRESULT CHWMFT::RequestSample(
     const UINT32 un32StreamID)
 {
-    HRESULT         hr      = S_OK;
-    IMFMediaEvent*  pEvent  = NULL;
+    HRESULT         hr          = S_OK;
+    IMFMediaEvent*  pEvent      = NULL;
+    BOOL            bCounted    = FALSE;
 
     TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Enter",  __FUNCTION__);
 
@@ -588,6 +593,28 @@ HRESULT CHWMFT::RequestSample(
                 hr = MF_E_NOTACCEPTING;
                 break;
             }
+
+            /***************************************
+            ** Backpressure: every outstanding request
+            ** and every frame being decoded will
+            ** become an output sample. Only ask for
+            ** more input while they all fit in the
+            ** output queue, so the decode path never
+            ** finds it full. ProcessOutput sends the
+            ** held request once the queue drains
+            ***************************************/
+            if(m_pOutputSampleQueue->GetSampleCount() + m_dwFramesInProgress + m_dwNeedInputCount >= MFT_OUTPUT_QUEUE_HIGH_WATER)
+            {
+                TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Output queue is full, holding back the request",  __FUNCTION__);
+                m_bNeedInputHeld = TRUE;
+                break;
+            }
+
+            m_bNeedInputHeld = FALSE;
+
+            // Count the request now, so that a concurrent caller sees it in the check above
+            m_dwNeedInputCount++;
+            bCounted = TRUE;
         }
 
         hr = MFCreateMediaEvent(METransformNeedInput, GUID_NULL, S_OK, NULL, &pEvent);
@@ -617,12 +644,20 @@ HRESULT CHWMFT::RequestSample(
                 break;
             }
 
-            m_dwNeedInputCount++;
-
             TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): NeedInputCount: %u",  __FUNCTION__, m_dwNeedInputCount);
         }
     }while(false);
 
+    if(FAILED(hr) && (bCounted != FALSE))
+    {
+        CAutoLock lock(&m_csLock);
+
+        if(m_dwNeedInputCount > 0)
+        {
+            m_dwNeedInputCount--;
+        }
+    }
+
     SAFERELEASE(pEvent);
 
     TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Exit(hr=0x%x)", __FUNCTION__, hr);
@@ -647,7 +682,8 @@ HRESULT CHWMFT::FlushSamples(void)
             break;
         }        
 
-        m_dwHaveOutputCount = 0;    // Don't Output samples until new input samples are given
+        m_dwHaveOutputCount = 0;        // Don't Output samples until new input samples are given
+        m_bNeedInputHeld    = FALSE;    // The next start of stream requests input again
 
         hr = m_pInputSampleQueue->RemoveAllSamples();
         if(FAILED(hr))
@@ -674,6 +710,7 @@ HRESULT CHWMFT::ScheduleFrameDecode(void)
     HRESULT             hr              = S_OK;
     IMFSample*          pInputSample    = NULL;
     CDecodeTask*        pDecodeTask     = NULL;
+    BOOL                bDecodeStarted  = FALSE;
 
     TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Enter",  __FUNCTION__);
 
@@ -706,8 +743,16 @@ HRESULT CHWMFT::ScheduleFrameDecode(void)
         {
             break;
         }
+
+        bDecodeStarted = TRUE;
     }while(false);
 
+    if(bDecodeStarted == FALSE)
+    {
+        // No frame will come out of this call (the input queue may have been flushed)
+        EndFrame();
+    }
+
     SAFERELEASE(pInputSample);
     SAFERELEASE(pDecodeTask);
 
@@ -728,6 +773,7 @@ HRESULT CHWMFT::DecodeInputFrame(
     BYTE*           pbData              = NULL;
     UINT64          pun64MarkerID       = 0;
     LONGLONG        llSampleDuration    = MFT_DEFAULT_SAMPLE_DURATION;
+    BOOL            bFrameEnded         = FALSE;
 
     TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Enter",  __FUNCTION__);
 
@@ -860,8 +906,16 @@ HRESULT CHWMFT::DecodeInputFrame(
         ** Since this in an internal function
         ** we know m_pOutputSampleQueue can never be
         ** NULL due to InitializeTransform()
+        **
+        ** RequestSample only asks for input while
+        ** there is room for it, so the queue
+        ** cannot be full here
         ***************************************/
         hr = m_pOutputSampleQueue->AddSample(pOutputSample);
+
+        EndFrame();
+        bFrameEnded = TRUE;
+
         if(FAILED(hr))
         {
             TraceString(CHMFTTracing::TRACE_ERROR, L"%S(): Failed to add sample to output queue (hr=0x%x)",  __FUNCTION__, hr);
@@ -958,6 +1012,11 @@ HRESULT CHWMFT::DecodeInputFrame(
         }
     }while(false);
 
+    if(bFrameEnded == FALSE)
+    {
+        EndFrame();
+    }
+
     if(pMediaBuffer != NULL)
     {
         if(pbData != NULL)
@@ -974,6 +1033,17 @@ HRESULT CHWMFT::DecodeInputFrame(
     return hr;
 }
 
+void CHWMFT::EndFrame(void)
+{
+    // A frame accepted by ProcessInput reached the output queue, or was dropped on an error or flush
+    CAutoLock lock(&m_csLock);
+
+    if(m_dwFramesInProgress > 0)
+    {
+        m_dwFramesInProgress--;
+    }
+}
+
 BOOL CHWMFT::IsLocked(void)
 {
     /***************************************
@@ -10,6 +10,8 @@
 #define MFT_FRAMERATE_NUMERATOR     30
 #define MFT_FRAMERATE_DENOMINATOR   1
 #define MFT_DEFAULT_SAMPLE_DURATION 300000 // 1/30th of a second in hundred nanoseconds
+#define MFT_OUTPUT_QUEUE_HIGH_WATER 48     // Most output samples queued or promised before input is held back
+                                           // (must not exceed CSampleQueue::QUEUE_CAPACITY)
 
 enum eMFTStatus
 {
@@ -236,6 +238,7 @@ protected:
                                 );
     HRESULT             FlushSamples(void);
     HRESULT             ScheduleFrameDecode(void);
+    void                EndFrame(void);
     HRESULT             SendEvent(void);
     BOOL                IsLocked(void);
     BOOL                IsMFTReady(void);
@@ -250,6 +253,8 @@ protected:
                         DWORD               m_dwStatus;
                         DWORD               m_dwNeedInputCount;
                         DWORD               m_dwHaveOutputCount;
+                        DWORD               m_dwFramesInProgress;   // Accepted by ProcessInput, not yet in the output queue
+                        BOOL                m_bNeedInputHeld;       // RequestSample held back a request, ProcessOutput resends it
                         DWORD               m_dwDecodeWorkQueueID;
                         LONGLONG            m_llCurrentSampleTime;
                         BOOL                m_bFirstSample;
@@ -1,4 +1,5 @@
 #include "CHWMFT_DecodeTask.h"
+#include "CHWMFT_DebugLogger.h"
 #include <Mfapi.h>
 
 #include <initguid.h>
@@ -12,6 +13,11 @@
         (x) = NULL; \
     } \
 
+// Tasks that are free for reuse. A zero-filled SLIST_HEADER is an empty list.
+static  SLIST_HEADER    g_slDecodeTaskPool;
+static  volatile LONG   g_lPoolHits     = 0;    // Create() reused a pooled task
+static  volatile LONG   g_lPoolMisses   = 0;    // Create() had to allocate a task
+
 HRESULT CDecodeTask::Create(
     const DWORD         dwDecodeWorkQueueID,
     IMFSample*          pInputSample,
@@ -28,11 +34,24 @@ HRESULT CDecodeTask::Create(
             break;
         }
 
-        pNewDecodeTask  = new CDecodeTask();
-        if(pNewDecodeTask == NULL)
+        PSLIST_ENTRY pEntry = InterlockedPopEntrySList(&g_slDecodeTaskPool);
+        if(pEntry != NULL)
         {
-            hr = E_OUTOFMEMORY;
-            break;
+            InterlockedIncrement(&g_lPoolHits);
+
+            pNewDecodeTask  = CONTAINING_RECORD(pEntry, CDecodeTask, m_slPoolEntry);
+            pNewDecodeTask->m_ulRef = 1;
+        }
+        else
+        {
+            InterlockedIncrement(&g_lPoolMisses);
+
+            pNewDecodeTask  = new CDecodeTask();
+            if(pNewDecodeTask == NULL)
+            {
+                hr = E_OUTOFMEMORY;
+                break;
+            }
         }
 
         pNewDecodeTask->m_dwDecodeWorkQueueID       = dwDecodeWorkQueueID;
@@ -92,6 +111,44 @@ HRESULT CDecodeTask::End(void)
     return S_OK;
 }
 
+void CDecodeTask::TracePoolStatistics(void)
+{
+    TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): %d tasks reused, %d tasks allocated, %u tasks pooled",
+        __FUNCTION__, g_lPoolHits, g_lPoolMisses, QueryDepthSList(&g_slDecodeTaskPool));
+}
+
+void CDecodeTask::ReleasePool(void)
+{
+    PSLIST_ENTRY pEntry = InterlockedFlushSList(&g_slDecodeTaskPool);
+
+    while(pEntry != NULL)
+    {
+        CDecodeTask* pTask = CONTAINING_RECORD(pEntry, CDecodeTask, m_slPoolEntry);
+
+        pEntry = pEntry->Next;
+
+        delete pTask;
+    }
+}
+
+void CDecodeTask::ReturnToPool(
+    CDecodeTask*    pTask)
+{
+    // Drop the sample now, a pooled task should not keep it alive
+    SAFERELEASE(pTask->m_pInputSample);
+
+    if(QueryDepthSList(&g_slDecodeTaskPool) >= MAX_POOLED_TASKS)
+    {
+        // The pool is big enough already. The check is not exact, 
+        // the pool can end up a few tasks larger under contention.
+        delete pTask;
+    }
+    else
+    {
+        InterlockedPushEntrySList(&g_slDecodeTaskPool, &pTask->m_slPoolEntry);
+    }
+}
+
 HRESULT CDecodeTask::GetParameters(
     DWORD*  pdwFlags,
     DWORD*  pdwQueue)
@@ -209,7 +266,7 @@ ULONG CDecodeTask::Release(void)
 
     if(ulRef == 0)
     {
-        delete this;
+        ReturnToPool(this);
     }
 
     return ulRef;
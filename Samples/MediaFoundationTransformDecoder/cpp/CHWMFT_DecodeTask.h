@@ -4,6 +4,13 @@
 
 class IMYMFT;   // Defined in IMYMFT.h, included in the cpp for this class
 
+/***************************************
+** Decode tasks are pooled: when the last
+** reference is released the task goes
+** back on a lock-free list (SLIST) and
+** the next Create() reuses it instead of
+** allocating a new one.
+***************************************/
 class CDecodeTask: 
     public IMFAsyncCallback
 {
@@ -19,6 +26,10 @@ public:
                                 );
             HRESULT     End(void);
 
+    // Pool management
+    static  void        TracePoolStatistics(void);
+    static  void        ReleasePool(void);      // Call when the DLL unloads
+
     // IMFAsyncCallback Implementations
     HRESULT __stdcall   GetParameters(
                                 DWORD*  pdwFlags,
@@ -37,9 +48,16 @@ public:
     ULONG   __stdcall   Release(void);
 
 protected:
+    static  const       USHORT      MAX_POOLED_TASKS    = 32;
+
                         CDecodeTask(void);
                         ~CDecodeTask(void);
 
+    static  void        ReturnToPool(
+                                CDecodeTask*    pTask
+                                );
+
+                        SLIST_ENTRY m_slPoolEntry;  // Link while the task is in the pool
             volatile    ULONG       m_ulRef;
                         IMFSample*  m_pInputSample;
                         DWORD       m_dwDecodeWorkQueueID;
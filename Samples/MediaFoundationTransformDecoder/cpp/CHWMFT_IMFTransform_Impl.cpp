@@ -823,7 +823,9 @@ HRESULT CHWMFT::ProcessInput(
     ** See http://msdn.microsoft.com/en-us/library/ms703131(v=VS.85).aspx
     *****************************************/
 
-    HRESULT hr = S_OK;
+    HRESULT hr              = S_OK;
+    BOOL    bFrameStarted   = FALSE;
+    BOOL    bScheduled      = FALSE;
 
     TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Enter",  __FUNCTION__);
 
@@ -848,7 +850,10 @@ HRESULT CHWMFT::ProcessInput(
             }
             else
             {
+                // The request becomes a frame in progress until its output is queued
                 m_dwNeedInputCount--;
+                m_dwFramesInProgress++;
+                bFrameStarted = TRUE;
             }
         }
 
@@ -884,6 +889,8 @@ HRESULT CHWMFT::ProcessInput(
         }
 
         // Now schedule the work to decode the sample
+        bScheduled = TRUE;
+
         hr = ScheduleFrameDecode();
         if(FAILED(hr))
         {
@@ -891,6 +898,11 @@ HRESULT CHWMFT::ProcessInput(
         }
     }while(false);
 
+    if((bFrameStarted != FALSE) && (bScheduled == FALSE))
+    {
+        EndFrame();
+    }
+
     TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Exit (hr=0x%x)",  __FUNCTION__, hr);
 
     return hr;
@@ -1057,6 +1069,37 @@ HRESULT CHWMFT::ProcessOutput(
             break;
         }
 
+        {
+            BOOL bResend = FALSE;
+
+            {
+                CAutoLock lock(&m_csLock);
+
+                bResend             = m_bNeedInputHeld;
+                m_bNeedInputHeld    = FALSE;    // RequestSample holds it again if there is still no room
+            }
+
+            if(bResend != FALSE)
+            {
+                // A sample left the output queue, ask again for the input RequestSample held back
+
+                /*******************************
+                ** Todo: This MFT only has one
+                ** input stream, so RequestSample
+                ** is always called with '0'. If
+                ** your MFT has more than one
+                ** input stream, you will
+                ** have to change this logic
+                *******************************/
+                HRESULT hrRequest = RequestSample(0);
+                if(FAILED(hrRequest))
+                {
+                    // Not fatal for this output sample; the stream has likely ended
+                    TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Held input request not sent (hr=0x%x)",  __FUNCTION__, hrRequest);
+                }
+            }
+        }
+
         /*******************************
         ** Todo: This MFT only has one
         ** input stream, so the output
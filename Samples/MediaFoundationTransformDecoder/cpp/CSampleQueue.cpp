@@ -1,5 +1,5 @@
 #include "CSampleQueue.h"
-#include "CAutoLock.h"
+#include <mferror.h>
 #include "CHWMFT.h"
 #include "CHWMFT_DebugLogger.h"
 
@@ -18,22 +18,11 @@
         (x) = NULL; \
     } \
 
-class CSampleQueue::CNode
+struct CSampleQueue::CCell
 {
-public:
-    IMFSample*  pSample;
-    CNode*      pNext;
-
-    CNode(void)
-    {
-        pSample = NULL;
-        pNext   = NULL;
-    }
-    ~CNode(void)
-    {
-        SAFERELEASE(pSample);
-        pNext   = NULL;
-    }
+    volatile    LONG        lSequence;  // == position: free for the producer of that position
+                                        // == position + 1: filled for the consumer of that position
+                IMFSample*  pSample;
 };
 
 HRESULT CSampleQueue::Create(
@@ -57,6 +46,19 @@ HRESULT CSampleQueue::Create(
             break;
         }
 
+        pNewQueue->m_pCells = new CCell[QUEUE_CAPACITY];
+        if(pNewQueue->m_pCells == NULL)
+        {
+            hr = E_OUTOFMEMORY;
+            break;
+        }
+
+        for(ULONG i = 0; i < QUEUE_CAPACITY; i++)
+        {
+            pNewQueue->m_pCells[i].lSequence    = (LONG)i;
+            pNewQueue->m_pCells[i].pSample      = NULL;
+        }
+
         (*ppQueue) = pNewQueue;
         (*ppQueue)->AddRef();
     }while(false);
@@ -122,8 +124,10 @@ ULONG CSampleQueue::Release(void)
 HRESULT CSampleQueue::AddSample(
     IMFSample*  pSample)
 {
-    HRESULT hr          = S_OK;
-    CNode*  pNewNode    = NULL;
+    HRESULT hr      = S_OK;
+    CCell*  pCell   = NULL;
+    LONG    lPos    = 0;
+    BOOL    bMarker = FALSE;
 
     TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Enter",  __FUNCTION__);
 
@@ -135,54 +139,92 @@ HRESULT CSampleQueue::AddSample(
             break;
         }
 
-        pNewNode = new CNode();
-        if(pNewNode == NULL)
+        /***************************************
+        ** Attach a pending marker, but leave the
+        ** flag set until the sample has a cell:
+        ** if the queue is full the marker must
+        ** stay pending for the next sample
+        ***************************************/
+        if(m_lAddMarker != FALSE)
         {
-            hr = E_OUTOFMEMORY;
-            break;
+            hr = pSample->SetUINT64(MYMFT_MFSampleExtension_Marker, m_pulMarkerID);
+            if(FAILED(hr))
+            {
+                break;
+            }
+
+            bMarker = TRUE;
         }
 
-        pNewNode->pSample           = pSample;
-        pNewNode->pSample->AddRef();
-        pNewNode->pNext             = NULL;
+        // Claim the next position
+        lPos = m_lEnqueuePos;
 
+        while(true)
         {
-            CAutoLock lock(&m_csLock);
+            pCell = &m_pCells[lPos & (QUEUE_CAPACITY - 1)];
+
+            LONG lDiff = pCell->lSequence - lPos;
 
-            if(m_bAddMarker != FALSE)
+            if(lDiff == 0)
             {
-                hr = pSample->SetUINT64(MYMFT_MFSampleExtension_Marker, m_pulMarkerID);
-                if(FAILED(hr))
+                LONG lSeenPos = InterlockedCompareExchange(&m_lEnqueuePos, lPos + 1, lPos);
+                if(lSeenPos == lPos)
                 {
                     break;
                 }
 
-                m_pulMarkerID   = 0;
-                m_bAddMarker    = FALSE;
+                // Another thread took this position
+                InterlockedIncrement(&m_lAddRetries);
+                lPos = lSeenPos;
             }
-
-            if(IsQueueEmpty() != FALSE)
+            else if(lDiff < 0)
             {
-                // This is the first sample in the queue
-                m_pHead     = pNewNode;
-                m_pTail     = pNewNode;
-
-                TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Sample @%p is first sample in Queue @%p",  __FUNCTION__, pSample, this);
+                // The cell still holds the sample from one lap ago
+                pCell = NULL;
+                break;
             }
             else
             {
-                m_pTail->pNext  = pNewNode;
-                m_pTail         = pNewNode;
+                // Another thread took this position and has already moved on
+                InterlockedIncrement(&m_lAddRetries);
+                lPos = m_lEnqueuePos;
+            }
+        }
 
-                TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Sample @%p added to back of Queue @%p",  __FUNCTION__, pSample, this);
+        if(pCell == NULL)
+        {
+            InterlockedIncrement(&m_lFullCount);
+
+            TraceString(CHMFTTracing::TRACE_ERROR, L"%S(): Queue @%p is full",  __FUNCTION__, this);
+
+            if(bMarker != FALSE)
+            {
+                pSample->DeleteItem(MYMFT_MFSampleExtension_Marker);
             }
+
+            hr = MF_E_NOTACCEPTING;
+            break;
         }
-    }while(false);
 
-    if(FAILED(hr))
-    {
-        SAFEDELETE(pNewNode);
-    }
+        if(bMarker != FALSE)
+        {
+            // The cell is ours; take the marker, unless another adder already has
+            if(InterlockedCompareExchange(&m_lAddMarker, FALSE, TRUE) == FALSE)
+            {
+                pSample->DeleteItem(MYMFT_MFSampleExtension_Marker);
+            }
+        }
+
+        pCell->pSample  = pSample;
+        pCell->pSample->AddRef();
+
+        // Publish the sample to the consumer of this position
+        InterlockedExchange(&pCell->lSequence, lPos + 1);
+
+        InterlockedIncrement(&m_lAddCount);
+
+        TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Sample @%p added to back of Queue @%p",  __FUNCTION__, pSample, this);
+    }while(false);
 
     TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Exit (hr=0x%x)",  __FUNCTION__, hr);
 
@@ -192,8 +234,9 @@ HRESULT CSampleQueue::AddSample(
 HRESULT CSampleQueue::GetNextSample(
     IMFSample** ppSample)
 {
-    HRESULT hr              = S_OK;
-    CNode*  pCurrentNode    = NULL;
+    HRESULT hr      = S_OK;
+    CCell*  pCell   = NULL;
+    LONG    lPos    = 0;
 
     do
     {
@@ -205,61 +248,74 @@ HRESULT CSampleQueue::GetNextSample(
 
         *ppSample   = NULL;
 
+        // Claim the next filled position
+        lPos = m_lDequeuePos;
+
+        while(true)
         {
-            CAutoLock lock(&m_csLock);
+            pCell = &m_pCells[lPos & (QUEUE_CAPACITY - 1)];
+
+            LONG lDiff = pCell->lSequence - (lPos + 1);
+
+            if(lDiff == 0)
+            {
+                LONG lSeenPos = InterlockedCompareExchange(&m_lDequeuePos, lPos + 1, lPos);
+                if(lSeenPos == lPos)
+                {
+                    break;
+                }
 
-            if(IsQueueEmpty() != FALSE)
+                // Another thread took this position
+                InterlockedIncrement(&m_lRemoveRetries);
+                lPos = lSeenPos;
+            }
+            else if(lDiff < 0)
             {
-                // The queue is empty
-                hr = S_FALSE;
+                // Nothing has been added at this position yet
+                pCell = NULL;
                 break;
             }
-            
-            pCurrentNode = m_pHead;
-
-            (*ppSample) = pCurrentNode->pSample;
-            (*ppSample)->AddRef();
-
-            // Now remove the node from the list
+            else
+            {
+                // Another thread took this position and has already moved on
+                InterlockedIncrement(&m_lRemoveRetries);
+                lPos = m_lDequeuePos;
+            }
+        }
 
-            m_pHead = m_pHead->pNext;
+        if(pCell == NULL)
+        {
+            // The queue is empty
+            hr = S_FALSE;
+            break;
+        }
 
-            TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Sample @%p removed from queue Queue @%p",  __FUNCTION__, (*ppSample), this);
+        // The queue's reference is handed to the caller
+        (*ppSample)     = pCell->pSample;
+        pCell->pSample  = NULL;
 
-            if(m_pHead == NULL)
-            {
-                // This was the last sample in the queue
-                m_pTail = NULL;
+        // Free the cell for the producer one lap from now
+        InterlockedExchange(&pCell->lSequence, lPos + (LONG)QUEUE_CAPACITY);
 
-                TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Queue @%p is not empty",  __FUNCTION__, this);
-            }
-        }
+        TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Sample @%p removed from queue Queue @%p",  __FUNCTION__, (*ppSample), this);
     }while(false);
 
-    SAFEDELETE(pCurrentNode);
-
     return hr;
 }
 
 HRESULT CSampleQueue::RemoveAllSamples(void)
 {
-    HRESULT hr          = S_OK;
-    CNode*  pCurrNode   = NULL;
+    HRESULT     hr      = S_OK;
+    IMFSample*  pSample = NULL;
 
     do
     {
-        CAutoLock lock(&m_csLock);
-
-        while(IsQueueEmpty() == FALSE)
+        while(GetNextSample(&pSample) == S_OK)
         {
-            pCurrNode = m_pHead;
-
-            m_pHead = m_pHead->pNext;
-
-            delete pCurrNode;
+            SAFERELEASE(pSample);
         }
 
-        m_pTail = NULL;
+        TraceStatistics();
     }while(false);
 
     return hr;
@@ -272,10 +328,9 @@ HRESULT CSampleQueue::MarkerNextSample(
 
     do
     {
-        CAutoLock lock(&m_csLock);
-
+        // The ID must be written before the flag is set
         m_pulMarkerID   = pulID;
-        m_bAddMarker    = TRUE;
+        InterlockedExchange(&m_lAddMarker, TRUE);
     }while(false);
 
     return hr;
@@ -283,25 +338,48 @@ HRESULT CSampleQueue::MarkerNextSample(
 
 BOOL CSampleQueue::IsQueueEmpty(void)
 {
-    CAutoLock lock(&m_csLock);
+    LONG    lPos    = m_lDequeuePos;
+    CCell*  pCell   = &m_pCells[lPos & (QUEUE_CAPACITY - 1)];
 
-    return (m_pHead == NULL) ? TRUE : FALSE;
+    return ((pCell->lSequence - (lPos + 1)) < 0) ? TRUE : FALSE;
 }
 
-CSampleQueue::CSampleQueue(void)
+ULONG CSampleQueue::GetSampleCount(void)
 {
-    m_ulRef         = 1;
-    m_pHead         = NULL;
-    m_pTail         = NULL;
-    m_bAddMarker    = FALSE;
-    m_pulMarkerID   = 0;
+    // Read the front first: the back can only have moved further since
+    LONG    lDequeuePos = m_lDequeuePos;
+    LONG    lEnqueuePos = m_lEnqueuePos;
 
-    InitializeCriticalSection(&m_csLock);
+    return (ULONG)(lEnqueuePos - lDequeuePos);
+}
+
+void CSampleQueue::TraceStatistics(void)
+{
+    TraceString(CHMFTTracing::TRACE_INFORMATION, L"%S(): Queue @%p: %d samples added, %d add retries, %d remove retries, %d times full",
+        __FUNCTION__, this, m_lAddCount, m_lAddRetries, m_lRemoveRetries, m_lFullCount);
+}
+
+CSampleQueue::CSampleQueue(void)
+{
+    m_ulRef             = 1;
+    m_pCells            = NULL;
+    m_lEnqueuePos       = 0;
+    m_lDequeuePos       = 0;
+    m_lAddMarker        = FALSE;
+    m_pulMarkerID       = 0;
+    m_lAddCount         = 0;
+    m_lAddRetries       = 0;
+    m_lRemoveRetries    = 0;
+    m_lFullCount        = 0;
 }
 
 CSampleQueue::~CSampleQueue(void)
 {
-    RemoveAllSamples();
+    if(m_pCells != NULL)
+    {
+        RemoveAllSamples();
 
-    DeleteCriticalSection(&m_csLock);
+        delete[] m_pCells;
+        m_pCells = NULL;
+    }
 }
\ No newline at end of file
@@ -3,6 +3,19 @@
 #include <windows.h>
 #include <Mfidl.h>
 
+/***************************************
+** CSampleQueue is a bounded, lock-free
+** FIFO of samples. The samples are kept
+** in a fixed ring of cells, so adding or
+** removing a sample does not allocate.
+** Each cell carries a sequence number
+** that tells producers and consumers
+** whether the cell is free or filled for
+** their position; positions are claimed
+** with InterlockedCompareExchange.
+** Any number of threads may add and
+** remove samples at the same time.
+***************************************/
 class CSampleQueue: public IUnknown
 {
 public:
@@ -24,7 +37,7 @@ public:
 
     // ILockedSampleCallback Implementation
             
-            HRESULT AddSample(                      // Add a sample to the back of the queue
+            HRESULT AddSample(                      // Add a sample to the back of the queue, MF_E_NOTACCEPTING if full
                             IMFSample*  pSample
                             );
             HRESULT GetNextSample(                  // Remove a sample from the front of the queue
@@ -35,19 +48,29 @@ public:
                             const ULONG_PTR pulID
                             );
             BOOL    IsQueueEmpty(void);
+            ULONG   GetSampleCount(void);           // Samples in the queue, including adds in progress
+            void    TraceStatistics(void);          // Trace the contention counters
+
+    static  const   ULONG           QUEUE_CAPACITY  = 64;   // Must be a power of 2
 
 protected:
-                class CNode;
+                struct CCell;
 
                     CSampleQueue(void);
                     ~CSampleQueue(void);
 
     volatile    ULONG               m_ulRef;
-                CNode*              m_pHead;
-                CNode*              m_pTail;
-                BOOL                m_bAddMarker;
+                CCell*              m_pCells;
+    volatile    LONG                m_lEnqueuePos;
+    volatile    LONG                m_lDequeuePos;
+    volatile    LONG                m_lAddMarker;
                 ULONG_PTR           m_pulMarkerID;
-                CRITICAL_SECTION    m_csLock;
+
+                // Contention counters, reported through TraceStatistics()
+    volatile    LONG                m_lAddCount;
+    volatile    LONG                m_lAddRetries;      // Lost a race for a position while adding
+    volatile    LONG                m_lRemoveRetries;   // Lost a race for a position while removing
+    volatile    LONG                m_lFullCount;       // AddSample found the queue full
 };
 
 class CSampleQueue::ILockedSample
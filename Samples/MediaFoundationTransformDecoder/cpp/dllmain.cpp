@@ -1,4 +1,5 @@
 #include "CHWMFT.h"
+#include "CHWMFT_DecodeTask.h"
 #include <strsafe.h>
 #include <mfapi.h>
 #include <initguid.h>
@@ -420,6 +421,11 @@ BOOL APIENTRY DllMain(
         // Nothing to do
 		break;
 	case DLL_PROCESS_DETACH:
+        if(lpReserved == NULL)
+        {
+            // FreeLibrary, not process exit: free the pooled decode tasks
+            CDecodeTask::ReleasePool();
+        }
 		break;
 	};
 
@@ -1017,6 +1017,15 @@ ci_makecomposite(COMPITEM ci)
  *    uniqueness condition to see how much more progress we can make.  This is
  *    controlled by the TryDups logic at the end of the loop.
  *
+ *    MYERSDIFF
+ *    If the MyersDiff option is set, step 1 is replaced by a Myers O(ND)
+ *    diff of the whole file (see mdiff.cpp), which links every line on a
+ *    longest common subsequence whether it is unique or not. Steps 2-5 then
+ *    run as before. This gives better results on files with many repeated
+ *    lines, but never reports moved blocks. The edit script covers the whole
+ *    file, so it is only worked out on the first time round the loop: later
+ *    passes only add links inside the sections it left unmatched.
+ *
  *    Finally build a composite list from the two lists of sections.
  */
 void
@@ -1026,7 +1035,9 @@ ci_compare(COMPITEM ci)
     SECTION whole_left, whole_right;
     BOOL bChanges;  /* loop control - we're still making more matches */
     BOOL bTryDups;  /* first try exact matches - then try matching non-unique ones too */
+    BOOL bDiffed;   /* MyersDiff only: whole-file diff has been done */
     extern BOOL Algorithm2;   /* declared in sdkdiff.cpp */
+    extern BOOL MyersDiff;    /* declared in sdkdiff.cpp */
 #ifdef trace
     DWORD Ticks;        /* time for profiling */
     DWORD StartTicks;   /* time for profiling */
@@ -1043,6 +1054,7 @@ ci_compare(COMPITEM ci)
     }
 
     bTryDups = FALSE;
+    bDiffed = FALSE;
 
 #ifdef trace
     StartTicks = GetTickCount();
@@ -1062,8 +1074,18 @@ ci_compare(COMPITEM ci)
         whole_right = section_new((LINE)List_First(lines_right),
                                   (LINE)List_Last(lines_right), NULL);
 
-        /* link up matching unique lines between these sections */
-        if (section_match(whole_left, whole_right, bTryDups)) {
+        /* link up matching lines between these sections - either
+         * the lines on a shortest edit script (Myers diff) or
+         * matching unique lines
+         */
+        if (MyersDiff) {
+            if (!bDiffed) {
+                bDiffed = TRUE;
+                if (section_diff(whole_left, whole_right)) {
+                    bChanges = TRUE;
+                }
+            }
+        } else if (section_match(whole_left, whole_right, bTryDups)) {
             bChanges = TRUE;
         }
 
@@ -93,6 +93,9 @@ int FAR PASCAL complist_dodlg_savelist(HWND hDlg, UINT message,
 int FAR PASCAL complist_dodlg_copyfiles(HWND hDlg, UINT message,
                                         UINT wParam, long lParam);
 BOOL complist_match(COMPLIST cl, VIEW view, BOOL fDeep, BOOL fExact);
+int complist_compareitems(COMPLIST cl, DIRITEM leftitem, DIRITEM rightitem);
+BOOL complist_istracked(DIRITEM leftitem, DIRITEM rightitem);
+void complist_prechecksum(COMPLIST cl, BOOL fDeep);
 COMPLIST complist_new(void);
 int FAR PASCAL complist_dodlg_dir(HWND hDlg, unsigned message,
                                   UINT wParam, LONG lParam);
@@ -1181,25 +1184,30 @@ complist_match(COMPLIST cl, VIEW view, BOOL fDeep, BOOL fExact)
 
     /* two directories */
 
+    /* scan both trees and checksum the candidate pairs up front on
+     * worker threads. The traversal below then finds everything
+     * already cached and only has to build the compitems.
+     */
+    if (fDeep) {
+        dir_scanparallel(cl->left, cl->right);
+    }
+    if (fExact) {
+        complist_prechecksum(cl, fDeep);
+    }
+
     /* traverse the two lists in parallel comparing the relative names*/
 
     leftitem = dir_firstitem(cl->left);
     rightitem = dir_firstitem(cl->right);
     while ((leftitem != NULL) && (rightitem != NULL)) {
 
-        lname = dir_getrelname(leftitem);
-        rname = dir_getrelname(rightitem);
-        if (!dir_compsequencenumber(leftitem, rightitem, &cmpvalue))
-        {
-            if (dir_iswildcard(cl->left) && dir_iswildcard(cl->right))
-                cmpvalue = dir_compwildcard(cl->left, cl->right, lname, rname);
-            else
-                cmpvalue = utils_CompPath(lname, rname);
-        }
+        cmpvalue = complist_compareitems(cl, leftitem, rightitem);
 
 #ifdef trace
         {       
 			char msg[2*MAX_PATH+30];
+            lname = dir_getrelname(leftitem);
+            rname = dir_getrelname(rightitem);
             hr = StringCchPrintf( msg, (2*MAX_PATH+30), "complist_match: %s %s %s\n"
                       , lname
                       , ( cmpvalue<0 ? "<"
@@ -1210,22 +1218,13 @@ complist_match(COMPLIST cl, VIEW view, BOOL fDeep, BOOL fExact)
 			if(FAILED(hr))
 				OutputError(hr, IDS_SAFE_PRINTF);
             if (bTrace) Trace_File(msg);
+            dir_freerelname(leftitem, lname);
+            dir_freerelname(rightitem, rname);
         }
 #endif
-        dir_freerelname(leftitem, lname);
-        dir_freerelname(rightitem, rname);
 
         if (cmpvalue == 0) {
-            BOOL trackThese = TrackSame || TrackDifferent;
-            if (!TrackReadonly) {
-                BOOL bothReadonly = (BOOL)((dir_getattr(leftitem) &
-                                            dir_getattr(rightitem) &
-                                            FILE_ATTRIBUTE_READONLY) != 0);
-                if (bothReadonly) {
-                    trackThese = FALSE;
-                }
-            }
-            if (trackThese) {
+            if (complist_istracked(leftitem, rightitem)) {
                 compitem_new( leftitem, rightitem
                               , cl->items, fExact);
                 if (view_newitem(view)) {
@@ -1298,6 +1297,120 @@ complist_match(COMPLIST cl, VIEW view, BOOL fDeep, BOOL fExact)
     return(TRUE);
 } /* complist_match */
 
+/*
+ * compare two items for the traversal in complist_match: <0 if the left
+ * item comes first, >0 if the right item comes first, 0 if they are a pair.
+ */
+int
+complist_compareitems(COMPLIST cl, DIRITEM leftitem, DIRITEM rightitem)
+{
+    LPSTR lname, rname;
+    int cmpvalue;
+
+    if (dir_compsequencenumber(leftitem, rightitem, &cmpvalue)) {
+        return(cmpvalue);
+    }
+
+    lname = dir_getrelname(leftitem);
+    rname = dir_getrelname(rightitem);
+    if (dir_iswildcard(cl->left) && dir_iswildcard(cl->right))
+        cmpvalue = dir_compwildcard(cl->left, cl->right, lname, rname);
+    else
+        cmpvalue = utils_CompPath(lname, rname);
+    dir_freerelname(leftitem, lname);
+    dir_freerelname(rightitem, rname);
+
+    return(cmpvalue);
+} /* complist_compareitems */
+
+/*
+ * should a pair of matching files be shown? (not if we are hiding
+ * both identical and different files, or if both are read-only and
+ * we are hiding read-only files)
+ */
+BOOL
+complist_istracked(DIRITEM leftitem, DIRITEM rightitem)
+{
+    BOOL trackThese = TrackSame || TrackDifferent;
+    if (!TrackReadonly) {
+        BOOL bothReadonly = (BOOL)((dir_getattr(leftitem) &
+                                    dir_getattr(rightitem) &
+                                    FILE_ATTRIBUTE_READONLY) != 0);
+        if (bothReadonly) {
+            trackThese = FALSE;
+        }
+    }
+    return(trackThese);
+} /* complist_istracked */
+
+/*
+ * before complist_match builds the compitems, walk the two lists in the
+ * same order it will, and collect every matched pair whose sizes are
+ * equal - these are the only files SetStateAndTag needs to checksum
+ * (pairs of different size are marked different without reading
+ * them). Checksum all of them on a pool of worker threads.
+ *
+ * Line lists are still only read when a pair is expanded, so files whose
+ * checksums match are never loaded.
+ */
+void
+complist_prechecksum(COMPLIST cl, BOOL fDeep)
+{
+    DIRITEM leftitem, rightitem;
+    DIRITEM FAR * items = NULL;
+    int nItems = 0, nAlloc = 0;
+    int cmpvalue;
+
+    leftitem = dir_firstitem(cl->left);
+    rightitem = dir_firstitem(cl->right);
+    while ((leftitem != NULL) && (rightitem != NULL)) {
+
+        cmpvalue = complist_compareitems(cl, leftitem, rightitem);
+        if (cmpvalue == 0) {
+            if (complist_istracked(leftitem, rightitem)
+                && !dir_fileerror(leftitem) && !dir_fileerror(rightitem)
+                && (dir_getfilesize(leftitem) == dir_getfilesize(rightitem))) {
+
+                /* room for two more */
+                if (nItems + 2 > nAlloc) {
+                    int nNew = (nAlloc == 0) ? 1024 : nAlloc * 2;
+                    DIRITEM FAR * pNew;
+
+                    if (items == NULL) {
+                        pNew = (DIRITEM FAR *) HeapAlloc(GetProcessHeap(), 0, nNew * sizeof(DIRITEM));
+                    } else {
+                        pNew = (DIRITEM FAR *) HeapReAlloc(GetProcessHeap(), 0, items, nNew * sizeof(DIRITEM));
+                    }
+                    if (pNew == NULL) {
+                        /* the rest will be checksummed on demand */
+                        break;
+                    }
+                    items = pNew;
+                    nAlloc = nNew;
+                }
+                if (!dir_validchecksum(leftitem)) {
+                    items[nItems++] = leftitem;
+                }
+                if (!dir_validchecksum(rightitem)) {
+                    items[nItems++] = rightitem;
+                }
+            }
+            leftitem = dir_nextitem(cl->left, leftitem, fDeep);
+            rightitem = dir_nextitem(cl->right, rightitem, fDeep);
+        } else if (cmpvalue < 0) {
+            leftitem = dir_nextitem(cl->left, leftitem, fDeep);
+        } else {
+            rightitem = dir_nextitem(cl->right, rightitem, fDeep);
+        }
+    }
+
+    dir_checksumparallel(items, nItems);
+
+    if (items != NULL) {
+        HeapFree(GetProcessHeap(), NULL, items);
+    }
+} /* complist_prechecksum */
+
 /* return time last operation took in milliseconds */
 DWORD complist_querytime(void)
 {       return TickCount;
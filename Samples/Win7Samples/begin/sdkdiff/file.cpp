@@ -44,6 +44,7 @@ struct filedata {
 
     DIRITEM diritem;        /* handle to file name information */
     LIST lines;             /* NULL if lines not read in */
+    LINESTORE store;        /* text of the lines in 'lines' */
 
     BOOL fUnicode;
 };
@@ -158,6 +159,10 @@ file_discardlines(FILEDATA fd)
         List_Destroy(&fd->lines);
     }
 
+    /* the text of all the lines goes in one go */
+    linestore_delete(fd->store);
+    fd->store = NULL;
+
     /* this is probably done in List_Destroy, but better do it anyway*/
     fd->lines = NULL;
 }
@@ -224,9 +229,12 @@ FILETIME file_GetTime(FILEDATA fd)
  *
  * we use the buffered read functions to read a block at a time, and
  * return us a pointer to a line within the block. The line we are
- * pointed to is not null terminated. from this we do a line_new: this
- * will make a copy of the text (since we want to re-use the buffer), and
- * will null-terminate its copy.
+ * pointed to is not null terminated. from this we do a line_newstored:
+ * this will make a copy of the text (since we want to re-use the buffer)
+ * in the file's line store, and will null-terminate its copy. the unicode
+ * text of unicode files is copied into the store as well: nothing keeps the
+ * file open or mapped once it is read, so the user can edit it while its
+ * lines are loaded.
  *
  * we also give each line a number, starting at one.
  */
@@ -240,6 +248,8 @@ file_readlines(FILEDATA fd)
     FILEBUFFER fbuf;
     int linelen;
     int linenr = 1;
+    long cbFile;
+    DWORD cbHint;
     HCURSOR hcurs;
 
     hcurs = SetCursor(LoadCursor(NULL, IDC_WAIT));
@@ -257,12 +267,22 @@ file_readlines(FILEDATA fd)
 
     if (fbuf)
     {
-        /* make an empty list for the files */
+        /* make an empty list for the files, and a store for their text.
+         * If the store can't be had, line_newstored falls back to line_new
+         */
         fd->lines = List_Create();
+        cbFile = dir_getfilesize(fd->diritem);
+        cbHint = (cbFile > 0) ? (DWORD)cbFile : 0;
+        if (fd->fUnicode && (cbHint + cbHint / 2 > cbHint)) {
+            /* the wide text, plus about one byte per character of ansi */
+            cbHint += cbHint / 2;
+        }
+        fd->store = linestore_new(cbHint);
 
         while ( (textp = readfile_next(fbuf, &linelen, &pwzText, &cwch)) != NULL) {
             if (linelen>0) { /* readfile failure gives linelen==-1 */
-                line_new(textp, linelen, pwzText, cwch, linenr++, fd->lines);
+                line_newstored(fd->store, textp, linelen, pwzText, cwch,
+                               linenr++, fd->lines);
             } else {
                 line_new("!! <unreadable> !!", 20, NULL, 0, linenr++,fd->lines);
                 break;
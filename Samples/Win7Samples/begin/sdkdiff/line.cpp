@@ -24,6 +24,13 @@
  * Lines can be allocated on a list. If a null list handle is passed, the
  * line will be allocated using HeapAlloc(). 
  *
+ * The text of a line is normally held in its own heap allocation. Lines
+ * read from a file are instead created with line_newstored, which carves
+ * the text out of a LINESTORE shared by the whole file: a few large blocks
+ * in place of two heap allocations per line. Their unicode text is copied
+ * into the store too: the file itself is not kept open or mapped, since the
+ * user may edit it while its lines are loaded.
+ *
  */
 
 #include "precomp.h"
@@ -38,6 +45,31 @@
 /* flag values (or-ed) */
 #define LF_DISCARD      1       /* if true, alloced using HeapAlloc */
 #define LF_HASHVALID    2       /* if true, hashcode need not be recalced */
+#define LF_STORED       4       /* if true, text is held in line->store */
+
+/*
+ * a line store is a chain of blocks, each holding the text of many lines.
+ */
+typedef struct storeblock {
+    struct storeblock FAR * next;   /* previous (full) block */
+    DWORD cbSize;                   /* size of data[] */
+    DWORD cbUsed;                   /* bytes of data[] handed out */
+    double data[1];                 /* text starts here (aligned) */
+} STOREBLOCK, FAR * PSTOREBLOCK;
+
+struct linestore {
+    PSTOREBLOCK blocks;     /* current block, linked to earlier ones */
+};
+
+/* minimum size of a store block; larger text gets a block of its own */
+#define LINESTORE_BLOCKSIZE     (64 * 1024)
+
+/* slack added to the first block for the cr/nl and null we add per line */
+#define LINESTORE_SLACK(cb)     ((cb) / 8 + 1024)
+
+PSTOREBLOCK linestore_newblock(DWORD cbSize);
+LPVOID linestore_alloc(LINESTORE store, DWORD cb);
+LPWSTR linestore_copytextW(LINESTORE store, LPCWSTR pwzText, int cwchText);
 
 
 /*
@@ -103,6 +135,68 @@ line_new(LPSTR text, int linelength, LPWSTR pwzText, int cwchText, UINT linenr,
 
     line->link = NULL;
     line->linenr = linenr;
+    line->store = NULL;
+
+    return(line);
+}
+
+/*
+ * create a new line whose text, and unicode text, are copied into a line
+ * store.
+ */
+LINE
+line_newstored(LINESTORE store, LPSTR text, int linelength,
+               LPWSTR pwzText, int cwchText, UINT linenr, LIST list)
+{
+    LINE line;
+    int cch;
+
+    if (store == NULL) {
+        return(line_new(text, linelength, pwzText, cwchText, linenr, list));
+    }
+
+    /* alloc a line. from the list if there is a list */
+    if (list) {
+        line = (LINE)List_NewLast(list, sizeof(struct fileline));
+        if (line == NULL) {
+            return(NULL);
+        }
+        line->flags = LF_STORED;
+    } else  {
+        line = (LINE) HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(struct fileline));
+        if (line == NULL) {
+            return(NULL);
+        }
+        line->flags = LF_DISCARD | LF_STORED;
+    }
+    line->store = store;
+    line->link = NULL;
+    line->linenr = linenr;
+    line->pwzText = NULL;
+
+    /* space for the text, a null, and a cr/nl pair if absent */
+    cch = (text[linelength - 1] == '\n') ? 1 : 3;
+    line->text = (LPSTR) linestore_alloc(store, linelength + cch);
+    if (line->text == NULL) {
+        line->text = "";
+        return(NULL);
+    }
+    My_mbsncpy(line->text, text, linelength);
+    if (cch == 3) {
+        line->text[linelength++] = '\r';
+        line->text[linelength++] = '\n';
+    }
+    line->text[linelength] = '\0';
+
+    /* we are about to compare every line, so get the hashcode now
+     * while the text is still in the cache
+     */
+    line->hash = hash_string(line->text, ignore_blanks);
+    line->flags |= LF_HASHVALID;
+
+    if ((pwzText != NULL) && (cwchText > 0)) {
+        line->pwzText = linestore_copytextW(store, pwzText, cwchText);
+    }
 
     return(line);
 }
@@ -118,8 +212,13 @@ line_delete(LINE line)
         return;
     }
 
-    /* free up text space */
-    HeapFree(GetProcessHeap(), NULL, line->text);
+    /* free up text space, unless it belongs to a line store */
+    if (! (line->flags & LF_STORED)) {
+        HeapFree(GetProcessHeap(), NULL, line->text);
+        if (line->pwzText != NULL) {
+            HeapFree(GetProcessHeap(), NULL, line->pwzText);
+        }
+    }
 
     /* free up line itself only if not on list */
     if (line->flags & LF_DISCARD) {
@@ -344,3 +443,138 @@ BOOL line_isblank(LINE line)
 {
     return line!=NULL && utils_isblank(line->text);
 }
+
+
+/* --- line stores ------------------------------------------------------*/
+
+/*
+ * create an empty line store. the first block is sized for cbHint bytes
+ * of text, so that typically all the text of a file is contiguous.
+ */
+LINESTORE
+linestore_new(DWORD cbHint)
+{
+    LINESTORE store;
+    DWORD cbFirst;
+
+    store = (LINESTORE) HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(struct linestore));
+    if (store == NULL) {
+        return(NULL);
+    }
+
+    cbFirst = cbHint + LINESTORE_SLACK(cbHint);
+    if ((cbFirst < cbHint) || (cbFirst < LINESTORE_BLOCKSIZE)) {
+        cbFirst = LINESTORE_BLOCKSIZE;
+    }
+
+    /* a huge hint can fail where smaller blocks would not */
+    store->blocks = linestore_newblock(cbFirst);
+    if (store->blocks == NULL) {
+        store->blocks = linestore_newblock(LINESTORE_BLOCKSIZE);
+    }
+    if (store->blocks == NULL) {
+        HeapFree(GetProcessHeap(), NULL, store);
+        return(NULL);
+    }
+
+    return(store);
+} /* linestore_new */
+
+/*
+ * free all the blocks of a line store
+ */
+void
+linestore_delete(LINESTORE store)
+{
+    PSTOREBLOCK block;
+    PSTOREBLOCK next;
+
+    if (store == NULL) {
+        return;
+    }
+
+    for (block = store->blocks; block != NULL; block = next) {
+        next = block->next;
+        HeapFree(GetProcessHeap(), NULL, block);
+    }
+
+    HeapFree(GetProcessHeap(), NULL, store);
+} /* linestore_delete */
+
+/* allocate an empty block with room for cbSize bytes */
+PSTOREBLOCK
+linestore_newblock(DWORD cbSize)
+{
+    PSTOREBLOCK block;
+    SIZE_T cbAlloc;
+
+    cbAlloc = FIELD_OFFSET(STOREBLOCK, data) + (SIZE_T)cbSize;
+    if (cbAlloc < cbSize) {
+        return(NULL);
+    }
+
+    block = (PSTOREBLOCK) HeapAlloc(GetProcessHeap(), NULL, cbAlloc);
+    if (block == NULL) {
+        return(NULL);
+    }
+    block->next = NULL;
+    block->cbSize = cbSize;
+    block->cbUsed = 0;
+
+    return(block);
+} /* linestore_newblock */
+
+/*
+ * carve cb bytes out of the store, starting a new block if the current one
+ * is full. Allocations are WCHAR aligned. All the text is added by the one
+ * thread that reads the file.
+ */
+LPVOID
+linestore_alloc(LINESTORE store, DWORD cb)
+{
+    PSTOREBLOCK block;
+    LPVOID pv;
+
+    cb = (cb + (sizeof(WCHAR) - 1)) & ~(sizeof(WCHAR) - 1);
+
+    block = store->blocks;
+    if (cb > block->cbSize - block->cbUsed) {
+        block = linestore_newblock(max(cb, LINESTORE_BLOCKSIZE));
+        if (block == NULL) {
+            return(NULL);
+        }
+        block->next = store->blocks;
+        store->blocks = block;
+    }
+
+    pv = (LPBYTE) block->data + block->cbUsed;
+    block->cbUsed += cb;
+
+    return(pv);
+} /* linestore_alloc */
+
+/*
+ * copy unicode text into the store, null-terminated and with a cr/nl pair
+ * added if absent, as line_new does.
+ */
+LPWSTR
+linestore_copytextW(LINESTORE store, LPCWSTR pwzText, int cwchText)
+{
+    LPWSTR pwz;
+    int cch;
+
+    cch = (pwzText[cwchText - 1] == '\n') ? 1 : 3;
+    pwz = (LPWSTR) linestore_alloc(store, (cwchText + cch) * sizeof(WCHAR));
+    if (pwz == NULL) {
+        return(NULL);
+    }
+
+    CopyMemory(pwz, pwzText, cwchText * sizeof(WCHAR));
+    if (cch == 3) {
+        pwz[cwchText++] = '\r';
+        pwz[cwchText++] = '\n';
+    }
+    pwz[cwchText] = '\0';
+
+    return(pwz);
+} /* linestore_copytextW */
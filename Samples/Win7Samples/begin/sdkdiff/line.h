@@ -31,6 +31,11 @@
  */
 typedef struct fileline FAR * LINE;
 
+/* a handle to a line store. lines created in a store share its memory
+ * instead of each holding separately allocated copies of their text.
+ */
+typedef struct linestore FAR * LINESTORE;
+
 /*
  * a LINE handle is a pointer to a struct fileline, defined here
  */
@@ -44,6 +49,8 @@ struct fileline
     LINE link;      /* handle for linked line */
     UINT linenr;    /* line number (any arbitrary value) */
     LPWSTR pwzText; /* null-terminated original unicode text */
+
+    LINESTORE store;/* store holding text, or NULL if separately allocated */
 };
 
 
@@ -69,12 +76,44 @@ LINE line_new(LPSTR text, int linelength, LPWSTR pwzText, int cwchText, UINT lin
 
 
 
+/*
+ * line stores.
+ *
+ * a line store is a set of large blocks from which the text of many lines
+ * is carved, so that reading a big file does not make two heap allocations
+ * per line. The text of all lines in a store is freed in one go by
+ * linestore_delete, which must not be called until every line in the store
+ * has been deleted (or will no longer be used).
+ *
+ * cbHint is the expected total size of text that will be added (typically
+ * the file size). It is used to size the first block so that most files
+ * fit in a single contiguous block.
+ *
+ * returns NULL if failed to create the store.
+ */
+LINESTORE linestore_new(DWORD cbHint);
+
+/* free a line store and all text held in it */
+void linestore_delete(LINESTORE store);
+
+/*
+ * create a new line whose text is held in a line store. This behaves like
+ * line_new, except that the copies of the text and unicode text are made
+ * in the store, and the hashcode is calculated immediately rather than on
+ * the first call to line_gethashcode.
+ */
+LINE line_newstored(LINESTORE store, LPSTR text, int linelength,
+                    LPWSTR pwzText, int cwchText, UINT linenr, LIST list);
+
+
 /*
  * discard a line. free up all memory associated with it.
  *
  * if the line was allocated on a list (list argument to line_new was non-null),
  * the associated memory will be freed, but the LINE itself will not be.
  * Otherwise, the line will freed as well.
+ *
+ * text held in a line store is not freed until linestore_delete.
  */
 void line_delete(LINE line);
 
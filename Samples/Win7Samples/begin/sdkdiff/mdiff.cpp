@@ -0,0 +1,368 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+
+/*
+ * mdiff.cpp
+ *
+ * Myers O(ND) line differencing with a linear space middle-snake search.
+ *
+ * We work on two arrays of LINE handles, X (left) and Y (right). The edit
+ * graph has a diagonal k = x - y for each possible offset between the two
+ * files. A "snake" is a run of matching lines along one diagonal.
+ *
+ * mdiff_compareseq recursively splits the problem: it strips any common
+ * prefix and suffix (linking those lines), then finds the middle snake of
+ * what is left by running the search forwards from the top left and
+ * backwards from the bottom right until the two meet. The two halves
+ * either side of the meeting point are then compared in turn. Each level
+ * of recursion roughly halves the edit distance, so the stack depth is
+ * logarithmic in D.
+ *
+ * Before starting we discard lines whose hashcode does not occur at all
+ * in the other file, since they cannot match anything.
+ *
+ * The only memory needed is a furthest-reaching x for each diagonal in
+ * each direction, plus a copy of the line handles and hashcodes that
+ * survive the discard pass.
+ */
+
+#include "precomp.h"
+
+#include <limits.h>
+
+#include "sdkdiff.h"
+
+#include "list.h"
+#include "line.h"
+#include "mdiff.h"
+
+/*
+ * do not search for more than this many edit steps in one middle snake
+ * unless the inputs are large: see mdiff_link.
+ */
+#define MDIFF_MINCOST   256
+
+/* state shared by all levels of the recursion */
+typedef struct {
+    LINE FAR * xline;       /* left lines */
+    LINE FAR * yline;       /* right lines */
+    DWORD FAR * xhash;      /* hashcodes of xline[] */
+    DWORD FAR * yhash;      /* hashcodes of yline[] */
+    int FAR * fdiag;        /* forward furthest x, indexed by diagonal */
+    int FAR * bdiag;        /* backward furthest x, indexed by diagonal */
+    int toocostly;          /* give up on a minimal split after this cost */
+    BOOL bLinked;           /* TRUE once any new link has been made */
+} MDIFF, FAR * PMDIFF;
+
+/* --- internal functions -------------------------------------------*/
+
+/*
+ * are line x on the left and line y on the right the same?
+ * hashcodes almost always decide it; line_compare settles collisions.
+ */
+static BOOL
+mdiff_equal(PMDIFF pd, int x, int y)
+{
+    if (pd->xhash[x] != pd->yhash[y]) {
+        return(FALSE);
+    }
+    return(line_compare(pd->xline[x], pd->yline[y]));
+}
+
+/* link lines x and y, which are known to be equal */
+static void
+mdiff_linkpair(PMDIFF pd, int x, int y)
+{
+    if (line_link(pd->xline[x], pd->yline[y])) {
+        pd->bLinked = TRUE;
+    }
+}
+
+/*
+ * find the midpoint of a shortest edit script for X[xoff..xlim-1] and
+ * Y[yoff..ylim-1], returning it in *pxmid, *pymid.
+ *
+ * Both ranges must be non-empty and must not start or end with a matching
+ * line (the caller strips those), which ensures the split point is not
+ * at either corner and so the recursion always makes progress.
+ *
+ * fdiag[k] is the furthest x reached so far on diagonal k searching
+ * forwards; bdiag[k] the smallest x reached searching backwards. The
+ * arrays are offset so that any diagonal from -nRight-1 to nLeft+1 can be
+ * indexed directly.
+ */
+static void
+mdiff_midsnake(PMDIFF pd, int xoff, int xlim, int yoff, int ylim, int * pxmid, int * pymid)
+{
+    int FAR * fd = pd->fdiag;
+    int FAR * bd = pd->bdiag;
+    int dmin = xoff - ylim;     /* lowest diagonal in this range */
+    int dmax = xlim - yoff;     /* highest diagonal in this range */
+    int fmid = xoff - yoff;     /* forward search starts on this diagonal */
+    int bmid = xlim - ylim;     /* backward search starts on this diagonal */
+    int fmin = fmid, fmax = fmid;
+    int bmin = bmid, bmax = bmid;
+    BOOL odd = (fmid - bmid) & 1;
+    int cost, d, x, y;
+
+    fd[fmid] = xoff;
+    bd[bmid] = xlim;
+
+    for (cost = 1; ; cost++) {
+
+        /* extend the range of forward diagonals by one each way,
+         * or pull it in if we have hit the edge of the graph
+         */
+        if (fmin > dmin) {
+            fd[--fmin - 1] = -1;
+        } else {
+            ++fmin;
+        }
+        if (fmax < dmax) {
+            fd[++fmax + 1] = -1;
+        } else {
+            --fmax;
+        }
+
+        for (d = fmax; d >= fmin; d -= 2) {
+            int tlo = fd[d - 1];
+            int thi = fd[d + 1];
+
+            x = (tlo >= thi) ? tlo + 1 : thi;
+            y = x - d;
+            while ((x < xlim) && (y < ylim) && mdiff_equal(pd, x, y)) {
+                x++;
+                y++;
+            }
+            fd[d] = x;
+            if (odd && (bmin <= d) && (d <= bmax) && (bd[d] <= x)) {
+                *pxmid = x;
+                *pymid = y;
+                return;
+            }
+        }
+
+        /* same again backwards from the bottom right corner */
+        if (bmin > dmin) {
+            bd[--bmin - 1] = INT_MAX;
+        } else {
+            ++bmin;
+        }
+        if (bmax < dmax) {
+            bd[++bmax + 1] = INT_MAX;
+        } else {
+            --bmax;
+        }
+
+        for (d = bmax; d >= bmin; d -= 2) {
+            int tlo = bd[d - 1];
+            int thi = bd[d + 1];
+
+            x = (tlo < thi) ? tlo : thi - 1;
+            y = x - d;
+            while ((xoff < x) && (yoff < y) && mdiff_equal(pd, x - 1, y - 1)) {
+                x--;
+                y--;
+            }
+            bd[d] = x;
+            if (!odd && (fmin <= d) && (d <= fmax) && (x <= fd[d])) {
+                *pxmid = x;
+                *pymid = y;
+                return;
+            }
+        }
+
+        /* if this is getting too expensive, settle for the diagonal that
+         * has got furthest in either direction. This keeps the worst case
+         * for two completely different large files within bounds at
+         * the cost of a possibly non-minimal result.
+         */
+        if (cost >= pd->toocostly) {
+            int fxybest = -1, fxbest = xoff;
+            int bxybest = INT_MAX, bxbest = xlim;
+
+            for (d = fmax; d >= fmin; d -= 2) {
+                x = min(fd[d], xlim);
+                y = x - d;
+                if (ylim < y) {
+                    x = ylim + d;
+                    y = ylim;
+                }
+                if (fxybest < x + y) {
+                    fxybest = x + y;
+                    fxbest = x;
+                }
+            }
+            for (d = bmax; d >= bmin; d -= 2) {
+                x = max(xoff, bd[d]);
+                y = x - d;
+                if (y < yoff) {
+                    x = yoff + d;
+                    y = yoff;
+                }
+                if (x + y < bxybest) {
+                    bxybest = x + y;
+                    bxbest = x;
+                }
+            }
+
+            if ((xlim + ylim) - bxybest < fxybest - (xoff + yoff)) {
+                *pxmid = fxbest;
+                *pymid = fxybest - fxbest;
+            } else {
+                *pxmid = bxbest;
+                *pymid = bxybest - bxbest;
+            }
+            return;
+        }
+    }
+} /* mdiff_midsnake */
+
+/*
+ * link the lines on a shortest edit script for X[xoff..xlim-1] and
+ * Y[yoff..ylim-1].
+ */
+static void
+mdiff_compareseq(PMDIFF pd, int xoff, int xlim, int yoff, int ylim)
+{
+    int xmid, ymid;
+
+    /* link any common prefix */
+    while ((xoff < xlim) && (yoff < ylim) && mdiff_equal(pd, xoff, yoff)) {
+        mdiff_linkpair(pd, xoff, yoff);
+        xoff++;
+        yoff++;
+    }
+
+    /* and any common suffix */
+    while ((xoff < xlim) && (yoff < ylim) && mdiff_equal(pd, xlim - 1, ylim - 1)) {
+        xlim--;
+        ylim--;
+        mdiff_linkpair(pd, xlim, ylim);
+    }
+
+    /* if either side is now empty, the rest is pure insertion or
+     * deletion and there is nothing more to link
+     */
+    if ((xoff == xlim) || (yoff == ylim)) {
+        return;
+    }
+
+    mdiff_midsnake(pd, xoff, xlim, yoff, ylim, &xmid, &ymid);
+
+    mdiff_compareseq(pd, xoff, xmid, yoff, ymid);
+    mdiff_compareseq(pd, xmid, xlim, ymid, ylim);
+} /* mdiff_compareseq */
+
+/* qsort/bsearch comparison for hashcodes */
+static int __cdecl
+mdiff_hashcmp(const void * p1, const void * p2)
+{
+    DWORD h1 = *(const DWORD *)p1;
+    DWORD h2 = *(const DWORD *)p2;
+
+    return (h1 < h2) ? -1 : ((h1 > h2) ? 1 : 0);
+}
+
+/*
+ * copy into line[] and hash[] only those of the n lines in src[] whose
+ * hashcode appears in the sorted array others[0..nOthers-1]. A line with
+ * no possible partner on the other side can never be on a common
+ * subsequence, so dropping it does not change the result. For two very
+ * different files this removes most of the work.
+ *
+ * returns the number of lines kept.
+ */
+static int
+mdiff_discard(LINE FAR * src, int n, DWORD FAR * others, int nOthers,
+              LINE FAR * line, DWORD FAR * hash)
+{
+    int i, nKept = 0;
+    DWORD h;
+
+    for (i = 0; i < n; i++) {
+        h = line_gethashcode(src[i]);
+        if (bsearch(&h, others, nOthers, sizeof(DWORD), mdiff_hashcmp) != NULL) {
+            line[nKept] = src[i];
+            hash[nKept] = h;
+            nKept++;
+        }
+    }
+    return(nKept);
+}
+
+/*-- external functions ------------------------------------------------- */
+
+/*
+ * link matching lines between left[] and right[] along a shortest
+ * edit script. See mdiff.h.
+ */
+BOOL
+mdiff_link(LINE FAR * left, int nLeft, LINE FAR * right, int nRight)
+{
+    MDIFF md;
+    LPVOID pMem;
+    DWORD FAR * xsorted;
+    DWORD FAR * ysorted;
+    int nx, ny, ndiags, i;
+
+    if ((left == NULL) || (right == NULL) || (nLeft <= 0) || (nRight <= 0)) {
+        return(FALSE);
+    }
+
+    /* one block holds, in order: both diagonal vectors (diagonals run
+     * from -nRight-1 to nLeft+1 inclusive), the kept lines and their
+     * hashcodes for each side, and a sorted copy of each side's hashcodes
+     * for the discard pass.
+     */
+    ndiags = nLeft + nRight + 3;
+    pMem = HeapAlloc(GetProcessHeap(), 0,
+                     2 * (SIZE_T)ndiags * sizeof(int)
+                     + ((SIZE_T)nLeft + nRight) * (sizeof(LINE) + 2 * sizeof(DWORD)));
+    if (pMem == NULL) {
+        return(FALSE);
+    }
+
+    md.xline = (LINE FAR *)pMem;
+    md.yline = md.xline + nLeft;
+    md.fdiag = (int FAR *)(md.yline + nRight) + nRight + 1;
+    md.bdiag = md.fdiag + ndiags;
+    md.xhash = (DWORD FAR *)(md.bdiag + nLeft + 2);
+    md.yhash = md.xhash + nLeft;
+    xsorted = md.yhash + nRight;
+    ysorted = xsorted + nLeft;
+    md.bLinked = FALSE;
+
+    for (i = 0; i < nLeft; i++) {
+        xsorted[i] = line_gethashcode(left[i]);
+    }
+    for (i = 0; i < nRight; i++) {
+        ysorted[i] = line_gethashcode(right[i]);
+    }
+    qsort(xsorted, nLeft, sizeof(DWORD), mdiff_hashcmp);
+    qsort(ysorted, nRight, sizeof(DWORD), mdiff_hashcmp);
+
+    nx = mdiff_discard(left, nLeft, ysorted, nRight, md.xline, md.xhash);
+    ny = mdiff_discard(right, nRight, xsorted, nLeft, md.yline, md.yhash);
+
+    /* cost limit grows with the square root of the problem size */
+    md.toocostly = 1;
+    for (i = nx + ny + 3; i != 0; i >>= 2) {
+        md.toocostly <<= 1;
+    }
+    if (md.toocostly < MDIFF_MINCOST) {
+        md.toocostly = MDIFF_MINCOST;
+    }
+
+    if ((nx > 0) && (ny > 0)) {
+        mdiff_compareseq(&md, 0, nx, 0, ny);
+    }
+
+    HeapFree(GetProcessHeap(), 0, pMem);
+
+    return(md.bLinked);
+} /* mdiff_link */
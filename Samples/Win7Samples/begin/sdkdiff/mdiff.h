@@ -0,0 +1,46 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+
+#ifndef __MDIFF_H__
+#define __MDIFF_H__
+
+/*
+ * mdiff.h
+ *
+ * line differencing using the Myers O(ND) algorithm ("An O(ND) Difference
+ * Algorithm and Its Variations", E. Myers, 1986).
+ *
+ * This is an alternative to the unique-line anchor matching done by
+ * section_match. Instead of anchoring on lines that occur exactly once in
+ * each file, it finds a longest common subsequence of the two line arrays
+ * and links every line on it. Files with many repeated lines (blank lines,
+ * braces, boilerplate) are therefore matched in order rather than left
+ * to the duplicate-matching passes.
+ *
+ * The middle-snake search uses linear space: memory is proportional to
+ * the number of lines in the two arrays, not to their product. Running time
+ * is O((N+M)D) where D is the size of the edit script. For very
+ * dissimilar inputs the search is bounded by a cost limit beyond which a
+ * good (but possibly non-minimal) split point is accepted.
+ *
+ * Lines are compared with their hashcodes first and line_compare
+ * second, so the ignore_blanks option is honoured.
+ */
+
+/*
+ * link matching lines between two arrays of LINE handles. left[0..nLeft-1]
+ * and right[0..nRight-1] must be in file order.
+ *
+ * Lines that are already linked are treated like any other line, but
+ * line_link will refuse to relink them.
+ *
+ * returns TRUE if any new links were made, FALSE if none were made or
+ * if we ran out of memory.
+ */
+BOOL mdiff_link(LINE FAR * left, int nLeft, LINE FAR * right, int nRight);
+
+#endif
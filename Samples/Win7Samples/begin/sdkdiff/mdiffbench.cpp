@@ -0,0 +1,319 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+
+/*
+ * mdiffbench.cpp
+ *
+ * console benchmark for the Myers line diff in mdiff.cpp.
+ *
+ *     mdiffbench [lines]
+ *
+ * builds a source-like file of the given number of lines (default 200000),
+ * about a third of them repeated boilerplate (blank lines, braces, return
+ * statements), and a second file made from it by each of these edits:
+ *
+ *     same        no change
+ *     1% edits    one line in a hundred inserted, deleted or changed
+ *     10% edits   one line in ten inserted, deleted or changed
+ *     disjoint    no line in common except the boilerplate
+ *     shuffled    the same lines in a random order
+ *
+ * For each, it times one mdiff_link over the whole of both files, and then
+ * a second call over the same (now linked) lines: the second figure is the
+ * cost ci_compare used to pay on every extra time round its matching loop.
+ *
+ * Only mdiff.obj is linked in. The LINE functions mdiff uses are supplied
+ * here over a plain array of struct fileline, with no ignore_blanks
+ * handling, so the figures are for the diff alone and not file reading.
+ */
+
+#include "precomp.h"
+
+#include "sdkdiff.h"
+
+#include "list.h"
+#include "line.h"
+#include "mdiff.h"
+
+/* --- LINE functions needed by mdiff.cpp ---------------------------*/
+
+DWORD
+line_gethashcode(LINE line)
+{
+    return(line->hash);
+}
+
+BOOL
+line_compare(LINE line1, LINE line2)
+{
+    if ((line1 == NULL) || (line2 == NULL)) {
+        return(FALSE);
+    }
+    if (line1->hash != line2->hash) {
+        return(FALSE);
+    }
+    return(strcmp(line1->text, line2->text) == 0);
+}
+
+BOOL
+line_link(LINE line1, LINE line2)
+{
+    if ((line1 == NULL) || (line2 == NULL)) {
+        return(FALSE);
+    }
+    if ((line1->link != NULL) || (line2->link != NULL)) {
+        return(FALSE);
+    }
+    if (line_compare(line1, line2)) {
+        line1->link = line2;
+        line2->link = line1;
+        return(TRUE);
+    }
+    return(FALSE);
+}
+
+/* --- test files ----------------------------------------------------*/
+
+#define LINE_TEXT   40      /* size of text buffer for each line */
+
+/* lines that occur many times over in real source files */
+static const char * const aszCommon[] = {
+    "",
+    "{",
+    "}",
+    "    }",
+    "        break;",
+    "    return(FALSE);",
+    "    return(TRUE);",
+    "#endif",
+};
+
+typedef struct {
+    struct fileline FAR * lines;    /* line structures */
+    LINE FAR * handles;             /* handles to the above, in file order */
+    char FAR * text;                /* text for all lines */
+    int nLines;
+} BENCHFILE;
+
+static ULONG ulSeed = 1;
+
+/* small linear congruential generator, so runs are repeatable */
+static ULONG
+bench_rand(void)
+{
+    ulSeed = ulSeed * 1103515245 + 12345;
+    return((ulSeed >> 8) & 0xffffff);
+}
+
+static DWORD
+bench_hash(LPCSTR psz)
+{
+    DWORD hash = 2166136261u;
+
+    while (*psz) {
+        hash = (hash ^ (BYTE)*psz++) * 16777619u;
+    }
+    return(hash);
+}
+
+static BOOL
+bench_alloc(BENCHFILE * pf, int nLines)
+{
+    pf->nLines = nLines;
+    pf->lines = (struct fileline FAR *)calloc(nLines, sizeof(struct fileline));
+    pf->handles = (LINE FAR *)calloc(nLines, sizeof(LINE));
+    pf->text = (char FAR *)calloc(nLines, LINE_TEXT);
+    return((pf->lines != NULL) && (pf->handles != NULL) && (pf->text != NULL));
+}
+
+static void
+bench_free(BENCHFILE * pf)
+{
+    free(pf->lines);
+    free(pf->handles);
+    free(pf->text);
+}
+
+/* make line i of a file: boilerplate a third of the time, else unique */
+static void
+bench_setline(BENCHFILE * pf, int i, ULONG ulUnique)
+{
+    LPSTR psz = pf->text + (SIZE_T)i * LINE_TEXT;
+
+    if (bench_rand() % 3 == 0) {
+        StringCchCopyA(psz, LINE_TEXT,
+                       aszCommon[bench_rand() % ARRAYSIZE(aszCommon)]);
+    } else {
+        StringCchPrintfA(psz, LINE_TEXT, "    x%lu = f(x%lu);",
+                         ulUnique, ulUnique + 1);
+    }
+}
+
+/* set up hashcodes and handles once all the text is in place */
+static void
+bench_finish(BENCHFILE * pf)
+{
+    int i;
+
+    for (i = 0; i < pf->nLines; i++) {
+        pf->lines[i].text = pf->text + (SIZE_T)i * LINE_TEXT;
+        pf->lines[i].hash = bench_hash(pf->lines[i].text);
+        pf->lines[i].link = NULL;
+        pf->lines[i].linenr = i + 1;
+        pf->handles[i] = &pf->lines[i];
+    }
+}
+
+/*
+ * make the right file from the left. nEditsPer1000 is how many lines in
+ * every thousand are inserted, deleted or changed; -1 makes a file with
+ * only boilerplate in common and -2 shuffles the left file.
+ */
+static BOOL
+bench_derive(BENCHFILE * pLeft, BENCHFILE * pRight, int nEditsPer1000)
+{
+    int i, j;
+
+    /* an insert for every line is the most the file can grow by */
+    if (!bench_alloc(pRight, pLeft->nLines * 2)) {
+        return(FALSE);
+    }
+
+    for (i = 0, j = 0; i < pLeft->nLines; i++) {
+        LPSTR pszFrom = pLeft->lines[i].text;
+
+        if (nEditsPer1000 == -1) {
+            bench_setline(pRight, j++, 0x40000000 + i);
+        } else if ((nEditsPer1000 > 0) &&
+                   ((int)(bench_rand() % 1000) < nEditsPer1000)) {
+            switch (bench_rand() % 3) {
+            case 0:     /* delete */
+                break;
+            case 1:     /* insert a new line before this one */
+                bench_setline(pRight, j++, 0x20000000 + i);
+                StringCchCopyA(pRight->text + (SIZE_T)j++ * LINE_TEXT,
+                               LINE_TEXT, pszFrom);
+                break;
+            default:    /* change */
+                bench_setline(pRight, j++, 0x30000000 + i);
+                break;
+            }
+        } else {
+            StringCchCopyA(pRight->text + (SIZE_T)j++ * LINE_TEXT,
+                           LINE_TEXT, pszFrom);
+        }
+    }
+    pRight->nLines = j;
+
+    if (nEditsPer1000 == -2) {
+        char szTemp[LINE_TEXT];
+
+        for (i = j - 1; i > 0; i--) {
+            int k = (int)(bench_rand() % (i + 1));
+            LPSTR p1 = pRight->text + (SIZE_T)i * LINE_TEXT;
+            LPSTR p2 = pRight->text + (SIZE_T)k * LINE_TEXT;
+
+            CopyMemory(szTemp, p1, LINE_TEXT);
+            CopyMemory(p1, p2, LINE_TEXT);
+            CopyMemory(p2, szTemp, LINE_TEXT);
+        }
+    }
+    bench_finish(pRight);
+    return(TRUE);
+}
+
+static double
+bench_ms(LARGE_INTEGER * pliStart, LARGE_INTEGER * pliFreq)
+{
+    LARGE_INTEGER liNow;
+
+    QueryPerformanceCounter(&liNow);
+    return((double)(liNow.QuadPart - pliStart->QuadPart) * 1000.0 /
+           (double)pliFreq->QuadPart);
+}
+
+static void
+bench_run(LPCSTR pszName, BENCHFILE * pLeft, BENCHFILE * pRight)
+{
+    LARGE_INTEGER liFreq, liStart;
+    double msFirst, msAgain;
+    int i, nLinked = 0;
+
+    QueryPerformanceFrequency(&liFreq);
+
+    QueryPerformanceCounter(&liStart);
+    mdiff_link(pLeft->handles, pLeft->nLines, pRight->handles, pRight->nLines);
+    msFirst = bench_ms(&liStart, &liFreq);
+
+    for (i = 0; i < pLeft->nLines; i++) {
+        if (pLeft->lines[i].link != NULL) {
+            nLinked++;
+        }
+    }
+
+    QueryPerformanceCounter(&liStart);
+    mdiff_link(pLeft->handles, pLeft->nLines, pRight->handles, pRight->nLines);
+    msAgain = bench_ms(&liStart, &liFreq);
+
+    printf("%-10s %8d %8d %8d %10.1f %12.0f %10.1f\n",
+           pszName, pLeft->nLines, pRight->nLines, nLinked, msFirst,
+           (pLeft->nLines + pRight->nLines) / (msFirst / 1000.0 + 1e-9),
+           msAgain);
+}
+
+int __cdecl
+main(int argc, char * argv[])
+{
+    static const struct {
+        LPCSTR pszName;
+        int nEditsPer1000;
+    } aCases[] = {
+        { "same",       0 },
+        { "1% edits",   10 },
+        { "10% edits",  100 },
+        { "disjoint",   -1 },
+        { "shuffled",   -2 },
+    };
+    BENCHFILE left, right;
+    int nLines = 200000;
+    int i, c;
+
+    if (argc > 1) {
+        nLines = atoi(argv[1]);
+    }
+    if (nLines <= 0) {
+        printf("usage: mdiffbench [lines]\n");
+        return(1);
+    }
+
+    printf("%-10s %8s %8s %8s %10s %12s %10s\n", "case", "left", "right",
+           "linked", "ms", "lines/sec", "again ms");
+
+    for (c = 0; c < ARRAYSIZE(aCases); c++) {
+        ulSeed = 1;
+        if (!bench_alloc(&left, nLines)) {
+            printf("out of memory\n");
+            return(1);
+        }
+        for (i = 0; i < nLines; i++) {
+            bench_setline(&left, i, i);
+        }
+        bench_finish(&left);
+
+        if (!bench_derive(&left, &right, aCases[c].nEditsPer1000)) {
+            printf("out of memory\n");
+            bench_free(&left);
+            return(1);
+        }
+
+        bench_run(aCases[c].pszName, &left, &right);
+
+        bench_free(&left);
+        bench_free(&right);
+    }
+    return(0);
+}
@@ -30,6 +30,8 @@
 
 #include "precomp.h"
 
+#include <limits.h>
+
 #include "list.h"
 #include "scandir.h"
 
@@ -1417,6 +1419,301 @@ dir_copy(
 
 
 
+/* ----- parallel scanning and checksumming ------------------------------*/
+
+/* never use more worker threads than this (WaitForMultipleObjects limit
+ * is 64; beyond a few threads per spindle we only add seek thrashing)
+ */
+#define DIR_MAXTHREADS          16
+
+/* how often (ms) the waiting thread refreshes the status bar */
+#define DIR_PROGRESS_INTERVAL   250
+
+/* state shared by the directory scanning workers */
+typedef struct {
+    CRITICAL_SECTION cs;    /* protects stack, nStack and nAlloc */
+    DIRECT * stack;         /* directories waiting to be scanned */
+    int nStack;             /* number of entries in use */
+    int nAlloc;             /* number of entries allocated */
+    LONG nPending;          /* queued or being scanned */
+    LONG nScanned;          /* finished (for progress) */
+    HANDLE hWork;           /* semaphore: one count per queued directory */
+    HANDLE hDone;           /* set when nPending drops to zero */
+} DIRSCANPOOL, * PDIRSCANPOOL;
+
+/* state shared by the checksum workers */
+typedef struct {
+    DIRITEM FAR * items;    /* files to checksum */
+    int nItems;
+    LONG iNext;             /* next index to take */
+    LONG nDone;             /* finished (for progress) */
+} DIRSUMPOOL, * PDIRSUMPOOL;
+
+/*
+ * number of worker threads to use: one per processor, within limits.
+ * checksumming is mostly waiting on the disk, so we allow at least two.
+ */
+int
+dir_getthreadcount(void)
+{
+    SYSTEM_INFO si;
+    int n;
+
+    GetSystemInfo(&si);
+    n = (int) si.dwNumberOfProcessors;
+    if (n < 2) {
+        n = 2;
+    }
+    if (n > DIR_MAXTHREADS) {
+        n = DIR_MAXTHREADS;
+    }
+    return(n);
+} /* dir_getthreadcount */
+
+/*
+ * start nThreads copies of proc with argument arg. returns the number
+ * actually started; the handles are placed in ahThreads[].
+ */
+int
+dir_startthreads(
+                 LPTHREAD_START_ROUTINE proc,
+                 LPVOID arg,
+                 HANDLE * ahThreads,
+                 int nThreads
+                 )
+{
+    int i, nStarted = 0;
+    DWORD tid;
+
+    for (i = 0; i < nThreads; i++) {
+        ahThreads[nStarted] = CreateThread(NULL, 0, proc, arg, 0, &tid);
+        if (ahThreads[nStarted] != NULL) {
+            nStarted++;
+        }
+    }
+    return(nStarted);
+} /* dir_startthreads */
+
+/*
+ * add a directory to the scan queue. If we cannot grow the queue, the
+ * directory is simply left unscanned: dir_findnextfile will scan it
+ * on demand later.
+ */
+void
+dir_scanpush(
+             PDIRSCANPOOL pool,
+             DIRECT dir
+             )
+{
+    EnterCriticalSection(&pool->cs);
+    if (pool->nStack == pool->nAlloc) {
+        int nNew = (pool->nAlloc == 0) ? 256 : pool->nAlloc * 2;
+        DIRECT * pNew;
+
+        if (pool->stack == NULL) {
+            pNew = (DIRECT *) HeapAlloc(GetProcessHeap(), 0, nNew * sizeof(DIRECT));
+        } else {
+            pNew = (DIRECT *) HeapReAlloc(GetProcessHeap(), 0, pool->stack, nNew * sizeof(DIRECT));
+        }
+        if (pNew == NULL) {
+            LeaveCriticalSection(&pool->cs);
+            return;
+        }
+        pool->stack = pNew;
+        pool->nAlloc = nNew;
+    }
+    pool->stack[pool->nStack++] = dir;
+    InterlockedIncrement(&pool->nPending);
+    LeaveCriticalSection(&pool->cs);
+
+    ReleaseSemaphore(pool->hWork, 1, NULL);
+} /* dir_scanpush */
+
+/*
+ * worker thread for dir_scanparallel. Each DIRECT is only ever touched by
+ * the one worker that popped it, and its children are not queued until it
+ * has been completely scanned, so no locking is needed around dir_scan.
+ */
+DWORD WINAPI
+dir_scanworker(
+               LPVOID arg
+               )
+{
+    PDIRSCANPOOL pool = (PDIRSCANPOOL) arg;
+    HANDLE ah[2];
+    DIRECT dir, child;
+
+    ah[0] = pool->hDone;
+    ah[1] = pool->hWork;
+
+    /* WaitForMultipleObjects reports the lowest signalled index, so
+     * hDone wins once everything is finished
+     */
+    while (WaitForMultipleObjects(2, ah, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+
+        EnterCriticalSection(&pool->cs);
+        dir = pool->stack[--pool->nStack];
+        LeaveCriticalSection(&pool->cs);
+
+        if (!bAbort) {
+            if (!dir->bScanned) {
+                dir_scan(dir, FALSE);
+            }
+            for (child = (DIRECT)List_First(dir->directs); child != NULL; child = (DIRECT)List_Next((LPVOID)child)) {
+                if (bAbort) break;  /* user requested abort */
+                dir_scanpush(pool, child);
+            }
+        }
+
+        InterlockedIncrement(&pool->nScanned);
+        if (InterlockedDecrement(&pool->nPending) == 0) {
+            SetEvent(pool->hDone);
+        }
+    }
+    return(0);
+} /* dir_scanworker */
+
+/*
+ * scan the whole of one or two trees on a pool of worker threads.
+ * see scandir.h
+ */
+void
+dir_scanparallel(
+                 DIRLIST left,
+                 DIRLIST right
+                 )
+{
+    DIRSCANPOOL pool;
+    HANDLE ahThreads[DIR_MAXTHREADS];
+    int nThreads;
+    char msg[80];
+	HRESULT hr;
+
+    ZeroMemory(&pool, sizeof(pool));
+    InitializeCriticalSection(&pool.cs);
+    pool.hWork = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+    pool.hDone = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if ((pool.hWork == NULL) || (pool.hDone == NULL)) {
+        goto LCleanup;
+    }
+
+    /* a file list has nothing to scan */
+    if ((left != NULL) && !left->bFile) {
+        dir_scanpush(&pool, left->dot);
+    }
+    if ((right != NULL) && !right->bFile) {
+        dir_scanpush(&pool, right->dot);
+    }
+    if (pool.nPending == 0) {
+        goto LCleanup;
+    }
+
+    nThreads = dir_startthreads(dir_scanworker, &pool, ahThreads, dir_getthreadcount());
+    if (nThreads == 0) {
+        /* leave it all to on-demand scanning */
+        goto LCleanup;
+    }
+
+    while (WaitForSingleObject(pool.hDone, DIR_PROGRESS_INTERVAL) == WAIT_TIMEOUT) {
+        hr = StringCchPrintf(msg, 80, LoadRcString(IDS_SCANNING_NDIRS), pool.nScanned);
+        if (SUCCEEDED(hr)) {
+            SetStatus(msg);
+        }
+    }
+
+    WaitForMultipleObjects(nThreads, ahThreads, TRUE, INFINITE);
+    while (nThreads > 0) {
+        CloseHandle(ahThreads[--nThreads]);
+    }
+    SetStatus(LoadRcString(IDS_COMPARING));
+
+LCleanup:
+    if (pool.hWork != NULL) {
+        CloseHandle(pool.hWork);
+    }
+    if (pool.hDone != NULL) {
+        CloseHandle(pool.hDone);
+    }
+    if (pool.stack != NULL) {
+        HeapFree(GetProcessHeap(), NULL, pool.stack);
+    }
+    DeleteCriticalSection(&pool.cs);
+} /* dir_scanparallel */
+
+/* worker thread for dir_checksumparallel */
+DWORD WINAPI
+dir_checksumworker(
+                   LPVOID arg
+                   )
+{
+    PDIRSUMPOOL pool = (PDIRSUMPOOL) arg;
+    LONG i;
+
+    for (;;) {
+        if (bAbort) break;  /* user requested abort */
+
+        i = InterlockedIncrement(&pool->iNext) - 1;
+        if (i >= pool->nItems) {
+            break;
+        }
+
+        /* computes and caches the checksum in the DIRITEM */
+        dir_getchecksum(pool->items[i]);
+
+        InterlockedIncrement(&pool->nDone);
+    }
+    return(0);
+} /* dir_checksumworker */
+
+/*
+ * checksum a set of files on a pool of worker threads. see scandir.h
+ */
+void
+dir_checksumparallel(
+                     DIRITEM FAR * items,
+                     int nItems
+                     )
+{
+    DIRSUMPOOL pool;
+    HANDLE ahThreads[DIR_MAXTHREADS];
+    int nThreads;
+    char msg[80];
+	HRESULT hr;
+
+    if ((items == NULL) || (nItems <= 0)) {
+        return;
+    }
+
+    pool.items = items;
+    pool.nItems = nItems;
+    pool.iNext = 0;
+    pool.nDone = 0;
+
+    nThreads = dir_getthreadcount();
+    if (nThreads > nItems) {
+        nThreads = nItems;
+    }
+    nThreads = dir_startthreads(dir_checksumworker, &pool, ahThreads, nThreads);
+    if (nThreads == 0) {
+        /* checksums will be calculated on demand instead */
+        return;
+    }
+
+    while (WaitForMultipleObjects(nThreads, ahThreads, TRUE, DIR_PROGRESS_INTERVAL) == WAIT_TIMEOUT) {
+        hr = StringCchPrintf(msg, 80, LoadRcString(IDS_CHECKSUMMING_NFILES), pool.nDone, nItems);
+        if (SUCCEEDED(hr)) {
+            SetStatus(msg);
+        }
+    }
+
+    while (nThreads > 0) {
+        CloseHandle(ahThreads[--nThreads]);
+    }
+    SetStatus(LoadRcString(IDS_COMPARING));
+} /* dir_checksumparallel */
+
+
+
 /*--- internal functions ---------------------------------------- */
 
 /* fill out a new DIRECT for a subdirectory (pre-allocated).
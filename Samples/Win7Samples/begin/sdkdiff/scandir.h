@@ -230,4 +230,25 @@ long CompareFileTime( CONST FILETIME * lpft1,  /* address of first file time */
 /* return the file time (last write time) (set during scanning), (0,0) if invalid */
 FILETIME dir_GetFileTime(DIRITEM cur);
 
+/*
+ * scan every directory in one or two trees using a pool of worker
+ * threads, so that later dir_nextitem calls do not have to scan on demand.
+ * Each worker takes a directory from a shared queue, scans it (files
+ * and immediate subdirectories only), and queues its subdirectories.
+ * Progress is shown on the status bar. right may be NULL.
+ *
+ * Safe to call on lists built with bOnDemand; directories already
+ * scanned are not rescanned. Returns when all scanning is done or bAbort
+ * is set.
+ */
+void dir_scanparallel(DIRLIST left, DIRLIST right);
+
+/*
+ * calculate the checksums of nItems files using a pool of worker threads.
+ * Items that already have a valid checksum are skipped. Afterwards
+ * dir_getchecksum and dir_validchecksum return the cached result without
+ * touching the file. Progress is shown on the status bar.
+ */
+void dir_checksumparallel(DIRITEM FAR * items, int nItems);
+
 #endif
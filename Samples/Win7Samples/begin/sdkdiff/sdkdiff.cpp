@@ -244,6 +244,7 @@ const CHAR szSdkDiff[]                = "SdkDiff";
 static const char szD[]                      = "%d";
 static const char szBlanks[]                 = "Blanks";
 static const char szAlgorithm2[]             = "Algorithm2";
+static const char szMyersDiff[]              = "MyersDiff";
 static const char szPicture[]                = "Picture";
 static const char szMonoColours[]            = "MonoColours";
 static const char szHideMark[]               = "HideMark";
@@ -527,6 +528,7 @@ int expand_include = INCLUDE_ALL;
 BOOL ignore_blanks = TRUE;
 BOOL show_whitespace = FALSE;
 BOOL Algorithm2 = TRUE;  /* Try duplicates - used in compitem.c */
+BOOL MyersDiff = FALSE;  /* Myers diff instead of unique-line anchors - used in compitem.c */
 BOOL picture_mode = TRUE;
 BOOL hide_markedfiles = FALSE;
 BOOL mono_colours = FALSE;       /* monochrome display */
@@ -1568,6 +1570,7 @@ CreateTools(void)
     expand_include = GetProfileInt(APPNAME, szLineInclude, expand_include);
     ignore_blanks = GetProfileInt(APPNAME, szBlanks, ignore_blanks);
     Algorithm2 = GetProfileInt(APPNAME, szAlgorithm2, Algorithm2);
+    MyersDiff = GetProfileInt(APPNAME, szMyersDiff, MyersDiff);
     mono_colours = GetProfileInt(APPNAME, szMonoColours, mono_colours);
     picture_mode = GetProfileInt(APPNAME, szPicture, picture_mode);
     hide_markedfiles = GetProfileInt(APPNAME, szHideMark, hide_markedfiles);
@@ -3433,6 +3436,7 @@ MainWndProc(
             CHECKMENU(IDM_IGNBLANKS, ignore_blanks);
             CHECKMENU(IDM_SHOWWHITESPACE, show_whitespace);
             CHECKMENU(IDM_ALG2, Algorithm2);
+            CHECKMENU(IDM_MYERS, MyersDiff);
             CHECKMENU(IDM_MONOCOLS, mono_colours);
             CHECKMENU(IDM_PICTURE, picture_mode);
             CHECKMENU(IDM_HIDEMARK, hide_markedfiles);
@@ -4156,6 +4160,31 @@ LTabWidth_tryagain:
 
                     break;
 
+                case IDM_MYERS:
+
+                    /* if selected, link lines using a Myers diff of
+                     * the whole file rather than unique-line anchors.
+                     */
+
+                    MyersDiff = !MyersDiff;
+                    CheckMenuItem(hMenu, IDM_MYERS,
+                                  MyersDiff? MF_CHECKED:MF_UNCHECKED);
+                    hr = StringCchPrintf(str, 32, szD, MyersDiff);
+					if (FAILED(hr))
+							OutputError(hr, IDS_SAFE_PRINTF);
+                    WriteProfileString(APPNAME, szMyersDiff, str);
+
+                    /* invalidate all diffs since we have
+                     * changed diff options, and re-do and display the
+                     * current diff if we are in expand mode.
+                     */
+                    view_changediffoptions(current_view);
+
+                    /* force repaint of bar window */
+                    InvalidateRect(hwndBar, NULL, TRUE);
+
+                    break;
+
                 case IDM_MONOCOLS:
 
                     /* Use monochrome colours - toggle */
@@ -36,6 +36,7 @@
 #include "list.h"
 #include "line.h"
 #include "section.h"
+#include "mdiff.h"
 
 #ifdef trace
 extern BOOL bTrace;  /* in sdkdiff.cpp'.  Read only here */
@@ -64,6 +65,7 @@ struct section {
 /* --- function prototypes ------------------------------------------*/
 
 TREE section_makectree(SECTION sec);
+int section_getlines(SECTION sec, LINE FAR * lines);
 BOOL section_expandanchor(SECTION sec1, LINE line1, SECTION sec2, LINE line2);
 
 
@@ -239,6 +241,69 @@ section_match(SECTION sec1, SECTION sec2, BOOL ReSynch)
     return(bLinked);
 } /* section_match */
 
+/*
+ * fill lines[] with the handles of the lines in a section, in order.
+ * if lines is NULL, just count them. returns the number of lines.
+ */
+int
+section_getlines(SECTION sec, LINE FAR * lines)
+{
+    LINE line;
+    int n = 0;
+
+    for (line = sec->first; line != NULL; line = (LINE)List_Next(line)) {
+        if (lines != NULL) {
+            lines[n] = line;
+        }
+        n++;
+        if (line == sec->last) {
+            break;
+        }
+    }
+    return(n);
+}
+
+/*
+ * match two sections using the Myers diff engine in mdiff.cpp, linking
+ * every line on a longest common subsequence of the two sections
+ * rather than anchoring on unique lines as section_match does.
+ *
+ * All links made are in order, so this never produces moved sections.
+ *
+ * we return TRUE if we linked any lines
+ */
+BOOL
+section_diff(SECTION sec1, SECTION sec2)
+{
+    LINE FAR * lines;
+    int n1, n2;
+    BOOL bLinked;
+
+    if ((sec1 == NULL) || (sec2 == NULL)) {
+        return(FALSE);
+    }
+
+    if ((sec1->first == NULL) || (sec2->first == NULL)) {
+        return(FALSE);
+    }
+
+    n1 = section_getlines(sec1, NULL);
+    n2 = section_getlines(sec2, NULL);
+
+    lines = (LINE FAR *) HeapAlloc(GetProcessHeap(), 0, ((SIZE_T)n1 + n2) * sizeof(LINE));
+    if (lines == NULL) {
+        return(FALSE);
+    }
+    section_getlines(sec1, lines);
+    section_getlines(sec2, lines + n1);
+
+    bLinked = mdiff_link(lines, n1, lines + n1, n2);
+
+    HeapFree(GetProcessHeap(), NULL, lines);
+
+    return(bLinked);
+} /* section_diff */
+
 /* -- accessor functions --------------*/
 
 /*
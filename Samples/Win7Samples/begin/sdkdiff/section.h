@@ -63,6 +63,15 @@ void section_delete(SECTION section);
  */
 BOOL section_match(SECTION section1, SECTION section2, BOOL ReSynch);
 
+/* match two sections using a Myers O(ND) diff: link all the lines on a
+ * longest common subsequence of the two sections. Unlike section_match
+ * this does not depend on lines being unique, but it only ever links
+ * lines in order, so it cannot detect moved blocks.
+ *
+ * returns TRUE if any new links between LINEs were made, or FALSE if not.
+ */
+BOOL section_diff(SECTION section1, SECTION section2);
+
 /* return the handle to the first or last line in the section. If the section
  * is one line long, these will be the same. they should never be NULL
  */
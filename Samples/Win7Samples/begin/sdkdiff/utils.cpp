@@ -462,13 +462,20 @@ checksum_file(
     *err = -2;                            /* default is "silly" */
 
     /* conceivably someone is fiddling with the file...?
-       we give 6 goes, with delays of 1,2,3,4 and 5 secs between
+       we give 6 goes, with delays of 1,2,3,4 and 5 secs between.
+       We share the file with other readers and writers (as dir_openfile
+       does), so a sharing violation means someone has it open
+       exclusively: that will not clear in a few seconds and waiting
+       would stall the checksum workers, so give up at once.
     */
     for (i=0; i<=5; ++i) {
         Sleep(1000*i);
-        fh = CreateFile(fn, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+        fh = CreateFile(fn, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE,
+                        NULL, OPEN_EXISTING, 0, NULL);
         if (fh!=INVALID_HANDLE_VALUE)
             break;
+        if (GetLastError() == ERROR_SHARING_VIOLATION)
+            break;
 
         {
             char msg[300];
@@ -99,6 +99,7 @@
 #define IDM_FPCHANGE_LAURIE		222
 #define IDM_TABWIDTH4   223
 #define IDM_TABWIDTH8   224
+#define IDM_MYERS       225
 
 #define IDM_MARK        300
 #define IDM_MARKPATTERN 301
@@ -237,5 +238,7 @@
 #define IDS_ERROR_IARGS				811
 #define IDS_ERROR_IARGS_OPENFILE	812
 #define IDS_ERROR_CANTLOADRICHEDIT	813
+#define IDS_SCANNING_NDIRS          814
+#define IDS_CHECKSUMMING_NFILES     815
 
 #endif
@@ -0,0 +1,460 @@
+//------------------------------------------------------------------------------
+// File: EZEffect.cpp
+//
+// Desc: DirectShow sample code - image effect functions used by the
+//       special effects filter.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+//------------------------------------------------------------------------------
+
+
+//
+// Each effect has a plain C version, which works a pixel at a time, and an
+// SSE2 version which works on 16 pixels (three 16 byte registers) at a time.
+// The SSE2 versions leave the pixels at the start and end of a row that do
+// not fill a whole block to the plain versions.
+//
+// RGB24 pixels are stored blue, green, red. A block of 16 pixels starts on
+// a pixel boundary, so byte j of register r in the block is the blue, green
+// or red byte of a pixel as (16 * r + j) % 3 is 0, 1 or 2.
+//
+// The image is read from one buffer and written to another, so the effects
+// are applied as the frame is copied rather than as a second pass over the
+// output buffer. That also means that BLUR and EMBOSS, which look at other
+// pixels on the same row, always see the original pixel values.
+//
+
+
+#include <windows.h>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>      // SSE2 intrinsics
+#endif
+
+#include "EZEffect.h"
+#include "resource.h"
+
+
+//
+// The effects which change each byte on its own are all done as
+//
+//      output = ((input >> shift) & and) ^ xor
+//
+// with a separate and and xor value for each of blue, green and red.
+//
+struct BYTE_EFFECT
+{
+    int  effect;
+    int  shift;
+    BYTE abAnd[3];          // Blue, green, red
+    BYTE abXor[3];
+};
+
+static const BYTE_EFFECT s_ByteEffects[] =
+{
+    // Zero out the other components to leave only the one we want
+
+    { IDC_RED,       0, { 0x00, 0x00, 0xff }, { 0x00, 0x00, 0x00 } },
+    { IDC_GREEN,     0, { 0x00, 0xff, 0x00 }, { 0x00, 0x00, 0x00 } },
+    { IDC_BLUE,      0, { 0xff, 0x00, 0x00 }, { 0x00, 0x00, 0x00 } },
+
+    // Bitwise shift each component to the right by 1 - the mask is needed
+    // by the SSE2 version, which shifts 16 bits at a time
+
+    { IDC_DARKEN,    1, { 0x7f, 0x7f, 0x7f }, { 0x00, 0x00, 0x00 } },
+
+    // Toggle each bit - this gives a sort of X-ray effect
+
+    { IDC_XOR,       0, { 0xff, 0xff, 0xff }, { 0xff, 0xff, 0xff } },
+
+    // Zero out the five LSB per each component
+
+    { IDC_POSTERIZE, 0, { 0xe0, 0xe0, 0xe0 }, { 0x00, 0x00, 0x00 } },
+};
+
+
+//
+// ByteEffectRow
+//
+// Apply one of the byte effects to pixels x through cxImage - 1 of a row
+//
+static void ByteEffectRow(const BYTE_EFFECT *pEffect,
+                          BYTE *pDest,
+                          const BYTE *pSource,
+                          int x,
+                          int cxImage)
+{
+    for (; x < cxImage; x++) {
+        for (int i = 0; i < 3; i++) {
+            pDest[x * 3 + i] = (BYTE) (((pSource[x * 3 + i] >> pEffect->shift)
+                                        & pEffect->abAnd[i]) ^ pEffect->abXor[i]);
+        }
+    }
+
+} // ByteEffectRow
+
+
+//
+// BlurRow
+//
+// Take pixel and its neighbor two pixels to the right and average
+// then out - this blurs them and produces a subtle motion effect.
+// The last two pixels on the row are copied as they are
+//
+static void BlurRow(BYTE *pDest, const BYTE *pSource, int x, int cxImage)
+{
+    const RGBTRIPLE *prgbIn = (const RGBTRIPLE *) pSource;
+    RGBTRIPLE *prgbOut = (RGBTRIPLE *) pDest;
+
+    for (; x < cxImage - 2; x++) {
+        prgbOut[x].rgbtRed   = (BYTE) ((prgbIn[x].rgbtRed + prgbIn[x + 2].rgbtRed) >> 1);
+        prgbOut[x].rgbtGreen = (BYTE) ((prgbIn[x].rgbtGreen + prgbIn[x + 2].rgbtGreen) >> 1);
+        prgbOut[x].rgbtBlue  = (BYTE) ((prgbIn[x].rgbtBlue + prgbIn[x + 2].rgbtBlue) >> 1);
+    }
+    for (; x < cxImage; x++) {
+        prgbOut[x] = prgbIn[x];
+    }
+
+} // BlurRow
+
+
+//
+// GreyRow
+//
+// An excellent greyscale calculation is:
+//      grey = (30 * red + 59 * green + 11 * blue) / 100
+// This is a bit too slow so a faster calculation is:
+//      grey = (red + green) / 2
+//
+static void GreyRow(BYTE *pDest, const BYTE *pSource, int x, int cxImage)
+{
+    const RGBTRIPLE *prgbIn = (const RGBTRIPLE *) pSource;
+    RGBTRIPLE *prgbOut = (RGBTRIPLE *) pDest;
+
+    for (; x < cxImage; x++) {
+        BYTE grey = (BYTE) ((prgbIn[x].rgbtRed + prgbIn[x].rgbtGreen) >> 1);
+        prgbOut[x].rgbtRed = prgbOut[x].rgbtGreen = prgbOut[x].rgbtBlue = grey;
+    }
+
+} // GreyRow
+
+
+//
+// EmbossRow
+//
+// Really sleazy emboss - rather than using a nice 3x3 convulution
+// matrix, we compare the greyscale values of two neighbours. If
+// they are not different, then a mid grey (128, 128, 128) is
+// supplied.  Large differences get father away from the mid grey
+//
+static void EmbossRow(BYTE *pDest, const BYTE *pSource, int x, int cxImage)
+{
+    const RGBTRIPLE *prgbIn = (const RGBTRIPLE *) pSource;
+    RGBTRIPLE *prgbOut = (RGBTRIPLE *) pDest;
+
+    if (x == 0 && cxImage > 0) {
+        prgbOut[0].rgbtRed = prgbOut[0].rgbtGreen = prgbOut[0].rgbtBlue = (BYTE) 128;
+        x++;
+    }
+
+    for (; x < cxImage; x++) {
+        int grey  = (prgbIn[x].rgbtRed + prgbIn[x].rgbtGreen) >> 1;
+        int grey2 = (prgbIn[x - 1].rgbtRed + prgbIn[x - 1].rgbtGreen) >> 1;
+        int temp = grey - grey2;
+        if (temp > 127) temp = 127;
+        if (temp < -127) temp = -127;
+        temp += 128;
+        prgbOut[x].rgbtRed = prgbOut[x].rgbtGreen = prgbOut[x].rgbtBlue = (BYTE) temp;
+    }
+
+} // EmbossRow
+
+
+#if defined(_M_IX86) || defined(_M_X64)
+
+//
+// Per register masks that pick out the blue, green and red bytes of a
+// block of 16 pixels
+//
+struct BLOCK_MASKS
+{
+    __m128i blue[3];
+    __m128i green[3];
+    __m128i red[3];
+};
+
+static void MakeBlockMask(__m128i mask[3], const BYTE abPixel[3])
+{
+    BYTE ab[48];
+    for (int i = 0; i < 48; i++) {
+        ab[i] = abPixel[i % 3];
+    }
+    for (int r = 0; r < 3; r++) {
+        mask[r] = _mm_loadu_si128((const __m128i *) (ab + 16 * r));
+    }
+
+} // MakeBlockMask
+
+static void MakeBlockMasks(BLOCK_MASKS *pMasks)
+{
+    static const BYTE abBlue[3]  = { 0xff, 0x00, 0x00 };
+    static const BYTE abGreen[3] = { 0x00, 0xff, 0x00 };
+    static const BYTE abRed[3]   = { 0x00, 0x00, 0xff };
+
+    MakeBlockMask(pMasks->blue, abBlue);
+    MakeBlockMask(pMasks->green, abGreen);
+    MakeBlockMask(pMasks->red, abRed);
+
+} // MakeBlockMasks
+
+
+//
+// AverageDown
+//
+// (a + b) >> 1 for each byte - _mm_avg_epu8 rounds up instead
+//
+static inline __m128i AverageDown(__m128i a, __m128i b)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+
+} // AverageDown
+
+
+//
+// BlockGrey
+//
+// Returns (red + green) >> 1 of each pixel in every byte of that pixel,
+// for register r of the block starting at pSource. Reads from one byte
+// before to two bytes after the register
+//
+static inline __m128i BlockGrey(const BYTE *pSource, int r, const BLOCK_MASKS *pMasks)
+{
+    const BYTE *p = pSource + 16 * r;
+    __m128i v0 = _mm_loadu_si128((const __m128i *) (p - 1));
+    __m128i v1 = _mm_loadu_si128((const __m128i *) p);
+    __m128i v2 = _mm_loadu_si128((const __m128i *) (p + 1));
+    __m128i v3 = _mm_loadu_si128((const __m128i *) (p + 2));
+
+    // The green and red bytes of a pixel are 1 and 2 bytes after its blue
+    // byte, 0 and 1 bytes after its green byte and -1 and 0 after its red
+
+    __m128i blue  = _mm_and_si128(AverageDown(v2, v3), pMasks->blue[r]);
+    __m128i green = _mm_and_si128(AverageDown(v1, v2), pMasks->green[r]);
+    __m128i red   = _mm_and_si128(AverageDown(v0, v1), pMasks->red[r]);
+
+    return _mm_or_si128(blue, _mm_or_si128(green, red));
+
+} // BlockGrey
+
+
+//
+// ByteEffectRow_SSE2
+//
+// Returns the number of pixels done, which is a multiple of 16
+//
+static int ByteEffectRow_SSE2(const BYTE_EFFECT *pEffect,
+                              BYTE *pDest,
+                              const BYTE *pSource,
+                              int cxImage)
+{
+    __m128i andMask[3], xorMask[3];
+    MakeBlockMask(andMask, pEffect->abAnd);
+    MakeBlockMask(xorMask, pEffect->abXor);
+    const __m128i shift = _mm_cvtsi32_si128(pEffect->shift);
+
+    int x = 0;
+    for (; x + 16 <= cxImage; x += 16) {
+        const BYTE *pIn = pSource + x * 3;
+        BYTE *pOut = pDest + x * 3;
+
+        for (int r = 0; r < 3; r++) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (pIn + 16 * r));
+            v = _mm_srl_epi16(v, shift);
+            v = _mm_xor_si128(_mm_and_si128(v, andMask[r]), xorMask[r]);
+            _mm_storeu_si128((__m128i *) (pOut + 16 * r), v);
+        }
+    }
+    return x;
+
+} // ByteEffectRow_SSE2
+
+
+//
+// BlurRow_SSE2
+//
+// Each byte is averaged with the byte 6 bytes (two pixels) further on, so
+// this does not need to keep to pixel boundaries. Returns the number of
+// whole pixels done
+//
+static int BlurRow_SSE2(BYTE *pDest, const BYTE *pSource, int cxImage)
+{
+    if (cxImage <= 2) {
+        return 0;
+    }
+
+    int cbBlur = (cxImage - 2) * 3;
+    int i = 0;
+
+    for (; i + 16 <= cbBlur; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *) (pSource + i));
+        __m128i b = _mm_loadu_si128((const __m128i *) (pSource + i + 6));
+        _mm_storeu_si128((__m128i *) (pDest + i), AverageDown(a, b));
+    }
+    return i / 3;
+
+} // BlurRow_SSE2
+
+
+//
+// GreyRow_SSE2
+//
+// Returns the number of pixels done. The first pixel is done by GreyRow
+// as the block reads the byte before it
+//
+static int GreyRow_SSE2(BYTE *pDest, const BYTE *pSource, int cxImage)
+{
+    if (cxImage < 1) {
+        return 0;
+    }
+
+    BLOCK_MASKS masks;
+    MakeBlockMasks(&masks);
+    GreyRow(pDest, pSource, 0, 1);
+
+    // The last register of a block reads two bytes past the block
+
+    int x = 1;
+    for (; (x + 16) * 3 + 2 <= cxImage * 3; x += 16) {
+        const BYTE *pIn = pSource + x * 3;
+        BYTE *pOut = pDest + x * 3;
+
+        for (int r = 0; r < 3; r++) {
+            _mm_storeu_si128((__m128i *) (pOut + 16 * r), BlockGrey(pIn, r, &masks));
+        }
+    }
+    return x;
+
+} // GreyRow_SSE2
+
+
+//
+// EmbossRow_SSE2
+//
+// Returns the number of pixels done. The first two pixels are done by
+// EmbossRow as the block reads the pixel before it, and one byte before that
+//
+static int EmbossRow_SSE2(BYTE *pDest, const BYTE *pSource, int cxImage)
+{
+    if (cxImage < 2) {
+        return 0;
+    }
+
+    BLOCK_MASKS masks;
+    MakeBlockMasks(&masks);
+    EmbossRow(pDest, pSource, 0, 2);
+
+    const __m128i limit = _mm_set1_epi8(127);
+    const __m128i midGrey = _mm_set1_epi8((char) 128);
+
+    int x = 2;
+    for (; (x + 16) * 3 + 2 <= cxImage * 3; x += 16) {
+        const BYTE *pIn = pSource + x * 3;
+        BYTE *pOut = pDest + x * 3;
+
+        for (int r = 0; r < 3; r++) {
+            __m128i grey  = BlockGrey(pIn, r, &masks);
+            __m128i grey2 = BlockGrey(pIn - 3, r, &masks);
+
+            // Only one of up and down is non zero, so this is
+            // 128 + the difference clamped to +/- 127
+
+            __m128i up   = _mm_min_epu8(_mm_subs_epu8(grey, grey2), limit);
+            __m128i down = _mm_min_epu8(_mm_subs_epu8(grey2, grey), limit);
+            __m128i temp = _mm_sub_epi8(_mm_add_epi8(midGrey, up), down);
+
+            _mm_storeu_si128((__m128i *) (pOut + 16 * r), temp);
+        }
+    }
+    return x;
+
+} // EmbossRow_SSE2
+
+#endif
+
+
+//
+// ApplyEffect
+//
+void ApplyEffect(int effect,
+                 BYTE *pDest,
+                 const BYTE *pSource,
+                 LONG lStride,
+                 int cxImage,
+                 int iFirstRow,
+                 int cRows,
+                 BOOL bSSE2)
+{
+    const BYTE_EFFECT *pByteEffect = NULL;
+
+    for (int i = 0; i < (int) (sizeof(s_ByteEffects) / sizeof(s_ByteEffects[0])); i++) {
+        if (s_ByteEffects[i].effect == effect) {
+            pByteEffect = &s_ByteEffects[i];
+        }
+    }
+
+    pDest += (LONG_PTR) lStride * iFirstRow;
+    pSource += (LONG_PTR) lStride * iFirstRow;
+
+    for (int y = 0; y < cRows; y++) {
+        int x = 0;
+
+        if (pByteEffect) {
+#if defined(_M_IX86) || defined(_M_X64)
+            if (bSSE2) {
+                x = ByteEffectRow_SSE2(pByteEffect, pDest, pSource, cxImage);
+            }
+#endif
+            ByteEffectRow(pByteEffect, pDest, pSource, x, cxImage);
+        }
+        else {
+            switch (effect)
+            {
+                case IDC_BLUR:
+#if defined(_M_IX86) || defined(_M_X64)
+                    if (bSSE2) {
+                        x = BlurRow_SSE2(pDest, pSource, cxImage);
+                    }
+#endif
+                    BlurRow(pDest, pSource, x, cxImage);
+                    break;
+
+                case IDC_GREY:
+#if defined(_M_IX86) || defined(_M_X64)
+                    if (bSSE2) {
+                        x = GreyRow_SSE2(pDest, pSource, cxImage);
+                    }
+#endif
+                    GreyRow(pDest, pSource, x, cxImage);
+                    break;
+
+                case IDC_EMBOSS:
+#if defined(_M_IX86) || defined(_M_X64)
+                    if (bSSE2) {
+                        x = EmbossRow_SSE2(pDest, pSource, cxImage);
+                    }
+#endif
+                    EmbossRow(pDest, pSource, x, cxImage);
+                    break;
+
+                default:
+                    CopyMemory(pDest, pSource, cxImage * 3);
+                    break;
+            }
+        }
+
+        pDest += lStride;
+        pSource += lStride;
+    }
+
+} // ApplyEffect
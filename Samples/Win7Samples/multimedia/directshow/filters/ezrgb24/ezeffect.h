@@ -0,0 +1,32 @@
+//------------------------------------------------------------------------------
+// File: EZEffect.h
+//
+// Desc: DirectShow sample code - image effect functions used by the
+//       special effects filter.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+//------------------------------------------------------------------------------
+
+
+//
+// ApplyEffect
+//
+// Reads rows iFirstRow through iFirstRow + cRows - 1 of an RGB24 image from
+// pSource, applies the effect (one of the IDC_ effect ids in resource.h) and
+// writes them to pDest. Both pointers are to the start of the image, not to
+// iFirstRow, and the source and destination must not overlap. Each output
+// row only depends on the same row of the input, so different row ranges
+// of one image can be done at the same time on different threads.
+//
+// Only the cxImage * 3 image bytes of each row are written, not the padding
+// at the end of the row. If bSSE2 is TRUE the SSE2 versions of the effects
+// are used; they give exactly the same results as the plain versions.
+//
+void ApplyEffect(int effect,
+                 BYTE *pDest,
+                 const BYTE *pSource,
+                 LONG lStride,
+                 int cxImage,
+                 int iFirstRow,
+                 int cRows,
+                 BOOL bSSE2);
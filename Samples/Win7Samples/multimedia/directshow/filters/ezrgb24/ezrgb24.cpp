@@ -50,6 +50,8 @@
 // ezprop.rc            Dialog box template for the property page
 // ezrgb24.cpp          Main filter code that does the special effects
 // ezrgb24.def          What APIs we import and export from this DLL
+// ezeffect.cpp         Plain and SSE2 versions of the effects
+// ezeffect.h           Declares the function that applies an effect
 // ezrgb24.h            Class definition for the special effects filter
 // ezuids.h             Header file containing the filter CLSIDs
 // iez.h                Defines the special effects custom interface
@@ -79,6 +81,7 @@
 #include "iEZ.h"
 #include "EZprop.h"
 #include "EZrgb24.h"
+#include "EZEffect.h"
 #include "resource.h"
 
 
@@ -193,6 +196,18 @@ CEZrgb24::CEZrgb24(TCHAR *tszName,
     CTransformFilter(tszName, punk, CLSID_EZrgb24),
     m_effect(IDC_RED),
     m_lBufferRequest(1),
+    m_bSSE2(FALSE),
+    m_cProcessors(1),
+    m_pBandWork(NULL),
+    m_bandEffect(IDC_NONE),
+    m_pBandDest(NULL),
+    m_pBandSource(NULL),
+    m_lBandStride(0),
+    m_cxBandImage(0),
+    m_cyBandImage(0),
+    m_cBandRows(0),
+    m_cBands(0),
+    m_iNextBand(0),
     CPersistStream(punk, phr)
 {
     char sz[60];
@@ -203,9 +218,35 @@ CEZrgb24::CEZrgb24(TCHAR *tszName,
     GetProfileStringA("Quartz", "EffectLength", "5.0", sz, 60);
     m_effectTime = COARefTime(atof(sz));
 
+#if defined(_M_IX86) || defined(_M_X64)
+    m_bSSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#endif
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    m_cProcessors = (int) info.dwNumberOfProcessors;
+
+    // If we can't get a thread pool work object each frame is
+    // done on the streaming thread, as a single band
+
+    m_pBandWork = CreateThreadpoolWork(BandWorkCallback, this, NULL);
+
 } // (Constructor)
 
 
+//
+// Destructor
+//
+CEZrgb24::~CEZrgb24()
+{
+    if (m_pBandWork) {
+        WaitForThreadpoolWorkCallbacks(m_pBandWork, FALSE);
+        CloseThreadpoolWork(m_pBandWork);
+    }
+
+} // (Destructor)
+
+
 //
 // CreateInstance
 //
@@ -251,15 +292,14 @@ STDMETHODIMP CEZrgb24::NonDelegatingQueryInterface(REFIID riid, void **ppv)
 //
 // Transform
 //
-// Copy the input sample into the output sample - then transform the output
-// sample 'in place'. If we have all keyframes, then we shouldn't do a copy
-// If we have cinepak or indeo and are decompressing frame N it needs frame
-// decompressed frame N-1 available to calculate it, unless we are at a
-// keyframe. So with keyframed codecs, you can't get away with applying the
-// transform to change the frames in place, because you'll mess up the next
-// frames decompression. The runtime MPEG decoder does not have keyframes in
-// the same way so it can be done in place. We know if a sample is key frame
-// as we transform because the sync point property will be set on the sample
+// Transform the input sample into the output sample. We never change the
+// input sample 'in place'. If we have cinepak or indeo and are decompressing
+// frame N it needs frame decompressed frame N-1 available to calculate it,
+// unless we are at a keyframe. So with keyframed codecs, you can't get away
+// with applying the transform to change the frames in place, because you'll
+// mess up the next frames decompression. Rather than copying the frame and
+// then applying the effect to the copy, the effect is applied as the frame
+// is copied, so each pixel is only read and written once
 //
 HRESULT CEZrgb24::Transform(IMediaSample *pIn, IMediaSample *pOut)
 {
@@ -268,7 +308,7 @@ HRESULT CEZrgb24::Transform(IMediaSample *pIn, IMediaSample *pOut)
 
     // Copy the properties across
 
-    HRESULT hr = Copy(pIn, pOut);
+    HRESULT hr = CopyProperties(pIn, pOut);
     if (FAILED(hr)) {
         return hr;
     }
@@ -278,44 +318,34 @@ HRESULT CEZrgb24::Transform(IMediaSample *pIn, IMediaSample *pOut)
     CRefTime tStart, tStop ;
     hr = pIn->GetTime((REFERENCE_TIME *) &tStart, (REFERENCE_TIME *) &tStop);
 
-    if (tStart >= m_effectStartTime) 
+    int effect = IDC_NONE;
     {
-        if (tStop <= (m_effectStartTime + m_effectTime)) 
+        CAutoLock cAutolock(&m_EZrgb24Lock);
+
+        if (tStart >= m_effectStartTime) 
         {
-            return Transform(pOut);
+            if (tStop <= (m_effectStartTime + m_effectTime)) 
+            {
+                effect = m_effect;
+            }
         }
     }
 
-    return NOERROR;
+    return Transform(pIn, pOut, effect);
 
 } // Transform
 
 
 //
-// Copy
+// CopyProperties
 //
-// Make destination an identical copy of source
+// Give the destination the same properties as the source
 //
-HRESULT CEZrgb24::Copy(IMediaSample *pSource, IMediaSample *pDest) const
+HRESULT CEZrgb24::CopyProperties(IMediaSample *pSource, IMediaSample *pDest) const
 {
     CheckPointer(pSource,E_POINTER);   
     CheckPointer(pDest,E_POINTER);   
 
-    // Copy the sample data
-
-    BYTE *pSourceBuffer, *pDestBuffer;
-    long lSourceSize = pSource->GetActualDataLength();
-
-#ifdef DEBUG
-    long lDestSize = pDest->GetSize();
-    ASSERT(lDestSize >= lSourceSize);
-#endif
-
-    pSource->GetPointer(&pSourceBuffer);
-    pDest->GetPointer(&pDestBuffer);
-
-    CopyMemory( (PVOID) pDestBuffer,(PVOID) pSourceBuffer,lSourceSize);
-
     // Copy the sample times
 
     REFERENCE_TIME TimeStart, TimeEnd;
@@ -381,167 +411,134 @@ HRESULT CEZrgb24::Copy(IMediaSample *pSource, IMediaSample *pDest) const
 
     return NOERROR;
 
-} // Copy
+} // CopyProperties
 
 
 //
-// Transform (in place)
+// Transform (with effect)
 //
-// 'In place' apply the image effect to this sample
+// Write the input image to the output sample with the effect applied to it
 //
-HRESULT CEZrgb24::Transform(IMediaSample *pMediaSample)
+HRESULT CEZrgb24::Transform(IMediaSample *pSource, IMediaSample *pDest, int effect)
 {
-    BYTE *pData;                // Pointer to the actual image buffer
-    long lDataLen;              // Holds length of any given sample
-    unsigned int grey,grey2;    // Used when applying greying effects
-    int iPixel;                 // Used to loop through the image pixels
-    int temp,x,y;               // General loop counters for transforms
-    RGBTRIPLE *prgb;            // Holds a pointer to the current pixel
+    BYTE *pSourceBuffer, *pDestBuffer;
+    long lSourceSize = pSource->GetActualDataLength();
+
+#ifdef DEBUG
+    long lDestSize = pDest->GetSize();
+    ASSERT(lDestSize >= lSourceSize);
+#endif
+
+    pSource->GetPointer(&pSourceBuffer);
+    pDest->GetPointer(&pDestBuffer);
+
+    // Get the image properties from the BITMAPINFOHEADER. Rows are
+    // padded out to a multiple of four bytes
 
     AM_MEDIA_TYPE* pType = &m_pInput->CurrentMediaType();
     VIDEOINFOHEADER *pvi = (VIDEOINFOHEADER *) pType->pbFormat;
     ASSERT(pvi);
 
-    CheckPointer(pMediaSample,E_POINTER);
-    pMediaSample->GetPointer(&pData);
-    lDataLen = pMediaSample->GetSize();
+    int cxImage = pvi->bmiHeader.biWidth;
+    int cyImage = abs(pvi->bmiHeader.biHeight);
+    LONG lStride = DIBWIDTHBYTES(pvi->bmiHeader);
 
-    // Get the image properties from the BITMAPINFOHEADER
+    // Just copy the sample if there is no effect, or if it does not
+    // hold a whole image
 
-    int cxImage    = pvi->bmiHeader.biWidth;
-    int cyImage    = pvi->bmiHeader.biHeight;
-    int numPixels  = cxImage * cyImage;
+    if (effect == IDC_NONE || lSourceSize < lStride * cyImage) {
+        CopyMemory( (PVOID) pDestBuffer,(PVOID) pSourceBuffer,lSourceSize);
+        return NOERROR;
+    }
 
-    // int iPixelSize = pvi->bmiHeader.biBitCount / 8;
-    // int cbImage    = cyImage * cxImage * iPixelSize;
+    m_cBands = GetBandCount(cyImage);
 
-    switch (m_effect)
-    {
-        case IDC_NONE: break;
-
-        // Zero out the green and blue components to leave only the red
-        // so acting as a filter - for better visual results, compute a
-        // greyscale value for the pixel and make that the red component
-
-        case IDC_RED:
-                        
-            prgb = (RGBTRIPLE*) pData;
-            for (iPixel=0; iPixel < numPixels; iPixel++, prgb++) {
-                prgb->rgbtGreen = 0;
-                prgb->rgbtBlue = 0;
-            }
-            break;
-    
-        case IDC_GREEN:
+    if (m_cBands <= 1) {
+        ApplyEffect(effect, pDestBuffer, pSourceBuffer, lStride,
+                    cxImage, 0, cyImage, m_bSSE2);
+    }
+    else {
+        m_bandEffect = effect;
+        m_pBandDest = pDestBuffer;
+        m_pBandSource = pSourceBuffer;
+        m_lBandStride = lStride;
+        m_cxBandImage = cxImage;
+        m_cyBandImage = cyImage;
+        m_cBandRows = (cyImage + m_cBands - 1) / m_cBands;
+        m_cBands = (cyImage + m_cBandRows - 1) / m_cBandRows;
+        m_iNextBand = 0;
+
+        // This thread does bands too, so submit one less work item than bands
+
+        for (int i = 1; i < m_cBands; i++) {
+            SubmitThreadpoolWork(m_pBandWork);
+        }
 
-            prgb = (RGBTRIPLE*) pData;
-            for (iPixel=0; iPixel < numPixels; iPixel++, prgb++) {
-                prgb->rgbtRed = 0;
-                prgb->rgbtBlue = 0;
-            }
-            break;
+        TransformNextBands();
 
-        case IDC_BLUE:
-            prgb = (RGBTRIPLE*) pData;
-            for (iPixel=0; iPixel < numPixels; iPixel++, prgb++) {
-                prgb->rgbtRed = 0;
-                prgb->rgbtGreen = 0;
-            }
-            break;
-
-        // Bitwise shift each component to the right by 1
-        // this results in the image getting much darker
-
-        case IDC_DARKEN:
-                        
-            prgb = (RGBTRIPLE*) pData;
-            for (iPixel=0; iPixel < numPixels; iPixel++, prgb++) {
-                prgb->rgbtRed   = (BYTE) (prgb->rgbtRed >> 1);
-                prgb->rgbtGreen = (BYTE) (prgb->rgbtGreen >> 1);
-                prgb->rgbtBlue  = (BYTE) (prgb->rgbtBlue >> 1);
-            }
-            break;
+        // Wait for the other bands before the samples are delivered
 
-        // Toggle each bit - this gives a sort of X-ray effect
+        WaitForThreadpoolWorkCallbacks(m_pBandWork, FALSE);
+    }
 
-        case IDC_XOR:   
-            prgb = (RGBTRIPLE*) pData;
-            for (iPixel=0; iPixel < numPixels; iPixel++, prgb++) {
-                prgb->rgbtRed   = (BYTE) (prgb->rgbtRed ^ 0xff);
-                prgb->rgbtGreen = (BYTE) (prgb->rgbtGreen ^ 0xff);
-                prgb->rgbtBlue  = (BYTE) (prgb->rgbtBlue ^ 0xff);
-            }
-            break;
+    return NOERROR;
 
-        // Zero out the five LSB per each component
+} // Transform (with effect)
 
-        case IDC_POSTERIZE:
-            prgb = (RGBTRIPLE*) pData;
-            for (iPixel=0; iPixel < numPixels; iPixel++, prgb++) {
-                prgb->rgbtRed   = (BYTE) (prgb->rgbtRed & 0xe0);
-                prgb->rgbtGreen = (BYTE) (prgb->rgbtGreen & 0xe0);
-                prgb->rgbtBlue  = (BYTE) (prgb->rgbtBlue & 0xe0);
-            }
-            break;
-
-        // Take pixel and its neighbor two pixels to the right and average
-        // then out - this blurs them and produces a subtle motion effect
-
-        case IDC_BLUR:
-            prgb = (RGBTRIPLE*) pData;
-            for (y = 0 ; y < pvi->bmiHeader.biHeight; y++) {
-                for (x = 2 ; x < pvi->bmiHeader.biWidth; x++,prgb++) {
-                    prgb->rgbtRed   = (BYTE) ((prgb->rgbtRed + prgb[2].rgbtRed) >> 1);
-                    prgb->rgbtGreen = (BYTE) ((prgb->rgbtGreen + prgb[2].rgbtGreen) >> 1);
-                    prgb->rgbtBlue  = (BYTE) ((prgb->rgbtBlue + prgb[2].rgbtBlue) >> 1);
-                }
-                prgb +=2;
-            }
-            break;
-
-        // An excellent greyscale calculation is:
-        //      grey = (30 * red + 59 * green + 11 * blue) / 100
-        // This is a bit too slow so a faster calculation is:
-        //      grey = (red + green) / 2
-
-        case IDC_GREY:  
-            prgb = (RGBTRIPLE*) pData;
-            for (iPixel=0; iPixel < numPixels ; iPixel++, prgb++) {
-                grey = (prgb->rgbtRed + prgb->rgbtGreen) >> 1;
-                prgb->rgbtRed = prgb->rgbtGreen = prgb->rgbtBlue = (BYTE) grey;
-            }
-            break;
 
-        // Really sleazy emboss - rather than using a nice 3x3 convulution
-        // matrix, we compare the greyscale values of two neighbours. If
-        // they are not different, then a mid grey (128, 128, 128) is
-        // supplied.  Large differences get father away from the mid grey
+//
+// GetBandCount
+//
+// How many bands of rows to split a frame into. Bands of only a few rows
+// are not worth handing to another thread
+//
+int CEZrgb24::GetBandCount(int cyImage) const
+{
+    if (m_pBandWork == NULL) {
+        return 1;
+    }
 
-        case IDC_EMBOSS:
-            prgb = (RGBTRIPLE*) pData;
-            for (y = 0 ; y < pvi->bmiHeader.biHeight; y++) 
-            {
-                grey2 = (prgb->rgbtRed + prgb->rgbtGreen) >> 1;
-                prgb->rgbtRed = prgb->rgbtGreen = prgb->rgbtBlue = (BYTE) 128;
-                prgb++;
-
-                for (x = 1 ; x < pvi->bmiHeader.biWidth; x++) {
-                    grey = (prgb->rgbtRed + prgb->rgbtGreen) >> 1;
-                    temp = grey - grey2;
-                    if (temp > 127) temp = 127;
-                    if (temp < -127) temp = -127;
-                    temp += 128;
-                    prgb->rgbtRed = prgb->rgbtGreen = prgb->rgbtBlue = (BYTE) temp;
-                    grey2 = grey;
-                    prgb++;
-                }
-            }   
-            break;
+    int cBands = min(m_cProcessors, (int) MAX_BANDS);
+    cBands = min(cBands, cyImage / MIN_BAND_ROWS);
+
+    return max(cBands, 1);
+
+} // GetBandCount
+
+
+//
+// TransformNextBands
+//
+// Apply the effect to bands of the current frame until there are none
+// left. Called on the streaming thread and from the thread pool
+//
+void CEZrgb24::TransformNextBands()
+{
+    LONG iBand;
+
+    while ((iBand = InterlockedIncrement(&m_iNextBand) - 1) < m_cBands) {
+        int iFirstRow = iBand * m_cBandRows;
+        int cRows = min(m_cBandRows, m_cyBandImage - iFirstRow);
+
+        ApplyEffect(m_bandEffect, m_pBandDest, m_pBandSource, m_lBandStride,
+                    m_cxBandImage, iFirstRow, cRows, m_bSSE2);
     }
 
-    return NOERROR;
+} // TransformNextBands
+
+
+//
+// BandWorkCallback
+//
+// Thread pool callback for band-parallel processing
+//
+VOID CALLBACK CEZrgb24::BandWorkCallback(PTP_CALLBACK_INSTANCE pInstance,
+                                         PVOID pContext,
+                                         PTP_WORK pWork)
+{
+    ((CEZrgb24 *) pContext)->TransformNextBands();
 
-} // Transform (in place)
+} // BandWorkCallback
 
 
 // Check the input type is OK - return an error otherwise
@@ -47,19 +47,43 @@ public:
 
 private:
 
-    // Constructor
+    // Constructor and destructor
     CEZrgb24(TCHAR *tszName, LPUNKNOWN punk, HRESULT *phr);
+    ~CEZrgb24();
 
     // Look after doing the special effect
     BOOL CanPerformEZrgb24(const CMediaType *pMediaType) const;
-    HRESULT Copy(IMediaSample *pSource, IMediaSample *pDest) const;
-    HRESULT Transform(IMediaSample *pMediaSample);
+    HRESULT CopyProperties(IMediaSample *pSource, IMediaSample *pDest) const;
+    HRESULT Transform(IMediaSample *pSource, IMediaSample *pDest, int effect);
+
+    // Split the frame into bands of rows and do them on the thread pool
+    enum { MAX_BANDS = 16, MIN_BAND_ROWS = 32 };
+    int GetBandCount(int cyImage) const;
+    void TransformNextBands();
+    static VOID CALLBACK BandWorkCallback(PTP_CALLBACK_INSTANCE pInstance,
+                                          PVOID pContext,
+                                          PTP_WORK pWork);
 
     CCritSec    m_EZrgb24Lock;          // Private play critical section
     int         m_effect;               // Which effect are we processing
     CRefTime    m_effectStartTime;      // When the effect will begin
     CRefTime    m_effectTime;           // And how long it will last for
     const long m_lBufferRequest;        // The number of buffers to use
+    BOOL        m_bSSE2;                // Can the processor run SSE2 code
+    int         m_cProcessors;          // Number of processors to use
+
+    // The frame being transformed by the thread pool
+
+    PTP_WORK    m_pBandWork;            // Runs BandWorkCallback
+    int         m_bandEffect;           // Effect for this frame
+    BYTE        *m_pBandDest;           // Output image
+    const BYTE  *m_pBandSource;         // Input image
+    LONG        m_lBandStride;          // Bytes per row of both images
+    int         m_cxBandImage;          // Image width
+    int         m_cyBandImage;          // Image height
+    int         m_cBandRows;            // Rows per band
+    int         m_cBands;               // Number of bands
+    LONG        m_iNextBand;            // Next band to be done
 
 }; // EZrgb24
 
@@ -0,0 +1,214 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// AudioDelayKernels.cpp
+// Mixing functions for the delay effect.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "AudioDelayKernels.h"
+
+#ifdef AUDIODELAY_SSE2
+#include <emmintrin.h>  // SSE2 intrinsics
+#endif
+
+// In each SSE2 block the input is stored to the delay line before any tap
+// is loaded, so a tap less than one block behind the write position reads
+// the samples of this call, as the plain loop does.
+
+void MixTaps8(
+    unsigned char               *pDest,
+    const unsigned char         *pInput,
+    unsigned char               *pLine,
+    const unsigned char * const *ppTaps,
+    const int                   *pnGains,
+    unsigned int                cTaps,
+    unsigned int                cSamples,
+    int                         nDry
+    )
+{
+    for (unsigned int n = 0; n < cSamples; n++)
+    {
+        // 8-bit sound is 0..255 with 128 == silence
+
+        // Normalize to -128 .. 127
+        int i = pInput[n] - 128;
+
+        pLine[n] = static_cast<unsigned char>(i + 128);
+
+        int sum = i * nDry;
+        for (unsigned int k = 0; k < cTaps; k++)
+        {
+            sum += (ppTaps[k][n] - 128) * pnGains[k];
+        }
+        i = sum >> MIX_SHIFT;
+
+        // Truncate
+        if (i > 127)
+        {
+            i = 127;
+        }
+        else if (i < -128)
+        {
+            i = -128;
+        }
+
+        pDest[n] = static_cast<unsigned char>(i + 128);
+    }
+}
+
+void MixTaps16(
+    short                       *pDest,
+    const short                 *pInput,
+    short                       *pLine,
+    const short * const         *ppTaps,
+    const int                   *pnGains,
+    unsigned int                cTaps,
+    unsigned int                cSamples,
+    int                         nDry,
+    bool                        bSSE2
+    )
+{
+    unsigned int n = 0;
+
+#ifdef AUDIODELAY_SSE2
+    if (bSSE2)
+    {
+        // Interleave the samples in pairs, so that one multiply-add computes
+        // (a * weightA + b * weightB): the input with the first tap, then
+        // the other taps two at a time (the last one with zero if odd).
+        __m128i weights[(MAX_DELAY_TAPS + 2) / 2];
+        weights[0] = _mm_set1_epi32((pnGains[0] << 16) | (nDry & 0xFFFF));
+
+        for (unsigned int k = 1; k < cTaps; k += 2)
+        {
+            int nGainB = (k + 1 < cTaps) ? pnGains[k + 1] : 0;
+            weights[(k + 1) / 2] = _mm_set1_epi32((nGainB << 16) | (pnGains[k] & 0xFFFF));
+        }
+
+        const __m128i zero = _mm_setzero_si128();
+
+        for (; n + 8 <= cSamples; n += 8)
+        {
+            __m128i input = _mm_loadu_si128((const __m128i*)(pInput + n));
+
+            _mm_storeu_si128((__m128i*)(pLine + n), input);
+
+            __m128i tap = _mm_loadu_si128((const __m128i*)(ppTaps[0] + n));
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(input, tap), weights[0]);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(input, tap), weights[0]);
+
+            for (unsigned int k = 1; k < cTaps; k += 2)
+            {
+                __m128i tapA = _mm_loadu_si128((const __m128i*)(ppTaps[k] + n));
+                __m128i tapB = (k + 1 < cTaps) ? _mm_loadu_si128((const __m128i*)(ppTaps[k + 1] + n)) : zero;
+
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(tapA, tapB), weights[(k + 1) / 2]));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(tapA, tapB), weights[(k + 1) / 2]));
+            }
+
+            lo = _mm_srai_epi32(lo, MIX_SHIFT);
+            hi = _mm_srai_epi32(hi, MIX_SHIFT);
+
+            // Pack with saturation to -32768 .. 32767
+            _mm_storeu_si128((__m128i*)(pDest + n), _mm_packs_epi32(lo, hi));
+        }
+    }
+#else
+    (void)bSSE2;
+#endif
+
+    for (; n < cSamples; n++)
+    {
+        int i = pInput[n];
+
+        pLine[n] = static_cast<short>(i);
+
+        int sum = i * nDry;
+        for (unsigned int k = 0; k < cTaps; k++)
+        {
+            sum += ppTaps[k][n] * pnGains[k];
+        }
+        i = sum >> MIX_SHIFT;
+
+        // Truncate
+        if (i > 32767)
+        {
+            i = 32767;
+        }
+        else if (i < -32768)
+        {
+            i = -32768;
+        }
+
+        pDest[n] = static_cast<short>(i);
+    }
+}
+
+void MixTapsFloat(
+    float                       *pDest,
+    const float                 *pInput,
+    float                       *pLine,
+    const float * const         *ppTaps,
+    const float                 *pfGains,
+    unsigned int                cTaps,
+    unsigned int                cSamples,
+    float                       fDry,
+    bool                        bSSE2
+    )
+{
+    unsigned int n = 0;
+
+#ifdef AUDIODELAY_SSE2
+    if (bSSE2)
+    {
+        __m128 gains[MAX_DELAY_TAPS];
+        for (unsigned int k = 0; k < cTaps; k++)
+        {
+            gains[k] = _mm_set1_ps(pfGains[k]);
+        }
+
+        const __m128 dry = _mm_set1_ps(fDry);
+
+        for (; n + 4 <= cSamples; n += 4)
+        {
+            __m128 input = _mm_loadu_ps(pInput + n);
+
+            _mm_storeu_ps(pLine + n, input);
+
+            // Same order of operations as the plain loop
+            __m128 sum = _mm_mul_ps(input, dry);
+            for (unsigned int k = 0; k < cTaps; k++)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(ppTaps[k] + n), gains[k]));
+            }
+
+            _mm_storeu_ps(pDest + n, sum);
+        }
+    }
+#else
+    (void)bSSE2;
+#endif
+
+    // Floating-point audio is not clipped; values outside -1.0 .. 1.0 are valid.
+    for (; n < cSamples; n++)
+    {
+        float f = pInput[n];
+
+        pLine[n] = f;
+
+        float sum = f * fDry;
+        for (unsigned int k = 0; k < cTaps; k++)
+        {
+            sum += ppTaps[k][n] * pfGains[k];
+        }
+
+        pDest[n] = sum;
+    }
+}
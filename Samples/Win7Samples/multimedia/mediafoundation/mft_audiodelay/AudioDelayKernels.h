@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// AudioDelayKernels.h
+// Mixing functions for the delay effect.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// The mixing functions use only standard C++ and SSE2 intrinsics, not
+// Windows or Media Foundation, so they can be built and measured on
+// their own (see the KernelBench directory).
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define AUDIODELAY_SSE2 1
+#endif
+
+// Integer formats are mixed in fixed point, with MIX_ONE == 100%.
+const int MIX_SHIFT = 14;
+const int MIX_ONE = 1 << MIX_SHIFT;
+
+// Most taps the effect can have.
+const unsigned int MAX_DELAY_TAPS = 16;
+
+// Most samples the SSE2 code mixes at a time.
+const unsigned int MIX_BLOCK_SAMPLES = 8;
+
+//-------------------------------------------------------------------
+// MixTaps8, MixTaps16, MixTapsFloat
+// Mix a span of input samples with any number of delay taps:
+//
+//     pDest[n] = pInput[n] * dry + sum over k of ppTaps[k][n] * gain[k]
+//
+// and write the input samples into the delay line at pLine.
+//
+// pDest: Destination samples. (Can equal pInput.)
+// pInput: Input samples.
+// pLine: Delay line at the write position. Receives the input samples.
+// ppTaps: Delay line at each tap's read position. A tap behind pLine
+//         by less than the span sees the samples written by this call.
+//         A tap ahead of pLine (reading the oldest samples of a circular
+//         line) must be at least MIX_BLOCK_SAMPLES ahead of it.
+// cTaps: Number of taps, 1 .. MAX_DELAY_TAPS.
+// cSamples: Number of samples, counting each channel.
+// dry, gains: Mix weights. Fixed point (MIX_ONE == 1.0) for the
+//         integer formats; the sum of the weights must not exceed
+//         MIX_ONE, so that the sums cannot overflow.
+// bSSE2: If true, use SSE2 instructions. The SSE2 and plain versions
+//         give exactly the same results.
+//
+// None of the pointers may wrap around within the span.
+//-------------------------------------------------------------------
+
+void MixTaps8(
+    unsigned char               *pDest,
+    const unsigned char         *pInput,
+    unsigned char               *pLine,
+    const unsigned char * const *ppTaps,
+    const int                   *pnGains,
+    unsigned int                cTaps,
+    unsigned int                cSamples,
+    int                         nDry
+    );
+
+void MixTaps16(
+    short                       *pDest,
+    const short                 *pInput,
+    short                       *pLine,
+    const short * const         *ppTaps,
+    const int                   *pnGains,
+    unsigned int                cTaps,
+    unsigned int                cSamples,
+    int                         nDry,
+    bool                        bSSE2
+    );
+
+void MixTapsFloat(
+    float                       *pDest,
+    const float                 *pInput,
+    float                       *pLine,
+    const float * const         *ppTaps,
+    const float                 *pfGains,
+    unsigned int                cTaps,
+    unsigned int                cSamples,
+    float                       fDry,
+    bool                        bSSE2
+    );
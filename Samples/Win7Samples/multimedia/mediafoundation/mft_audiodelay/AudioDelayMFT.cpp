@@ -79,10 +79,14 @@ CDelayMFT::CDelayMFT() :
     m_cbDelayBuffer(0),
     m_pbDelayPtr(NULL),
     m_dwDelay(DEFAULT_DELAY),
+    m_cTaps(0),
     m_bDraining(FALSE),
-    m_cbTailSamples(0)
+    m_cbTailSamples(0),
+    m_bSSE2(FALSE)
 {
-
+#if defined(_M_IX86) || defined(_M_X64)
+    m_bSSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#endif
 }
 
 //-------------------------------------------------------------------
@@ -1183,26 +1187,26 @@ HRESULT CDelayMFT::AllocateStreamingResources()
     }
 
     HRESULT hr = S_OK;
+    DWORD cbMaxDelay = 0;
 
-    // Lazily create the attribute store, which holds the attribute for the delay length.
+    // Lazily create the attribute store, which holds the attributes for the delay.
     CHECK_HR(hr = CreateAttributeStore());
 
-    // Get the delay length. 
-    m_dwDelay = MFGetAttributeUINT32(m_pAttributes, MF_AUDIODELAY_DELAY_LENGTH, DEFAULT_DELAY);
+    // Get the delay taps.
+    CHECK_HR(hr = GetDelayTaps());
 
-    // A zero-length delay buffer will complicate things, so disallow zero.
-    // Use the default instead.
-    if (m_dwDelay == 0)
+    for (UINT32 k = 0; k < m_cTaps; k++)
     {
-        m_dwDelay = DEFAULT_DELAY;
+        cbMaxDelay = max(cbMaxDelay, m_cbTapDelay[k]);
     }
 
-    // Make sure the delay buffer won't exceed MAXDWORD bytes.
-    m_dwDelay = min( m_dwDelay, MAXDWORD / (SamplesPerSec() * BlockAlign()) );
-
+    // Allocate the buffer that holds the delayed samples. It holds the
+    // longest delay, plus at least MIX_BLOCK_SAMPLES samples of whole
+    // frames, so that the longest tap is never so close ahead of the
+    // write position that the mix functions overwrite what it reads.
+    m_cbDelayBuffer = cbMaxDelay + 
+        ((MIX_BLOCK_SAMPLES + NumChannels() - 1) / NumChannels()) * BlockAlign();
 
-    // Allocate the buffer that holds the delayed samples.
-    m_cbDelayBuffer = (m_dwDelay * SamplesPerSec() * BlockAlign()) / 1000;
     m_pbDelayBuffer = (BYTE*)CoTaskMemAlloc(m_cbDelayBuffer);
     
     if (m_pbDelayBuffer == NULL)
@@ -1293,6 +1297,94 @@ done:
 }
 
 
+//-------------------------------------------------------------------
+// GetDelayTaps
+// Gets the delay taps from the MF_AUDIODELAY_TAPS attribute. If that
+// attribute is not set, makes one tap from MF_AUDIODELAY_DELAY_LENGTH.
+//
+// The delays are converted to bytes, so the media type must be set.
+//-------------------------------------------------------------------
+
+HRESULT CDelayMFT::GetDelayTaps()
+{
+    HRESULT hr = S_OK;
+
+    AUDIODELAY_TAP taps[MAX_DELAY_TAPS];
+    UINT32 cbTaps = 0;
+    UINT32 cTaps = 0;
+    DWORD dwGainTotal = 0;
+
+    hr = m_pAttributes->GetBlob(MF_AUDIODELAY_TAPS, (UINT8*)taps, sizeof(taps), &cbTaps);
+
+    if (hr == MF_E_ATTRIBUTENOTFOUND)
+    {
+        // Get the delay length. 
+        m_dwDelay = MFGetAttributeUINT32(m_pAttributes, MF_AUDIODELAY_DELAY_LENGTH, DEFAULT_DELAY);
+
+        // A zero-length delay buffer will complicate things, so disallow zero.
+        // Use the default instead.
+        if (m_dwDelay == 0)
+        {
+            m_dwDelay = DEFAULT_DELAY;
+        }
+
+        taps[0].dwDelay = m_dwDelay;
+        taps[0].dwGain = 100;
+        cbTaps = sizeof(AUDIODELAY_TAP);
+        hr = S_OK;
+    }
+    else if (hr == E_NOT_SUFFICIENT_BUFFER)
+    {
+        // Too many taps.
+        hr = E_INVALIDARG;
+    }
+    CHECK_HR(hr);
+
+    if (cbTaps == 0 || (cbTaps % sizeof(AUDIODELAY_TAP)) != 0)
+    {
+        CHECK_HR(hr = E_INVALIDARG);
+    }
+
+    cTaps = cbTaps / sizeof(AUDIODELAY_TAP);
+
+    for (UINT32 k = 0; k < cTaps; k++)
+    {
+        if (taps[k].dwDelay == 0)
+        {
+            CHECK_HR(hr = E_INVALIDARG);
+        }
+
+        // Make sure the delay buffer won't exceed MAXDWORD bytes.
+        DWORD dwDelay = min( taps[k].dwDelay, MAXDWORD / (SamplesPerSec() * BlockAlign()) );
+
+        // The delay must be whole audio frames, so that each channel 
+        // always lines up with its own delayed samples.
+        m_cbTapDelay[k] = (dwDelay * SamplesPerSec() * BlockAlign()) / 1000;
+        m_cbTapDelay[k] -= (m_cbTapDelay[k] % BlockAlign());
+        m_cbTapDelay[k] = max(m_cbTapDelay[k], BlockAlign());
+
+        // Clip the gain to [0...100]
+        m_dwTapGain[k] = min(taps[k].dwGain, 100);
+        dwGainTotal += m_dwTapGain[k];
+    }
+
+    // The taps together can be at most 100% of the wet signal; otherwise 
+    // the integer mix could overflow.
+    if (dwGainTotal > 100)
+    {
+        for (UINT32 k = 0; k < cTaps; k++)
+        {
+            m_dwTapGain[k] = m_dwTapGain[k] * 100 / dwGainTotal;
+        }
+    }
+
+    m_cTaps = cTaps;
+
+done:
+    return hr;
+}
+
+
 //-------------------------------------------------------------------
 // Name: GetProposedType
 // Description: Returns a preferred media type from our list.
@@ -1303,7 +1395,7 @@ done:
 
 HRESULT CDelayMFT::GetProposedType(DWORD dwTypeIndex, IMFMediaType **ppmt)
 {
-    if (dwTypeIndex > 1)
+    if (dwTypeIndex > 2)
     {
         return MF_E_NO_MORE_TYPES;
     }
@@ -1324,6 +1416,11 @@ HRESULT CDelayMFT::GetProposedType(DWORD dwTypeIndex, IMFMediaType **ppmt)
         break;
 
     case 1:
+        // Partial type: Floating-point audio
+        CHECK_HR(hr = pType->SetGUID(MF_MT_SUBTYPE, MFAudioFormat_Float));
+        break;
+
+    case 2:
         // Full type: Propose 48 kHz, 16-bit, 2-channel
 
         const UINT32 SamplesPerSec = 48000;
@@ -1492,7 +1589,13 @@ HRESULT CDelayMFT::OnDrain()
     if (m_cbDelayBuffer > 0)
     {
         m_bDraining = TRUE;
-        m_cbTailSamples = m_cbDelayBuffer;
+
+        // The tail is as long as the longest delay.
+        m_cbTailSamples = 0;
+        for (UINT32 k = 0; k < m_cTaps; k++)
+        {
+            m_cbTailSamples = max(m_cbTailSamples, m_cbTapDelay[k]);
+        }
     }
     return S_OK;
 }
@@ -1508,6 +1611,13 @@ HRESULT CDelayMFT::OnDrain()
 //
 // Note: pbDest can equal pbInputData, because this MFT supports 
 // in-place processing.
+//
+// Each input sample replaces the sample at the delay pointer, and is 
+// mixed with the samples each tap's delay behind it. Channels are 
+// interleaved in both the input and the delay buffer, so this does not
+// depend on the number of channels. The data is processed in spans that
+// end where the delay pointer or a tap reaches the end of the delay 
+// buffer, so the mix functions never have to wrap around.
 //-------------------------------------------------------------------
 
 HRESULT CDelayMFT::ProcessAudio(BYTE *pbDest, const BYTE *pbInputData, DWORD dwQuanta)
@@ -1516,79 +1626,102 @@ HRESULT CDelayMFT::ProcessAudio(BYTE *pbDest, const BYTE *pbInputData, DWORD dwQ
     assert(m_pAttributes);
 
     int   nWet = 0;  // Wet portion of wet/dry mix
-    DWORD sample = 0, channel = 0, cChannels = 0;
     
-    cChannels = NumChannels();
-
     // Get the wet/dry mix.
     nWet = (int)MFGetAttributeUINT32(m_pAttributes, MF_AUDIODELAY_WET_DRY_MIX, DEFAULT_WET_DRY_MIX);
     // Clip the value to [0...100]
-    nWet = min(nWet, 100);
+    nWet = max(min(nWet, 100), 0);
+
+    const BOOL  bFloat = IsFloat();
+    const BOOL  b8Bit = Is8Bit();
+    const DWORD cbSample = BitsPerSample() / 8;
+
+    const BYTE  *pbDelayEnd = m_pbDelayBuffer + m_cbDelayBuffer;
+
+    // Mix weights: the wet part is shared among the taps by their gains.
+    // (Fixed point for the integer formats.)
+    const int   nDry = (100 - nWet) * MIX_ONE / 100;
+    const float fDry = (100 - nWet) / 100.0f;
 
-    if (Is8Bit())
+    int         rgnGain[MAX_DELAY_TAPS];
+    float       rgfGain[MAX_DELAY_TAPS];
+    const BYTE  *rgpbTap[MAX_DELAY_TAPS];   // Read position of each tap.
+
+    for (UINT32 k = 0; k < m_cTaps; k++)
     {
-        for (sample = 0; sample < dwQuanta; ++sample)
+        rgnGain[k] = nWet * (int)m_dwTapGain[k] * MIX_ONE / 10000;
+        rgfGain[k] = (nWet * (int)m_dwTapGain[k]) / 10000.0f;
+
+        DWORD cbOffset = (DWORD)(m_pbDelayPtr - m_pbDelayBuffer);
+
+        if (cbOffset < m_cbTapDelay[k])
         {
-            for (channel = 0; channel < cChannels; ++channel)
-            {
-                // 8-bit sound is 0..255 with 128 == silence
-                
-                // Get the input sample and normalize to -128 .. 127
-                int i = pbInputData[sample * cChannels + channel] - 128;
-                
-                // Get the delay sample and normalize to -128 .. 127
-                int delay = m_pbDelayPtr[0] - 128;
-                
-                m_pbDelayPtr[0] = static_cast<BYTE>(i + 128);
-                IncrementDelayPtr(sizeof(unsigned char));
-                
-                i = (i * (100 - nWet)) / 100 + (delay * nWet) / 100;
-                
-                // Truncate
-                if (i > 127)
-                {
-                    i = 127;
-                }
-                else if (i < -128)
-                {
-                    i = -128;
-                }
-                
-                pbDest[sample * cChannels + channel] = (unsigned char)(i+128);
-                
-            }
+            cbOffset += m_cbDelayBuffer;
         }
+        rgpbTap[k] = m_pbDelayBuffer + (cbOffset - m_cbTapDelay[k]);
     }
-    else  // 16-bit
+
+    DWORD cSamples = dwQuanta * NumChannels();    // Samples in all channels.
+
+    while (cSamples > 0)
     {
-        for (sample = 0; sample < dwQuanta; ++sample)
+        DWORD cSpan = min(cSamples, (DWORD)(pbDelayEnd - m_pbDelayPtr) / cbSample);
+
+        for (UINT32 k = 0; k < m_cTaps; k++)
         {
-            for (channel = 0; channel < cChannels; ++channel)
+            cSpan = min(cSpan, (DWORD)(pbDelayEnd - rgpbTap[k]) / cbSample);
+        }
+
+        if (bFloat)
+        {
+            const float *rgpfTap[MAX_DELAY_TAPS];
+            for (UINT32 k = 0; k < m_cTaps; k++)
+            {
+                rgpfTap[k] = (const float*)rgpbTap[k];
+            }
+
+            MixTapsFloat((float*)pbDest, (const float*)pbInputData, (float*)m_pbDelayPtr, 
+                rgpfTap, rgfGain, m_cTaps, cSpan, fDry, m_bSSE2 != FALSE);
+        }
+        else if (b8Bit)
+        {
+            MixTaps8(pbDest, pbInputData, m_pbDelayPtr, 
+                rgpbTap, rgnGain, m_cTaps, cSpan, nDry);
+        }
+        else
+        {
+            const short *rgpsTap[MAX_DELAY_TAPS];
+            for (UINT32 k = 0; k < m_cTaps; k++)
             {
-                int i = ((short*)pbInputData)[sample * cChannels + channel];
-                
-                int delay = ((short*)m_pbDelayPtr)[0];
-
-                ((short*)m_pbDelayPtr)[0] = static_cast<short>(i);
-                IncrementDelayPtr(sizeof(short));
-                
-                i = (i * (100 - nWet)) / 100 + (delay * nWet) / 100;
-                
-                // Truncate
-                if (i > 32767)
-                {
-                    i = 32767;
-                }
-                else if (i < -32768)
-                {
-                    i = -32768;
-                }
-                
-                ((short*)pbDest)[sample * cChannels + channel] = (short)i;
-                
+                rgpsTap[k] = (const short*)rgpbTap[k];
             }
+
+            MixTaps16((short*)pbDest, (const short*)pbInputData, (short*)m_pbDelayPtr, 
+                rgpsTap, rgnGain, m_cTaps, cSpan, nDry, m_bSSE2 != FALSE);
         }
+
+        pbDest += cSpan * cbSample;
+        pbInputData += cSpan * cbSample;
+        m_pbDelayPtr += cSpan * cbSample;
+
+        if (m_pbDelayPtr == pbDelayEnd)
+        {
+            m_pbDelayPtr = m_pbDelayBuffer;
+        }
+
+        for (UINT32 k = 0; k < m_cTaps; k++)
+        {
+            rgpbTap[k] += cSpan * cbSample;
+
+            if (rgpbTap[k] == pbDelayEnd)
+            {
+                rgpbTap[k] = m_pbDelayBuffer;
+            }
+        }
+
+        cSamples -= cSpan;
     }
+
     return S_OK;
 }
 
@@ -1649,12 +1782,33 @@ HRESULT ValidatePCMAudioType(IMFMediaType *pmt)
 
     // Validate the values. 
 
-    if (nChannels != 1 && nChannels != 2)
+    if (majorType != MFMediaType_Audio)
+    {
+        CHECK_HR(hr = MF_E_INVALIDMEDIATYPE);
+    }
+
+    // Any number of interleaved channels.
+    if (nChannels == 0)
     {
         CHECK_HR(hr = MF_E_INVALIDMEDIATYPE);
     }
 
-    if (wBitsPerSample != 8 && wBitsPerSample != 16)
+    // 8-bit or 16-bit PCM, or 32-bit floating point.
+    if (subtype == MFAudioFormat_PCM)
+    {
+        if (wBitsPerSample != 8 && wBitsPerSample != 16)
+        {
+            CHECK_HR(hr = MF_E_INVALIDMEDIATYPE);
+        }
+    }
+    else if (subtype == MFAudioFormat_Float)
+    {
+        if (wBitsPerSample != 32)
+        {
+            CHECK_HR(hr = MF_E_INVALIDMEDIATYPE);
+        }
+    }
+    else
     {
         CHECK_HR(hr = MF_E_INVALIDMEDIATYPE);
     }
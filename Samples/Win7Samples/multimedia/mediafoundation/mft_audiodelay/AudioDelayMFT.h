@@ -25,10 +25,12 @@
 #include "common.h"
 using namespace MediaFoundationSamples;
 
+#include "AudioDelayKernels.h"
+
 const DWORD UNITS = 10000000;            // 1 sec = 1 * UNITS
 const DWORD DEFAULT_WET_DRY_MIX = 25;    // Percentage of "wet" (delay) audio in the mix.
 const DWORD DEFAULT_DELAY = 1000;        // Delay in msec
-const UINT32 ATTRIBUTE_COUNT = 2;        // Initial size of our attribute store. 
+const UINT32 ATTRIBUTE_COUNT = 3;        // Initial size of our attribute store. 
 
 
 
@@ -147,6 +149,12 @@ private:
 
     DWORD                   m_dwDelay;          // Delay in ms
 
+    UINT32                  m_cTaps;                        // Number of delay taps
+    DWORD                   m_cbTapDelay[MAX_DELAY_TAPS];   // Delay of each tap, in bytes
+    DWORD                   m_dwTapGain[MAX_DELAY_TAPS];    // Gain of each tap, as a percentage of the wet signal
+
+    BOOL                    m_bSSE2;            // Can the processor run SSE2 code?
+
 private:
 
     enum StreamDirection { InputStream, OutputStream };
@@ -160,15 +168,12 @@ private:
 
     BOOL Is8Bit() const { return (BitsPerSample() == 8); }
 
-    // IncrementDelayPtr: Moves the delay pointer around the circular buffer
-    void IncrementDelayPtr(size_t size) 
+    BOOL IsFloat() const
     {
-        m_pbDelayPtr += size;
-        if (m_pbDelayPtr + size > m_pbDelayBuffer + m_cbDelayBuffer)
-        {
-            m_pbDelayPtr = m_pbDelayBuffer;
-        }
-    }   
+        assert(m_pMediaType);
+        GUID subtype = GUID_NULL;
+        return SUCCEEDED(m_pMediaType->GetGUID(MF_MT_SUBTYPE, &subtype)) && (subtype == MFAudioFormat_Float);
+    }
 
     // IsValidInputStream: Returns TRUE if dwInputStreamID is a valid input stream identifier.
     BOOL IsValidInputStream(DWORD dwInputStreamID) const 
@@ -206,6 +211,7 @@ private:
     HRESULT AllocateStreamingResources();
     void    FreeStreamingResources(BOOL bFlush);  
     HRESULT CreateAttributeStore();
+    HRESULT GetDelayTaps();
 
     HRESULT InternalProcessOutput(MFT_OUTPUT_DATA_BUFFER& OutputSample, DWORD *pdwStatus);
     
@@ -40,3 +40,23 @@ DEFINE_GUID(MF_AUDIODELAY_DELAY_LENGTH,
 DEFINE_GUID(MF_AUDIODELAY_WET_DRY_MIX, 
 0x72127f43, 0x5878, 0x4ea8, 0x82, 0x69, 0xd1, 0xaf, 0x3b, 0xb1, 0x1c, 0xb2);
 
+
+
+// MF_AUDIODELAY_TAPS: {D6105E0E-B46B-4f15-A992-27883B28ACBC}
+// Type: Blob (array of AUDIODELAY_TAP, 1 to 16 entries)
+// Specifies several delays (taps) that are mixed together into the "wet"
+// signal. Each tap gives its delay in milliseconds (not zero) and its gain
+// as a percentage of the wet signal. If the gains add up to more than 100,
+// they are scaled down to 100.
+// If this attribute is not set, the MFT uses one tap with a gain of 100 and
+// the delay given by MF_AUDIODELAY_DELAY_LENGTH.
+// This attribute must be set before the MFT_MESSAGE_NOTIFY_BEGIN_STREAMING
+// message is sent, or before the first call to ProcessInput. 
+DEFINE_GUID(MF_AUDIODELAY_TAPS, 
+0xd6105e0e, 0xb46b, 0x4f15, 0xa9, 0x92, 0x27, 0x88, 0x3b, 0x2b, 0xac, 0xbc);
+
+struct AUDIODELAY_TAP
+{
+    UINT32  dwDelay;    // Delay in msec
+    UINT32  dwGain;     // Percentage of the wet signal
+};
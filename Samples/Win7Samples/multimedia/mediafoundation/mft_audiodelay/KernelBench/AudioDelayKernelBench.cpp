@@ -0,0 +1,368 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// AudioDelayKernelBench.cpp: Checks and times the delay mixing functions
+// with 1 to 16 taps.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+// AudioDelayKernelBench [seconds]
+//
+// Runs audio through a circular delay line in buffers, splitting each
+// buffer where the write position or a tap reaches the end of the line,
+// as CDelayMFT::ProcessAudio does.
+//
+// First checks the plain and SSE2 functions against a sample-by-sample
+// reference, for several channel counts, with taps as short as one frame
+// and as long as the line, and buffers of random sizes.
+//
+// Then runs a 48 kHz stereo stream in 10 ms buffers, with the taps spread
+// up to 1 second, single threaded, for about the given time per case
+// (default 0.5 seconds), and prints millions of samples (counting each
+// channel) mixed per second, and how many such streams one core keeps up
+// with in real time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "../AudioDelayKernels.h"
+
+const unsigned int SAMPLE_RATE = 48000;
+
+// Mix weights, as ProcessAudio computes them from the wet/dry mix and
+// the tap gains (percentages).
+struct WEIGHTS
+{
+    int     nDry;
+    int     rgnGain[MAX_DELAY_TAPS];
+    float   fDry;
+    float   rgfGain[MAX_DELAY_TAPS];
+
+    WEIGHTS(int nWet, const unsigned int *pGains, unsigned int cTaps)
+    {
+        nDry = (100 - nWet) * MIX_ONE / 100;
+        fDry = (100 - nWet) / 100.0f;
+        for (unsigned int k = 0; k < cTaps; k++)
+        {
+            rgnGain[k] = nWet * (int)pGains[k] * MIX_ONE / 10000;
+            rgfGain[k] = (nWet * (int)pGains[k]) / 10000.0f;
+        }
+    }
+};
+
+void Mix(unsigned char *pDest, const unsigned char *pInput, unsigned char *pLine,
+    const unsigned char * const *ppTaps, unsigned int cTaps, unsigned int cSamples,
+    const WEIGHTS& w, bool /* bSSE2 */)
+{
+    MixTaps8(pDest, pInput, pLine, ppTaps, w.rgnGain, cTaps, cSamples, w.nDry);
+}
+
+void Mix(short *pDest, const short *pInput, short *pLine,
+    const short * const *ppTaps, unsigned int cTaps, unsigned int cSamples,
+    const WEIGHTS& w, bool bSSE2)
+{
+    MixTaps16(pDest, pInput, pLine, ppTaps, w.rgnGain, cTaps, cSamples, w.nDry, bSSE2);
+}
+
+void Mix(float *pDest, const float *pInput, float *pLine,
+    const float * const *ppTaps, unsigned int cTaps, unsigned int cSamples,
+    const WEIGHTS& w, bool bSSE2)
+{
+    MixTapsFloat(pDest, pInput, pLine, ppTaps, w.rgfGain, cTaps, cSamples, w.fDry, bSSE2);
+}
+
+unsigned char Silence(unsigned char) { return 128; }
+short Silence(short) { return 0; }
+float Silence(float) { return 0.0f; }
+
+unsigned char TestSample(unsigned char, unsigned int n) { return (unsigned char)(n * 2654435761u >> 24); }
+short TestSample(short, unsigned int n) { return (short)(n * 2654435761u >> 16); }
+float TestSample(float, unsigned int n) { return (int)(n * 2654435761u >> 8) / 8388608.0f - 1.0f; }
+
+// One output sample, computed directly from the whole input signal.
+unsigned char Reference(const unsigned char *pInput, unsigned int n, const unsigned int *pDelays,
+    unsigned int cTaps, const WEIGHTS& w)
+{
+    int sum = (pInput[n] - 128) * w.nDry;
+    for (unsigned int k = 0; k < cTaps; k++)
+    {
+        sum += (n >= pDelays[k] ? pInput[n - pDelays[k]] - 128 : 0) * w.rgnGain[k];
+    }
+    int i = sum >> MIX_SHIFT;
+    return (unsigned char)((i > 127 ? 127 : i < -128 ? -128 : i) + 128);
+}
+
+short Reference(const short *pInput, unsigned int n, const unsigned int *pDelays,
+    unsigned int cTaps, const WEIGHTS& w)
+{
+    int sum = pInput[n] * w.nDry;
+    for (unsigned int k = 0; k < cTaps; k++)
+    {
+        sum += (n >= pDelays[k] ? pInput[n - pDelays[k]] : 0) * w.rgnGain[k];
+    }
+    int i = sum >> MIX_SHIFT;
+    return (short)(i > 32767 ? 32767 : i < -32768 ? -32768 : i);
+}
+
+float Reference(const float *pInput, unsigned int n, const unsigned int *pDelays,
+    unsigned int cTaps, const WEIGHTS& w)
+{
+    float sum = pInput[n] * w.fDry;
+    for (unsigned int k = 0; k < cTaps; k++)
+    {
+        sum += (n >= pDelays[k] ? pInput[n - pDelays[k]] : 0.0f) * w.rgfGain[k];
+    }
+    return sum;
+}
+
+//-------------------------------------------------------------------
+// DelayLine
+// The circular delay line of CDelayMFT, in samples instead of bytes.
+//-------------------------------------------------------------------
+
+template <class T>
+class DelayLine
+{
+public:
+    // pDelays: Delay of each tap, in samples (a multiple of cChannels).
+    DelayLine(unsigned int cChannels, const unsigned int *pDelays, unsigned int cTaps)
+        : m_cTaps(cTaps), m_iWrite(0)
+    {
+        unsigned int cMaxDelay = 0;
+        for (unsigned int k = 0; k < cTaps; k++)
+        {
+            m_rgcDelay[k] = pDelays[k];
+            cMaxDelay = pDelays[k] > cMaxDelay ? pDelays[k] : cMaxDelay;
+        }
+
+        // Same padding as CDelayMFT::AllocateStreamingResources
+        m_line.assign(cMaxDelay + ((MIX_BLOCK_SAMPLES + cChannels - 1) / cChannels) * cChannels,
+            Silence(T()));
+    }
+
+    void Process(T *pDest, const T *pInput, unsigned int cSamples, const WEIGHTS& w, bool bSSE2)
+    {
+        const unsigned int cLine = (unsigned int)m_line.size();
+
+        unsigned int rgiTap[MAX_DELAY_TAPS];
+        for (unsigned int k = 0; k < m_cTaps; k++)
+        {
+            rgiTap[k] = (m_iWrite + cLine - m_rgcDelay[k]) % cLine;
+        }
+
+        while (cSamples > 0)
+        {
+            unsigned int cSpan = cSamples < cLine - m_iWrite ? cSamples : cLine - m_iWrite;
+
+            const T *rgpTap[MAX_DELAY_TAPS];
+            for (unsigned int k = 0; k < m_cTaps; k++)
+            {
+                cSpan = cSpan < cLine - rgiTap[k] ? cSpan : cLine - rgiTap[k];
+                rgpTap[k] = &m_line[rgiTap[k]];
+            }
+
+            Mix(pDest, pInput, &m_line[m_iWrite], rgpTap, m_cTaps, cSpan, w, bSSE2);
+
+            pDest += cSpan;
+            pInput += cSpan;
+            m_iWrite = (m_iWrite + cSpan) % cLine;
+            for (unsigned int k = 0; k < m_cTaps; k++)
+            {
+                rgiTap[k] = (rgiTap[k] + cSpan) % cLine;
+            }
+            cSamples -= cSpan;
+        }
+    }
+
+private:
+    unsigned int    m_cTaps;
+    unsigned int    m_rgcDelay[MAX_DELAY_TAPS];
+    unsigned int    m_iWrite;
+    std::vector<T>  m_line;
+};
+
+// Spreads cTaps taps evenly up to cMaxFrames, with equal gains.
+void SpreadTaps(unsigned int cTaps, unsigned int cMaxFrames, unsigned int cChannels,
+    unsigned int *pDelays, unsigned int *pGains)
+{
+    for (unsigned int k = 0; k < cTaps; k++)
+    {
+        unsigned int cFrames = cMaxFrames * (k + 1) / cTaps;
+        pDelays[k] = (cFrames > 0 ? cFrames : 1) * cChannels;
+        pGains[k] = 100 / cTaps;
+    }
+}
+
+template <class T>
+bool Check(const char *pszFormat, bool bSSE2)
+{
+    static const unsigned int channels[] = { 1, 2, 3, 6 };
+    static const unsigned int tapCounts[] = { 1, 2, 3, 7, 16 };
+
+    unsigned int seed = 1;
+    bool bOK = true;
+
+    for (size_t c = 0; c < sizeof(channels) / sizeof(channels[0]); c++)
+    {
+        for (size_t t = 0; t < sizeof(tapCounts) / sizeof(tapCounts[0]); t++)
+        {
+            const unsigned int cChannels = channels[c];
+            const unsigned int cTaps = tapCounts[t];
+
+            // Taps from one frame up to 50 frames, so that they wrap often.
+            unsigned int delays[MAX_DELAY_TAPS];
+            unsigned int gains[MAX_DELAY_TAPS];
+            SpreadTaps(cTaps, 50, cChannels, delays, gains);
+            delays[0] = cChannels;
+
+            // Loud input and all the wet signal, so that the integer formats clip.
+            WEIGHTS w(75, gains, cTaps);
+
+            const unsigned int cSamples = 4000 * cChannels;
+            std::vector<T> input(cSamples);
+            std::vector<T> output(cSamples);
+            for (unsigned int n = 0; n < cSamples; n++)
+            {
+                input[n] = TestSample(T(), n);
+            }
+
+            DelayLine<T> line(cChannels, delays, cTaps);
+            for (unsigned int n = 0; n < cSamples; )
+            {
+                seed = seed * 1103515245 + 12345;
+                unsigned int cFrames = (seed >> 16) % 97 + 1;
+                unsigned int cBuffer = cFrames * cChannels < cSamples - n ? cFrames * cChannels : cSamples - n;
+                line.Process(&output[n], &input[n], cBuffer, w, bSSE2);
+                n += cBuffer;
+            }
+
+            for (unsigned int n = 0; n < cSamples; n++)
+            {
+                T expected = Reference(&input[0], n, delays, cTaps, w);
+                if (memcmp(&output[n], &expected, sizeof(T)) != 0)
+                {
+                    printf("FAILED: %s %s, %u channels, %u taps, sample %u\n",
+                        pszFormat, bSSE2 ? "SSE2" : "plain", cChannels, cTaps, n);
+                    bOK = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    return bOK;
+}
+
+template <class T>
+double Bench(unsigned int cTaps, bool bSSE2, double seconds)
+{
+    const unsigned int cChannels = 2;
+    const unsigned int cBuffer = SAMPLE_RATE / 100 * cChannels;     // 10 ms
+
+    unsigned int delays[MAX_DELAY_TAPS];
+    unsigned int gains[MAX_DELAY_TAPS];
+    SpreadTaps(cTaps, SAMPLE_RATE, cChannels, delays, gains);
+
+    WEIGHTS w(50, gains, cTaps);
+    DelayLine<T> line(cChannels, delays, cTaps);
+
+    // Not in place: fed back through the line, the signal would decay, and
+    // floating-point math is much slower on denormal numbers.
+    std::vector<T> input(cBuffer);
+    std::vector<T> output(cBuffer);
+    for (unsigned int n = 0; n < cBuffer; n++)
+    {
+        input[n] = TestSample(T(), n);
+    }
+
+    // warm up (one pass through the line), then double the batch until it takes long enough
+    for (unsigned int i = 0; i < 100; i++)
+    {
+        line.Process(&output[0], &input[0], cBuffer, w, bSSE2);
+    }
+
+    long buffers = 1;
+    double elapsed = 0;
+    for (;;)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (long i = 0; i < buffers; i++)
+        {
+            line.Process(&output[0], &input[0], cBuffer, w, bSSE2);
+        }
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= seconds || buffers >= (1L << 28))
+        {
+            break;
+        }
+        buffers *= 2;
+    }
+
+    return (double)buffers * cBuffer / elapsed;
+}
+
+template <class T>
+void BenchFormat(const char *pszFormat, bool bHasSSE2, double seconds)
+{
+    static const unsigned int tapCounts[] = { 1, 2, 4, 8, 16 };
+
+    for (size_t t = 0; t < sizeof(tapCounts) / sizeof(tapCounts[0]); t++)
+    {
+        for (int sse2 = 0; sse2 <= (bHasSSE2 ? 1 : 0); sse2++)
+        {
+            double rate = Bench<T>(tapCounts[t], sse2 != 0, seconds);
+            printf("%-7s %5u %-6s %14.1f %12.0f\n", pszFormat, tapCounts[t], sse2 ? "SSE2" : "plain",
+                rate / 1e6, rate / (SAMPLE_RATE * 2));
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = 0.5;
+    if (argc > 1)
+    {
+        seconds = atof(argv[1]);
+    }
+    if (seconds <= 0)
+    {
+        printf("usage: AudioDelayKernelBench [seconds]\n");
+        return 1;
+    }
+
+#ifdef AUDIODELAY_SSE2
+    const bool bHasSSE2 = true;     // Every x86 processor this builds for.
+#else
+    const bool bHasSSE2 = false;
+#endif
+
+    bool bOK = true;
+    for (int sse2 = 0; sse2 <= (bHasSSE2 ? 1 : 0); sse2++)
+    {
+        bOK = Check<unsigned char>("8-bit", sse2 != 0) && bOK;
+        bOK = Check<short>("16-bit", sse2 != 0) && bOK;
+        bOK = Check<float>("float", sse2 != 0) && bOK;
+    }
+    if (!bOK)
+    {
+        return 1;
+    }
+    printf("All mix functions match the reference.\n\n");
+
+    printf("%-7s %5s %-6s %14s %12s\n", "format", "taps", "code", "Msamples/s", "streams");
+
+    BenchFormat<unsigned char>("8-bit", false, seconds);
+    BenchFormat<short>("16-bit", bHasSSE2, seconds);
+    BenchFormat<float>("float", bHasSSE2, seconds);
+
+    return 0;
+}
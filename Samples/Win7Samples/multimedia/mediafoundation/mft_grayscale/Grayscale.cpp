@@ -15,6 +15,7 @@
 
 #include "MFT_Grayscale.h"
 #include "Grayscale.h"
+#include "GrayscaleGuids.h"
 #include "logmediatype.h"
 
 #include <uuids.h>      // DirectShow GUIDs
@@ -30,6 +31,8 @@
 // 1-in, 1-out
 // Fixed streams
 // Formats: UYVY, YUY2, NV12
+// Frames can be split into slices that are converted on the thread pool.
+//   (See MFT_GRAYSCALE_SLICE_COUNT.)
 
 // Assumptions:
 // 1. If the MFT is holding an input sample, SetInputType and SetOutputType 
@@ -43,11 +46,6 @@
 //        a list of supported video subtypes. 
 // 5. Preferred output types: As above.
  
-// Video FOURCC codes.
-const FOURCC FOURCC_YUY2 = MAKEFOURCC('Y', 'U', 'Y', '2');
-const FOURCC FOURCC_UYVY = MAKEFOURCC('U', 'Y', 'V', 'Y');
-const FOURCC FOURCC_NV12 = MAKEFOURCC('N', 'V', '1', '2');
-
 // Static array of media types (preferred and accepted).
 const GUID* g_MediaSubtypes[] = 
 {
@@ -62,118 +60,11 @@ DWORD g_cNumSubtypes = ARRAY_SIZE(g_MediaSubtypes);
 // GetImageSize: Returns the size of a video frame, in bytes.
 HRESULT GetImageSize(FOURCC fcc, UINT32 width, UINT32 height, DWORD* pcbImage);
 
-//-------------------------------------------------------------------
-// Name: TransformImage_UYVY
-// Description: Converts an image in UYVY format to grayscale.
-//
-// The image conversion functions take the following parameters:
-//
-// pDest:            Pointer to the destination buffer.
-// lDestStride:      Stride of the destination buffer, in bytes.
-// pSrc:             Pointer to the source buffer.
-// lSrcStride:       Stride of the source buffer, in bytes.
-// dwWidthInPixels:  Frame width in pixels.
-// dwHeightInPixels: Frame height, in pixels.
-//-------------------------------------------------------------------
-
-void TransformImage_UYVY(
-    BYTE*       pDest,
-    LONG        lDestStride,
-    const BYTE* pSrc,
-    LONG        lSrcStride,
-    DWORD       dwWidthInPixels,
-    DWORD       dwHeightInPixels
-    )
-{
-    for (DWORD y = 0; y < dwHeightInPixels; y++)
-    {
-        WORD *pSrc_Pixel = (WORD*)pSrc;
-        WORD *pDest_Pixel = (WORD*)pDest;
-        
-        for (DWORD x = 0; x < dwWidthInPixels; x++)
-        {
-            // Byte order is U0 Y0 V0 Y1
-            // Each WORD is a byte pair (U/V, Y)
-            // Windows is little-endian so the order appears reversed.
-            
-            WORD pixel = pSrc_Pixel[x] & 0xFF00;
-            pixel |= 0x0080;
-            pDest_Pixel[x] = pixel;
-        }
-        pDest += lDestStride;
-        pSrc += lSrcStride;
-    }
-}
-
-
-//-------------------------------------------------------------------
-// Name: TransformImage_YUY2
-// Description: Converts an image in YUY2 format to grayscale.
-//-------------------------------------------------------------------
-
-void TransformImage_YUY2(
-    BYTE*       pDest,
-    LONG        lDestStride,
-    const BYTE* pSrc,
-    LONG        lSrcStride,
-    DWORD       dwWidthInPixels,
-    DWORD       dwHeightInPixels
-    )
-{
-    for (DWORD y = 0; y < dwHeightInPixels; y++)
-    {
-        WORD *pSrc_Pixel = (WORD*)pSrc;
-        WORD *pDest_Pixel = (WORD*)pDest;
-        
-        for (DWORD x = 0; x < dwWidthInPixels; x++)
-        {
-            // Byte order is Y0 U0 Y1 V0 
-            // Each WORD is a byte pair (Y, U/V)
-            // Windows is little-endian so the order appears reversed.
-            
-            WORD pixel = pSrc_Pixel[x] & 0x00FF;
-            pixel |= 0x8000;
-            pDest_Pixel[x] = pixel;
-        }
-        pDest += lDestStride;
-        pSrc += lSrcStride;
-    }
-}
-
-
-
-//-------------------------------------------------------------------
-// Name: TransformImage_NV12
-// Description: Converts an image in NV12 format to grayscale.
-//-------------------------------------------------------------------
-
-void TransformImage_NV12(
-    BYTE*       pDest,
-    LONG        lDestStride,
-    const BYTE* pSrc,
-    LONG        lSrcStride,
-    DWORD       dwWidthInPixels,
-    DWORD       dwHeightInPixels
-    )
-{
-    // NV12 is planar: Y plane, followed by packed U-V plane.
-
-    // Y plane
-    for (DWORD y = 0; y < dwHeightInPixels; y++)
-    {
-        CopyMemory(pDest, pSrc, dwWidthInPixels);
-        pDest += lDestStride;
-        pSrc += lSrcStride;
-    }
-
-    // U-V plane
-    for (DWORD y = 0; y < dwHeightInPixels/2; y++)
-    {
-        FillMemory(pDest, dwWidthInPixels, 0x80);
-        pDest += lDestStride;
-    }
-}
-
+// When picking the slice count automatically, use at most this many slices,
+// and do not make slices shorter than this many rows. Past a few slices the
+// conversion is limited by memory bandwidth, not by the processor.
+const UINT32 AUTO_MAX_SLICES = 4;
+const UINT32 AUTO_MIN_SLICE_ROWS = 64;
 
 //-------------------------------------------------------------------
 // Name: CreateInstance
@@ -203,6 +94,7 @@ HRESULT CGrayscale::CreateInstance(IUnknown *pUnkOuter, REFIID iid, void **ppMFT
     {
         CHECK_HR(hr = E_OUTOFMEMORY);
     }
+    CHECK_HR(hr);
 
     CHECK_HR(hr = pMFT->QueryInterface(iid, ppMFT));
 
@@ -225,8 +117,27 @@ CGrayscale::CGrayscale(HRESULT& hr) :
     m_videoFOURCC(0),
     m_imageWidthInPixels(0),
     m_imageHeightInPixels(0),
-    m_cbImageSize(0)
+    m_cbImageSize(0),
+    m_pAttributes(NULL),
+    m_pSliceWork(NULL),
+    m_pSliceDest(NULL),
+    m_lSliceDestStride(0),
+    m_pSliceSrc(NULL),
+    m_lSliceSrcStride(0),
+    m_dwSliceRows(0),
+    m_cSlices(0),
+    m_nNextSlice(0)
 {
+    hr = MFCreateAttributes(&m_pAttributes, 1);
+
+    if (SUCCEEDED(hr))
+    {
+        m_pSliceWork = CreateThreadpoolWork(SliceWorkCallback, this, NULL);
+        if (m_pSliceWork == NULL)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
 }
 
 //-------------------------------------------------------------------
@@ -237,9 +148,16 @@ CGrayscale::~CGrayscale()
 {
     assert(m_nRefCount == 0);
 
+    if (m_pSliceWork)
+    {
+        WaitForThreadpoolWorkCallbacks(m_pSliceWork, FALSE);
+        CloseThreadpoolWork(m_pSliceWork);
+    }
+
     SAFE_RELEASE(m_pInputType);
     SAFE_RELEASE(m_pOutputType);
     SAFE_RELEASE(m_pSample);
+    SAFE_RELEASE(m_pAttributes);
 }
 
 // IUnknown methods
@@ -465,8 +383,16 @@ HRESULT CGrayscale::GetOutputStreamInfo(
 
 HRESULT CGrayscale::GetAttributes(IMFAttributes** pAttributes)
 {
-    // This MFT does not support any attributes, so the method is not implemented.
-    return E_NOTIMPL;   
+    // The only attribute this MFT reads is MFT_GRAYSCALE_SLICE_COUNT.
+    if (pAttributes == NULL)
+    {
+        return E_POINTER;
+    }
+
+    *pAttributes = m_pAttributes;
+    (*pAttributes)->AddRef();
+
+    return S_OK;
 }
 
 
@@ -1378,14 +1304,42 @@ HRESULT CGrayscale::OnProcessOutput(IMFMediaBuffer *pIn, IMFMediaBuffer *pOut)
 
     // Invoke the image transform function.
     assert (m_pTransformFn != NULL); 
-    if (m_pTransformFn)
+    if (m_pTransformFn == NULL)
+    {
+        CHECK_HR(hr = E_UNEXPECTED);
+    }
+
+    m_cSlices = GetSliceCount();
+
+    if (m_cSlices <= 1)
     {
         (*m_pTransformFn)( pDest, lDestStride, pSrc, lSrcStride, 
-            m_imageWidthInPixels, m_imageHeightInPixels);
+            m_imageWidthInPixels, m_imageHeightInPixels, 0, m_imageHeightInPixels);
     }
     else
     {
-        CHECK_HR(hr = E_UNEXPECTED);
+        // Split the frame into bands of rows. Keep the bands an even number
+        // of rows so that NV12 chroma rows are not split between two bands.
+        m_dwSliceRows = (m_imageHeightInPixels + m_cSlices - 1) / m_cSlices;
+        m_dwSliceRows = (m_dwSliceRows + 1) & ~1;
+        m_cSlices = (m_imageHeightInPixels + m_dwSliceRows - 1) / m_dwSliceRows;
+
+        m_pSliceDest = pDest;
+        m_lSliceDestStride = lDestStride;
+        m_pSliceSrc = pSrc;
+        m_lSliceSrcStride = lSrcStride;
+        m_nNextSlice = 0;
+
+        // This thread does its share too, so submit one less work item than slices.
+        for (UINT32 i = 1; i < m_cSlices; i++)
+        {
+            SubmitThreadpoolWork(m_pSliceWork);
+        }
+
+        TransformNextSlices();
+
+        // Wait for the other slices before the buffers are unlocked.
+        WaitForThreadpoolWorkCallbacks(m_pSliceWork, FALSE);
     }
 
 
@@ -1398,6 +1352,70 @@ done:
 }
 
 
+//-------------------------------------------------------------------
+// Name: GetSliceCount
+// Description: Returns the number of slices to split the next frame into.
+//-------------------------------------------------------------------
+
+UINT32 CGrayscale::GetSliceCount() const
+{
+    UINT32 cSlices = MFGetAttributeUINT32(m_pAttributes, MFT_GRAYSCALE_SLICE_COUNT, 0);
+
+    if (cSlices == 0)
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+
+        cSlices = min(info.dwNumberOfProcessors, AUTO_MAX_SLICES);
+        cSlices = min(cSlices, m_imageHeightInPixels / AUTO_MIN_SLICE_ROWS);
+    }
+
+    // Each slice needs at least two rows.
+    cSlices = min(cSlices, MAX_SLICES);
+    cSlices = min(cSlices, m_imageHeightInPixels / 2);
+
+    if (m_pSliceWork == NULL || cSlices == 0)
+    {
+        cSlices = 1;
+    }
+
+    return cSlices;
+}
+
+
+//-------------------------------------------------------------------
+// Name: TransformNextSlices
+// Description: Converts slices of the current frame until there are
+//              none left. Called from the thread pool and from
+//              OnProcessOutput.
+//-------------------------------------------------------------------
+
+void CGrayscale::TransformNextSlices()
+{
+    LONG iSlice;
+
+    while ((iSlice = InterlockedIncrement(&m_nNextSlice) - 1) < (LONG)m_cSlices)
+    {
+        DWORD dwFirstRow = iSlice * m_dwSliceRows;
+        DWORD dwRowCount = min(m_dwSliceRows, m_imageHeightInPixels - dwFirstRow);
+
+        (*m_pTransformFn)(m_pSliceDest, m_lSliceDestStride, m_pSliceSrc, m_lSliceSrcStride,
+            m_imageWidthInPixels, m_imageHeightInPixels, dwFirstRow, dwRowCount);
+    }
+}
+
+
+//-------------------------------------------------------------------
+// Name: SliceWorkCallback
+// Description: Thread pool callback for slice-parallel processing.
+//-------------------------------------------------------------------
+
+VOID CALLBACK CGrayscale::SliceWorkCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext, PTP_WORK pWork)
+{
+    ((CGrayscale*)pContext)->TransformNextSlices();
+}
+
+
 //-------------------------------------------------------------------
 // Name: OnFlush
 // Description: Flush the MFT.
@@ -1438,21 +1456,10 @@ HRESULT CGrayscale::UpdateFormatInfo()
 
         m_videoFOURCC = subtype.Data1;
 
-        switch (m_videoFOURCC)
+        // Use the SSE2 version of the conversion if the processor has it.
+        m_pTransformFn = GetTransformFunction(m_videoFOURCC);
+        if (m_pTransformFn == NULL)
         {
-        case FOURCC_YUY2:
-            m_pTransformFn = TransformImage_YUY2;
-            break;
-
-        case FOURCC_UYVY:
-            m_pTransformFn = TransformImage_UYVY;
-            break;
-
-        case FOURCC_NV12:
-            m_pTransformFn = TransformImage_NV12;
-            break;
-
-        default:
             CHECK_HR(hr = E_UNEXPECTED);
         }
 
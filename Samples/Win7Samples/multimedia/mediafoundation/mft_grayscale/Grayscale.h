@@ -13,15 +13,10 @@
 
 #pragma once
 
-// Function pointer for the function that transforms the image.
-typedef void (*IMAGE_TRANSFORM_FN)(
-    BYTE*       pDest,
-    LONG        lDestStride,
-    const BYTE* pSrc,
-    LONG        lSrcStride,
-    DWORD       dwWidthInPixels,
-    DWORD       dwHeightInPixels
-    );
+#include "GrayscaleKernels.h"
+
+// Maximum number of slices a frame is split into. (See MFT_GRAYSCALE_SLICE_COUNT.)
+const UINT32 MAX_SLICES = 16;
 
 // CGrayscale class:
 // Implements a grayscale video effect.
@@ -191,6 +186,11 @@ private:
 
     HRESULT UpdateFormatInfo();
 
+    UINT32 GetSliceCount() const;
+    void TransformNextSlices();
+
+    static VOID CALLBACK SliceWorkCallback(PTP_CALLBACK_INSTANCE pInstance, PVOID pContext, PTP_WORK pWork);
+
     long                        m_nRefCount;                // reference count
     CritSec                     m_critSec;
 
@@ -207,4 +207,18 @@ private:
     // Image transform function. (Changes based on the media type.)
     IMAGE_TRANSFORM_FN          m_pTransformFn;
 
+    IMFAttributes               *m_pAttributes;             // MFT attributes.
+
+    // Slice-parallel processing. The frame is split into bands of rows;
+    // the thread pool and the calling thread each take the next band
+    // until none are left. Only valid during OnProcessOutput.
+    PTP_WORK                    m_pSliceWork;
+    BYTE                        *m_pSliceDest;
+    LONG                        m_lSliceDestStride;
+    const BYTE                  *m_pSliceSrc;
+    LONG                        m_lSliceSrcStride;
+    DWORD                       m_dwSliceRows;              // Rows per slice (even).
+    UINT32                      m_cSlices;
+    volatile LONG               m_nNextSlice;
+
 };
\ No newline at end of file
@@ -1,6 +1,6 @@
 //////////////////////////////////////////////////////////////////////////
 //
-// GrayscaleGuids.h: Defines the CLSID for the transform.
+// GrayscaleGuids.h: Defines the CLSID and attributes for the transform.
 // 
 // THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
 // ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
@@ -14,3 +14,11 @@
 // {2F3DBC05-C011-4a8f-B264-E42E35C67BF4}
 DEFINE_GUID(CLSID_GrayscaleMFT, 
 0x2f3dbc05, 0xc011, 0x4a8f, 0xb2, 0x64, 0xe4, 0x2e, 0x35, 0xc6, 0x7b, 0xf4);
+
+// MFT_GRAYSCALE_SLICE_COUNT: UINT32, set on the MFT attributes (IMFTransform::GetAttributes).
+// Number of slices to split each frame into, converted in parallel on the
+// thread pool. 0 (the default) picks a count from the number of processors
+// and the frame height; 1 converts the whole frame on the calling thread.
+// {6E9C4D1A-33B8-4F6B-9D25-7A0C1E58B2F3}
+DEFINE_GUID(MFT_GRAYSCALE_SLICE_COUNT, 
+0x6e9c4d1a, 0x33b8, 0x4f6b, 0x9d, 0x25, 0x7a, 0xc, 0x1e, 0x58, 0xb2, 0xf3);
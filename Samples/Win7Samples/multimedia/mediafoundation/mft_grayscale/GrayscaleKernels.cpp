@@ -0,0 +1,531 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// GrayscaleKernels.cpp: Image conversion functions used by the transform.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <string.h>     // memcpy, memset
+#include <stddef.h>
+
+#include "GrayscaleKernels.h"
+
+#ifdef GRAYSCALE_X86
+#include <emmintrin.h>  // SSE2 intrinsics
+#ifdef GRAYSCALE_AVX2
+#include <immintrin.h>  // AVX2 intrinsics
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>     // __cpuid, __cpuidex, _xgetbv
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC and Clang only emit SIMD instructions in functions built for them.
+// Visual C++ needs no annotation.
+#if defined(GRAYSCALE_X86) && defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+// The image conversion functions take the following parameters:
+//
+// pDest:            Pointer to the destination buffer.
+// lDestStride:      Stride of the destination buffer, in bytes.
+// pSrc:             Pointer to the source buffer.
+// lSrcStride:       Stride of the source buffer, in bytes.
+// dwWidthInPixels:  Frame width in pixels.
+// dwHeightInPixels: Frame height, in pixels.
+// dwFirstRow:       First row to convert.
+// dwRowCount:       Number of rows to convert.
+
+//-------------------------------------------------------------------
+// Name: TransformPackedRows
+// Description: Shared loop for the packed 4:2:2 formats.
+//
+// Each pixel is a (luma, chroma) byte pair with the luma byte at
+// iLuma (0 or 1). The luma byte is kept and the chroma byte is set to
+// 0x80. Working a byte at a time keeps this independent of byte order
+// and of the alignment of the rows.
+//-------------------------------------------------------------------
+
+static void TransformPackedRows(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount,
+    int                  iLuma
+    )
+{
+    const int iChroma = 1 - iLuma;
+
+    pDest += (ptrdiff_t)lDestStride * dwFirstRow;
+    pSrc += (ptrdiff_t)lSrcStride * dwFirstRow;
+
+    for (unsigned int y = 0; y < dwRowCount; y++)
+    {
+        for (unsigned int x = 0; x < dwWidthInPixels; x++)
+        {
+            pDest[2 * x + iLuma] = pSrc[2 * x + iLuma];
+            pDest[2 * x + iChroma] = 0x80;
+        }
+        pDest += lDestStride;
+        pSrc += lSrcStride;
+    }
+}
+
+//-------------------------------------------------------------------
+// Name: TransformImage_UYVY
+// Description: Converts an image in UYVY format to grayscale.
+//-------------------------------------------------------------------
+
+void TransformImage_UYVY(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwHeightInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount
+    )
+{
+    (void)dwHeightInPixels;
+
+    // Byte order is U0 Y0 V0 Y1
+    TransformPackedRows(pDest, lDestStride, pSrc, lSrcStride,
+        dwWidthInPixels, dwFirstRow, dwRowCount, 1);
+}
+
+
+//-------------------------------------------------------------------
+// Name: TransformImage_YUY2
+// Description: Converts an image in YUY2 format to grayscale.
+//-------------------------------------------------------------------
+
+void TransformImage_YUY2(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwHeightInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount
+    )
+{
+    (void)dwHeightInPixels;
+
+    // Byte order is Y0 U0 Y1 V0
+    TransformPackedRows(pDest, lDestStride, pSrc, lSrcStride,
+        dwWidthInPixels, dwFirstRow, dwRowCount, 0);
+}
+
+
+
+//-------------------------------------------------------------------
+// Name: TransformImage_NV12
+// Description: Converts an image in NV12 format to grayscale.
+//
+// Luma rows [dwFirstRow, dwFirstRow + dwRowCount) are copied and the
+// chroma rows that go with them are set to 0x80.
+//-------------------------------------------------------------------
+
+void TransformImage_NV12(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwHeightInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount
+    )
+{
+    // NV12 is planar: Y plane, followed by packed U-V plane.
+    unsigned char *pDestUV = pDest + (ptrdiff_t)lDestStride * dwHeightInPixels;
+
+    // Y plane
+    pDest += (ptrdiff_t)lDestStride * dwFirstRow;
+    pSrc += (ptrdiff_t)lSrcStride * dwFirstRow;
+
+    for (unsigned int y = 0; y < dwRowCount; y++)
+    {
+        memcpy(pDest, pSrc, dwWidthInPixels);
+        pDest += lDestStride;
+        pSrc += lSrcStride;
+    }
+
+    // U-V plane
+    unsigned int dwFirstRowUV = dwFirstRow / 2;
+    unsigned int dwEndRowUV = (dwFirstRow + dwRowCount) / 2;
+
+    pDestUV += (ptrdiff_t)lDestStride * dwFirstRowUV;
+
+    for (unsigned int y = dwFirstRowUV; y < dwEndRowUV; y++)
+    {
+        memset(pDestUV, 0x80, dwWidthInPixels);
+        pDestUV += lDestStride;
+    }
+}
+
+
+#ifdef GRAYSCALE_X86
+
+//-------------------------------------------------------------------
+// Name: Cpuid
+// Description: Runs CPUID for a leaf (and sub-leaf 0).
+//-------------------------------------------------------------------
+
+static void Cpuid(unsigned int leaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+#ifdef GRAYSCALE_AVX2
+    __cpuidex(info, (int)leaf, 0);
+#else
+    __cpuid(info, (int)leaf);       // leaves 0 and 1 have no sub-leaves
+#endif
+    for (int i = 0; i < 4; i++)
+    {
+        regs[i] = (unsigned int)info[i];
+    }
+#else
+    if (!__get_cpuid_count(leaf, 0, &regs[0], &regs[1], &regs[2], &regs[3]))
+    {
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    }
+#endif
+}
+
+//-------------------------------------------------------------------
+// Name: CpuHasSSE2
+// Description: CPUID.1:EDX bit 26. Always set on x64.
+//-------------------------------------------------------------------
+
+bool CpuHasSSE2()
+{
+    unsigned int regs[4];
+    Cpuid(1, regs);
+    return (regs[3] & (1u << 26)) != 0;
+}
+
+//-------------------------------------------------------------------
+// Name: CpuHasAVX2
+// Description: CPUID.7:EBX bit 5, and the OS must save the AVX
+// registers: CPUID.1:ECX OSXSAVE (27) and AVX (28), and XCR0 bits 1
+// (SSE state) and 2 (AVX state).
+//-------------------------------------------------------------------
+
+bool CpuHasAVX2()
+{
+#ifdef GRAYSCALE_AVX2
+    unsigned int regs[4];
+
+    Cpuid(0, regs);
+    if (regs[0] < 7)
+    {
+        return false;
+    }
+
+    Cpuid(1, regs);
+    const unsigned int osxsaveAndAvx = (1u << 27) | (1u << 28);
+    if ((regs[2] & osxsaveAndAvx) != osxsaveAndAvx)
+    {
+        return false;
+    }
+
+#if defined(_MSC_VER)
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int xcr0Low, xcr0High;
+    __asm__ ("xgetbv" : "=a" (xcr0Low), "=d" (xcr0High) : "c" (0));
+    unsigned long long xcr0 = ((unsigned long long)xcr0High << 32) | xcr0Low;
+#endif
+    if ((xcr0 & 6) != 6)
+    {
+        return false;
+    }
+
+    Cpuid(7, regs);
+    return (regs[1] & (1u << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+//-------------------------------------------------------------------
+// Name: TransformPackedRows_SSE2
+// Description: SSE2 version of TransformPackedRows.
+//
+// Each 16-bit word is (luma, chroma) in some order. The luma byte is
+// kept with wLumaMask and the chroma byte is replaced with wChroma,
+// eight pixels at a time. Buffers need not be aligned.
+//-------------------------------------------------------------------
+
+TARGET_SSE2
+static void TransformPackedRows_SSE2(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount,
+    int                  iLuma
+    )
+{
+    // little-endian: the byte at offset 0 is the low byte of each word
+    const short wLumaMask = iLuma ? (short)0xFF00 : (short)0x00FF;
+    const short wChroma = iLuma ? (short)0x0080 : (short)0x8000;
+    const __m128i mask = _mm_set1_epi16(wLumaMask);
+    const __m128i chroma = _mm_set1_epi16(wChroma);
+    const int iChroma = 1 - iLuma;
+
+    pDest += (ptrdiff_t)lDestStride * dwFirstRow;
+    pSrc += (ptrdiff_t)lSrcStride * dwFirstRow;
+
+    for (unsigned int y = 0; y < dwRowCount; y++)
+    {
+        unsigned int x = 0;
+
+        // 32 pixels per iteration, so that several loads are in flight.
+        for (; x + 32 <= dwWidthInPixels; x += 32)
+        {
+            __m128i p0 = _mm_loadu_si128((const __m128i*)(pSrc + 2 * x));
+            __m128i p1 = _mm_loadu_si128((const __m128i*)(pSrc + 2 * x + 16));
+            __m128i p2 = _mm_loadu_si128((const __m128i*)(pSrc + 2 * x + 32));
+            __m128i p3 = _mm_loadu_si128((const __m128i*)(pSrc + 2 * x + 48));
+
+            _mm_storeu_si128((__m128i*)(pDest + 2 * x),      _mm_or_si128(_mm_and_si128(p0, mask), chroma));
+            _mm_storeu_si128((__m128i*)(pDest + 2 * x + 16), _mm_or_si128(_mm_and_si128(p1, mask), chroma));
+            _mm_storeu_si128((__m128i*)(pDest + 2 * x + 32), _mm_or_si128(_mm_and_si128(p2, mask), chroma));
+            _mm_storeu_si128((__m128i*)(pDest + 2 * x + 48), _mm_or_si128(_mm_and_si128(p3, mask), chroma));
+        }
+
+        for (; x + 8 <= dwWidthInPixels; x += 8)
+        {
+            __m128i p = _mm_loadu_si128((const __m128i*)(pSrc + 2 * x));
+            _mm_storeu_si128((__m128i*)(pDest + 2 * x), _mm_or_si128(_mm_and_si128(p, mask), chroma));
+        }
+
+        for (; x < dwWidthInPixels; x++)
+        {
+            pDest[2 * x + iLuma] = pSrc[2 * x + iLuma];
+            pDest[2 * x + iChroma] = 0x80;
+        }
+
+        pDest += lDestStride;
+        pSrc += lSrcStride;
+    }
+}
+
+//-------------------------------------------------------------------
+// Name: TransformImage_UYVY_SSE2
+// Description: SSE2 version of TransformImage_UYVY.
+//-------------------------------------------------------------------
+
+void TransformImage_UYVY_SSE2(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwHeightInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount
+    )
+{
+    (void)dwHeightInPixels;
+    TransformPackedRows_SSE2(pDest, lDestStride, pSrc, lSrcStride,
+        dwWidthInPixels, dwFirstRow, dwRowCount, 1);
+}
+
+//-------------------------------------------------------------------
+// Name: TransformImage_YUY2_SSE2
+// Description: SSE2 version of TransformImage_YUY2.
+//-------------------------------------------------------------------
+
+void TransformImage_YUY2_SSE2(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwHeightInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount
+    )
+{
+    (void)dwHeightInPixels;
+    TransformPackedRows_SSE2(pDest, lDestStride, pSrc, lSrcStride,
+        dwWidthInPixels, dwFirstRow, dwRowCount, 0);
+}
+
+#ifdef GRAYSCALE_AVX2
+
+//-------------------------------------------------------------------
+// Name: TransformPackedRows_AVX2
+// Description: AVX2 version of TransformPackedRows_SSE2, sixteen
+// pixels per register.
+//-------------------------------------------------------------------
+
+TARGET_AVX2
+static void TransformPackedRows_AVX2(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount,
+    int                  iLuma
+    )
+{
+    const short wLumaMask = iLuma ? (short)0xFF00 : (short)0x00FF;
+    const short wChroma = iLuma ? (short)0x0080 : (short)0x8000;
+    const __m256i mask = _mm256_set1_epi16(wLumaMask);
+    const __m256i chroma = _mm256_set1_epi16(wChroma);
+    const int iChroma = 1 - iLuma;
+
+    pDest += (ptrdiff_t)lDestStride * dwFirstRow;
+    pSrc += (ptrdiff_t)lSrcStride * dwFirstRow;
+
+    for (unsigned int y = 0; y < dwRowCount; y++)
+    {
+        unsigned int x = 0;
+
+        for (; x + 64 <= dwWidthInPixels; x += 64)
+        {
+            __m256i p0 = _mm256_loadu_si256((const __m256i*)(pSrc + 2 * x));
+            __m256i p1 = _mm256_loadu_si256((const __m256i*)(pSrc + 2 * x + 32));
+            __m256i p2 = _mm256_loadu_si256((const __m256i*)(pSrc + 2 * x + 64));
+            __m256i p3 = _mm256_loadu_si256((const __m256i*)(pSrc + 2 * x + 96));
+
+            _mm256_storeu_si256((__m256i*)(pDest + 2 * x),      _mm256_or_si256(_mm256_and_si256(p0, mask), chroma));
+            _mm256_storeu_si256((__m256i*)(pDest + 2 * x + 32), _mm256_or_si256(_mm256_and_si256(p1, mask), chroma));
+            _mm256_storeu_si256((__m256i*)(pDest + 2 * x + 64), _mm256_or_si256(_mm256_and_si256(p2, mask), chroma));
+            _mm256_storeu_si256((__m256i*)(pDest + 2 * x + 96), _mm256_or_si256(_mm256_and_si256(p3, mask), chroma));
+        }
+
+        for (; x + 16 <= dwWidthInPixels; x += 16)
+        {
+            __m256i p = _mm256_loadu_si256((const __m256i*)(pSrc + 2 * x));
+            _mm256_storeu_si256((__m256i*)(pDest + 2 * x), _mm256_or_si256(_mm256_and_si256(p, mask), chroma));
+        }
+
+        for (; x < dwWidthInPixels; x++)
+        {
+            pDest[2 * x + iLuma] = pSrc[2 * x + iLuma];
+            pDest[2 * x + iChroma] = 0x80;
+        }
+
+        pDest += lDestStride;
+        pSrc += lSrcStride;
+    }
+
+    // avoid the AVX to SSE transition penalty in the caller
+    _mm256_zeroupper();
+}
+
+//-------------------------------------------------------------------
+// Name: TransformImage_UYVY_AVX2
+// Description: AVX2 version of TransformImage_UYVY.
+//-------------------------------------------------------------------
+
+void TransformImage_UYVY_AVX2(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwHeightInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount
+    )
+{
+    (void)dwHeightInPixels;
+    TransformPackedRows_AVX2(pDest, lDestStride, pSrc, lSrcStride,
+        dwWidthInPixels, dwFirstRow, dwRowCount, 1);
+}
+
+//-------------------------------------------------------------------
+// Name: TransformImage_YUY2_AVX2
+// Description: AVX2 version of TransformImage_YUY2.
+//-------------------------------------------------------------------
+
+void TransformImage_YUY2_AVX2(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwHeightInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount
+    )
+{
+    (void)dwHeightInPixels;
+    TransformPackedRows_AVX2(pDest, lDestStride, pSrc, lSrcStride,
+        dwWidthInPixels, dwFirstRow, dwRowCount, 0);
+}
+
+#endif // GRAYSCALE_AVX2
+#endif // GRAYSCALE_X86
+
+
+//-------------------------------------------------------------------
+// Name: GetTransformFunction
+// Description: Picks the conversion function for a format.
+//-------------------------------------------------------------------
+
+IMAGE_TRANSFORM_FN GetTransformFunction(unsigned int fcc)
+{
+    // The packed conversions only mask each word, so they are bound by
+    // memory bandwidth: on 1080p and 2160p frames the AVX2 versions are
+    // no faster than SSE2, and sometimes slower (KernelTest benchmark).
+    // SSE2 is used; the AVX2 versions are kept for the test and benchmark.
+#ifdef GRAYSCALE_X86
+    const bool bSSE2 = CpuHasSSE2();
+#endif
+
+    switch (fcc)
+    {
+    case FOURCC_YUY2:
+#ifdef GRAYSCALE_X86
+        if (bSSE2)
+        {
+            return TransformImage_YUY2_SSE2;
+        }
+#endif
+        return TransformImage_YUY2;
+
+    case FOURCC_UYVY:
+#ifdef GRAYSCALE_X86
+        if (bSSE2)
+        {
+            return TransformImage_UYVY_SSE2;
+        }
+#endif
+        return TransformImage_UYVY;
+
+    case FOURCC_NV12:
+        return TransformImage_NV12;
+
+    default:
+        return NULL;
+    }
+}
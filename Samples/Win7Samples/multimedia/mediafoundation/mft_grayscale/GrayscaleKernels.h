@@ -0,0 +1,102 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// GrayscaleKernels.h: Image conversion functions used by the transform.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// The conversion functions use only standard C++ and compiler intrinsics,
+// not Windows or Media Foundation, so they can be built and checked on
+// their own (see the KernelTest directory).
+
+// Video FOURCC codes, as MAKEFOURCC would make them.
+#define GRAYSCALE_FOURCC(ch0, ch1, ch2, ch3) \
+    ((unsigned int)(unsigned char)(ch0) | ((unsigned int)(unsigned char)(ch1) << 8) | \
+    ((unsigned int)(unsigned char)(ch2) << 16) | ((unsigned int)(unsigned char)(ch3) << 24))
+
+const unsigned int FOURCC_YUY2 = GRAYSCALE_FOURCC('Y', 'U', 'Y', '2');
+const unsigned int FOURCC_UYVY = GRAYSCALE_FOURCC('U', 'Y', 'V', 'Y');
+const unsigned int FOURCC_NV12 = GRAYSCALE_FOURCC('N', 'V', '1', '2');
+
+// x86 and x64 get SIMD versions of the packed formats. AVX2 intrinsics
+// need Visual Studio 2012 or later, or a GCC/Clang that accepts the
+// target attribute.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define GRAYSCALE_X86 1
+#if (defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__GNUC__)
+#define GRAYSCALE_AVX2 1
+#endif
+#endif
+
+// Function pointer for the function that transforms the image.
+//
+// The function converts rows dwFirstRow through dwFirstRow + dwRowCount - 1
+// of a dwWidthInPixels x dwHeightInPixels image. pDest and pSrc always
+// point to the start of the image, not to dwFirstRow. Different row ranges
+// of the same image can be converted at the same time on different threads.
+// Strides are in bytes and need not be even or aligned.
+//
+// For planar formats a row range covers the matching rows of every plane,
+// so dwFirstRow should be even (NV12 has one chroma row per two luma rows).
+typedef void (*IMAGE_TRANSFORM_FN)(
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         dwWidthInPixels,
+    unsigned int         dwHeightInPixels,
+    unsigned int         dwFirstRow,
+    unsigned int         dwRowCount
+    );
+
+// Portable versions. These are also the reference the SIMD versions are
+// tested against.
+void TransformImage_UYVY(unsigned char* pDest, long lDestStride, const unsigned char* pSrc, long lSrcStride,
+    unsigned int dwWidthInPixels, unsigned int dwHeightInPixels, unsigned int dwFirstRow, unsigned int dwRowCount);
+
+void TransformImage_YUY2(unsigned char* pDest, long lDestStride, const unsigned char* pSrc, long lSrcStride,
+    unsigned int dwWidthInPixels, unsigned int dwHeightInPixels, unsigned int dwFirstRow, unsigned int dwRowCount);
+
+void TransformImage_NV12(unsigned char* pDest, long lDestStride, const unsigned char* pSrc, long lSrcStride,
+    unsigned int dwWidthInPixels, unsigned int dwHeightInPixels, unsigned int dwFirstRow, unsigned int dwRowCount);
+
+#ifdef GRAYSCALE_X86
+
+// CPU feature tests, from CPUID (and XGETBV for the AVX register state).
+bool CpuHasSSE2();
+bool CpuHasAVX2();
+
+// SSE2 versions of the packed formats. Only call these if CpuHasSSE2().
+// (NV12 is a row copy and a row fill, which the CRT already vectorizes.)
+void TransformImage_UYVY_SSE2(unsigned char* pDest, long lDestStride, const unsigned char* pSrc, long lSrcStride,
+    unsigned int dwWidthInPixels, unsigned int dwHeightInPixels, unsigned int dwFirstRow, unsigned int dwRowCount);
+
+void TransformImage_YUY2_SSE2(unsigned char* pDest, long lDestStride, const unsigned char* pSrc, long lSrcStride,
+    unsigned int dwWidthInPixels, unsigned int dwHeightInPixels, unsigned int dwFirstRow, unsigned int dwRowCount);
+
+#ifdef GRAYSCALE_AVX2
+
+// AVX2 versions of the packed formats. Only call these if CpuHasAVX2().
+// GetTransformFunction does not pick them: they measure no faster than
+// the SSE2 versions.
+void TransformImage_UYVY_AVX2(unsigned char* pDest, long lDestStride, const unsigned char* pSrc, long lSrcStride,
+    unsigned int dwWidthInPixels, unsigned int dwHeightInPixels, unsigned int dwFirstRow, unsigned int dwRowCount);
+
+void TransformImage_YUY2_AVX2(unsigned char* pDest, long lDestStride, const unsigned char* pSrc, long lSrcStride,
+    unsigned int dwWidthInPixels, unsigned int dwHeightInPixels, unsigned int dwFirstRow, unsigned int dwRowCount);
+
+#endif // GRAYSCALE_AVX2
+#endif // GRAYSCALE_X86
+
+// GetTransformFunction: Returns the conversion function for a video
+// FOURCC, the SSE2 version where the processor has SSE2, or NULL if the
+// format is not supported.
+IMAGE_TRANSFORM_FN GetTransformFunction(unsigned int fcc);
@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// GrayscaleKernelBench.cpp: Times every conversion function on full
+// video frames.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+// GrayscaleKernelBench [seconds]
+//
+// Converts 1080p and 2160p frames with each kernel this processor
+// supports, single threaded, for about the given time per case (default
+// 0.5 seconds), and prints frames per second and the memory bandwidth
+// that implies (bytes read plus bytes written). The 1080p frames fit in
+// a large last-level cache; the 2160p ones mostly do not.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "KernelList.h"
+
+int main(int argc, char* argv[])
+{
+    double seconds = 0.5;
+    if (argc > 1)
+    {
+        seconds = atof(argv[1]);
+    }
+    if (seconds <= 0)
+    {
+        printf("usage: GrayscaleKernelBench [seconds]\n");
+        return 1;
+    }
+
+    static const struct { unsigned int width, height; } sizes[] =
+    {
+        { 1920, 1080 },
+        { 3840, 2160 },
+    };
+
+    KERNEL kernels[8];
+    int cKernels = GetKernels(kernels);
+
+    printf("%-10s %10s %12s %12s\n", "kernel", "frame", "frames/s", "GB/s");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        for (int k = 0; k < cKernels; k++)
+        {
+            const KERNEL& kernel = kernels[k];
+            if (!kernel.bSupported)
+            {
+                continue;
+            }
+
+            const unsigned int width = sizes[s].width;
+            const unsigned int height = sizes[s].height;
+            const long lStride = (long)RowBytes(kernel.fcc, width);
+            const size_t cbFrame = (size_t)lStride * BufferRows(kernel.fcc, height);
+
+            std::vector<unsigned char> src(cbFrame);
+            std::vector<unsigned char> dest(cbFrame);
+            for (size_t i = 0; i < cbFrame; i++)
+            {
+                src[i] = (unsigned char)(i * 7);
+            }
+
+            // warm up, then double the batch until it takes long enough
+            kernel.pfn(&dest[0], lStride, &src[0], lStride, width, height, 0, height);
+
+            long frames = 1;
+            double elapsed = 0;
+            for (;;)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for (long i = 0; i < frames; i++)
+                {
+                    kernel.pfn(&dest[0], lStride, &src[0], lStride, width, height, 0, height);
+                }
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (elapsed >= seconds || frames >= (1L << 24))
+                {
+                    break;
+                }
+                frames *= 2;
+            }
+
+            // NV12 reads only the luma plane, and writes both planes
+            const double cbRead = (double)lStride * height;
+            const double cbMoved = cbRead + (double)cbFrame;
+
+            printf("%-10s %4ux%-5u %12.1f %12.2f\n", kernel.pszName, width, height,
+                frames / elapsed, cbMoved * frames / elapsed / 1e9);
+        }
+    }
+
+    return 0;
+}
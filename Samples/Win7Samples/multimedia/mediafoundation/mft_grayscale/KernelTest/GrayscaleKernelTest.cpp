@@ -0,0 +1,225 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// GrayscaleKernelTest.cpp: Checks every conversion function against a
+// byte-by-byte reference.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+// Each kernel converts images of odd and even widths and heights, with
+// source and destination strides padded by odd byte counts and buffers
+// that start one byte past an aligned address. The image is converted
+// whole and also in row ranges, the way the transform splits it between
+// threads. The whole destination buffer, padding included, must match
+// the reference, so a kernel that writes past the end of a row fails.
+//
+// Returns 0 if every supported kernel passed.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "KernelList.h"
+
+static unsigned int g_seed = 1;
+
+static unsigned char RandomByte()
+{
+    g_seed = g_seed * 1103515245 + 12345;
+    return (unsigned char)(g_seed >> 16);
+}
+
+//-------------------------------------------------------------------
+// Name: Reference
+// Description: What a conversion must produce, written out byte by
+// byte from the format definitions. Bytes outside the image are left
+// alone.
+//-------------------------------------------------------------------
+
+static void Reference(
+    unsigned int         fcc,
+    unsigned char*       pDest,
+    long                 lDestStride,
+    const unsigned char* pSrc,
+    long                 lSrcStride,
+    unsigned int         width,
+    unsigned int         height
+    )
+{
+    for (unsigned int y = 0; y < height; y++)
+    {
+        unsigned char* pDestRow = pDest + (ptrdiff_t)lDestStride * y;
+        const unsigned char* pSrcRow = pSrc + (ptrdiff_t)lSrcStride * y;
+
+        for (unsigned int x = 0; x < width; x++)
+        {
+            if (fcc == FOURCC_YUY2)         // Y0 U0 Y1 V0
+            {
+                pDestRow[2 * x] = pSrcRow[2 * x];
+                pDestRow[2 * x + 1] = 0x80;
+            }
+            else if (fcc == FOURCC_UYVY)    // U0 Y0 V0 Y1
+            {
+                pDestRow[2 * x] = 0x80;
+                pDestRow[2 * x + 1] = pSrcRow[2 * x + 1];
+            }
+            else                            // NV12 luma
+            {
+                pDestRow[x] = pSrcRow[x];
+            }
+        }
+    }
+
+    if (fcc == FOURCC_NV12)
+    {
+        unsigned char* pDestUV = pDest + (ptrdiff_t)lDestStride * height;
+        for (unsigned int y = 0; y < height / 2; y++)
+        {
+            memset(pDestUV + (ptrdiff_t)lDestStride * y, 0x80, width);
+        }
+    }
+}
+
+//-------------------------------------------------------------------
+// Name: TestOne
+// Description: Runs one kernel on one image shape. Returns false and
+// prints the first difference on failure.
+//-------------------------------------------------------------------
+
+static bool TestOne(
+    const KERNEL&   kernel,
+    unsigned int    width,
+    unsigned int    height,
+    unsigned int    srcPad,
+    unsigned int    destPad,
+    unsigned int    sliceRows       // 0: whole image in one call
+    )
+{
+    const long lSrcStride = (long)(RowBytes(kernel.fcc, width) + srcPad);
+    const long lDestStride = (long)(RowBytes(kernel.fcc, width) + destPad);
+    const unsigned int rows = BufferRows(kernel.fcc, height);
+
+    // one byte in, so that nothing is aligned
+    std::vector<unsigned char> src(1 + (size_t)lSrcStride * rows);
+    std::vector<unsigned char> expected(1 + (size_t)lDestStride * rows);
+    std::vector<unsigned char> actual;
+
+    for (size_t i = 0; i < src.size(); i++)
+    {
+        src[i] = RandomByte();
+    }
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        expected[i] = RandomByte();
+    }
+    actual = expected;
+
+    Reference(kernel.fcc, &expected[1], lDestStride, &src[1], lSrcStride, width, height);
+
+    if (sliceRows == 0)
+    {
+        kernel.pfn(&actual[1], lDestStride, &src[1], lSrcStride, width, height, 0, height);
+    }
+    else
+    {
+        for (unsigned int first = 0; first < height; first += sliceRows)
+        {
+            unsigned int count = (height - first < sliceRows) ? height - first : sliceRows;
+            kernel.pfn(&actual[1], lDestStride, &src[1], lSrcStride, width, height, first, count);
+        }
+    }
+
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        if (actual[i] != expected[i])
+        {
+            size_t offset = i - 1;
+            printf("FAIL %s: %ux%u src stride %ld dest stride %ld slice %u: "
+                "byte %u of row %u is 0x%02X, expected 0x%02X\n",
+                kernel.pszName, width, height, lSrcStride, lDestStride, sliceRows,
+                (unsigned int)(offset % lDestStride), (unsigned int)(offset / lDestStride),
+                actual[i], expected[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    static const unsigned int widths[] =
+    {
+        1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 129, 255, 321
+    };
+    static const unsigned int heights[] = { 1, 2, 3, 4, 7, 16 };
+    static const unsigned int pads[] = { 0, 1, 3, 17, 64 };
+    static const unsigned int slices[] = { 0, 2, 4 };    // NV12 slices must start on even rows
+
+    KERNEL kernels[8];
+    int cKernels = GetKernels(kernels);
+    int failed = 0;
+
+    for (int k = 0; k < cKernels; k++)
+    {
+        if (!kernels[k].bSupported)
+        {
+            printf("skip %-10s (not supported by this processor)\n", kernels[k].pszName);
+            continue;
+        }
+
+        int cases = 0;
+        bool ok = true;
+
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]) && ok; w++)
+        for (size_t h = 0; h < sizeof(heights) / sizeof(heights[0]) && ok; h++)
+        for (size_t sp = 0; sp < sizeof(pads) / sizeof(pads[0]) && ok; sp++)
+        for (size_t dp = 0; dp < sizeof(pads) / sizeof(pads[0]) && ok; dp++)
+        for (size_t s = 0; s < sizeof(slices) / sizeof(slices[0]) && ok; s++)
+        {
+            ok = TestOne(kernels[k], widths[w], heights[h], pads[sp], pads[dp], slices[s]);
+            cases++;
+        }
+
+        printf("%s %-10s %d cases\n", ok ? "ok  " : "FAIL", kernels[k].pszName, cases);
+        if (!ok)
+        {
+            failed++;
+        }
+    }
+
+    // the transform must be handed a kernel this processor can run
+    const unsigned int formats[] = { FOURCC_YUY2, FOURCC_UYVY, FOURCC_NV12 };
+    for (int f = 0; f < 3; f++)
+    {
+        IMAGE_TRANSFORM_FN pfn = GetTransformFunction(formats[f]);
+        bool found = false;
+        for (int k = 0; k < cKernels; k++)
+        {
+            if (kernels[k].pfn == pfn && kernels[k].fcc == formats[f] && kernels[k].bSupported)
+            {
+                printf("GetTransformFunction picks %s\n", kernels[k].pszName);
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            printf("FAIL GetTransformFunction returned no usable kernel for format %d\n", f);
+            failed++;
+        }
+    }
+    if (GetTransformFunction(GRAYSCALE_FOURCC('R', 'G', 'B', '3')) != NULL)
+    {
+        printf("FAIL GetTransformFunction accepted an unsupported format\n");
+        failed++;
+    }
+
+    return failed ? 1 : 0;
+}
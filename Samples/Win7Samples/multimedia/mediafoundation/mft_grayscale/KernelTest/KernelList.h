@@ -0,0 +1,82 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// KernelList.h: The conversion functions the test and benchmark run.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "../GrayscaleKernels.h"
+
+struct KERNEL
+{
+    const char*         pszName;
+    unsigned int        fcc;
+    IMAGE_TRANSFORM_FN  pfn;
+    bool                bSupported;     // this processor can run it
+};
+
+// GetKernels: Fills pKernels (room for at least 8) with every conversion
+// function built into GrayscaleKernels.cpp and returns how many there are.
+inline int GetKernels(KERNEL* pKernels)
+{
+    int n = 0;
+
+    KERNEL portable[] =
+    {
+        { "YUY2", FOURCC_YUY2, TransformImage_YUY2, true },
+        { "UYVY", FOURCC_UYVY, TransformImage_UYVY, true },
+        { "NV12", FOURCC_NV12, TransformImage_NV12, true },
+    };
+    for (int i = 0; i < 3; i++)
+    {
+        pKernels[n++] = portable[i];
+    }
+
+#ifdef GRAYSCALE_X86
+    const bool bSSE2 = CpuHasSSE2();
+    KERNEL sse2[] =
+    {
+        { "YUY2_SSE2", FOURCC_YUY2, TransformImage_YUY2_SSE2, bSSE2 },
+        { "UYVY_SSE2", FOURCC_UYVY, TransformImage_UYVY_SSE2, bSSE2 },
+    };
+    for (int i = 0; i < 2; i++)
+    {
+        pKernels[n++] = sse2[i];
+    }
+
+#ifdef GRAYSCALE_AVX2
+    const bool bAVX2 = CpuHasAVX2();
+    KERNEL avx2[] =
+    {
+        { "YUY2_AVX2", FOURCC_YUY2, TransformImage_YUY2_AVX2, bAVX2 },
+        { "UYVY_AVX2", FOURCC_UYVY, TransformImage_UYVY_AVX2, bAVX2 },
+    };
+    for (int i = 0; i < 2; i++)
+    {
+        pKernels[n++] = avx2[i];
+    }
+#endif
+#endif
+
+    return n;
+}
+
+// Bytes per row of luma (or of packed pixels) for a format.
+inline unsigned int RowBytes(unsigned int fcc, unsigned int dwWidthInPixels)
+{
+    return (fcc == FOURCC_NV12) ? dwWidthInPixels : 2 * dwWidthInPixels;
+}
+
+// Rows in the whole buffer: NV12 adds a chroma row per two luma rows.
+inline unsigned int BufferRows(unsigned int fcc, unsigned int dwHeightInPixels)
+{
+    return (fcc == FOURCC_NV12) ? dwHeightInPixels + (dwHeightInPixels + 1) / 2 : dwHeightInPixels;
+}
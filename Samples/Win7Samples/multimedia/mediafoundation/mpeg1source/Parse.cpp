@@ -12,9 +12,25 @@
 //
 //////////////////////////////////////////////////////////////////////////
 
+#ifdef MPEG1_PARSER_STANDALONE
+#include "ParserStandalone.h"   // Just the parser, without Media Foundation (see ParseBench)
+#else
 #include "MPEG1Source.h"
+#endif
 #include "Parse.h"
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define PARSE_SSE2
+#include <emmintrin.h>  // SSE2 intrinsics
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>   // Mirrored ring buffer (see Buffer::AllocateRing)
+#include <unistd.h>
+#endif
+
 // HAS_FLAG: Test if 'b' contains a specified bit flag
 #define HAS_FLAG(b, flag) (((b) & (flag)) == (flag))
 
@@ -88,22 +104,37 @@ HRESULT GetSamplingFrequency(BYTE code, DWORD *pdwSamplesPerSec);
 //-------------------------------------------------------------------
 
 
-Buffer::Buffer() : m_begin(0), m_end(0)
+Buffer::Buffer() : m_pRing(NULL), m_cbRing(0), m_begin(0), m_end(0)
+{
+}
+
+Buffer::~Buffer()
 {
+    FreeRing(m_pRing, m_cbRing);
 }
 
 
 //-------------------------------------------------------------------
 // Initalize
 // Sets the initial buffer size.
+//
+// The size is rounded up to the allocation granularity (64 KB).
 //-------------------------------------------------------------------
 
 HRESULT Buffer::Initalize(DWORD cbSize)
 {
-    HRESULT hr = SetSize(cbSize);
+    BYTE *pRing = NULL;
+    DWORD cbRing = 0;
+
+    HRESULT hr = AllocateRing(cbSize, &pRing, &cbRing);
     if (SUCCEEDED(hr))
     {
-        ZeroMemory(Ptr(), cbSize);
+        FreeRing(m_pRing, m_cbRing);
+
+        m_pRing = pRing;
+        m_cbRing = cbRing;
+        m_begin = 0;
+        m_end = 0;
     }
     return hr;
 }
@@ -116,7 +147,7 @@ HRESULT Buffer::Initalize(DWORD cbSize)
 
 BYTE* Buffer::DataPtr()
 {
-    return Ptr() + m_begin;
+    return m_pRing + m_begin;
 }
 
 
@@ -142,40 +173,42 @@ DWORD Buffer::DataSize() const
 //
 // This method does *not* increase the value returned by DataSize().
 //
-// After this method returns, the value of DataPtr() might change,
-// so do not cache the old value.
+// The data only moves if the ring has to grow. After this method 
+// returns, the value of DataPtr() might change, so do not cache the
+// old value.
 //-------------------------------------------------------------------
 
 HRESULT Buffer::Reserve(DWORD cb)
 {
-    if (cb > MAXDWORD - DataSize())
+    if (cb > MAXDWORD / 2 - DataSize())
     {
         return E_INVALIDARG; // Overflow
     }
 
+    if (cb <= CurrentFreeSize())
+    {
+        return S_OK;
+    }
+
+    // The ring needs to grow. Double it, so that a stream of growing 
+    // requests does not copy the data every time.
+
     HRESULT hr = S_OK;
+    BYTE *pRing = NULL;
+    DWORD cbRing = 0;
 
-    // If this would push the end position past the end of the array, 
-    // then we need to copy up the data to start of the array. We might 
-    // also need to realloc the array.
+    DWORD cbNewSize = max(DataSize() + cb, min(m_cbRing * 2, MAXDWORD / 2));
 
-    if (cb > GetCount() - m_end)
-    {
-        // New end position would be past the end of the array.
-        // Check if we need to grow the array.
+    CHECK_HR(hr = AllocateRing(cbNewSize, &pRing, &cbRing));
 
-        if (cb > CurrentFreeSize())
-        {
-            // Array needs to grow
-            CHECK_HR(hr = SetSize(DataSize() + cb));
-        }
-        
-        MoveMemory(Ptr(), DataPtr(), DataSize());
+    CopyMemory(pRing, DataPtr(), DataSize());
 
-        // Reset begin and end. 
-        m_end = DataSize(); // Update m_end first before resetting m_begin!
-        m_begin = 0;
-    }
+    m_end = DataSize(); // Update m_end first before resetting m_begin!
+    m_begin = 0;
+
+    FreeRing(m_pRing, m_cbRing);
+    m_pRing = pRing;
+    m_cbRing = cbRing;
 
     assert(CurrentFreeSize() >= cb);
 
@@ -200,6 +233,14 @@ HRESULT Buffer::MoveStart(DWORD cb)
     }
 
     m_begin += cb;
+
+    // Once the start moves into the second view, continue from the 
+    // same place in the first view.
+    if (m_begin >= m_cbRing)
+    {
+        m_begin -= m_cbRing;
+        m_end -= m_cbRing;
+    }
     return S_OK;
 }
 
@@ -226,24 +267,191 @@ HRESULT Buffer::MoveEnd(DWORD cb)
 //-------------------------------------------------------------------
 // CurrentFreeSize (private)
 //
-// Returns the size of the array minus the size of the data.
+// Returns the size of the ring minus the size of the data.
 //-------------------------------------------------------------------
 
 DWORD Buffer::CurrentFreeSize() const
 {
-    assert(GetCount() >= DataSize());
-    return GetCount() - DataSize();
+    assert(m_cbRing >= DataSize());
+    return m_cbRing - DataSize();
+}
+
+
+//-------------------------------------------------------------------
+// AllocateRing (static)
+// Allocates a ring of at least cbSize bytes and maps it twice in a
+// row, so that pRing[i] and pRing[i + cbRing] are the same byte.
+//
+// ppRing: Receives the address of the first view.
+// pcbRing: Receives the size of each view.
+//
+// Free the ring by calling FreeRing.
+//-------------------------------------------------------------------
+
+#ifdef _WIN32
+
+HRESULT Buffer::AllocateRing(DWORD cbSize, BYTE **ppRing, DWORD *pcbRing)
+{
+    // Number of times to try to map the views. Another thread can take
+    // the address range between VirtualFree and MapViewOfFileEx.
+    const int MAX_MAP_ATTEMPTS = 8;
+
+    HRESULT hr = S_OK;
+    HANDLE hSection = NULL;
+    BYTE *pRing = NULL;
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+
+    // Views must start on an allocation granularity boundary.
+    DWORD cbGranularity = si.dwAllocationGranularity;
+    if (cbSize == 0 || cbSize > MAXDWORD / 2 - cbGranularity)
+    {
+        return E_INVALIDARG;
+    }
+    DWORD cbRing = (cbSize + cbGranularity - 1) / cbGranularity * cbGranularity;
+
+    hSection = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, cbRing, NULL);
+    if (hSection == NULL)
+    {
+        CHECK_HR(hr = HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    for (int i = 0; i < MAX_MAP_ATTEMPTS && pRing == NULL; i++)
+    {
+        // Find a free address range large enough for both views.
+        BYTE *pAddress = (BYTE*)VirtualAlloc(NULL, cbRing * 2, MEM_RESERVE, PAGE_NOACCESS);
+        if (pAddress == NULL)
+        {
+            CHECK_HR(hr = E_OUTOFMEMORY);
+        }
+        VirtualFree(pAddress, 0, MEM_RELEASE);
+
+        BYTE *pView1 = (BYTE*)MapViewOfFileEx(hSection, FILE_MAP_WRITE, 0, 0, cbRing, pAddress);
+        if (pView1 == NULL)
+        {
+            continue;
+        }
+
+        BYTE *pView2 = (BYTE*)MapViewOfFileEx(hSection, FILE_MAP_WRITE, 0, 0, cbRing, pAddress + cbRing);
+        if (pView2 == NULL)
+        {
+            UnmapViewOfFile(pView1);
+            continue;
+        }
+
+        pRing = pView1;
+    }
+
+    if (pRing == NULL)
+    {
+        CHECK_HR(hr = E_OUTOFMEMORY);
+    }
+
+    *ppRing = pRing;
+    *pcbRing = cbRing;
+
+done:
+    // The views keep the section alive.
+    if (hSection)
+    {
+        CloseHandle(hSection);
+    }
+    return hr;
+}
+
+
+//-------------------------------------------------------------------
+// FreeRing (static)
+// Unmaps a ring allocated by AllocateRing.
+//-------------------------------------------------------------------
+
+void Buffer::FreeRing(BYTE *pRing, DWORD cbRing)
+{
+    if (pRing)
+    {
+        UnmapViewOfFile(pRing + cbRing);
+        UnmapViewOfFile(pRing);
+    }
 }
 
+#else
+
+// The same ring on POSIX systems, so that the parser can be benchmarked
+// there: a shared memory file mapped twice over one reserved range.
+// MAP_FIXED replaces the reservation atomically, so there is no race.
+
+HRESULT Buffer::AllocateRing(DWORD cbSize, BYTE **ppRing, DWORD *pcbRing)
+{
+    DWORD cbPage = (DWORD)sysconf(_SC_PAGESIZE);
+    if (cbSize == 0 || cbSize > MAXDWORD / 2 - cbPage)
+    {
+        return E_INVALIDARG;
+    }
+    DWORD cbRing = (cbSize + cbPage - 1) / cbPage * cbPage;
+
+    char szName[64];
+    snprintf(szName, sizeof(szName), "/mpeg1ring-%ld-%p", (long)getpid(), (void*)&szName);
+
+    int fd = shm_open(szName, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        return E_OUTOFMEMORY;
+    }
+    shm_unlink(szName);
+
+    HRESULT hr = E_OUTOFMEMORY;
+    BYTE *pAddress = (BYTE*)MAP_FAILED;
+
+    if (ftruncate(fd, cbRing) == 0)
+    {
+        pAddress = (BYTE*)mmap(NULL, (size_t)cbRing * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (pAddress != (BYTE*)MAP_FAILED)
+    {
+        if (mmap(pAddress, cbRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+            mmap(pAddress + cbRing, cbRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED)
+        {
+            *ppRing = pAddress;
+            *pcbRing = cbRing;
+            hr = S_OK;
+        }
+        else
+        {
+            munmap(pAddress, (size_t)cbRing * 2);
+        }
+    }
+
+    // The mappings keep the memory alive.
+    close(fd);
+    return hr;
+}
+
+void Buffer::FreeRing(BYTE *pRing, DWORD cbRing)
+{
+    if (pRing)
+    {
+        munmap(pRing, (size_t)cbRing * 2);
+    }
+}
+
+#endif // _WIN32
+
 
 //-------------------------------------------------------------------
 // Parser class
 //-------------------------------------------------------------------
 
 
-Parser::Parser() : m_SCR(0), m_muxRate(0), m_pHeader(NULL), m_bHasPacketHeader(FALSE), m_bEOS(FALSE)
+Parser::Parser() : m_SCR(0), m_muxRate(0), m_pHeader(NULL), m_bHasPacketHeader(FALSE), m_bEOS(FALSE), m_bSSE2(FALSE)
 {
     ZeroMemory(&m_curPacketHeader, sizeof(m_curPacketHeader));
+
+#if defined(_M_IX86) || defined(_M_X64)
+    m_bSSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+#elif defined(PARSE_SSE2)
+    m_bSSE2 = TRUE;     // The compiler already targets SSE2.
+#endif
 }
 
 Parser::~Parser()
@@ -295,11 +503,13 @@ HRESULT Parser::GetSystemHeader(MPEG1SystemHeader **ppHeader)
 // 
 // Return values:
 //      S_OK: The method consumed some data (*pAte > 0).
-//      S_FALSE: The method did not consume any data (*pAte == 0). 
+//      S_FALSE: The method needs more data. 
 //      [or an error code]
 //
 // If the method returns S_FALSE, the caller must allocate a larger
-// buffer and pass in more data.
+// buffer and pass in more data. In that case *pAte can still be > 0 
+// if the buffer did not contain a start code: the bytes before the
+// last 3 cannot start one, so they are skipped.
 //-------------------------------------------------------------------
 
 HRESULT Parser::ParseBytes(const BYTE *pData, DWORD cbLen, DWORD *pAte)
@@ -354,6 +564,12 @@ HRESULT Parser::ParseBytes(const BYTE *pData, DWORD cbLen, DWORD *pAte)
     {
         *pAte = cbLengthToStartCode + cbParsed;
     }
+    else if (hr == S_FALSE)
+    {
+        // Discard whatever precedes the start code (or the partial start 
+        // code at the end of the buffer), so that it is not scanned again.
+        *pAte = cbLengthToStartCode;
+    }
     return hr;
 };
 
@@ -366,28 +582,85 @@ HRESULT Parser::ParseBytes(const BYTE *pData, DWORD cbLen, DWORD *pAte)
 // cbLen: Size of the buffer.
 // pAte: Receives the number of bytes *before* the start code.
 //
-// If no start code is found, the method returns S_FALSE.
+// If no start code is found, the method returns S_FALSE, and pAte 
+// receives the number of bytes that can be skipped.
 //-------------------------------------------------------------------
 
 HRESULT Parser::FindNextStartCode(const BYTE *pData, DWORD cbLen, DWORD *pAte)
 {
-    HRESULT hr = S_FALSE;
+    assert(cbLen >= 4);
+
+    // A start code is 4 bytes: 00 00 01 xx.
+    DWORD cbSkip = FindStartCodePrefix(pData, cbLen);
+
+    if (cbSkip <= cbLen - 4)
+    {
+        *pAte = cbSkip;
+        return S_OK;
+    }
+    else
+    {
+        // The last 3 bytes might be the start of a start code.
+        *pAte = cbLen - 3;
+        return S_FALSE;
+    }
+}
+
+
+//-------------------------------------------------------------------
+// FindStartCodePrefix
+// Returns the offset of the first 00 00 01 sequence in the buffer, or
+// cbLen if there is none.
+//
+// Start codes are not aligned, so every byte position is checked. 
+// The SSE2 version compares 16 positions at a time.
+//-------------------------------------------------------------------
 
-    DWORD cbLeft = cbLen;
+DWORD Parser::FindStartCodePrefix(const BYTE *pData, DWORD cbLen) const
+{
+    DWORD i = 0;
 
-    while (cbLeft > 4)
+#ifdef PARSE_SSE2
+    if (m_bSSE2)
     {
-        if ( (MAKE_DWORD_HOSTORDER(pData) & 0x00FFFFFF) == 0x00010000 )
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi8(1);
+
+        // Each iteration reads pData[i] through pData[i + 17].
+        for (; i + 18 <= cbLen; i += 16)
         {
-            hr = S_OK;
-            break;
+            __m128i b0 = _mm_loadu_si128((const __m128i*)(pData + i));
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(pData + i + 1));
+            __m128i b2 = _mm_loadu_si128((const __m128i*)(pData + i + 2));
+
+            __m128i match = _mm_and_si128(
+                _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+                _mm_cmpeq_epi8(b2, one)
+                );
+
+            int mask = _mm_movemask_epi8(match);
+            if (mask != 0)
+            {
+#ifdef _MSC_VER
+                unsigned long index = 0;
+                _BitScanForward(&index, mask);
+#else
+                unsigned long index = __builtin_ctz(mask);
+#endif
+                return i + index;
+            }
         }
+    }
+#endif
 
-        cbLeft -= 4;
-        pData += 4;
+    for (; i + 3 <= cbLen; i++)
+    {
+        if (pData[i] == 0 && pData[i + 1] == 0 && pData[i + 2] == 1)
+        {
+            return i;
+        }
     }
-    *pAte = (cbLen - cbLeft);
-    return hr;
+    return cbLen;
 }
 
 
@@ -580,6 +853,9 @@ HRESULT Parser::ParsePacketHeader(const BYTE *pData, DWORD cbLen, DWORD *pAte)
     StreamType type = StreamType_Unknown;
     BYTE num = 0;
     BOOL bHasPTS = FALSE;
+    DWORD cbLeft = 0;
+    DWORD cbPadding = 0;
+    LONGLONG pts = 0;
 
     ZeroMemory(&m_curPacketHeader, sizeof(m_curPacketHeader));
 
@@ -587,10 +863,8 @@ HRESULT Parser::ParsePacketHeader(const BYTE *pData, DWORD cbLen, DWORD *pAte)
     id = pData[3];
     CHECK_HR(hr = ParseStreamId(id, &type, &num));
 
-    DWORD cbLeft = cbPacketLen - MPEG1_PACKET_HEADER_MIN_SIZE;
+    cbLeft = cbPacketLen - MPEG1_PACKET_HEADER_MIN_SIZE;
     pData = pData + MPEG1_PACKET_HEADER_MIN_SIZE;
-    DWORD cbPadding = 0;
-    LONGLONG pts = 0;
 
     // Go past the stuffing bytes.
     while ((cbLeft > 0) && (*pData == 0xFF))
@@ -170,12 +170,18 @@ struct MPEG1AudioFrameHeader
 };
 
 // Buffer class:
-// Resizable buffer used to hold the MPEG-1 data.
+// Circular buffer used to hold the MPEG-1 data.
+//
+// The ring is mapped twice, back to back, in virtual memory. Data that wraps
+// past the end of the ring shows up again, contiguous, in the second view, so
+// DataPtr() always points to DataSize() contiguous bytes, followed by the
+// free space. Consuming data never moves the remaining data.
 
-class Buffer : GrowableArray<BYTE>
+class Buffer
 {
 public:
     Buffer();
+    ~Buffer();
     HRESULT Initalize(DWORD cbSize);
 
     BYTE*   DataPtr();
@@ -196,9 +202,14 @@ public:
 private:
     DWORD   CurrentFreeSize() const;
 
+    static HRESULT AllocateRing(DWORD cbSize, BYTE **ppRing, DWORD *pcbRing);
+    static void    FreeRing(BYTE *pRing, DWORD cbRing);
+
 private:
-    DWORD   m_begin;
-    DWORD   m_end;  // 1 past the last element
+    BYTE    *m_pRing;   // First of the two views.
+    DWORD   m_cbRing;   // Size of one view. (A multiple of the allocation granularity.)
+    DWORD   m_begin;    // Always < m_cbRing.
+    DWORD   m_end;      // 1 past the last element. Can be past m_cbRing (in the second view).
 };
 
 
@@ -226,6 +237,8 @@ public:
 
 private:
 
+    DWORD   FindStartCodePrefix(const BYTE *pData, DWORD cbLen) const;
+
     HRESULT FindNextStartCode(const BYTE *pData, DWORD cbLen, DWORD *pAte);
     HRESULT ParsePackHeader(const BYTE *pData, DWORD cbLen, DWORD *pAte);
     HRESULT ParseSystemHeader(const BYTE *pData, DWORD cbLen, DWORD *pAte);
@@ -244,6 +257,8 @@ private:
     MPEG1PacketHeader   m_curPacketHeader;  // Most recent packet header.
     
     BOOL                m_bEOS;
+
+    BOOL                m_bSSE2;            // Use SSE2 to look for start codes?
 };
 
 
@@ -0,0 +1,436 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ParseBench.cpp
+// Throughput of the MPEG-1 systems-layer parser and its read buffer.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+// ParseBench [gigabytes | file.mpg] [read size]
+//
+// Runs the parser and the mirrored ring buffer over a program stream the
+// way MPEG1Source::ParseData and ReadPayload do: read a block into the
+// buffer, parse headers until the parser needs more data, and copy each
+// payload out once it is complete. Reads are READ_SIZE (4 KB) unless
+// another size is given, and grow to the unread part of a payload.
+//
+// With a number, the stream is synthetic: a pack with the system header,
+// then 2324-byte packs (as on a Video CD) holding one video or audio
+// packet each, with a padding packet after every audio packet, repeated
+// until the given number of gigabytes (default 4) has been parsed. The
+// packet counts are checked against what was generated. With a file
+// name, the file is read with fread, so the time includes the I/O.
+//
+// A second test times the start code scan alone: ParseBytes on a buffer
+// with no start code in it, which is what the parser does when it has to
+// resynchronize after damaged data.
+
+#include "ParserStandalone.h"
+#include "Parse.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+using namespace MediaFoundationSamples;
+
+const DWORD INITIAL_BUFFER_SIZE = 4 * 1024; // As in MPEG1Source.h
+const DWORD READ_SIZE = 4 * 1024;
+
+const DWORD PACK_SIZE = 2324;
+const size_t SEGMENT_SIZE = 64 * 1024 * 1024;   // Synthetic packs generated once and repeated.
+
+static unsigned int g_seed = 1;
+
+static BYTE RandomByte()
+{
+    g_seed = g_seed * 1103515245 + 12345;
+    return (BYTE)(g_seed >> 16);
+}
+
+struct StreamCounts
+{
+    unsigned long long video;
+    unsigned long long audio;
+    unsigned long long padding;
+    unsigned long long payloadBytes;
+};
+
+//-------------------------------------------------------------------
+// Synthetic stream
+//-------------------------------------------------------------------
+
+static void AppendPackHeader(std::vector<BYTE>& data)
+{
+    // SCR 0, mux rate 0, marker bits set.
+    static const BYTE header[] = { 0x00, 0x00, 0x01, 0xBA, 0x21, 0x00, 0x01, 0x00, 0x01, 0x80, 0x00, 0x01 };
+    data.insert(data.end(), header, header + sizeof(header));
+}
+
+static void AppendSystemHeader(std::vector<BYTE>& data)
+{
+    // One video stream (E0) and one audio stream (C0).
+    static const BYTE header[] =
+    {
+        0x00, 0x00, 0x01, 0xBB, 0x00, 0x0C, 0x80, 0x00, 0x01, 0x04, 0x21, 0xFF,
+        0xE0, 0xE0, 0x00,
+        0xC0, 0xC0, 0x20,
+    };
+    data.insert(data.end(), header, header + sizeof(header));
+}
+
+// Packet with an STD buffer size and a PTS; cbPacket includes the header.
+static void AppendPacket(std::vector<BYTE>& data, BYTE id, DWORD cbPacket)
+{
+    const DWORD cbHeader = MPEG1_PACKET_HEADER_MIN_SIZE + 2 + 5;
+    const DWORD cbLength = cbPacket - MPEG1_PACKET_HEADER_MIN_SIZE;
+
+    const BYTE header[] =
+    {
+        0x00, 0x00, 0x01, id, (BYTE)(cbLength >> 8), (BYTE)cbLength,
+        0x60, 0x00,                         // STD buffer size
+        0x21, 0x00, 0x01, 0x00, 0x01,       // PTS 0
+    };
+    data.insert(data.end(), header, header + sizeof(header));
+
+    // Random payload. It can contain 00 00 01 by chance, which the
+    // parser must not mistake for a start code.
+    for (DWORD i = cbHeader; i < cbPacket; i++)
+    {
+        data.push_back(RandomByte());
+    }
+}
+
+static void AppendPaddingPacket(std::vector<BYTE>& data, DWORD cbPacket)
+{
+    const DWORD cbLength = cbPacket - MPEG1_PACKET_HEADER_MIN_SIZE;
+
+    const BYTE header[] = { 0x00, 0x00, 0x01, MPEG1_STREAMTYPE_PADDING, (BYTE)(cbLength >> 8), (BYTE)cbLength, 0x0F };
+    data.insert(data.end(), header, header + sizeof(header));
+    data.insert(data.end(), cbPacket - sizeof(header), 0xFF);
+}
+
+// Appends packs until the segment is full, and counts what it wrote.
+static void MakeSegment(std::vector<BYTE>& data, size_t cbSegment, StreamCounts *pCounts)
+{
+    ZeroMemory(pCounts, sizeof(*pCounts));
+
+    for (unsigned int i = 0; data.size() + PACK_SIZE <= cbSegment; i++)
+    {
+        AppendPackHeader(data);
+
+        DWORD cbLeft = PACK_SIZE - MPEG1_PACK_HEADER_SIZE;
+
+        if (i % 4 == 3)
+        {
+            // MPEG-1 Layer II audio frames at 224 kbps are 731 bytes.
+            AppendPacket(data, 0xC0, 731 + 13);
+            AppendPaddingPacket(data, cbLeft - (731 + 13));
+            pCounts->audio++;
+            pCounts->padding++;
+            pCounts->payloadBytes += 731 + (cbLeft - (731 + 13)) - 7;
+        }
+        else
+        {
+            AppendPacket(data, 0xE0, cbLeft);
+            pCounts->video++;
+            pCounts->payloadBytes += cbLeft - 13;
+        }
+    }
+}
+
+//-------------------------------------------------------------------
+// Source: where the data comes from
+//-------------------------------------------------------------------
+
+class Source
+{
+public:
+    Source(const std::vector<BYTE> *pPrefix, const std::vector<BYTE> *pSegment, unsigned long long cbTotal)
+        : m_pPrefix(pPrefix), m_pSegment(pSegment), m_pFile(NULL), m_cbTotal(cbTotal), m_pos(0)
+    {
+    }
+
+    explicit Source(FILE *pFile)
+        : m_pPrefix(NULL), m_pSegment(NULL), m_pFile(pFile), m_cbTotal(0), m_pos(0)
+    {
+    }
+
+    // Reads up to cb bytes; returns 0 at the end of the stream.
+    DWORD Read(BYTE *pDest, DWORD cb)
+    {
+        if (m_pFile)
+        {
+            DWORD cbRead = (DWORD)fread(pDest, 1, cb, m_pFile);
+            m_pos += cbRead;
+            return cbRead;
+        }
+
+        DWORD cbRead = 0;
+        while (cbRead < cb && m_pos < m_cbTotal)
+        {
+            const std::vector<BYTE>& from = (m_pos < m_pPrefix->size()) ? *m_pPrefix : *m_pSegment;
+            size_t offset = (m_pos < m_pPrefix->size()) ? (size_t)m_pos : (size_t)((m_pos - m_pPrefix->size()) % m_pSegment->size());
+
+            size_t cbCopy = min((size_t)(cb - cbRead), from.size() - offset);
+            cbCopy = (size_t)min((unsigned long long)cbCopy, m_cbTotal - m_pos);
+
+            memcpy(pDest + cbRead, &from[offset], cbCopy);
+            cbRead += (DWORD)cbCopy;
+            m_pos += cbCopy;
+        }
+        return cbRead;
+    }
+
+    unsigned long long Position() const { return m_pos; }
+
+private:
+    const std::vector<BYTE> *m_pPrefix;
+    const std::vector<BYTE> *m_pSegment;
+    FILE                    *m_pFile;
+    unsigned long long      m_cbTotal;
+    unsigned long long      m_pos;
+};
+
+//-------------------------------------------------------------------
+// ParseStream
+// The read and parse loop of MPEG1Source::ParseData, with every
+// stream active: complete payloads are copied out, as DeliverPayload
+// copies them into a media buffer.
+//-------------------------------------------------------------------
+
+static HRESULT ParseStream(Source& source, DWORD cbReadSize, StreamCounts *pCounts)
+{
+    HRESULT hr = S_OK;
+    Buffer buffer;
+    Parser parser;
+    std::vector<BYTE> payload(MPEG1_MAX_PACKET_SIZE);
+    DWORD cbNextRequest = 0;
+    BOOL bEndOfFile = FALSE;
+
+    ZeroMemory(pCounts, sizeof(*pCounts));
+
+    CHECK_HR(hr = buffer.Initalize(INITIAL_BUFFER_SIZE));
+
+    while (!parser.IsEndOfStream())
+    {
+        DWORD cbAte = 0;
+        BOOL bNeedMoreData = FALSE;
+
+        if (parser.HasPacket())
+        {
+            const MPEG1PacketHeader& packet = parser.PacketHeader();
+
+            if (packet.cbPayload > buffer.DataSize())
+            {
+                cbNextRequest = packet.cbPayload - buffer.DataSize();
+                bNeedMoreData = TRUE;
+            }
+            else
+            {
+                memcpy(&payload[0], buffer.DataPtr(), packet.cbPayload);
+                cbAte = packet.cbPayload;
+
+                pCounts->payloadBytes += packet.cbPayload;
+                if (packet.type == StreamType_Video)
+                {
+                    pCounts->video++;
+                }
+                else if (packet.type == StreamType_Audio)
+                {
+                    pCounts->audio++;
+                }
+                else if (packet.type == StreamType_Padding)
+                {
+                    pCounts->padding++;
+                }
+                parser.ClearPacket();
+            }
+        }
+        else
+        {
+            CHECK_HR(hr = parser.ParseBytes(buffer.DataPtr(), buffer.DataSize(), &cbAte));
+
+            if (hr == S_FALSE)
+            {
+                bNeedMoreData = TRUE;
+            }
+        }
+
+        CHECK_HR(hr = buffer.MoveStart(cbAte));
+
+        if (bNeedMoreData)
+        {
+            if (bEndOfFile)
+            {
+                break;  // The stream ended without a stop code.
+            }
+
+            DWORD cbRequest = max(cbReadSize, cbNextRequest);
+            cbNextRequest = 0;
+
+            CHECK_HR(hr = buffer.Reserve(cbRequest));
+
+            DWORD cbRead = source.Read(buffer.DataPtr() + buffer.DataSize(), cbRequest);
+            if (cbRead == 0)
+            {
+                bEndOfFile = TRUE;
+            }
+            CHECK_HR(hr = buffer.MoveEnd(cbRead));
+        }
+    }
+    hr = S_OK;
+
+done:
+    return hr;
+}
+
+//-------------------------------------------------------------------
+// ScanJunk
+// Times ParseBytes on data with no start code in it. Each call scans
+// the whole buffer and reports all but the last 3 bytes as consumed.
+//-------------------------------------------------------------------
+
+static void ScanJunk()
+{
+    const DWORD cbJunk = 1024 * 1024;
+    const unsigned long long cbTotal = 4ULL * 1024 * 1024 * 1024;
+
+    std::vector<BYTE> junk(cbJunk);
+    for (DWORD i = 0; i < cbJunk; i++)
+    {
+        junk[i] = RandomByte() | 0x02;  // Never 00 or 01, so never a start code.
+    }
+
+    Parser parser;
+    unsigned long long cbScanned = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (cbScanned < cbTotal)
+    {
+        DWORD cbAte = 0;
+        HRESULT hr = parser.ParseBytes(&junk[0], cbJunk, &cbAte);
+        if (hr != S_FALSE || cbAte != cbJunk - 3)
+        {
+            printf("start code scan: unexpected result 0x%08X, %u bytes consumed\n", (unsigned int)hr, cbAte);
+            return;
+        }
+        cbScanned += cbJunk;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("start code scan: %.2f GB in %.2f s, %.2f GB/s\n", cbScanned / 1e9, seconds, cbScanned / seconds / 1e9);
+}
+
+int main(int argc, char* argv[])
+{
+    double gigabytes = 4;
+    const char *pszFile = NULL;
+    DWORD cbReadSize = READ_SIZE;
+
+    if (argc > 1)
+    {
+        char *pEnd = NULL;
+        gigabytes = strtod(argv[1], &pEnd);
+        if (*pEnd != '\0')
+        {
+            pszFile = argv[1];
+        }
+        else if (gigabytes <= 0)
+        {
+            printf("usage: ParseBench [gigabytes | file.mpg] [read size]\n");
+            return 1;
+        }
+    }
+    if (argc > 2)
+    {
+        cbReadSize = (DWORD)atol(argv[2]);
+        if (cbReadSize == 0)
+        {
+            printf("usage: ParseBench [gigabytes | file.mpg] [read size]\n");
+            return 1;
+        }
+    }
+
+    std::vector<BYTE> prefix;
+    std::vector<BYTE> segment;
+    StreamCounts expected;
+    FILE *pFile = NULL;
+    Source *pSource = NULL;
+
+    if (pszFile)
+    {
+        pFile = fopen(pszFile, "rb");
+        if (pFile == NULL)
+        {
+            printf("cannot open %s\n", pszFile);
+            return 1;
+        }
+        pSource = new Source(pFile);
+    }
+    else
+    {
+        AppendPackHeader(prefix);
+        AppendSystemHeader(prefix);
+
+        segment.reserve(SEGMENT_SIZE);
+        MakeSegment(segment, SEGMENT_SIZE, &expected);
+
+        // Whole segments only, so that the expected counts are exact.
+        unsigned long long cSegments = (unsigned long long)(gigabytes * 1e9 / segment.size());
+        if (cSegments == 0)
+        {
+            cSegments = 1;
+        }
+        expected.video *= cSegments;
+        expected.audio *= cSegments;
+        expected.padding *= cSegments;
+        expected.payloadBytes *= cSegments;
+
+        pSource = new Source(&prefix, &segment, prefix.size() + segment.size() * cSegments);
+    }
+
+    StreamCounts counts;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    HRESULT hr = ParseStream(*pSource, cbReadSize, &counts);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned long long cbParsed = pSource->Position();
+    int result = 0;
+
+    if (FAILED(hr))
+    {
+        printf("parse failed with 0x%08X after %llu bytes\n", (unsigned int)hr, cbParsed);
+        result = 1;
+    }
+    else
+    {
+        printf("%s: %.2f GB in %.2f s, %.2f GB/s, %u-byte reads\n", pszFile ? pszFile : "synthetic",
+            cbParsed / 1e9, seconds, cbParsed / seconds / 1e9, cbReadSize);
+        printf("  %llu video, %llu audio, %llu padding packets, %.0f packets/s\n",
+            counts.video, counts.audio, counts.padding,
+            (counts.video + counts.audio + counts.padding) / seconds);
+
+        if (!pszFile && memcmp(&counts, &expected, sizeof(counts)) != 0)
+        {
+            printf("FAIL: expected %llu video, %llu audio, %llu padding packets, %llu payload bytes; got %llu payload bytes\n",
+                expected.video, expected.audio, expected.padding, expected.payloadBytes, counts.payloadBytes);
+            result = 1;
+        }
+    }
+
+    delete pSource;
+    if (pFile)
+    {
+        fclose(pFile);
+    }
+
+    ScanJunk();
+    return result;
+}
@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// ParserStandalone.h
+// What Parse.cpp needs from MPEG1Source.h, without Media Foundation.
+//
+// Parse.cpp includes this header instead of MPEG1Source.h when
+// MPEG1_PARSER_STANDALONE is defined, so that the parser and the read
+// buffer can be built into a console program. On other systems than
+// Windows it also supplies the few Windows types and functions the
+// parser uses.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+#include <winsock2.h>   // htonl
+#include <windows.h>
+#include <objbase.h>    // CoTaskMemAlloc
+#include <mfobjects.h>  // MFRatio
+#include <mferror.h>    // MF_E_INVALIDTYPE
+
+#pragma comment(lib, "Ws2_32")
+#pragma comment(lib, "ole32")
+
+#else
+
+#include <stdint.h>
+#include <arpa/inet.h>  // htonl
+
+typedef uint8_t     BYTE;
+typedef uint16_t    WORD;
+typedef uint32_t    DWORD;
+typedef int64_t     LONGLONG;
+typedef int         BOOL;
+typedef int32_t     HRESULT;
+
+#define TRUE    1
+#define FALSE   0
+#define MAXDWORD 0xffffffff
+
+#define S_OK            ((HRESULT)0)
+#define S_FALSE         ((HRESULT)1)
+#define E_FAIL          ((HRESULT)0x80004005)
+#define E_POINTER       ((HRESULT)0x80004003)
+#define E_OUTOFMEMORY   ((HRESULT)0x8007000E)
+#define E_INVALIDARG    ((HRESULT)0x80070057)
+#define E_UNEXPECTED    ((HRESULT)0x8000FFFF)
+#define MF_E_INVALIDTYPE ((HRESULT)0xC00D36B4)
+
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+
+#define CopyMemory(dest, src, cb)   memcpy((dest), (src), (cb))
+#define ZeroMemory(dest, cb)        memset((dest), 0, (cb))
+#define ARRAYSIZE(a)                (sizeof(a) / sizeof((a)[0]))
+
+#define CoTaskMemAlloc(cb)  malloc(cb)
+#define CoTaskMemFree(p)    free(p)
+
+union LARGE_INTEGER
+{
+    struct
+    {
+        DWORD LowPart;      // Little-endian layout, as on Windows.
+        DWORD HighPart;
+    };
+    LONGLONG QuadPart;
+};
+
+struct MFRatio
+{
+    DWORD Numerator;
+    DWORD Denominator;
+};
+
+template <class T> inline T max(T a, T b) { return a > b ? a : b; }
+template <class T> inline T min(T a, T b) { return a < b ? a : b; }
+
+#endif // _WIN32
+
+// From the common sample files.
+#define SAFE_ARRAY_DELETE(x) if (x) { delete [] x; x = NULL; }
+#define IF_FAILED_GOTO(hr, label) if (FAILED(hr)) { goto label; }
+#define TRACE(x)
+
+#define CHECK_HR(hr) IF_FAILED_GOTO(hr, done)
@@ -0,0 +1,820 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+
+//
+// HttpBench: a load generator for AsynchronousHTTPServerApp.
+//
+// Each thread opens -c keep-alive connections and keeps one GET request in
+// flight on each: as soon as a response is complete, the next request goes
+// out. At the end it prints requests per second, the bytes per second of
+// response bodies, and the time from sending each request to having its
+// whole response, at the median, the 99th percentile and the maximum.
+// With -r every request carries that Range header.
+//
+// With -l, HttpBench serves a file of the given size from an HTTP server of
+// its own on the loopback interface and runs against that, so it runs where
+// the HTTP API does not. The stand-in answers Range headers with ParseRange
+// (..\range.c), as the sample does, but it is a thread per connection over
+// plain sockets: it measures the client, the loopback and the Range path,
+// not HTTP.sys.
+//
+// Usage:
+//     AsynchronousHTTPServerApp.exe http://localhost:8080/ C:\httpsrv
+//     HttpBench -e:8080 -u:/file.bin -t:4 -c:16 -d:10
+//
+//     Against the loopback stand-in, 64 KB responses, asking for 1 KB ranges
+//     HttpBench -l:65536 -t:4 -c:16 -r:bytes=1024-2047
+//
+// Build:
+//     Windows: cl /EHsc /O2 HttpBench.cpp ..\range.c ws2_32.lib
+//     Linux and other systems with gcc or clang: make (see Makefile)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600     // WSAPoll
+#endif
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "ws2_32")
+
+#define SHUT_RDWR SD_BOTH
+#define strncasecmp _strnicmp
+
+static int SocketError() { return WSAGetLastError(); }
+static int PollSockets(struct pollfd *pfds, unsigned long nfds, int nTimeout) { return WSAPoll(pfds, nfds, nTimeout); }
+
+#else
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+
+typedef int SOCKET;
+
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+
+static int closesocket(SOCKET s) { return close(s); }
+static int SocketError() { return errno; }
+static int PollSockets(struct pollfd *pfds, unsigned long nfds, int nTimeout) { return poll(pfds, nfds, nTimeout); }
+
+#endif
+
+extern "C" {
+#include "../range.h"
+}
+
+#define MAXTHREADS 256
+#define MAXCONNECTIONS 1024     // per thread
+#define MAXFILESIZE (64 * 1024 * 1024)
+#define HEADER_BUFFER_SIZE 4096
+#define BODY_BUFFER_SIZE 65536
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct _OPTIONS
+{
+    char szHostname[64];
+    char szPort[16];
+    char szPath[256];
+    char szRange[64];           // empty for no Range header
+    int nThreads;
+    int nConnections;
+    double dSeconds;
+    unsigned long ulLoopbackSize; // 0 unless -l
+} OPTIONS;
+
+//
+// What one thread measured. aulMicroseconds holds the time each request took.
+//
+typedef struct _THREAD_RESULT
+{
+    std::vector<unsigned long> aulMicroseconds;
+    unsigned long long ullBodyBytes;
+    unsigned long ulFailures;
+} THREAD_RESULT;
+
+//
+// One connection of a client thread, and the response it is reading.
+//
+typedef struct _CONNECTION
+{
+    SOCKET sd;
+    Clock::time_point start;
+    char Header[HEADER_BUFFER_SIZE];
+    int cbHeader;                   // -1 once the header is complete
+    unsigned long long ullBodyLeft;
+} CONNECTION;
+
+static OPTIONS g_Options = {"localhost", "80", "/", "", 4, 1, 5.0, 0};
+static std::atomic<bool> g_bStop(false);
+static std::string g_strRequest;
+
+static bool ValidOptions(char *argv[], int argc);
+static void Usage(char *szProgramname);
+static void ClientThread(struct addrinfo *addr_srv, THREAD_RESULT *pResult);
+static void PrintResults(std::vector<THREAD_RESULT> &Results, double dElapsed);
+static unsigned short StandInStart(int nThreads);
+static void StandInStop();
+
+static void SetNoDelay(SOCKET sd)
+{
+    int nOne = 1;
+    setsockopt(sd, IPPROTO_TCP, TCP_NODELAY, (const char *)&nOne, sizeof(nOne));
+}
+
+static bool SendAll(SOCKET sd, const char *buf, size_t cb)
+{
+    while (cb > 0)
+    {
+        int nSend = send(sd, buf, (int)std::min(cb, (size_t)1 << 30), 0);
+        if (nSend <= 0)
+            return false;
+        buf += nSend;
+        cb -= nSend;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    struct addrinfo hints;
+    struct addrinfo *addr_srv = NULL;
+
+    if (!ValidOptions(argv, argc))
+        return 1;
+
+#ifdef _WIN32
+    WSADATA WSAData;
+    if (WSAStartup(MAKEWORD(2,2), &WSAData) != 0)
+    {
+        printf("WSAStartup() failed\n");
+        return 1;
+    }
+#else
+    // A send on a connection the other end has closed fails instead of
+    // ending the process.
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    if (g_Options.ulLoopbackSize != 0)
+    {
+        //
+        // One server thread per client connection, plus one spare.
+        //
+        unsigned short usPort = StandInStart(g_Options.nThreads * g_Options.nConnections + 1);
+        if (usPort == 0)
+            return 1;
+        strcpy(g_Options.szHostname, "127.0.0.1");
+        sprintf(g_Options.szPort, "%u", usPort);
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    if (getaddrinfo(g_Options.szHostname, g_Options.szPort, &hints, &addr_srv) != 0 || addr_srv == NULL)
+    {
+        printf("getaddrinfo() failed to resolve %s: %d\n", g_Options.szHostname, SocketError());
+        StandInStop();
+        return 1;
+    }
+
+    g_strRequest = std::string("GET ") + g_Options.szPath + " HTTP/1.1\r\nHost: " +
+                   g_Options.szHostname + ":" + g_Options.szPort + "\r\n";
+    if (g_Options.szRange[0] != '\0')
+        g_strRequest += std::string("Range: ") + g_Options.szRange + "\r\n";
+    g_strRequest += "\r\n";
+
+    printf("http://%s:%s%s, %d threads with %d connections each, %s%s, %.1f seconds\n",
+           g_Options.szHostname, g_Options.szPort, g_Options.szPath,
+           g_Options.nThreads, g_Options.nConnections,
+           g_Options.szRange[0] ? "Range: " : "no Range", g_Options.szRange, g_Options.dSeconds);
+
+    std::vector<THREAD_RESULT> Results(g_Options.nThreads);
+    std::vector<std::thread> Threads;
+
+    Clock::time_point start = Clock::now();
+
+    for (int i = 0; i < g_Options.nThreads; i++)
+        Threads.push_back(std::thread(ClientThread, addr_srv, &Results[i]));
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(g_Options.dSeconds));
+    g_bStop = true;
+
+    for (size_t i = 0; i < Threads.size(); i++)
+        Threads[i].join();
+
+    double dElapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    PrintResults(Results, dElapsed);
+
+    freeaddrinfo(addr_srv);
+    StandInStop();
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    return 0;
+}
+
+//
+// Routine Description:
+//
+//     Reads the status code and Content-Length of a complete response header.
+//
+// Return Value:
+//
+//     false if the response is not a 2xx with a Content-Length.
+//
+
+static bool ParseResponseHeader(
+                                const char *pszHeader,
+                                unsigned long long *pullContentLength
+                                )
+{
+    const char *psz;
+
+    if (strncmp(pszHeader, "HTTP/1.", 7) != 0 || pszHeader[9] != '2')
+        return false;
+
+    for (psz = strstr(pszHeader, "\r\n"); psz != NULL; psz = strstr(psz + 2, "\r\n"))
+    {
+        if (strncasecmp(psz + 2, "Content-Length:", 15) == 0)
+        {
+            *pullContentLength = strtoull(psz + 2 + 15, NULL, 10);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//
+// Routine Description:
+//
+//     Sends the next request on a connection.
+//
+
+static bool SendRequest(
+                        CONNECTION *pConn
+                        )
+{
+    pConn->cbHeader = 0;
+    pConn->ullBodyLeft = 0;
+    pConn->start = Clock::now();
+    return SendAll(pConn->sd, g_strRequest.data(), g_strRequest.size());
+}
+
+//
+// Routine Description:
+//
+//     Reads what has arrived on a connection.
+//
+// Return Value:
+//
+//     -1 if the connection failed or sent something that is not a good
+//     response, 1 if the response is complete, 0 if there is more to come.
+//
+
+static int ReadResponse(
+                        CONNECTION *pConn,
+                        char *pBody,
+                        THREAD_RESULT *pResult
+                        )
+{
+    int nRecv;
+
+    if (pConn->cbHeader >= 0)
+    {
+        nRecv = recv(pConn->sd, pConn->Header + pConn->cbHeader,
+                     HEADER_BUFFER_SIZE - 1 - pConn->cbHeader, 0);
+        if (nRecv <= 0)
+            return -1;
+
+        pConn->cbHeader += nRecv;
+        pConn->Header[pConn->cbHeader] = '\0';
+
+        char *pEnd = strstr(pConn->Header, "\r\n\r\n");
+        if (pEnd == NULL)
+            return (pConn->cbHeader < HEADER_BUFFER_SIZE - 1) ? 0 : -1;
+
+        unsigned long long ullContentLength = 0;
+        unsigned long long ullBodyHere = pConn->Header + pConn->cbHeader - (pEnd + 4);
+
+        pEnd[2] = '\0';
+        if (!ParseResponseHeader(pConn->Header, &ullContentLength) || ullBodyHere > ullContentLength)
+            return -1;
+
+        pResult->ullBodyBytes += ullBodyHere;
+        pConn->ullBodyLeft = ullContentLength - ullBodyHere;
+        pConn->cbHeader = -1;
+        return (pConn->ullBodyLeft == 0) ? 1 : 0;
+    }
+
+    nRecv = recv(pConn->sd, pBody, (int)std::min(pConn->ullBodyLeft, (unsigned long long)BODY_BUFFER_SIZE), 0);
+    if (nRecv <= 0)
+        return -1;
+
+    pResult->ullBodyBytes += nRecv;
+    pConn->ullBodyLeft -= nRecv;
+    return (pConn->ullBodyLeft == 0) ? 1 : 0;
+}
+
+//
+// Routine Description:
+//
+//     Opens the connections and keeps a request in flight on each until the
+//     time is up, timing each one. A connection that fails is counted and
+//     closed, and the thread goes on with the others.
+//
+
+static void ClientThread(
+                         struct addrinfo *addr_srv,
+                         THREAD_RESULT *pResult
+                         )
+{
+    std::vector<CONNECTION *> Conns;
+    std::vector<struct pollfd> Fds;
+    std::vector<char> Body(BODY_BUFFER_SIZE);
+
+    pResult->ullBodyBytes = 0;
+    pResult->ulFailures = 0;
+    pResult->aulMicroseconds.reserve(1 << 20);
+
+    for (int i = 0; i < g_Options.nConnections; i++)
+    {
+        SOCKET sd = socket(addr_srv->ai_family, addr_srv->ai_socktype, addr_srv->ai_protocol);
+        if (sd == INVALID_SOCKET)
+        {
+            pResult->ulFailures++;
+            continue;
+        }
+
+        SetNoDelay(sd);
+
+        if (connect(sd, addr_srv->ai_addr, (int)addr_srv->ai_addrlen) == SOCKET_ERROR)
+        {
+            pResult->ulFailures++;
+            closesocket(sd);
+            continue;
+        }
+
+        CONNECTION *pConn = new CONNECTION;
+        struct pollfd Fd;
+
+        pConn->sd = sd;
+        Fd.fd = sd;
+        Fd.events = POLLIN;
+        Fd.revents = 0;
+        Conns.push_back(pConn);
+        Fds.push_back(Fd);
+    }
+
+    for (size_t i = 0; i < Conns.size(); i++)
+        SendRequest(Conns[i]);
+
+    while (!g_bStop && !Conns.empty())
+    {
+        int nReady = PollSockets(&Fds[0], (unsigned long)Fds.size(), 100);
+        if (nReady == SOCKET_ERROR)
+            break;
+
+        for (size_t i = 0; i < Conns.size() && nReady > 0; i++)
+        {
+            CONNECTION *pConn = Conns[i];
+
+            if (Fds[i].revents == 0)
+                continue;
+            nReady--;
+
+            int nRet = ReadResponse(pConn, &Body[0], pResult);
+            if (nRet == 0)
+                continue;
+
+            if (nRet == 1)
+            {
+                Clock::time_point now = Clock::now();
+
+                pResult->aulMicroseconds.push_back((unsigned long)
+                    std::chrono::duration_cast<std::chrono::microseconds>(now - pConn->start).count());
+                if (SendRequest(pConn))
+                    continue;
+            }
+
+            //
+            // Drop the connection: move the last one into its place, and look
+            // at that one next.
+            //
+            pResult->ulFailures++;
+            closesocket(pConn->sd);
+            delete pConn;
+            Conns[i] = Conns.back();
+            Fds[i] = Fds.back();
+            Conns.pop_back();
+            Fds.pop_back();
+            i--;
+        }
+    }
+
+    for (size_t i = 0; i < Conns.size(); i++)
+    {
+        closesocket(Conns[i]->sd);
+        delete Conns[i];
+    }
+}
+
+//
+// Routine Description:
+//
+//     Prints requests per second and the percentiles of the request times.
+//
+
+static void PrintResults(
+                         std::vector<THREAD_RESULT> &Results,
+                         double dElapsed
+                         )
+{
+    std::vector<unsigned long> aulAll;
+    unsigned long long ullBodyBytes = 0;
+    unsigned long ulFailures = 0;
+
+    for (size_t i = 0; i < Results.size(); i++)
+    {
+        aulAll.insert(aulAll.end(), Results[i].aulMicroseconds.begin(), Results[i].aulMicroseconds.end());
+        ullBodyBytes += Results[i].ullBodyBytes;
+        ulFailures += Results[i].ulFailures;
+    }
+
+    printf("%lu requests in %.2f seconds: %.0f requests/s, %.1f MB/s of content, %lu connections failed\n",
+           (unsigned long)aulAll.size(), dElapsed, aulAll.size() / dElapsed,
+           ullBodyBytes / dElapsed / 1e6, ulFailures);
+
+    if (aulAll.empty())
+        return;
+
+    std::sort(aulAll.begin(), aulAll.end());
+    printf("request time: median %lu us, p99 %lu us, p99.9 %lu us, max %lu us\n",
+           aulAll[aulAll.size() / 2], aulAll[aulAll.size() * 99 / 100],
+           aulAll[aulAll.size() * 999 / 1000], aulAll.back());
+}
+
+//
+// The loopback stand-in. It serves one file, whatever the path, from memory.
+//
+
+#define STANDIN_LAST_MODIFIED "Mon, 01 Jan 2024 00:00:00 GMT"
+#define STANDIN_ETAG "\"01da3c7a1a2b3c4d-0\""
+
+static SOCKET g_sdListen = INVALID_SOCKET;
+static std::vector<std::thread> g_StandInThreads;
+static std::vector<char> g_File;
+
+//
+// Routine Description:
+//
+//     Finds a request header and returns its value and length, without the
+//     spaces around it. *pcchValue is 0 if the request has no such header.
+//
+
+static const char *FindRequestHeader(
+                                     const char *pszRequest,
+                                     const char *pszName,
+                                     size_t *pcchValue
+                                     )
+{
+    size_t cchName = strlen(pszName);
+    const char *psz;
+
+    *pcchValue = 0;
+
+    for (psz = strstr(pszRequest, "\r\n"); psz != NULL; psz = strstr(psz + 2, "\r\n"))
+    {
+        if (strncasecmp(psz + 2, pszName, cchName) == 0 && psz[2 + cchName] == ':')
+        {
+            const char *pValue = psz + 2 + cchName + 1;
+            const char *pEnd = strstr(pValue, "\r\n");
+
+            while (*pValue == ' ')
+                ++pValue;
+            while (pEnd > pValue && pEnd[-1] == ' ')
+                --pEnd;
+
+            *pcchValue = pEnd - pValue;
+            return pValue;
+        }
+    }
+
+    return NULL;
+}
+
+//
+// Routine Description:
+//
+//     Answers one GET request, with the whole file, the range it asks for,
+//     or 416 for a range past the end.
+//
+
+static bool StandInRespond(
+                           SOCKET sd,
+                           const char *pszRequest
+                           )
+{
+    const char *pRange;
+    const char *pIfRange;
+    size_t cchRange;
+    size_t cchIfRange;
+    unsigned long long ullFirst;
+    unsigned long long ullLength;
+    unsigned long long ullSize = g_File.size();
+    char szHeader[512];
+    int cchHeader;
+
+    pRange = FindRequestHeader(pszRequest, "Range", &cchRange);
+    pIfRange = FindRequestHeader(pszRequest, "If-Range", &cchIfRange);
+
+    switch (ParseRange(pRange, cchRange, pIfRange, cchIfRange, ullSize,
+                       STANDIN_LAST_MODIFIED, STANDIN_ETAG, &ullFirst, &ullLength))
+    {
+    case RangeNotSatisfiable:
+        cchHeader = sprintf(szHeader,
+                            "HTTP/1.1 416 Requested Range Not Satisfiable\r\n"
+                            "Content-Range: bytes */%llu\r\n"
+                            "Content-Length: 0\r\n\r\n",
+                            ullSize);
+        return SendAll(sd, szHeader, cchHeader);
+
+    case RangePartial:
+        cchHeader = sprintf(szHeader,
+                            "HTTP/1.1 206 Partial Content\r\n"
+                            "Content-Type: application/octet-stream\r\n"
+                            "Content-Length: %llu\r\n"
+                            "Content-Range: bytes %llu-%llu/%llu\r\n",
+                            ullLength, ullFirst, ullFirst + ullLength - 1, ullSize);
+        break;
+
+    default:
+        cchHeader = sprintf(szHeader,
+                            "HTTP/1.1 200 OK\r\n"
+                            "Content-Type: application/octet-stream\r\n"
+                            "Content-Length: %llu\r\n",
+                            ullSize);
+        break;
+    }
+
+    cchHeader += sprintf(szHeader + cchHeader,
+                         "Accept-Ranges: bytes\r\n"
+                         "Last-Modified: " STANDIN_LAST_MODIFIED "\r\n"
+                         "ETag: " STANDIN_ETAG "\r\n\r\n");
+
+    return SendAll(sd, szHeader, cchHeader) &&
+           SendAll(sd, &g_File[0] + ullFirst, (size_t)ullLength);
+}
+
+//
+// Routine Description:
+//
+//     Accepts a connection, answers the requests on it until the client
+//     closes it, then accepts the next one. Returns when the listening
+//     socket is closed.
+//
+
+static void StandInThread()
+{
+    char Request[HEADER_BUFFER_SIZE];
+
+    while (true)
+    {
+        SOCKET sd = accept(g_sdListen, NULL, NULL);
+        if (sd == INVALID_SOCKET)
+            break;
+
+        SetNoDelay(sd);
+
+        int cbRequest = 0;
+        while (true)
+        {
+            int nRecv = recv(sd, Request + cbRequest, HEADER_BUFFER_SIZE - 1 - cbRequest, 0);
+            if (nRecv <= 0)
+                break;
+
+            cbRequest += nRecv;
+            Request[cbRequest] = '\0';
+
+            //
+            // Answer every complete request in the buffer, and keep the start
+            // of the next one.
+            //
+            char *pEnd;
+            bool bFailed = false;
+            while ((pEnd = strstr(Request, "\r\n\r\n")) != NULL)
+            {
+                pEnd[2] = '\0';
+                if (strncmp(Request, "GET ", 4) != 0 || !StandInRespond(sd, Request))
+                {
+                    bFailed = true;
+                    break;
+                }
+
+                cbRequest -= (int)(pEnd + 4 - Request);
+                memmove(Request, pEnd + 4, cbRequest + 1);
+            }
+
+            if (bFailed || cbRequest == HEADER_BUFFER_SIZE - 1)
+                break;
+        }
+
+        closesocket(sd);
+    }
+}
+
+static unsigned short StandInStart(
+                                   int nThreads
+                                   )
+{
+    struct sockaddr_in addr;
+    socklen_t cbAddr = sizeof(addr);
+
+    g_File.resize(g_Options.ulLoopbackSize);
+    for (size_t i = 0; i < g_File.size(); i++)
+        g_File[i] = (char)('a' + i % 26);
+
+    g_sdListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (g_sdListen == INVALID_SOCKET)
+    {
+        printf("socket() failed: %d\n", SocketError());
+        return 0;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    if (bind(g_sdListen, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        listen(g_sdListen, SOMAXCONN) == SOCKET_ERROR ||
+        getsockname(g_sdListen, (struct sockaddr *)&addr, &cbAddr) == SOCKET_ERROR)
+    {
+        printf("loopback server failed to listen: %d\n", SocketError());
+        closesocket(g_sdListen);
+        g_sdListen = INVALID_SOCKET;
+        return 0;
+    }
+
+    for (int i = 0; i < nThreads; i++)
+        g_StandInThreads.push_back(std::thread(StandInThread));
+
+    return ntohs(addr.sin_port);
+}
+
+static void StandInStop()
+{
+    if (g_sdListen == INVALID_SOCKET)
+        return;
+
+    //
+    // On Linux, only shutdown wakes up the threads blocked in accept.
+    //
+    shutdown(g_sdListen, SHUT_RDWR);
+    closesocket(g_sdListen);
+
+    for (size_t i = 0; i < g_StandInThreads.size(); i++)
+        g_StandInThreads[i].join();
+    g_StandInThreads.clear();
+
+    g_sdListen = INVALID_SOCKET;
+}
+
+//
+// Routine Description:
+//
+//     Verifies the options and sets g_Options from them.
+//
+
+static bool ValidOptions(
+                         char *argv[],
+                         int argc
+                         )
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if ((argv[i][0] != '-' && argv[i][0] != '/') || argv[i][1] == '\0' ||
+            (argv[i][2] != '\0' && argv[i][2] != ':'))
+        {
+            printf("  unknown option %s\n", argv[i]);
+            Usage(argv[0]);
+            return false;
+        }
+
+        const char *pszValue = (argv[i][2] == ':') ? &argv[i][3] : "";
+
+        switch (argv[i][1])
+        {
+        case 'n':
+        case 'N':
+            strncpy(g_Options.szHostname, pszValue, sizeof(g_Options.szHostname) - 1);
+            break;
+
+        case 'e':
+        case 'E':
+            strncpy(g_Options.szPort, pszValue, sizeof(g_Options.szPort) - 1);
+            break;
+
+        case 'u':
+        case 'U':
+            strncpy(g_Options.szPath, pszValue, sizeof(g_Options.szPath) - 1);
+            break;
+
+        case 'r':
+        case 'R':
+            strncpy(g_Options.szRange, pszValue, sizeof(g_Options.szRange) - 1);
+            break;
+
+        case 't':
+        case 'T':
+            g_Options.nThreads = std::min(std::max(atoi(pszValue), 1), MAXTHREADS);
+            break;
+
+        case 'c':
+        case 'C':
+            g_Options.nConnections = std::min(std::max(atoi(pszValue), 1), MAXCONNECTIONS);
+            break;
+
+        case 'd':
+        case 'D':
+            g_Options.dSeconds = atof(pszValue);
+            if (g_Options.dSeconds <= 0)
+            {
+                Usage(argv[0]);
+                return false;
+            }
+            break;
+
+        case 'l':
+        case 'L':
+            g_Options.ulLoopbackSize = (*pszValue != '\0') ? strtoul(pszValue, NULL, 10) : 4096;
+            if (g_Options.ulLoopbackSize == 0 || g_Options.ulLoopbackSize > MAXFILESIZE)
+            {
+                Usage(argv[0]);
+                return false;
+            }
+            break;
+
+        default:
+            Usage(argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void Usage(
+                  char *szProgramname
+                  )
+{
+    printf("usage:\n%s [-n:host] [-e:port] [-u:path] [-r:range] [-t:#] [-c:#] [-d:#] [-l[:size]] [-?]\n",
+           szProgramname);
+    printf("  -n:host\tserver to connect to (default localhost)\n");
+    printf("  -e:port\tport the server is listening on (default 80)\n");
+    printf("  -u:path\tpath to request (default /)\n");
+    printf("  -r:range\tRange header value to send, such as bytes=0-1023 (default none)\n");
+    printf("  -t:#\t\tnumber of threads (default 4, max %d)\n", MAXTHREADS);
+    printf("  -c:#\t\tconnections for each thread (default 1, max %d)\n", MAXCONNECTIONS);
+    printf("  -d:#\t\tseconds to run (default 5)\n");
+    printf("  -l[:size]\trun against a server on the loopback interface started by HttpBench,\n"
+           "\t\tserving a file of size bytes (default 4096)\n");
+    printf("  -?\t\tdisplay this help\n");
+}
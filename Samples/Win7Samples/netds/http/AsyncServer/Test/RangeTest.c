@@ -0,0 +1,147 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+
+//
+// RangeTest: checks ParseRange (..\range.c) against a table of Range and
+// If-Range headers, and the part of the file each one should send.
+//
+// Returns 0 if every case passed.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../range.h"
+
+#define LAST_MODIFIED "Mon, 01 Jan 2024 00:00:00 GMT"
+#define ETAG "\"01d9e1a2b3c4d5e6-64\""
+
+typedef struct _RANGE_CASE
+{
+    const char *pszRange;       // NULL for no Range header
+    const char *pszIfRange;     // NULL for no If-Range header
+    unsigned long long ullSize;
+    RANGE_RESULT Expected;
+    unsigned long long ullFirst;
+    unsigned long long ullLength;
+} RANGE_CASE;
+
+static const RANGE_CASE g_rgCases[] =
+{
+    // No Range header: the whole file
+    { NULL,                 NULL,          100, RangeNone,           0,   100 },
+
+    // One range, with both ends, an open end, or a suffix length
+    { "bytes=0-9",          NULL,          100, RangePartial,        0,   10 },
+    { "bytes=90-",          NULL,          100, RangePartial,        90,  10 },
+    { "bytes=-10",          NULL,          100, RangePartial,        90,  10 },
+    { "bytes=99-99",        NULL,          100, RangePartial,        99,  1 },
+
+    // Ranges past the end are cut to the file
+    { "bytes=-200",         NULL,          100, RangePartial,        0,   100 },
+    { "bytes=50-500",       NULL,          100, RangePartial,        50,  50 },
+
+    // Ranges that start past the end, or ask for nothing
+    { "bytes=100-",         NULL,          100, RangeNotSatisfiable, 0,   100 },
+    { "bytes=-0",           NULL,          100, RangeNotSatisfiable, 0,   100 },
+    { "bytes=0-",           NULL,          0,   RangeNotSatisfiable, 0,   0 },
+    { "bytes=-5",           NULL,          0,   RangeNotSatisfiable, 0,   0 },
+
+    // Headers that are ignored, so the whole file is sent
+    { "bytes=5-2",          NULL,          100, RangeNone,           0,   100 },
+    { "bytes=0-1,5-6",      NULL,          100, RangeNone,           0,   100 },
+    { "items=0-1",          NULL,          100, RangeNone,           0,   100 },
+    { "bytes=1-2x",         NULL,          100, RangeNone,           0,   100 },
+    { "bytes=-",            NULL,          100, RangeNone,           0,   100 },
+    { "bytes=",             NULL,          100, RangeNone,           0,   100 },
+    { "bytes",              NULL,          100, RangeNone,           0,   100 },
+    { "bytes=99999999999999999999999-", NULL, 100, RangeNone,        0,   100 },
+    { "bytes=0-1234567890123456789012345678901234567890123456789012345678901234567890",
+                            NULL,          100, RangeNone,           0,   100 },
+
+    // The unit is not case sensitive, and spaces are allowed around it
+    { " Bytes= 1-2 ",       NULL,          100, RangePartial,        1,   2 },
+    { "BYTES=1-2",          NULL,          100, RangePartial,        1,   2 },
+
+    // If-Range: the range is used only if the file has not changed
+    { "bytes=0-9",          ETAG,          100, RangePartial,        0,   10 },
+    { "bytes=0-9",          LAST_MODIFIED, 100, RangePartial,        0,   10 },
+    { "bytes=0-9",          "\"other\"",   100, RangeNone,           0,   100 },
+    { "bytes=0-9",          "\"01d9e1a2b3c4d5e6-6\"", 100, RangeNone, 0,  100 },
+    { NULL,                 ETAG,          100, RangeNone,           0,   100 },
+};
+
+static const char *ResultName(
+                              RANGE_RESULT Result
+                              )
+{
+    switch (Result)
+    {
+    case RangeNone:           return "RangeNone";
+    case RangePartial:        return "RangePartial";
+    case RangeNotSatisfiable: return "RangeNotSatisfiable";
+    }
+    return "?";
+}
+
+int main()
+{
+    char szHeader[128];
+    int nFailed = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(g_rgCases) / sizeof(g_rgCases[0]); ++i)
+    {
+        const RANGE_CASE *pCase = &g_rgCases[i];
+        size_t cchRange = pCase->pszRange ? strlen(pCase->pszRange) : 0;
+        unsigned long long ullFirst = 12345;
+        unsigned long long ullLength = 12345;
+        RANGE_RESULT Result;
+
+        //
+        // Header values from HTTP.sys are not null terminated, so put
+        // something after the value that would change the result if it
+        // were read.
+        //
+        if (cchRange != 0)
+        {
+            memset(szHeader, '7', sizeof(szHeader));
+            if (cchRange <= sizeof(szHeader))
+                memcpy(szHeader, pCase->pszRange, cchRange);
+        }
+
+        Result = ParseRange(cchRange <= sizeof(szHeader) ? szHeader : pCase->pszRange,
+                            cchRange,
+                            pCase->pszIfRange,
+                            pCase->pszIfRange ? strlen(pCase->pszIfRange) : 0,
+                            pCase->ullSize,
+                            LAST_MODIFIED,
+                            ETAG,
+                            &ullFirst,
+                            &ullLength);
+
+        if (Result != pCase->Expected ||
+            ullFirst != pCase->ullFirst ||
+            ullLength != pCase->ullLength)
+        {
+            printf("FAIL Range: %s, If-Range: %s, size %llu: got %s %llu+%llu, expected %s %llu+%llu\n",
+                   pCase->pszRange ? pCase->pszRange : "(none)",
+                   pCase->pszIfRange ? pCase->pszIfRange : "(none)",
+                   pCase->ullSize,
+                   ResultName(Result), ullFirst, ullLength,
+                   ResultName(pCase->Expected), pCase->ullFirst, pCase->ullLength);
+            ++nFailed;
+        }
+    }
+
+    printf("%d of %d cases passed\n",
+           (int)(sizeof(g_rgCases) / sizeof(g_rgCases[0])) - nFailed,
+           (int)(sizeof(g_rgCases) / sizeof(g_rgCases[0])));
+
+    return nFailed != 0;
+}
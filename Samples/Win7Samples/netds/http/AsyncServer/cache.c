@@ -0,0 +1,614 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+//
+// Abstract:
+//
+//     Response cache for files. The first request for a file reads it into
+//     a section, and later requests are answered from the section without
+//     opening the file again, for as long as the file's last write time and
+//     size stay the same. The header values for the file are built when it
+//     is read.
+//
+//     The data is copied into a pagefile-backed section rather than mapping
+//     the file itself, so the file can still be replaced or truncated while
+//     it is cached.
+//
+
+#include "common.h"
+
+//
+// Global variables
+//
+
+static PCSTR g_rgszDays[] =
+{
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+};
+
+static PCSTR g_rgszMonths[] =
+{
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+static struct
+{
+    PCWSTR pwszExtension;
+    PCSTR pszContentType;
+} g_rgContentTypes[] =
+{
+    { L".htm",  "text/html" },
+    { L".html", "text/html" },
+    { L".txt",  "text/plain" },
+    { L".css",  "text/css" },
+    { L".js",   "application/javascript" },
+    { L".xml",  "text/xml" },
+    { L".gif",  "image/gif" },
+    { L".jpg",  "image/jpeg" },
+    { L".jpeg", "image/jpeg" },
+    { L".png",  "image/png" },
+    { L".ico",  "image/x-icon" },
+};
+
+//
+// Routine Description:
+//
+//     Builds the Last-Modified and ETag header values for a file. The ETag
+//     changes whenever the last write time or size of the file does.
+//
+// Arguments:
+//
+//     pftLastWrite - The time the file was last written.
+//
+//     ullSize - The size of the file.
+//
+//     pszLastModified, cbLastModified - Buffer for the Last-Modified value.
+//
+//     pszETag, cbETag - Buffer for the ETag value.
+//
+// Return Value:
+//
+//     N/A
+//
+
+VOID FormatFileValidators(
+                          const FILETIME *pftLastWrite,
+                          ULONGLONG ullSize,
+                          PCHAR pszLastModified,
+                          SIZE_T cbLastModified,
+                          PCHAR pszETag,
+                          SIZE_T cbETag
+                          )
+{
+    SYSTEMTIME st;
+
+    if (!FileTimeToSystemTime(pftLastWrite, &st))
+    {
+        ZeroMemory(&st, sizeof(st));
+    }
+
+    StringCbPrintfA(pszLastModified,
+                    cbLastModified,
+                    "%s, %02u %s %04u %02u:%02u:%02u GMT",
+                    g_rgszDays[st.wDayOfWeek % 7],
+                    st.wDay,
+                    g_rgszMonths[(st.wMonth + 11) % 12],
+                    st.wYear,
+                    st.wHour,
+                    st.wMinute,
+                    st.wSecond);
+
+    StringCbPrintfA(pszETag,
+                    cbETag,
+                    "\"%08lx%08lx-%I64x\"",
+                    pftLastWrite->dwHighDateTime,
+                    pftLastWrite->dwLowDateTime,
+                    ullSize);
+}
+
+//
+// Routine Description:
+//
+//     Picks the Content-Type for a file from its extension.
+//
+// Arguments:
+//
+//     pwszPath - Full path of the file.
+//
+// Return Value:
+//
+//     The Content-Type value. Files with no extension, or one that is not
+//     known, are sent as application/octet-stream, so a client does not
+//     render an arbitrary file as HTML.
+//
+
+PCSTR GetContentType(
+                     PCWSTR pwszPath
+                     )
+{
+    PCWSTR pwszExtension;
+    ULONG i;
+
+    pwszExtension = wcsrchr(pwszPath, L'.');
+
+    // The path is made from the URL, so it may use either kind of slash.
+    if (pwszExtension != NULL && wcspbrk(pwszExtension, L"\\/") == NULL)
+    {
+        for (i = 0; i < ARRAYSIZE(g_rgContentTypes); ++i)
+        {
+            if (CompareStringOrdinal(pwszExtension,
+                                     -1,
+                                     g_rgContentTypes[i].pwszExtension,
+                                     -1,
+                                     TRUE) == CSTR_EQUAL)
+            {
+                return g_rgContentTypes[i].pszContentType;
+            }
+        }
+    }
+
+    return "application/octet-stream";
+}
+
+//
+// Routine Description:
+//
+//     Hashes a path. Paths that differ only in the case of ASCII letters
+//     hash the same, because they name the same file.
+//
+
+static ULONG HashPath(
+                      PCWSTR pwszPath
+                      )
+{
+    ULONG ulHash = 2166136261UL;
+    WCHAR wch;
+
+    for (; *pwszPath != L'\0'; ++pwszPath)
+    {
+        wch = *pwszPath;
+
+        if (wch >= L'a' && wch <= L'z')
+        {
+            wch -= L'a' - L'A';
+        }
+
+        ulHash = (ulHash ^ wch) * 16777619UL;
+    }
+
+    return ulHash;
+}
+
+//
+// Routine Description:
+//
+//     Frees a cache entry and its section.
+//
+
+static VOID FreeCacheEntry(
+                           PCACHE_ENTRY pEntry
+                           )
+{
+    if (pEntry->pView != NULL)
+    {
+        UnmapViewOfFile(pEntry->pView);
+    }
+
+    if (pEntry->hSection != NULL)
+    {
+        CloseHandle(pEntry->hSection);
+    }
+
+    FREE(pEntry);
+}
+
+//
+// Routine Description:
+//
+//     Reads a file into a new cache entry.
+//
+// Arguments:
+//
+//     pwszPath - Full path of the file.
+//
+//     ulHash - Hash of pwszPath.
+//
+// Return Value:
+//
+//     The new entry with one reference, or NULL if the file could not be
+//     read or is too large to cache.
+//
+
+static PCACHE_ENTRY LoadCacheEntry(
+                                   PCWSTR pwszPath,
+                                   ULONG ulHash
+                                   )
+{
+    PCACHE_ENTRY pEntry;
+    HANDLE hFile;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    ULONGLONG ullSize;
+    ULONGLONG ullRead;
+    DWORD dwRead;
+
+    hFile = CreateFileW(
+        pwszPath,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL);
+
+    if (hFile == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    //
+    // The key is the time and size of the data actually read, which may be
+    // newer than what the caller looked at.
+    //
+    if (!GetFileInformationByHandle(hFile, &FileInfo))
+    {
+        CloseHandle(hFile);
+        return NULL;
+    }
+
+    ullSize = ((ULONGLONG)FileInfo.nFileSizeHigh << 32) | FileInfo.nFileSizeLow;
+
+    if (ullSize > CACHE_MAX_FILE_SIZE)
+    {
+        CloseHandle(hFile);
+        return NULL;
+    }
+
+    pEntry = (PCACHE_ENTRY)MALLOC(sizeof(CACHE_ENTRY));
+
+    if (pEntry == NULL)
+    {
+        CloseHandle(hFile);
+        return NULL;
+    }
+
+    ZeroMemory(pEntry, sizeof(CACHE_ENTRY));
+
+    pEntry->lRefCount = 1;
+    pEntry->dwLastUsed = GetTickCount();
+    pEntry->ulHash = ulHash;
+    pEntry->ftLastWrite = FileInfo.ftLastWriteTime;
+    pEntry->ullSize = ullSize;
+
+    if (FAILED(StringCbCopyW(pEntry->wszPath, sizeof(pEntry->wszPath), pwszPath)))
+    {
+        CloseHandle(hFile);
+        FreeCacheEntry(pEntry);
+        return NULL;
+    }
+
+    //
+    // An empty section can not be created, an empty file has no view.
+    //
+    if (ullSize > 0)
+    {
+        pEntry->hSection = CreateFileMappingW(
+            INVALID_HANDLE_VALUE,
+            NULL,
+            PAGE_READWRITE,
+            0,
+            (DWORD)ullSize,
+            NULL);
+
+        if (pEntry->hSection != NULL)
+        {
+            pEntry->pView = MapViewOfFile(
+                pEntry->hSection,
+                FILE_MAP_WRITE,
+                0,
+                0,
+                (SIZE_T)ullSize);
+        }
+
+        if (pEntry->pView == NULL)
+        {
+            CloseHandle(hFile);
+            FreeCacheEntry(pEntry);
+            return NULL;
+        }
+
+        for (ullRead = 0; ullRead < ullSize; ullRead += dwRead)
+        {
+            if (!ReadFile(hFile,
+                          (PUCHAR)pEntry->pView + ullRead,
+                          (DWORD)(ullSize - ullRead),
+                          &dwRead,
+                          NULL) ||
+                dwRead == 0)
+            {
+                //
+                // The file got shorter while it was being read.
+                //
+                CloseHandle(hFile);
+                FreeCacheEntry(pEntry);
+                return NULL;
+            }
+        }
+    }
+
+    CloseHandle(hFile);
+
+    pEntry->pszContentType = GetContentType(pwszPath);
+
+    FormatFileValidators(&pEntry->ftLastWrite,
+                         pEntry->ullSize,
+                         pEntry->szLastModified,
+                         sizeof(pEntry->szLastModified),
+                         pEntry->szETag,
+                         sizeof(pEntry->szETag));
+
+    return pEntry;
+}
+
+//
+// Routine Description:
+//
+//     Adds an entry to the cache in place of any entry for the same path,
+//     then drops the entries that have not been used for the longest time
+//     until the cache is within CACHE_MAX_SIZE.
+//
+// Arguments:
+//
+//     pCache - The response cache.
+//
+//     pEntry - The entry to add. The cache takes a reference of its own.
+//
+// Return Value:
+//
+//     N/A
+//
+
+static VOID InsertCacheEntry(
+                             PRESPONSE_CACHE pCache,
+                             PCACHE_ENTRY pEntry
+                             )
+{
+    PCACHE_ENTRY *ppLink;
+    PCACHE_ENTRY *ppOldest;
+    PCACHE_ENTRY pRemoved = NULL;
+    PCACHE_ENTRY pTemp;
+    DWORD dwNow;
+    DWORD dwAge;
+    DWORD dwOldestAge;
+    ULONG i;
+
+    InterlockedIncrement(&pEntry->lRefCount);
+
+    AcquireSRWLockExclusive(&pCache->Lock);
+
+    ppLink = &pCache->Buckets[pEntry->ulHash % CACHE_BUCKETS];
+
+    while (*ppLink != NULL)
+    {
+        pTemp = *ppLink;
+
+        if (pTemp->ulHash == pEntry->ulHash &&
+            CompareStringOrdinal(pTemp->wszPath, -1, pEntry->wszPath, -1, TRUE) == CSTR_EQUAL)
+        {
+            *ppLink = pTemp->pNext;
+            pCache->ullSize -= pTemp->ullSize;
+            pTemp->pNext = pRemoved;
+            pRemoved = pTemp;
+            continue;
+        }
+
+        ppLink = &pTemp->pNext;
+    }
+
+    pEntry->pNext = pCache->Buckets[pEntry->ulHash % CACHE_BUCKETS];
+    pCache->Buckets[pEntry->ulHash % CACHE_BUCKETS] = pEntry;
+    pCache->ullSize += pEntry->ullSize;
+
+    dwNow = GetTickCount();
+
+    while (pCache->ullSize > CACHE_MAX_SIZE)
+    {
+        ppOldest = NULL;
+        dwOldestAge = 0;
+
+        for (i = 0; i < CACHE_BUCKETS; ++i)
+        {
+            for (ppLink = &pCache->Buckets[i]; *ppLink != NULL; ppLink = &(*ppLink)->pNext)
+            {
+                dwAge = dwNow - (*ppLink)->dwLastUsed;
+
+                if (*ppLink != pEntry && (ppOldest == NULL || dwAge > dwOldestAge))
+                {
+                    ppOldest = ppLink;
+                    dwOldestAge = dwAge;
+                }
+            }
+        }
+
+        if (ppOldest == NULL)
+            break;
+
+        pTemp = *ppOldest;
+        *ppOldest = pTemp->pNext;
+        pCache->ullSize -= pTemp->ullSize;
+        pTemp->pNext = pRemoved;
+        pRemoved = pTemp;
+    }
+
+    ReleaseSRWLockExclusive(&pCache->Lock);
+
+    //
+    // Responses still being sent from the removed entries keep them alive.
+    //
+    while (pRemoved != NULL)
+    {
+        pTemp = pRemoved->pNext;
+        ReleaseCacheEntry(pRemoved);
+        pRemoved = pTemp;
+    }
+}
+
+//
+// Routine Description:
+//
+//     Sets up an empty response cache.
+//
+// Arguments:
+//
+//     pCache - The response cache.
+//
+// Return Value:
+//
+//     N/A
+//
+
+VOID InitializeCache(
+                     PRESPONSE_CACHE pCache
+                     )
+{
+    ZeroMemory(pCache, sizeof(RESPONSE_CACHE));
+
+    InitializeSRWLock(&pCache->Lock);
+}
+
+//
+// Routine Description:
+//
+//     Removes every entry from the cache. No responses may still be using
+//     the cache.
+//
+// Arguments:
+//
+//     pCache - The response cache.
+//
+// Return Value:
+//
+//     N/A
+//
+
+VOID UninitializeCache(
+                       PRESPONSE_CACHE pCache
+                       )
+{
+    PCACHE_ENTRY pEntry;
+    ULONG i;
+
+    for (i = 0; i < CACHE_BUCKETS; ++i)
+    {
+        while (pCache->Buckets[i] != NULL)
+        {
+            pEntry = pCache->Buckets[i];
+            pCache->Buckets[i] = pEntry->pNext;
+            ReleaseCacheEntry(pEntry);
+        }
+    }
+
+    pCache->ullSize = 0;
+}
+
+//
+// Routine Description:
+//
+//     Finds the cache entry for a file, reading the file into a new entry if
+//     it is not in the cache or has been written since it was cached.
+//
+// Arguments:
+//
+//     pCache - The response cache.
+//
+//     pwszPath - Full path of the file.
+//
+//     pFileData - The file's attributes, from GetFileAttributesEx.
+//
+// Return Value:
+//
+//     The entry, with a reference the caller must release with
+//     ReleaseCacheEntry. NULL if the file is too large to cache or could
+//     not be read.
+//
+
+PCACHE_ENTRY GetCacheEntry(
+                           PRESPONSE_CACHE pCache,
+                           PCWSTR pwszPath,
+                           const WIN32_FILE_ATTRIBUTE_DATA *pFileData
+                           )
+{
+    PCACHE_ENTRY pEntry;
+    ULONGLONG ullSize;
+    ULONG ulHash;
+
+    ullSize = ((ULONGLONG)pFileData->nFileSizeHigh << 32) | pFileData->nFileSizeLow;
+
+    if (ullSize > CACHE_MAX_FILE_SIZE)
+        return NULL;
+
+    ulHash = HashPath(pwszPath);
+
+    AcquireSRWLockShared(&pCache->Lock);
+
+    for (pEntry = pCache->Buckets[ulHash % CACHE_BUCKETS]; pEntry != NULL; pEntry = pEntry->pNext)
+    {
+        if (pEntry->ulHash == ulHash &&
+            CompareStringOrdinal(pEntry->wszPath, -1, pwszPath, -1, TRUE) == CSTR_EQUAL)
+        {
+            break;
+        }
+    }
+
+    if (pEntry != NULL &&
+        pEntry->ullSize == ullSize &&
+        CompareFileTime(&pEntry->ftLastWrite, &pFileData->ftLastWriteTime) == 0)
+    {
+        InterlockedIncrement(&pEntry->lRefCount);
+        pEntry->dwLastUsed = GetTickCount();
+
+        ReleaseSRWLockShared(&pCache->Lock);
+
+        return pEntry;
+    }
+
+    ReleaseSRWLockShared(&pCache->Lock);
+
+    //
+    // Not cached, or the file has changed. Read it again.
+    //
+    pEntry = LoadCacheEntry(pwszPath, ulHash);
+
+    if (pEntry != NULL)
+    {
+        InsertCacheEntry(pCache, pEntry);
+    }
+
+    return pEntry;
+}
+
+//
+// Routine Description:
+//
+//     Releases a reference to a cache entry, freeing it if it was the last.
+//
+// Arguments:
+//
+//     pEntry - The cache entry.
+//
+// Return Value:
+//
+//     N/A
+//
+
+VOID ReleaseCacheEntry(
+                       PCACHE_ENTRY pEntry
+                       )
+{
+    if (InterlockedDecrement(&pEntry->lRefCount) == 0)
+    {
+        FreeCacheEntry(pEntry);
+    }
+}
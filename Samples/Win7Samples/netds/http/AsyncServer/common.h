@@ -42,8 +42,54 @@
 // Headers, URL, entity-body, etc will all be stored in this buffer.
 #define REQUEST_BUFFER_SIZE 4096
 
+// Files larger than this are not kept in the response cache, they are sent
+// from a file handle instead.
+#define CACHE_MAX_FILE_SIZE (4 * 1024 * 1024)
+// The most file data the response cache holds before it drops the entries
+// that have not been used for the longest time.
+#define CACHE_MAX_SIZE (64 * 1024 * 1024)
+// The number of hash buckets in the response cache
+#define CACHE_BUCKETS 256
+// How long HTTP.sys may keep serving a file response from its own cache
+// before the request comes back to us and the file time is checked again.
+#define KERNEL_CACHE_SECONDS 5
+
 typedef VOID (*HTTP_COMPLETION_FUNCTION)(struct _HTTP_IO_CONTEXT*, PTP_IO, ULONG);
 
+// A file in the response cache. The entry is freed when the last response
+// using it completes after it has been removed from the cache.
+typedef struct _CACHE_ENTRY
+{
+    // Next entry in the same hash bucket
+    struct _CACHE_ENTRY *pNext;
+    // One reference for the cache and one for each response being sent
+    LONG lRefCount;
+    // GetTickCount() when the entry was last used
+    volatile DWORD dwLastUsed;
+    // The key is the full path, and the time the file was last written
+    WCHAR wszPath[MAX_STR_SIZE];
+    ULONG ulHash;
+    FILETIME ftLastWrite;
+    ULONGLONG ullSize;
+    // The file data, in a section that all responses for the file share.
+    // pView is NULL for an empty file.
+    HANDLE hSection;
+    PVOID pView;
+    // Header values, built when the file is loaded
+    PCSTR pszContentType;
+    CHAR szLastModified[32];
+    CHAR szETag[48];
+} CACHE_ENTRY, *PCACHE_ENTRY;
+
+// Cache of file responses, keyed by path and last write time
+typedef struct _RESPONSE_CACHE
+{
+    SRWLOCK Lock;
+    PCACHE_ENTRY Buckets[CACHE_BUCKETS];
+    // Bytes of file data held by entries in the cache
+    ULONGLONG ullSize;
+} RESPONSE_CACHE, *PRESPONSE_CACHE;
+
 // Structure for handling http server context data
 typedef struct _SERVER_CONTEXT
 {
@@ -61,6 +107,8 @@ typedef struct _SERVER_CONTEXT
     BOOL bHttpInit;
     // TRUE, when we receive a user command to stop the server
     BOOL bStopServer;
+    // Files that have been sent before
+    RESPONSE_CACHE Cache;
 } SERVER_CONTEXT, *PSERVER_CONTEXT;
 
 // Structure for handling I/O context parameters
@@ -92,6 +140,14 @@ typedef struct _HTTP_IO_RESPONSE
     // Structure represents an individual block of data either in memory,
     // in a file, or in the HTTP Server API response-fragment cache.
     HTTP_DATA_CHUNK HttpDataChunk;
+
+    // The cache entry the data chunk points into, if any
+    PCACHE_ENTRY pCacheEntry;
+
+    // Header values that are different for each response
+    CHAR szContentRange[64];
+    CHAR szLastModified[32];
+    CHAR szETag[48];
 } HTTP_IO_RESPONSE, *PHTTP_IO_RESPONSE;
 
 //
@@ -138,4 +194,35 @@ VOID CleanupHttpIoResponse(
 VOID CleanupHttpIoRequest(
                           PHTTP_IO_REQUEST pIoRequest
                           );
+
+VOID InitializeCache(
+                     PRESPONSE_CACHE pCache
+                     );
+
+VOID UninitializeCache(
+                       PRESPONSE_CACHE pCache
+                       );
+
+PCACHE_ENTRY GetCacheEntry(
+                           PRESPONSE_CACHE pCache,
+                           PCWSTR pwszPath,
+                           const WIN32_FILE_ATTRIBUTE_DATA *pFileData
+                           );
+
+VOID ReleaseCacheEntry(
+                       PCACHE_ENTRY pEntry
+                       );
+
+VOID FormatFileValidators(
+                          const FILETIME *pftLastWrite,
+                          ULONGLONG ullSize,
+                          PCHAR pszLastModified,
+                          SIZE_T cbLastModified,
+                          PCHAR pszETag,
+                          SIZE_T cbETag
+                          );
+
+PCSTR GetContentType(
+                     PCWSTR pwszPath
+                     );
 #endif
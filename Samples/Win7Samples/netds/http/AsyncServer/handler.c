@@ -7,6 +7,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved
 
 #include "common.h"
+#include "range.h"
 
 //
 // Global variables
@@ -15,6 +16,15 @@
 static USHORT g_usOKCode = 200;
 static CHAR g_szOKReason[] = "OK";
 
+static USHORT g_usPartialContentCode = 206;
+static CHAR g_szPartialContentReason[] = "Partial Content";
+
+static USHORT g_usRangeNotSatisfiableCode = 416;
+static CHAR g_szRangeNotSatisfiableReason[] = "Requested Range Not Satisfiable";
+static CHAR g_szRangeNotSatisfiableMessage[] = "Requested range not satisfiable";
+
+static CHAR g_szAcceptRanges[] = "bytes";
+
 static USHORT g_usFileNotFoundCode = 404;
 static CHAR g_szFileNotFoundReason[] = "Not Found";
 static CHAR g_szFileNotFoundMessage[] = "File not found";
@@ -132,6 +142,226 @@ VOID SendCompletionCallback(
     CleanupHttpIoResponse(pIoResponse);
 }
 
+//
+// Routine Description:
+//
+//     Creates an http response if the requested file was not found.
+// 
+// Arguments:
+// 
+//     pServerContext - Pointer to the http server context structure.
+//
+//     code - The error code to use in the response
+//
+//     pReason - The reason string to send back to the client
+//
+//     pMessage - The more verbose message to send back to the client
+// 
+// Return Value:
+// 
+//     Return a pointer to the HTTP_IO_RESPONSE structure
+//
+
+PHTTP_IO_RESPONSE CreateMessageResponse(
+                                        PSERVER_CONTEXT pServerContext,
+                                        USHORT code,
+                                        PCHAR pReason,
+                                        PCHAR pMessage
+                                        )
+{
+    PHTTP_IO_RESPONSE pIoResponse;
+    PHTTP_DATA_CHUNK pChunk;
+
+    pIoResponse = AllocateHttpIoResponse(pServerContext);
+
+    if (pIoResponse == NULL)
+        return NULL;
+
+    // Can not find the requested file
+    pIoResponse->HttpResponse.StatusCode = code;
+    pIoResponse->HttpResponse.pReason = pReason;
+    pIoResponse->HttpResponse.ReasonLength = (USHORT)strlen(pReason);
+
+    pChunk = &pIoResponse->HttpResponse.pEntityChunks[0];
+    pChunk->DataChunkType = HttpDataChunkFromMemory;
+    pChunk->FromMemory.pBuffer = pMessage;
+    pChunk->FromMemory.BufferLength = (ULONG)strlen(pMessage);
+
+    return pIoResponse;
+}
+
+//
+// Routine Description:
+//
+//     Works out which part of a file to send from the Range and If-Range
+//     headers of the request, with ParseRange (see range.c).
+// 
+// Arguments:
+// 
+//     pHttpRequest - The request.
+//
+//     ullSize - The size of the file.
+//
+//     pszLastModified - The Last-Modified value of the file.
+//
+//     pszETag - The ETag value of the file.
+//
+//     pullFirst - Receives the offset of the first byte to send.
+//
+//     pullLength - Receives the number of bytes to send.
+// 
+// Return Value:
+// 
+//     What to send. *pullFirst and *pullLength cover the whole file unless
+//     RangePartial is returned.
+//
+
+static RANGE_RESULT ParseRangeHeader(
+                                     PHTTP_REQUEST pHttpRequest,
+                                     ULONGLONG ullSize,
+                                     PCSTR pszLastModified,
+                                     PCSTR pszETag,
+                                     PULONGLONG pullFirst,
+                                     PULONGLONG pullLength
+                                     )
+{
+    PHTTP_KNOWN_HEADER pRangeHeader;
+    PHTTP_KNOWN_HEADER pIfRangeHeader;
+
+    pRangeHeader = &pHttpRequest->Headers.KnownHeaders[HttpHeaderRange];
+    pIfRangeHeader = &pHttpRequest->Headers.KnownHeaders[HttpHeaderIfRange];
+
+    return ParseRange(pRangeHeader->pRawValue,
+                      pRangeHeader->RawValueLength,
+                      pIfRangeHeader->pRawValue,
+                      pIfRangeHeader->RawValueLength,
+                      ullSize,
+                      pszLastModified,
+                      pszETag,
+                      pullFirst,
+                      pullLength);
+}
+
+//
+// Routine Description:
+//
+//     Sets the status and headers of a response that sends all or part of
+//     a file.
+// 
+// Arguments:
+// 
+//     pIoResponse - The response.
+//
+//     Range - RangeNone or RangePartial, from ParseRangeHeader.
+//
+//     ullFirst, ullLength - The part of the file being sent.
+//
+//     ullSize - The size of the file.
+//
+//     pszContentType, pszLastModified, pszETag - Header values for the file.
+//         They must stay valid until the response has been sent.
+// 
+// Return Value:
+// 
+//     N/A
+//
+
+static VOID SetFileResponseHeaders(
+                                   PHTTP_IO_RESPONSE pIoResponse,
+                                   RANGE_RESULT Range,
+                                   ULONGLONG ullFirst,
+                                   ULONGLONG ullLength,
+                                   ULONGLONG ullSize,
+                                   PCSTR pszContentType,
+                                   PCSTR pszLastModified,
+                                   PCSTR pszETag
+                                   )
+{
+    PHTTP_KNOWN_HEADER pHeaders;
+
+    pHeaders = pIoResponse->HttpResponse.Headers.KnownHeaders;
+
+    pHeaders[HttpHeaderContentType].pRawValue = pszContentType;
+    pHeaders[HttpHeaderContentType].RawValueLength = (USHORT)strlen(pszContentType);
+    pHeaders[HttpHeaderLastModified].pRawValue = pszLastModified;
+    pHeaders[HttpHeaderLastModified].RawValueLength = (USHORT)strlen(pszLastModified);
+    pHeaders[HttpHeaderEtag].pRawValue = pszETag;
+    pHeaders[HttpHeaderEtag].RawValueLength = (USHORT)strlen(pszETag);
+    pHeaders[HttpHeaderAcceptRanges].pRawValue = g_szAcceptRanges;
+    pHeaders[HttpHeaderAcceptRanges].RawValueLength = (USHORT)strlen(g_szAcceptRanges);
+
+    if (Range == RangePartial)
+    {
+        pIoResponse->HttpResponse.StatusCode = g_usPartialContentCode;
+        pIoResponse->HttpResponse.pReason = g_szPartialContentReason;
+        pIoResponse->HttpResponse.ReasonLength = (USHORT)strlen(g_szPartialContentReason);
+
+        StringCbPrintfA(pIoResponse->szContentRange,
+                        sizeof(pIoResponse->szContentRange),
+                        "bytes %I64u-%I64u/%I64u",
+                        ullFirst,
+                        ullFirst + ullLength - 1,
+                        ullSize);
+
+        pHeaders[HttpHeaderContentRange].pRawValue = pIoResponse->szContentRange;
+        pHeaders[HttpHeaderContentRange].RawValueLength = 
+            (USHORT)strlen(pIoResponse->szContentRange);
+    }
+    else
+    {
+        pIoResponse->HttpResponse.StatusCode = g_usOKCode;
+        pIoResponse->HttpResponse.pReason = g_szOKReason;
+        pIoResponse->HttpResponse.ReasonLength = (USHORT)strlen(g_szOKReason);
+    }
+}
+
+//
+// Routine Description:
+//
+//     Creates the response for a Range header that starts past the end of
+//     the file.
+// 
+// Arguments:
+// 
+//     pServerContext - Pointer to the http server context structure.
+//
+//     ullSize - The size of the file.
+// 
+// Return Value:
+// 
+//     Return a pointer to the HTTP_IO_RESPONSE structure.
+//
+
+PHTTP_IO_RESPONSE CreateRangeNotSatisfiableResponse(
+                                                    PSERVER_CONTEXT pServerContext,
+                                                    ULONGLONG ullSize
+                                                    )
+{
+    PHTTP_IO_RESPONSE pIoResponse;
+    PHTTP_KNOWN_HEADER pContentRangeHeader;
+
+    pIoResponse = CreateMessageResponse(
+                    pServerContext,
+                    g_usRangeNotSatisfiableCode,
+                    g_szRangeNotSatisfiableReason,
+                    g_szRangeNotSatisfiableMessage);
+
+    if (pIoResponse == NULL)
+        return NULL;
+
+    StringCbPrintfA(pIoResponse->szContentRange,
+                    sizeof(pIoResponse->szContentRange),
+                    "bytes */%I64u",
+                    ullSize);
+
+    pContentRangeHeader = 
+        &pIoResponse->HttpResponse.Headers.KnownHeaders[HttpHeaderContentRange];
+    pContentRangeHeader->pRawValue = pIoResponse->szContentRange;
+    pContentRangeHeader->RawValueLength = (USHORT)strlen(pIoResponse->szContentRange);
+
+    return pIoResponse;
+}
+
 //
 // Routine Description:
 //
@@ -142,7 +372,11 @@ VOID SendCompletionCallback(
 // 
 //     pServerContext - Pointer to the http server context structure.
 //
-//     hFile - Handle to the specified file.
+//     hFile - Handle to the specified file. The response closes it.
+//
+//     pwszFilePath - Full path of the file.
+//
+//     pHttpRequest - The request, for its Range header.
 //
 // Return Value:
 // 
@@ -151,25 +385,74 @@ VOID SendCompletionCallback(
 
 PHTTP_IO_RESPONSE CreateFileResponse(
                                      PSERVER_CONTEXT pServerContext, 
-                                     HANDLE hFile
+                                     HANDLE hFile,
+                                     PCWSTR pwszFilePath,
+                                     PHTTP_REQUEST pHttpRequest
                                      )
 {
     PHTTP_IO_RESPONSE pIoResponse;
     PHTTP_DATA_CHUNK pChunk;
+    BY_HANDLE_FILE_INFORMATION FileInfo;
+    RANGE_RESULT Range;
+    ULONGLONG ullSize;
+    ULONGLONG ullFirst;
+    ULONGLONG ullLength;
+
+    if (!GetFileInformationByHandle(hFile, &FileInfo))
+    {
+        CloseHandle(hFile);
+        return CreateMessageResponse(
+                    pServerContext,
+                    g_usFileNotFoundCode,
+                    g_szFileNotFoundReason,
+                    g_szFileNotAccessibleMessage);
+    }
 
     pIoResponse = AllocateHttpIoResponse(pServerContext);
 
     if (pIoResponse == NULL)
+    {
+        CloseHandle(hFile);
         return NULL;
-    
-    pIoResponse->HttpResponse.StatusCode = g_usOKCode;
-    pIoResponse->HttpResponse.pReason = g_szOKReason;
-    pIoResponse->HttpResponse.ReasonLength = (USHORT)strlen(g_szOKReason);
+    }
+
+    ullSize = ((ULONGLONG)FileInfo.nFileSizeHigh << 32) | FileInfo.nFileSizeLow;
+
+    FormatFileValidators(&FileInfo.ftLastWriteTime,
+                         ullSize,
+                         pIoResponse->szLastModified,
+                         sizeof(pIoResponse->szLastModified),
+                         pIoResponse->szETag,
+                         sizeof(pIoResponse->szETag));
+
+    Range = ParseRangeHeader(pHttpRequest,
+                             ullSize,
+                             pIoResponse->szLastModified,
+                             pIoResponse->szETag,
+                             &ullFirst,
+                             &ullLength);
+
+    if (Range == RangeNotSatisfiable)
+    {
+        CloseHandle(hFile);
+        CleanupHttpIoResponse(pIoResponse);
+        return CreateRangeNotSatisfiableResponse(pServerContext, ullSize);
+    }
+
+    SetFileResponseHeaders(pIoResponse,
+                           Range,
+                           ullFirst,
+                           ullLength,
+                           ullSize,
+                           GetContentType(pwszFilePath),
+                           pIoResponse->szLastModified,
+                           pIoResponse->szETag);
 
     pChunk = &pIoResponse->HttpResponse.pEntityChunks[0];
     pChunk->DataChunkType = HttpDataChunkFromFileHandle;
-    pChunk->FromFileHandle.ByteRange.Length.QuadPart = HTTP_BYTE_RANGE_TO_EOF;
-    pChunk->FromFileHandle.ByteRange.StartingOffset.QuadPart = 0;
+    pChunk->FromFileHandle.ByteRange.Length.QuadPart = 
+        (Range == RangePartial) ? ullLength : HTTP_BYTE_RANGE_TO_EOF;
+    pChunk->FromFileHandle.ByteRange.StartingOffset.QuadPart = ullFirst;
     pChunk->FromFileHandle.FileHandle = hFile;
 
     return pIoResponse;
@@ -178,47 +461,81 @@ PHTTP_IO_RESPONSE CreateFileResponse(
 //
 // Routine Description:
 //
-//     Creates an http response if the requested file was not found.
+//     Creates a response for a successful get, the content is served
+//     from the response cache. The headers were built when the file was
+//     cached, only Content-Range is built for each response.
 // 
 // Arguments:
 // 
 //     pServerContext - Pointer to the http server context structure.
 //
-//     code - The error code to use in the response
+//     pCacheEntry - The cache entry for the file. The response takes over
+//                   the caller's reference.
 //
-//     pReason - The reason string to send back to the client
+//     pHttpRequest - The request, for its Range header.
 //
-//     pMessage - The more verbose message to send back to the client
-// 
 // Return Value:
 // 
-//     Return a pointer to the HTTP_IO_RESPONSE structure
+//     Return a pointer to the HTTP_IO_RESPONSE structure.
 //
 
-PHTTP_IO_RESPONSE CreateMessageResponse(
-                                        PSERVER_CONTEXT pServerContext,
-                                        USHORT code,
-                                        PCHAR pReason,
-                                        PCHAR pMessage
-                                        )
+PHTTP_IO_RESPONSE CreateCachedFileResponse(
+                                           PSERVER_CONTEXT pServerContext, 
+                                           PCACHE_ENTRY pCacheEntry,
+                                           PHTTP_REQUEST pHttpRequest
+                                           )
 {
     PHTTP_IO_RESPONSE pIoResponse;
     PHTTP_DATA_CHUNK pChunk;
+    RANGE_RESULT Range;
+    ULONGLONG ullSize;
+    ULONGLONG ullFirst;
+    ULONGLONG ullLength;
+
+    ullSize = pCacheEntry->ullSize;
+
+    Range = ParseRangeHeader(pHttpRequest,
+                             ullSize,
+                             pCacheEntry->szLastModified,
+                             pCacheEntry->szETag,
+                             &ullFirst,
+                             &ullLength);
+
+    if (Range == RangeNotSatisfiable)
+    {
+        ReleaseCacheEntry(pCacheEntry);
+        return CreateRangeNotSatisfiableResponse(pServerContext, ullSize);
+    }
 
     pIoResponse = AllocateHttpIoResponse(pServerContext);
 
     if (pIoResponse == NULL)
+    {
+        ReleaseCacheEntry(pCacheEntry);
         return NULL;
+    }
 
-    // Can not find the requested file
-    pIoResponse->HttpResponse.StatusCode = code;
-    pIoResponse->HttpResponse.pReason = pReason;
-    pIoResponse->HttpResponse.ReasonLength = (USHORT)strlen(pReason);
+    pIoResponse->pCacheEntry = pCacheEntry;
+
+    SetFileResponseHeaders(pIoResponse,
+                           Range,
+                           ullFirst,
+                           ullLength,
+                           ullSize,
+                           pCacheEntry->pszContentType,
+                           pCacheEntry->szLastModified,
+                           pCacheEntry->szETag);
+
+    if (ullLength == 0)
+    {
+        pIoResponse->HttpResponse.EntityChunkCount = 0;
+        return pIoResponse;
+    }
 
     pChunk = &pIoResponse->HttpResponse.pEntityChunks[0];
     pChunk->DataChunkType = HttpDataChunkFromMemory;
-    pChunk->FromMemory.pBuffer = pMessage;
-    pChunk->FromMemory.BufferLength = (ULONG)strlen(pMessage);
+    pChunk->FromMemory.pBuffer = (PUCHAR)pCacheEntry->pView + ullFirst;
+    pChunk->FromMemory.BufferLength = (ULONG)ullLength;
 
     return pIoResponse;
 }
@@ -253,17 +570,21 @@ VOID ProcessReceiveAndPostResponse(
     ULONG Result;
     HANDLE hFile;
     HTTP_CACHE_POLICY CachePolicy;
+    PHTTP_CACHE_POLICY pCachePolicy;
     PHTTP_IO_RESPONSE pIoResponse;
     PSERVER_CONTEXT pServerContext;
 
     pServerContext = pIoRequest->ioContext.pServerContext;
     hFile = INVALID_HANDLE_VALUE;
+    pCachePolicy = NULL;
 
     switch(IoResult){
         case NO_ERROR:
         {
             WCHAR wszFilePath[MAX_STR_SIZE];       
             BOOL bValidUrl; 
+            WIN32_FILE_ATTRIBUTE_DATA FileData;
+            PCACHE_ENTRY pCacheEntry;
   
             if (pIoRequest->pHttpRequest->Verb != HttpVerbGET){
                 pIoResponse = CreateMessageResponse(
@@ -289,41 +610,77 @@ VOID ProcessReceiveAndPostResponse(
                                 g_szBadPathMessage);
                 break;
             }
-        
-            hFile = CreateFileW(
-                wszFilePath, 
-                GENERIC_READ,
-                FILE_SHARE_READ,
-                NULL,
-                OPEN_EXISTING,
-                FILE_ATTRIBUTE_NORMAL, 
-                NULL);
-    
-            if (hFile == INVALID_HANDLE_VALUE)
+
+            //
+            // Files that are small enough are sent from the response cache,
+            // which only reads a file again after it has been written to.
+            //
+            pCacheEntry = NULL;
+
+            if (GetFileAttributesExW(wszFilePath, GetFileExInfoStandard, &FileData) &&
+                (FileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            {
+                pCacheEntry = GetCacheEntry(&pServerContext->Cache, wszFilePath, &FileData);
+            }
+
+            if (pCacheEntry != NULL)
+            {
+                pIoResponse = CreateCachedFileResponse(
+                                pServerContext,
+                                pCacheEntry,
+                                pIoRequest->pHttpRequest);
+            }
+            else
             {
-                if (GetLastError() == ERROR_PATH_NOT_FOUND || 
-                    GetLastError() == ERROR_FILE_NOT_FOUND)
+                hFile = CreateFileW(
+                    wszFilePath, 
+                    GENERIC_READ,
+                    FILE_SHARE_READ,
+                    NULL,
+                    OPEN_EXISTING,
+                    FILE_ATTRIBUTE_NORMAL, 
+                    NULL);
+    
+                if (hFile == INVALID_HANDLE_VALUE)
                 {
+                    if (GetLastError() == ERROR_PATH_NOT_FOUND || 
+                        GetLastError() == ERROR_FILE_NOT_FOUND)
+                    {
+                        pIoResponse = CreateMessageResponse(
+                                        pServerContext,
+                                        g_usFileNotFoundCode,
+                                        g_szFileNotFoundReason,
+                                        g_szFileNotFoundMessage);
+                        break;
+                    }
+
                     pIoResponse = CreateMessageResponse(
                                     pServerContext,
                                     g_usFileNotFoundCode,
                                     g_szFileNotFoundReason,
-                                    g_szFileNotFoundMessage);
+                                    g_szFileNotAccessibleMessage);
                     break;
                 }
-
-                pIoResponse = CreateMessageResponse(
+        
+                pIoResponse = CreateFileResponse(
                                 pServerContext,
-                                g_usFileNotFoundCode,
-                                g_szFileNotFoundReason,
-                                g_szFileNotAccessibleMessage);
-                break;
+                                hFile,
+                                wszFilePath,
+                                pIoRequest->pHttpRequest);
             }
-        
-            pIoResponse = CreateFileResponse(pServerContext, hFile);
 
-            CachePolicy.Policy = HttpCachePolicyUserInvalidates;
-            CachePolicy.SecondsToLive = 0;
+            //
+            // Let HTTP.sys answer repeat requests for the whole file from its
+            // own cache for a few seconds. After that the request comes back
+            // here and the file time is checked again.
+            //
+            if (pIoResponse != NULL && 
+                pIoResponse->HttpResponse.StatusCode == g_usOKCode)
+            {
+                CachePolicy.Policy = HttpCachePolicyTimeToLive;
+                CachePolicy.SecondsToLive = KERNEL_CACHE_SECONDS;
+                pCachePolicy = &CachePolicy;
+            }
             break;
         }
         case ERROR_MORE_DATA:
@@ -354,7 +711,7 @@ VOID ProcessReceiveAndPostResponse(
         pIoRequest->pHttpRequest->RequestId,
         0,
         &pIoResponse->HttpResponse,
-        (hFile != INVALID_HANDLE_VALUE) ? &CachePolicy : NULL,
+        pCachePolicy,
         NULL,
         NULL,
         0,
@@ -119,7 +119,8 @@ PHTTP_IO_RESPONSE AllocateHttpIoResponse(
 // Routine Description:
 // 
 //     Cleans the structure associated with the specific response.
-//     Releases this structure, and decrements the I/O counter.
+//     Releases this structure, its file handle or cache entry, and 
+//     decrements the I/O counter.
 // 
 // Arguments:
 // 
@@ -152,6 +153,12 @@ VOID CleanupHttpIoResponse(
         }
     }
 
+    if (pIoResponse->pCacheEntry != NULL)
+    {
+        ReleaseCacheEntry(pIoResponse->pCacheEntry);
+        pIoResponse->pCacheEntry = NULL;
+    }
+
     FREE(pIoResponse);
 }
 
@@ -280,10 +287,10 @@ VOID CALLBACK IoCompletionCallback(
 //
 // Routine Description:
 // 
-//     Initializes the Url and server directory using command line parameters,
-//     accesses the HTTP Server API driver, creates a server session, creates 
-//     a Url Group under the specified server session, adds the specified Url to 
-//     the Url Group.
+//     Initializes the response cache, the Url and server directory using 
+//     command line parameters, accesses the HTTP Server API driver, creates a 
+//     server session, creates a Url Group under the specified server session,
+//     adds the specified Url to the Url Group.
 //
 //
 // Arguments:
@@ -310,6 +317,8 @@ BOOL InitializeHttpServer(
     ULONG ulResult;
     HRESULT hResult;
 
+    InitializeCache(&pServerContext->Cache);
+
     hResult = StringCbCopyW(
                 pServerContext->wszRootDirectory, 
                 MAX_STR_SIZE, 
@@ -607,7 +616,8 @@ VOID UninitializeServerIo(
 // Routine Description:
 //
 //     Closes the Url Group, deletes the server session 
-//     cleans up resources used by the HTTP Server API.
+//     cleans up resources used by the HTTP Server API, and empties the
+//     response cache.
 //
 //
 // Arguments:
@@ -640,6 +650,8 @@ VOID UninitializeHttpServer(
         HttpTerminate(HTTP_INITIALIZE_SERVER, NULL);
         pServerContext->bHttpInit = FALSE;
     }
+
+    UninitializeCache(&pServerContext->Cache);
 }
 
 //
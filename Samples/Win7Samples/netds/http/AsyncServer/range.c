@@ -0,0 +1,202 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+
+#include <ctype.h>
+#include <limits.h>
+#include <string.h>
+
+#include "range.h"
+
+//
+// Routine Description:
+//
+//     Reads a decimal number from a Range header value.
+//
+// Arguments:
+//
+//     ppsz - The position to read from. Moved past the digits that were read.
+//
+//     pullValue - Receives the number.
+//
+// Return Value:
+//
+//     0 if there are no digits or the number is too large.
+//
+
+static int ParseRangeNumber(
+                            const char **ppsz,
+                            unsigned long long *pullValue
+                            )
+{
+    const char *psz = *ppsz;
+    unsigned long long ullValue = 0;
+
+    if (*psz < '0' || *psz > '9')
+        return 0;
+
+    for (; *psz >= '0' && *psz <= '9'; ++psz)
+    {
+        if (ullValue > (ULLONG_MAX - (*psz - '0')) / 10)
+            return 0;
+
+        ullValue = ullValue * 10 + (*psz - '0');
+    }
+
+    *ppsz = psz;
+    *pullValue = ullValue;
+
+    return 1;
+}
+
+//
+// Routine Description:
+//
+//     Tells whether a header value, which need not be null terminated, is
+//     exactly the given string.
+//
+
+static int HeaderEquals(
+                        const char *pValue,
+                        size_t cchValue,
+                        const char *psz
+                        )
+{
+    return cchValue == strlen(psz) && strncmp(pValue, psz, cchValue) == 0;
+}
+
+//
+// Routine Description:
+//
+//     Works out which part of a file to send from the Range and If-Range
+//     headers of a request. Only a single range is supported, for any
+//     other Range header the whole file is sent, which HTTP allows.
+//
+// Arguments:
+//
+//     pRange, cchRange - The Range header value, not null terminated.
+//                        cchRange is 0 if the request has none.
+//
+//     pIfRange, cchIfRange - The If-Range header value, the same way.
+//
+//     ullSize - The size of the file.
+//
+//     pszLastModified - The Last-Modified value of the file.
+//
+//     pszETag - The ETag value of the file.
+//
+//     pullFirst - Receives the offset of the first byte to send.
+//
+//     pullLength - Receives the number of bytes to send.
+//
+// Return Value:
+//
+//     What to send. *pullFirst and *pullLength cover the whole file unless
+//     RangePartial is returned.
+//
+
+RANGE_RESULT ParseRange(
+                        const char *pRange,
+                        size_t cchRange,
+                        const char *pIfRange,
+                        size_t cchIfRange,
+                        unsigned long long ullSize,
+                        const char *pszLastModified,
+                        const char *pszETag,
+                        unsigned long long *pullFirst,
+                        unsigned long long *pullLength
+                        )
+{
+    static const char szBytes[] = "bytes=";
+    char szRange[64];
+    const char *psz;
+    unsigned long long ullFirst;
+    unsigned long long ullLast;
+    size_t i;
+
+    *pullFirst = 0;
+    *pullLength = ullSize;
+
+    if (cchRange == 0 || cchRange >= sizeof(szRange))
+        return RangeNone;
+
+    // If-Range: only send part of the file if it has not changed.
+    if (cchIfRange != 0 &&
+        !HeaderEquals(pIfRange, cchIfRange, pszETag) &&
+        !HeaderEquals(pIfRange, cchIfRange, pszLastModified))
+        return RangeNone;
+
+    memcpy(szRange, pRange, cchRange);
+    szRange[cchRange] = '\0';
+
+    psz = szRange;
+    while (*psz == ' ')
+        ++psz;
+
+    // The unit is not case sensitive.
+    for (i = 0; i < sizeof(szBytes) - 1; ++i)
+    {
+        if (tolower((unsigned char)psz[i]) != szBytes[i])
+            return RangeNone;
+    }
+
+    if (strchr(psz, ',') != NULL)
+        return RangeNone;
+
+    psz += sizeof(szBytes) - 1;
+    while (*psz == ' ')
+        ++psz;
+
+    if (*psz == '-')
+    {
+        // "bytes=-N" is the last N bytes of the file.
+        ++psz;
+        if (!ParseRangeNumber(&psz, &ullLast))
+            return RangeNone;
+
+        while (*psz == ' ')
+            ++psz;
+        if (*psz != '\0')
+            return RangeNone;
+
+        if (ullLast == 0 || ullSize == 0)
+            return RangeNotSatisfiable;
+
+        if (ullLast > ullSize)
+            ullLast = ullSize;
+
+        *pullFirst = ullSize - ullLast;
+        *pullLength = ullLast;
+
+        return RangePartial;
+    }
+
+    // "bytes=F-L" or "bytes=F-", which runs to the end of the file.
+    if (!ParseRangeNumber(&psz, &ullFirst) || *psz != '-')
+        return RangeNone;
+
+    ++psz;
+    ullLast = ULLONG_MAX;
+    if (*psz >= '0' && *psz <= '9' && !ParseRangeNumber(&psz, &ullLast))
+        return RangeNone;
+
+    while (*psz == ' ')
+        ++psz;
+    if (*psz != '\0' || ullLast < ullFirst)
+        return RangeNone;
+
+    if (ullFirst >= ullSize)
+        return RangeNotSatisfiable;
+
+    if (ullLast >= ullSize)
+        ullLast = ullSize - 1;
+
+    *pullFirst = ullFirst;
+    *pullLength = ullLast - ullFirst + 1;
+
+    return RangePartial;
+}
@@ -0,0 +1,46 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved
+
+#ifndef __RANGE__
+#define __RANGE__
+
+//
+// The Range header parser uses only the C library, not Windows or the
+// HTTP API, so it can be built and checked on its own (see the Test
+// directory).
+//
+
+#include <stddef.h>
+
+//
+// What the Range header of a request asks for
+//
+
+typedef enum _RANGE_RESULT
+{
+    // No Range header, or one we do not use: send the whole file
+    RangeNone,
+    // Send one range of the file
+    RangePartial,
+    // The range starts past the end of the file
+    RangeNotSatisfiable
+} RANGE_RESULT;
+
+RANGE_RESULT ParseRange(
+                        const char *pRange,
+                        size_t cchRange,
+                        const char *pIfRange,
+                        size_t cchIfRange,
+                        unsigned long long ullSize,
+                        const char *pszLastModified,
+                        const char *pszETag,
+                        unsigned long long *pullFirst,
+                        unsigned long long *pullLength
+                        );
+
+#endif
@@ -0,0 +1,117 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (C) Microsoft Corporation.  All Rights Reserved.
+//
+// Module:
+//      benchsocket.h
+//
+// Abstract:
+//      The few socket calls iocpbench makes, for Winsock and for BSD sockets,
+//      so that the benchmark also runs on systems without Winsock.
+//
+
+#ifndef BENCHSOCKET_H
+#define BENCHSOCKET_H
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+	#define WIN32_LEAN_AND_MEAN
+#endif
+
+#ifndef _WIN32_WINNT
+	#define _WIN32_WINNT 0x0600		// WSAPoll
+#endif
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "ws2_32")
+
+#define SHUT_WR		SD_SEND
+#define SHUT_RDWR	SD_BOTH
+
+inline int SocketError() { return WSAGetLastError(); }
+
+inline bool SocketStartup() {
+	WSADATA WSAData;
+	return WSAStartup(MAKEWORD(2,2), &WSAData) == 0;
+}
+
+inline void SocketCleanup() { WSACleanup(); }
+
+inline int PollSockets(struct pollfd *pfds, unsigned long nfds, int nTimeout) {
+	return WSAPoll(pfds, nfds, nTimeout);
+}
+
+#else
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+typedef int SOCKET;
+
+#define INVALID_SOCKET	(-1)
+#define SOCKET_ERROR	(-1)
+
+inline int closesocket(SOCKET s) { return close(s); }
+inline int SocketError() { return errno; }
+inline bool SocketStartup() { return true; }
+inline void SocketCleanup() { }
+
+inline int PollSockets(struct pollfd *pfds, unsigned long nfds, int nTimeout) {
+	return poll(pfds, nfds, nTimeout);
+}
+
+#endif
+
+//
+// Abstract:
+//     Send or receive exactly cb bytes.  Returns false if the socket failed or
+//     was closed first.
+//
+inline bool SendAll(SOCKET sd, const char *buf, int cb) {
+
+	while( cb > 0 ) {
+		int nSend = send(sd, buf, cb, 0);
+		if( nSend <= 0 )
+			return(false);
+		buf += nSend;
+		cb -= nSend;
+	}
+	return(true);
+}
+
+inline bool RecvAll(SOCKET sd, char *buf, int cb) {
+
+	while( cb > 0 ) {
+		int nRecv = recv(sd, buf, cb, 0);
+		if( nRecv <= 0 )
+			return(false);
+		buf += nRecv;
+		cb -= nRecv;
+	}
+	return(true);
+}
+
+//
+// Abstract:
+//     Turn off the Nagle algorithm, so that small echoes go out right away.
+//
+inline void SetNoDelay(SOCKET sd) {
+
+	int nOne = 1;
+	setsockopt(sd, IPPROTO_TCP, TCP_NODELAY, (const char *)&nOne, sizeof(nOne));
+}
+
+#endif
@@ -0,0 +1,544 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (C) Microsoft Corporation.  All Rights Reserved.
+//
+// Module:
+//      iocpbench.cpp
+//
+// Abstract:
+//      Use the -? commandline switch to determine available options.
+//
+//      A load generator for iocpserver and iocpserverex.  By default it
+//      measures how fast the server goes through connections (connection
+//      churn).  Each thread connects, sends one buffer, waits for the echo,
+//      closes the connection and starts over, for a given time.  At the end it
+//      prints the connections completed per second and the time each one took
+//      (connect, echo and close), at the median, the 99th percentile and the
+//      maximum.
+//
+//      With -m:echo it measures echo throughput and latency on connections
+//      that stay open instead.  Each thread opens -c connections and keeps one
+//      buffer in flight on each: as soon as the echo is back, it sends the next.
+//      At the end it prints the messages echoed per second, the bytes per second
+//      and the round trip times.
+//
+//      A connection is closed gracefully: the client shuts down its side, waits
+//      for the server to close, then closes the socket.  This is the path where
+//      iocpserverex hands the socket to DisconnectEx and reuses it.  The client
+//      side of each connection is left in TIME_WAIT, and on Windows that uses up
+//      the ephemeral ports after a few tens of thousands of connections; -a
+//      closes with a reset instead, which leaves no TIME_WAIT behind (the server
+//      then sees the connection drop rather than close).
+//
+//      With -l, iocpbench starts its own echo server on the loopback interface
+//      (see loopbackserver.h) and runs against that.  This does not measure
+//      iocpserverex, but gives the client side and the system's own loopback
+//      cost, to compare against, and lets the benchmark run on systems
+//      where iocpserverex does not.  -l:uring starts iocpserverex's worker loop
+//      on io_uring instead (Linux only, see uringserver.h), which submits each
+//      batch of sends and receives with one system call; -l:uring1 submits
+//      them one at a time, as iocpserverex has to, for comparison.
+//
+//  Usage:
+//      Start iocpserverex on port 6001, then churn through connections to it
+//      with 8 threads for 10 seconds
+//          iocpserverex -e:6001 -s
+//          iocpbench -e:6001 -t:8 -d:10
+//
+//      Churn against the loopback stand-in
+//          iocpbench -l -t:8 -d:10
+//
+//      Echo on 256 connections (4 threads with 64 each) against the io_uring
+//      stand-in, with batched and then with unbatched submission
+//          iocpbench -m:echo -t:4 -c:64 -l:uring
+//          iocpbench -m:echo -t:4 -c:64 -l:uring1
+//
+//  Build:
+//      Windows: cl /EHsc /O2 IocpBench.cpp LoopbackServer.cpp UringServer.cpp ws2_32.lib
+//      Linux and other systems with gcc or clang: make (see Makefile)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "BenchSocket.h"
+#include "LoopbackServer.h"
+#include "UringServer.h"
+
+#define MAXTHREADS		256
+#define MAXCONNECTIONS	1024	// per thread, with -m:echo
+
+//
+// The echo server -l starts, if any.
+//
+typedef enum _LOOPBACK_SERVER {
+	LoopbackNone,
+	LoopbackThreads,		// thread per connection
+	LoopbackUring,			// io_uring, batched submission
+	LoopbackUringUnbatched	// io_uring, one system call per I/O
+} LOOPBACK_SERVER;
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct _OPTIONS {
+	char szHostname[64];
+	char szPort[16];
+	int nTotalThreads;
+	int nBufSize;
+	double dSeconds;
+	bool bAbortive;
+	bool bEcho;
+	int nConnections;
+	LOOPBACK_SERVER Loopback;
+} OPTIONS;
+
+//
+// What one thread measured.  aulMicroseconds holds the time each connection took,
+// or with -m:echo, each round trip.
+//
+typedef struct _THREAD_RESULT {
+	std::vector<unsigned long> aulMicroseconds;
+	unsigned long ulFailures;
+} THREAD_RESULT;
+
+static OPTIONS g_Options = {"localhost", "5001", 4, 64, 5.0, false, false, 1, LoopbackNone};
+static std::atomic<bool> g_bStop(false);
+
+static bool ValidOptions(char *argv[], int argc);
+static void Usage(char *szProgramname, OPTIONS *pOptions);
+static void ChurnThread(struct addrinfo *addr_srv, THREAD_RESULT *pResult);
+static bool Churn(struct addrinfo *addr_srv, char *outbuf, char *inbuf);
+static void EchoThread(struct addrinfo *addr_srv, THREAD_RESULT *pResult);
+static void PrintResults(std::vector<THREAD_RESULT> &Results, double dElapsed);
+
+int main(int argc, char *argv[]) {
+
+	struct addrinfo hints;
+	struct addrinfo *addr_srv = NULL;
+	unsigned short usPort = 0;
+
+	if( !ValidOptions(argv, argc) )
+		return(1);
+
+	if( !SocketStartup() ) {
+		printf("WSAStartup() failed\n");
+		return(1);
+	}
+
+	if( g_Options.Loopback != LoopbackNone ) {
+
+		if( g_Options.Loopback == LoopbackThreads ) {
+
+			//
+			// One server thread per client connection, plus one to accept the next
+			// connection while the previous one is being closed.
+			//
+			usPort = LoopbackServerStart(g_Options.nTotalThreads * (g_Options.bEcho ? g_Options.nConnections : 1) + 1);
+		} else {
+			usPort = UringServerStart(std::max((int)std::thread::hardware_concurrency(), 1),
+									  g_Options.Loopback == LoopbackUring);
+		}
+
+		if( usPort == 0 ) {
+			SocketCleanup();
+			return(1);
+		}
+		strcpy(g_Options.szHostname, "127.0.0.1");
+		sprintf(g_Options.szPort, "%u", usPort);
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	if( getaddrinfo(g_Options.szHostname, g_Options.szPort, &hints, &addr_srv) != 0 || addr_srv == NULL ) {
+		printf("getaddrinfo() failed to resolve %s: %d\n", g_Options.szHostname, SocketError());
+		LoopbackServerStop();
+		UringServerStop();
+		SocketCleanup();
+		return(1);
+	}
+
+	if( g_Options.bEcho )
+		printf("%s:%s, echo, %d threads with %d connections each, %d byte buffers, %.1f seconds\n",
+			   g_Options.szHostname, g_Options.szPort, g_Options.nTotalThreads, g_Options.nConnections,
+			   g_Options.nBufSize, g_Options.dSeconds);
+	else
+		printf("%s:%s, churn, %d threads, %d byte buffers, %s close, %.1f seconds\n",
+			   g_Options.szHostname, g_Options.szPort, g_Options.nTotalThreads, g_Options.nBufSize,
+			   g_Options.bAbortive ? "abortive" : "graceful", g_Options.dSeconds);
+
+	std::vector<THREAD_RESULT> Results(g_Options.nTotalThreads);
+	std::vector<std::thread> Threads;
+
+	Clock::time_point start = Clock::now();
+
+	for( int i = 0; i < g_Options.nTotalThreads; i++ )
+		Threads.push_back(std::thread(g_Options.bEcho ? EchoThread : ChurnThread, addr_srv, &Results[i]));
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(g_Options.dSeconds));
+	g_bStop = true;
+
+	for( size_t i = 0; i < Threads.size(); i++ )
+		Threads[i].join();
+
+	double dElapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+	PrintResults(Results, dElapsed);
+
+	freeaddrinfo(addr_srv);
+	LoopbackServerStop();
+	UringServerStop();
+	SocketCleanup();
+
+	return(0);
+}
+
+//
+// Abstract:
+//     Open, use and close connections until the time is up, timing each one.
+//
+static void ChurnThread(struct addrinfo *addr_srv, THREAD_RESULT *pResult) {
+
+	std::vector<char> outbuf(g_Options.nBufSize);
+	std::vector<char> inbuf(g_Options.nBufSize);
+
+	for( int i = 0; i < g_Options.nBufSize; i++ )
+		outbuf[i] = (char)i;
+
+	pResult->ulFailures = 0;
+	pResult->aulMicroseconds.reserve(1 << 16);
+
+	while( !g_bStop ) {
+		Clock::time_point start = Clock::now();
+
+		if( Churn(addr_srv, &outbuf[0], &inbuf[0]) )
+			pResult->aulMicroseconds.push_back((unsigned long)
+				std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+		else {
+
+			//
+			// Do not spin on a server that is refusing connections.
+			//
+			pResult->ulFailures++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+//
+// Abstract:
+//     Connect, send one buffer, check the echo, and close.  Returns false if any
+//     step failed.
+//
+static bool Churn(struct addrinfo *addr_srv, char *outbuf, char *inbuf) {
+
+	bool bRet = false;
+	SOCKET sd = socket(addr_srv->ai_family, addr_srv->ai_socktype, addr_srv->ai_protocol);
+
+	if( sd == INVALID_SOCKET )
+		return(false);
+
+	SetNoDelay(sd);
+
+	if( connect(sd, addr_srv->ai_addr, (int)addr_srv->ai_addrlen) != SOCKET_ERROR &&
+		SendAll(sd, outbuf, g_Options.nBufSize) &&
+		RecvAll(sd, inbuf, g_Options.nBufSize) &&
+		memcmp(inbuf, outbuf, g_Options.nBufSize) == 0 ) {
+
+		if( g_Options.bAbortive ) {
+			struct linger lingerStruct;
+
+			lingerStruct.l_onoff = 1;
+			lingerStruct.l_linger = 0;
+			setsockopt(sd, SOL_SOCKET, SO_LINGER, (char *)&lingerStruct, sizeof(lingerStruct));
+			bRet = true;
+		} else {
+
+			//
+			// Wait for the server to close its end after ours.
+			//
+			shutdown(sd, SHUT_WR);
+			bRet = (recv(sd, inbuf, 1, 0) == 0);
+		}
+	}
+
+	closesocket(sd);
+	return(bRet);
+}
+
+//
+// One connection of an echo thread, with the buffer it is waiting to get back.
+//
+typedef struct _ECHO_CONNECTION {
+	SOCKET sd;
+	int nRecvd;
+	Clock::time_point start;
+	std::vector<char> inbuf;
+} ECHO_CONNECTION;
+
+//
+// Abstract:
+//     Open -c connections and keep a buffer in flight on each until the time is
+//     up, timing each round trip.  A connection that fails is counted and closed,
+//     and the thread goes on with the others.
+//
+static void EchoThread(struct addrinfo *addr_srv, THREAD_RESULT *pResult) {
+
+	std::vector<char> outbuf(g_Options.nBufSize);
+	std::vector<ECHO_CONNECTION> Conns;
+	std::vector<struct pollfd> Fds;
+
+	for( int i = 0; i < g_Options.nBufSize; i++ )
+		outbuf[i] = (char)i;
+
+	pResult->ulFailures = 0;
+	pResult->aulMicroseconds.reserve(1 << 20);
+
+	for( int i = 0; i < g_Options.nConnections; i++ ) {
+		ECHO_CONNECTION Conn;
+		struct pollfd Fd;
+
+		Conn.sd = socket(addr_srv->ai_family, addr_srv->ai_socktype, addr_srv->ai_protocol);
+		if( Conn.sd == INVALID_SOCKET ) {
+			pResult->ulFailures++;
+			continue;
+		}
+
+		SetNoDelay(Conn.sd);
+
+		if( connect(Conn.sd, addr_srv->ai_addr, (int)addr_srv->ai_addrlen) == SOCKET_ERROR ) {
+			pResult->ulFailures++;
+			closesocket(Conn.sd);
+			continue;
+		}
+
+		Conn.nRecvd = 0;
+		Conn.inbuf.resize(g_Options.nBufSize);
+		Fd.fd = Conn.sd;
+		Fd.events = POLLIN;
+		Fd.revents = 0;
+		Conns.push_back(Conn);
+		Fds.push_back(Fd);
+	}
+
+	for( size_t i = 0; i < Conns.size(); i++ ) {
+		Conns[i].start = Clock::now();
+		SendAll(Conns[i].sd, &outbuf[0], g_Options.nBufSize);
+	}
+
+	while( !g_bStop && !Conns.empty() ) {
+		int nReady = PollSockets(&Fds[0], (unsigned long)Fds.size(), 100);
+		if( nReady == SOCKET_ERROR )
+			break;
+
+		for( size_t i = 0; i < Conns.size() && nReady > 0; i++ ) {
+			ECHO_CONNECTION &Conn = Conns[i];
+
+			if( Fds[i].revents == 0 )
+				continue;
+			nReady--;
+
+			int nRecv = recv(Conn.sd, &Conn.inbuf[Conn.nRecvd], g_Options.nBufSize - Conn.nRecvd, 0);
+			if( nRecv > 0 ) {
+				Conn.nRecvd += nRecv;
+				if( Conn.nRecvd < g_Options.nBufSize )
+					continue;
+
+				if( memcmp(&Conn.inbuf[0], &outbuf[0], g_Options.nBufSize) == 0 ) {
+					Clock::time_point now = Clock::now();
+
+					pResult->aulMicroseconds.push_back((unsigned long)
+						std::chrono::duration_cast<std::chrono::microseconds>(now - Conn.start).count());
+					Conn.nRecvd = 0;
+					Conn.start = now;
+					if( SendAll(Conn.sd, &outbuf[0], g_Options.nBufSize) )
+						continue;
+				}
+			}
+
+			//
+			// Drop the connection: move the last one into its place, and look at
+			// that one next.
+			//
+			pResult->ulFailures++;
+			closesocket(Conn.sd);
+			std::swap(Conns[i], Conns.back());
+			std::swap(Fds[i], Fds.back());
+			Conns.pop_back();
+			Fds.pop_back();
+			i--;
+		}
+	}
+
+	for( size_t i = 0; i < Conns.size(); i++ )
+		closesocket(Conns[i].sd);
+}
+
+//
+// Abstract:
+//     Print connections or messages per second and the percentiles of the
+//     connection or round trip times.
+//
+static void PrintResults(std::vector<THREAD_RESULT> &Results, double dElapsed) {
+
+	std::vector<unsigned long> aulAll;
+	unsigned long ulFailures = 0;
+
+	for( size_t i = 0; i < Results.size(); i++ ) {
+		aulAll.insert(aulAll.end(), Results[i].aulMicroseconds.begin(), Results[i].aulMicroseconds.end());
+		ulFailures += Results[i].ulFailures;
+	}
+
+	if( g_Options.bEcho )
+		printf("%lu messages in %.2f seconds: %.0f messages/s, %.1f MB/s echoed, %lu connections failed\n",
+			   (unsigned long)aulAll.size(), dElapsed, aulAll.size() / dElapsed,
+			   (double)aulAll.size() * g_Options.nBufSize / dElapsed / 1e6, ulFailures);
+	else
+		printf("%lu connections in %.2f seconds: %.0f connections/s, %lu failed\n",
+			   (unsigned long)aulAll.size(), dElapsed, aulAll.size() / dElapsed, ulFailures);
+
+	if( aulAll.empty() )
+		return;
+
+	std::sort(aulAll.begin(), aulAll.end());
+	printf("%s: median %lu us, p99 %lu us, max %lu us\n", g_Options.bEcho ? "round trip" : "connection time",
+		   aulAll[aulAll.size() / 2], aulAll[aulAll.size() * 99 / 100], aulAll.back());
+}
+
+//
+// Abstract:
+//      Verify options passed in and set options structure accordingly.
+//
+static bool ValidOptions(char *argv[], int argc) {
+
+	for( int i = 1; i < argc; i++ ) {
+		if( (argv[i][0] == '-') || (argv[i][0] == '/') ) {
+			switch( argv[i][1] ) {
+			case 'n':
+			case 'N':
+				if( strlen(argv[i]) > 3 ) {
+					strncpy(g_Options.szHostname, &argv[i][3], sizeof(g_Options.szHostname) - 1);
+					g_Options.szHostname[sizeof(g_Options.szHostname) - 1] = '\0';
+				}
+				break;
+
+			case 'e':
+			case 'E':
+				if( strlen(argv[i]) > 3 ) {
+					strncpy(g_Options.szPort, &argv[i][3], sizeof(g_Options.szPort) - 1);
+					g_Options.szPort[sizeof(g_Options.szPort) - 1] = '\0';
+				}
+				break;
+
+			case 't':
+			case 'T':
+				if( strlen(argv[i]) > 3 )
+					g_Options.nTotalThreads = std::min(std::max(atoi(&argv[i][3]), 1), MAXTHREADS);
+				break;
+
+			case 'b':
+			case 'B':
+				if( strlen(argv[i]) > 3 )
+					g_Options.nBufSize = std::min(std::max(atoi(&argv[i][3]), 1), 8192);
+				break;
+
+			case 'd':
+			case 'D':
+				if( strlen(argv[i]) > 3 )
+					g_Options.dSeconds = atof(&argv[i][3]);
+				if( g_Options.dSeconds <= 0 ) {
+					Usage(argv[0], &g_Options);
+					return(false);
+				}
+				break;
+
+			case 'a':
+			case 'A':
+				g_Options.bAbortive = true;
+				break;
+
+			case 'm':
+			case 'M':
+				if( strlen(argv[i]) > 3 && strcmp(&argv[i][3], "echo") == 0 )
+					g_Options.bEcho = true;
+				else if( strlen(argv[i]) > 3 && strcmp(&argv[i][3], "churn") == 0 )
+					g_Options.bEcho = false;
+				else {
+					Usage(argv[0], &g_Options);
+					return(false);
+				}
+				break;
+
+			case 'c':
+			case 'C':
+				if( strlen(argv[i]) > 3 )
+					g_Options.nConnections = std::min(std::max(atoi(&argv[i][3]), 1), MAXCONNECTIONS);
+				break;
+
+			case 'l':
+			case 'L':
+				if( strlen(argv[i]) <= 3 )
+					g_Options.Loopback = LoopbackThreads;
+				else if( strcmp(&argv[i][3], "uring") == 0 )
+					g_Options.Loopback = LoopbackUring;
+				else if( strcmp(&argv[i][3], "uring1") == 0 )
+					g_Options.Loopback = LoopbackUringUnbatched;
+				else {
+					Usage(argv[0], &g_Options);
+					return(false);
+				}
+				break;
+
+			case '?':
+				Usage(argv[0], &g_Options);
+				return(false);
+
+			default:
+				printf("  unknown options flag %s\n", argv[i]);
+				Usage(argv[0], &g_Options);
+				return(false);
+			}
+		} else {
+			printf("  unknown option %s\n", argv[i]);
+			Usage(argv[0], &g_Options);
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+//
+// Abstract:
+//      Print out usage table for the program
+//
+static void Usage(char *szProgramname, OPTIONS *pOptions) {
+
+	printf("usage:\n%s [-n:host] [-e:port] [-m:churn|echo] [-t:#] [-c:#] [-b:#] [-d:#] [-a] [-l[:uring|:uring1]] [-?]\n",
+		   szProgramname);
+	printf("  -n:host\tserver to connect to (default %s)\n", pOptions->szHostname);
+	printf("  -e:port\tport the server is listening on (default %s)\n", pOptions->szPort);
+	printf("  -m:churn\topen, use and close connections (default)\n");
+	printf("  -m:echo\techo buffers on connections that stay open\n");
+	printf("  -t:#\t\tnumber of threads (default %d, max %d)\n", pOptions->nTotalThreads, MAXTHREADS);
+	printf("  -c:#\t\tconnections for each thread with -m:echo (default %d, max %d)\n",
+		   pOptions->nConnections, MAXCONNECTIONS);
+	printf("  -b:#\t\tbytes sent and echoed on each connection (default %d, max 8192)\n", pOptions->nBufSize);
+	printf("  -d:#\t\tseconds to run (default %.0f)\n", pOptions->dSeconds);
+	printf("  -a\t\tclose connections with a reset, leaving no TIME_WAIT\n");
+	printf("  -l\t\trun against an echo server on the loopback interface started by iocpbench\n");
+	printf("  -l:uring\tthe same with iocpserverex's worker loop on io_uring (Linux only)\n");
+	printf("  -l:uring1\tthe same with one io_uring_enter call for each send and receive\n");
+	printf("  -?\t\tdisplay this help\n");
+}
@@ -0,0 +1,103 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (C) Microsoft Corporation.  All Rights Reserved.
+//
+// Module:
+//      loopbackserver.cpp
+//
+// Abstract:
+//      Thread-per-connection echo server that stands in for iocpserverex.  See
+//      loopbackserver.h.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "BenchSocket.h"
+#include "LoopbackServer.h"
+
+#define ECHO_BUFF_SIZE	8192	// same as MAX_BUFF_SIZE in iocpserverex
+
+static SOCKET g_sdListen = INVALID_SOCKET;
+static std::vector<std::thread> g_Threads;
+
+//
+// Abstract:
+//     Accept a connection, echo everything received on it until the client
+//     closes it, then close it and accept the next one.  Returns when the
+//     listening socket is closed.
+//
+static void EchoThread() {
+
+	char buf[ECHO_BUFF_SIZE];
+
+	while( true ) {
+		SOCKET sd = accept(g_sdListen, NULL, NULL);
+		if( sd == INVALID_SOCKET )
+			break;
+
+		SetNoDelay(sd);
+
+		int nRecv;
+		while( (nRecv = recv(sd, buf, sizeof(buf), 0)) > 0 ) {
+			if( !SendAll(sd, buf, nRecv) )
+				break;
+		}
+
+		closesocket(sd);
+	}
+}
+
+unsigned short LoopbackServerStart(int nThreads) {
+
+	struct sockaddr_in addr;
+	socklen_t cbAddr = sizeof(addr);
+
+	g_sdListen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if( g_sdListen == INVALID_SOCKET ) {
+		printf("socket() failed: %d\n", SocketError());
+		return(0);
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+
+	if( bind(g_sdListen, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR ||
+		listen(g_sdListen, SOMAXCONN) == SOCKET_ERROR ||
+		getsockname(g_sdListen, (struct sockaddr *)&addr, &cbAddr) == SOCKET_ERROR ) {
+		printf("loopback server failed to listen: %d\n", SocketError());
+		closesocket(g_sdListen);
+		g_sdListen = INVALID_SOCKET;
+		return(0);
+	}
+
+	for( int i = 0; i < nThreads; i++ )
+		g_Threads.push_back(std::thread(EchoThread));
+
+	return(ntohs(addr.sin_port));
+}
+
+void LoopbackServerStop() {
+
+	if( g_sdListen == INVALID_SOCKET )
+		return;
+
+	//
+	// On Linux, only shutdown wakes up the threads blocked in accept.
+	//
+	shutdown(g_sdListen, SHUT_RDWR);
+	closesocket(g_sdListen);
+
+	for( size_t i = 0; i < g_Threads.size(); i++ )
+		g_Threads[i].join();
+	g_Threads.clear();
+
+	g_sdListen = INVALID_SOCKET;
+}
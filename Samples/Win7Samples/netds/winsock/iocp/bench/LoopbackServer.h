@@ -0,0 +1,40 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (C) Microsoft Corporation.  All Rights Reserved.
+//
+// Module:
+//      loopbackserver.h
+//
+// Abstract:
+//      An echo server on the loopback interface, started inside iocpbench (-l)
+//      to stand in for iocpserverex where that can not run, such as on a Linux
+//      build machine.  It behaves like iocpserverex as a client sees it: data
+//      sent on a connection is echoed back, and the server closes its end when
+//      the client closes.
+//
+//      Each of its threads blocks in accept on the listening socket, then echoes
+//      on the connection it accepted until the client closes it.  There must be
+//      at least as many threads as connections open at the same time.
+//
+
+#ifndef LOOPBACKSERVER_H
+#define LOOPBACKSERVER_H
+
+//
+// Start the server with nThreads threads on 127.0.0.1, on a port the system
+// picks.  Returns the port, or 0 if the server could not be started.
+//
+unsigned short LoopbackServerStart(
+    int nThreads
+    );
+
+//
+// Stop the server.  Every client connection must be closed first.
+//
+void LoopbackServerStop(
+    );
+
+#endif
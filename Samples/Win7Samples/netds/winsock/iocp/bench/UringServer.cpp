@@ -0,0 +1,708 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (C) Microsoft Corporation.  All Rights Reserved.
+//
+// Module:
+//      uringserver.cpp
+//
+// Abstract:
+//      The completion port and connection functions of iocpecho.h on io_uring,
+//      so that iocpserverex's worker loop and state machine (serverex\iocpecho.cpp)
+//      run as an echo server that stands in for iocpserverex.  See uringserver.h.
+//
+//      There is no liburing dependency: the ring is set up and driven with the
+//      io_uring_setup and io_uring_enter system calls from <linux/io_uring.h>.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "BenchSocket.h"
+#include "UringServer.h"
+
+#if defined(__linux__)
+
+#include <stdarg.h>
+#include <time.h>
+#include <thread>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "IocpEcho.h"
+
+#define URING_SQ_ENTRIES		256
+#define URING_CQ_ENTRIES		4096	// one I/O outstanding per connection
+
+//
+// The rings the kernel shares with the process.  sqTail and ulQueued are the
+// process's own: submission entries filled in but not yet handed to the kernel.
+//
+typedef struct _URING {
+	int fd;
+	void *pSqRing;
+	void *pCqRing;
+	size_t cbSqRing;
+	size_t cbCqRing;
+	struct io_uring_sqe *pSqes;
+	size_t cbSqes;
+	unsigned *psqHead;
+	unsigned *psqTail;
+	unsigned sqMask;
+	unsigned sqEntries;
+	unsigned *pcqHead;
+	unsigned *pcqTail;
+	unsigned cqMask;
+	struct io_uring_cqe *pCqes;
+	unsigned sqTail;
+	unsigned ulQueued;
+} URING;
+
+typedef struct _URING_STATS {
+	unsigned long long ullEnterCalls;	// io_uring_enter calls, to submit or to wait
+	unsigned long long ullSubmitted;	// I/Os submitted
+} URING_STATS;
+
+//
+// A worker thread and its ring, which is the HANDLE the completion port
+// functions are given.  Each connection has at most one I/O outstanding, and
+// the ring hands its PER_SOCKET_CONTEXT back as the completion's user data.
+//
+typedef struct _URING_WORKER {
+	URING Ring;
+	PER_SOCKET_CONTEXT ListenContext;
+	PER_IO_CONTEXT ListenIOContext;
+	unsigned long long ullExitValue;	// read from g_fdExit
+	int nInFlight;						// I/Os on connections and the listening socket
+	std::vector<PPER_SOCKET_CONTEXT> Contexts;		// every connection context, in use or free
+	std::vector<PPER_SOCKET_CONTEXT> FreeContexts;
+	IO_STATS Stats;
+	URING_STATS RingStats;
+	std::thread Thread;
+} URING_WORKER;
+
+//
+// iocpecho.cpp's switches.  This server has no -v or -s, and each worker takes
+// its own exit packet, so nothing needs g_bEndServer.
+//
+BOOL g_bEndServer = FALSE;
+BOOL g_bVerbose = FALSE;
+BOOL g_bStats = FALSE;
+
+static std::vector<URING_WORKER *> g_Workers;
+static thread_local URING_WORKER *t_pWorker = NULL;	// the worker running on this thread
+static int g_fdExit = -1;		// semaphore eventfd: each count wakes one worker
+static bool g_bBatchSubmit = true;
+
+//
+// Ring setup.
+//
+
+static bool UringCreate(URING *pRing) {
+
+	struct io_uring_params params;
+
+	memset(pRing, 0, sizeof(*pRing));
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = URING_CQ_ENTRIES;
+
+	pRing->fd = (int)syscall(__NR_io_uring_setup, URING_SQ_ENTRIES, &params);
+	if( pRing->fd < 0 ) {
+		printf("io_uring_setup() failed: %d\n", errno);
+		return(false);
+	}
+
+	pRing->cbSqRing = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	pRing->cbCqRing = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+		if( pRing->cbCqRing > pRing->cbSqRing )
+			pRing->cbSqRing = pRing->cbCqRing;
+		pRing->cbCqRing = 0;
+	}
+
+	pRing->pSqRing = mmap(NULL, pRing->cbSqRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+						  pRing->fd, IORING_OFF_SQ_RING);
+	if( pRing->pSqRing == MAP_FAILED ) {
+		printf("mmap() of the submission ring failed: %d\n", errno);
+		close(pRing->fd);
+		return(false);
+	}
+
+	pRing->pCqRing = pRing->pSqRing;
+	if( pRing->cbCqRing ) {
+		pRing->pCqRing = mmap(NULL, pRing->cbCqRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+							  pRing->fd, IORING_OFF_CQ_RING);
+		if( pRing->pCqRing == MAP_FAILED ) {
+			printf("mmap() of the completion ring failed: %d\n", errno);
+			munmap(pRing->pSqRing, pRing->cbSqRing);
+			close(pRing->fd);
+			return(false);
+		}
+	}
+
+	pRing->cbSqes = params.sq_entries * sizeof(struct io_uring_sqe);
+	pRing->pSqes = (struct io_uring_sqe *)mmap(NULL, pRing->cbSqes, PROT_READ | PROT_WRITE,
+											   MAP_SHARED | MAP_POPULATE, pRing->fd, IORING_OFF_SQES);
+	if( pRing->pSqes == MAP_FAILED ) {
+		printf("mmap() of the submission entries failed: %d\n", errno);
+		if( pRing->cbCqRing )
+			munmap(pRing->pCqRing, pRing->cbCqRing);
+		munmap(pRing->pSqRing, pRing->cbSqRing);
+		close(pRing->fd);
+		return(false);
+	}
+
+	char *pSq = (char *)pRing->pSqRing;
+	char *pCq = (char *)pRing->pCqRing;
+
+	pRing->psqHead = (unsigned *)(pSq + params.sq_off.head);
+	pRing->psqTail = (unsigned *)(pSq + params.sq_off.tail);
+	pRing->sqMask = *(unsigned *)(pSq + params.sq_off.ring_mask);
+	pRing->sqEntries = params.sq_entries;
+	pRing->pcqHead = (unsigned *)(pCq + params.cq_off.head);
+	pRing->pcqTail = (unsigned *)(pCq + params.cq_off.tail);
+	pRing->cqMask = *(unsigned *)(pCq + params.cq_off.ring_mask);
+	pRing->pCqes = (struct io_uring_cqe *)(pCq + params.cq_off.cqes);
+	pRing->sqTail = *pRing->psqTail;
+
+	//
+	// Submission entry i always goes in slot i.
+	//
+	unsigned *pArray = (unsigned *)(pSq + params.sq_off.array);
+	for( unsigned i = 0; i < params.sq_entries; i++ )
+		pArray[i] = i;
+
+	return(true);
+}
+
+static void UringFree(URING *pRing) {
+
+	munmap(pRing->pSqes, pRing->cbSqes);
+	if( pRing->cbCqRing )
+		munmap(pRing->pCqRing, pRing->cbCqRing);
+	munmap(pRing->pSqRing, pRing->cbSqRing);
+	close(pRing->fd);
+}
+
+//
+//  Hand the queued I/Os to the kernel and, with bWait, wait for at least one
+//  completion in the same call.  Returns false if the ring failed.
+//
+static bool UringEnter(URING_WORKER *pWorker, bool bWait) {
+
+	URING *pRing = &pWorker->Ring;
+
+	__atomic_store_n(pRing->psqTail, pRing->sqTail, __ATOMIC_RELEASE);
+
+	while( true ) {
+		int nRet = (int)syscall(__NR_io_uring_enter, pRing->fd, pRing->ulQueued, bWait ? 1 : 0,
+								bWait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		pWorker->RingStats.ullEnterCalls++;
+
+		if( nRet < 0 ) {
+			if( errno == EINTR )
+				continue;
+			printf("io_uring_enter() failed: %d\n", errno);
+			return(false);
+		}
+
+		pRing->ulQueued -= nRet;
+		pWorker->RingStats.ullSubmitted += nRet;
+
+		//
+		// The kernel stops at an entry it can not start and posts its failure as
+		// a completion; submit the rest after it.
+		//
+		if( pRing->ulQueued == 0 || nRet == 0 )
+			return(true);
+	}
+}
+
+//
+//  Fill in the next submission entry.  Entries are only handed to the kernel by
+//  UringEnter, unless the ring is full.
+//
+static struct io_uring_sqe *UringGetSqe(URING_WORKER *pWorker) {
+
+	URING *pRing = &pWorker->Ring;
+	struct io_uring_sqe *pSqe = NULL;
+
+	if( pRing->sqTail - __atomic_load_n(pRing->psqHead, __ATOMIC_ACQUIRE) >= pRing->sqEntries ) {
+		if( !UringEnter(pWorker, false) )
+			return(NULL);
+	}
+
+	pSqe = &pRing->pSqes[pRing->sqTail & pRing->sqMask];
+	memset(pSqe, 0, sizeof(*pSqe));
+	pRing->sqTail++;
+	pRing->ulQueued++;
+	return(pSqe);
+}
+
+//
+//  Queue the socket's next I/O, which its IOOperation says.  With batched
+//  submission it goes to the kernel with the next wait for completions, 
+//  otherwise it is submitted right away, as an IOCP would need.  Returns false
+//  if it could not be queued.
+//
+static bool UringQueueIo(URING_WORKER *pWorker, PPER_SOCKET_CONTEXT lpPerSocketContext,
+						 char *pBuffer, ULONG cbBuffer) {
+
+	struct io_uring_sqe *pSqe = UringGetSqe(pWorker);
+
+	if( pSqe == NULL )
+		return(false);
+
+	pSqe->fd = lpPerSocketContext->Socket;
+	pSqe->user_data = (unsigned long long)lpPerSocketContext;
+
+	switch( lpPerSocketContext->pIOContext->IOOperation ) {
+	case ClientIoAccept:
+		pSqe->opcode = IORING_OP_ACCEPT;
+		pSqe->ioprio = IORING_ACCEPT_MULTISHOT;
+		break;
+
+	case ClientIoRead:
+		pSqe->opcode = IORING_OP_RECV;
+		pSqe->addr = (unsigned long long)pBuffer;
+		pSqe->len = cbBuffer;
+		break;
+
+	case ClientIoWrite:
+		pSqe->opcode = IORING_OP_SEND;
+		pSqe->addr = (unsigned long long)pBuffer;
+		pSqe->len = cbBuffer;
+		pSqe->msg_flags = MSG_NOSIGNAL;
+		break;
+
+	case ClientIoDisconnect:
+		pSqe->opcode = IORING_OP_CLOSE;
+		break;
+	}
+
+	pWorker->nInFlight++;
+
+	if( !g_bBatchSubmit )
+		return(UringEnter(pWorker, false));
+	return(true);
+}
+
+static void QueueExitRead(URING_WORKER *pWorker) {
+
+	struct io_uring_sqe *pSqe = UringGetSqe(pWorker);
+
+	if( pSqe == NULL )
+		return;
+
+	pSqe->opcode = IORING_OP_READ;
+	pSqe->fd = g_fdExit;
+	pSqe->addr = (unsigned long long)&pWorker->ullExitValue;
+	pSqe->len = sizeof(pWorker->ullExitValue);
+	pSqe->user_data = 0;
+}
+
+//
+// Completion port functions, with the same roles as in iocpserverex.
+//
+
+//
+//  Submit whatever is queued and dequeue up to ulMaxCount completions, waiting
+//  for one if there are none.  Returns the number dequeued, or 0 if the ring
+//  failed.  An exit packet is always returned on its own, so that the worker
+//  loop leaves the completions after it in the ring for WorkerDrain.
+//
+ULONG CompletionPortGet(HANDLE hIOCP, PIO_COMPLETION pCompletions, ULONG ulMaxCount) {
+
+	URING_WORKER *pWorker = (URING_WORKER *)hIOCP;
+	URING *pRing = &pWorker->Ring;
+	unsigned cqHead = *pRing->pcqHead;
+	unsigned cqTail = __atomic_load_n(pRing->pcqTail, __ATOMIC_ACQUIRE);
+	ULONG ulCount = 0;
+
+	if( ulMaxCount > MAX_COMPLETION_BATCH )
+		ulMaxCount = MAX_COMPLETION_BATCH;
+
+	if( pRing->ulQueued || cqHead == cqTail ) {
+		if( !UringEnter(pWorker, cqHead == cqTail) )
+			return(0);
+		cqTail = __atomic_load_n(pRing->pcqTail, __ATOMIC_ACQUIRE);
+	}
+
+	while( cqHead != cqTail && ulCount < ulMaxCount ) {
+		struct io_uring_cqe *pCqe = &pRing->pCqes[cqHead & pRing->cqMask];
+		PPER_SOCKET_CONTEXT lpPerSocketContext = (PPER_SOCKET_CONTEXT)pCqe->user_data;
+		PIO_COMPLETION pCompletion = &pCompletions[ulCount];
+
+		if( lpPerSocketContext == NULL && ulCount > 0 )
+			break;
+
+		pCompletion->lpPerSocketContext = lpPerSocketContext;
+		pCompletion->lpIOContext = lpPerSocketContext ? lpPerSocketContext->pIOContext : NULL;
+		pCompletion->nResult = pCqe->res;
+		pCompletion->uFlags = pCqe->flags;
+		pCompletion->bSuccess = (pCqe->res >= 0);
+		pCompletion->dwIoSize = (pCqe->res > 0) ? pCqe->res : 0;
+
+		if( lpPerSocketContext && !(pCqe->flags & IORING_CQE_F_MORE) )
+			pWorker->nInFlight--;
+
+		ulCount++;
+		cqHead++;
+
+		if( lpPerSocketContext == NULL )
+			break;
+	}
+
+	__atomic_store_n(pRing->pcqHead, cqHead, __ATOMIC_RELEASE);
+	return(ulCount);
+}
+
+//
+//  Queue dwCount exit packets, one for each worker thread that should exit.
+//  Each worker keeps a read of g_fdExit outstanding, with no context.
+//
+VOID CompletionPortPostExit(HANDLE hIOCP, DWORD dwCount) {
+
+	unsigned long long ullCount = dwCount;
+
+	(void)hIOCP;
+	if( write(g_fdExit, &ullCount, sizeof(ullCount)) != sizeof(ullCount) )
+		printf("write() to the exit event failed: %d\n", errno);
+}
+
+//
+//  Queue the sends and receives in pBatch on the worker's ring.  They go to the
+//  kernel with the io_uring_enter call in the next CompletionPortGet, in one
+//  system call with the wait.  Returns how many could not be queued.
+//
+ULONG CompletionPortSubmit(HANDLE hIOCP, PIO_SUBMIT_BATCH pBatch) {
+
+	URING_WORKER *pWorker = (URING_WORKER *)hIOCP;
+	ULONG ulFailed = 0;
+
+	for( ULONG i = 0; i < pBatch->ulCount; i++ ) {
+		PIO_SUBMISSION pEntry = &pBatch->Entries[i];
+
+		pEntry->bSuccess = UringQueueIo(pWorker, pEntry->lpPerSocketContext,
+										pEntry->wsabuf.buf, pEntry->wsabuf.len);
+		if( !pEntry->bSuccess )
+			ulFailed++;
+	}
+
+	return(ulFailed);
+}
+
+//
+// Connection contexts, reused rather than freed.  A connection's I/O all goes
+// through the ring of the worker that accepted it, so only that worker's
+// thread ever uses its context.
+//
+
+static PPER_SOCKET_CONTEXT CtxtAllocate(URING_WORKER *pWorker, SOCKET sd) {
+
+	PPER_SOCKET_CONTEXT lpPerSocketContext = NULL;
+
+	if( pWorker->FreeContexts.empty() ) {
+		lpPerSocketContext = new PER_SOCKET_CONTEXT;
+		memset(lpPerSocketContext, 0, sizeof(*lpPerSocketContext));
+		lpPerSocketContext->pIOContext = new PER_IO_CONTEXT;
+		pWorker->Contexts.push_back(lpPerSocketContext);
+	} else {
+		lpPerSocketContext = pWorker->FreeContexts.back();
+		pWorker->FreeContexts.pop_back();
+	}
+
+	lpPerSocketContext->Socket = sd;
+	lpPerSocketContext->pIOContext->IOOperation = ClientIoAccept;
+	lpPerSocketContext->pIOContext->nTotalBytes = 0;
+	lpPerSocketContext->pIOContext->nSentBytes = 0;
+	lpPerSocketContext->pIOContext->SocketAccept = INVALID_SOCKET;
+	lpPerSocketContext->pIOContext->pAcceptContext = NULL;
+	lpPerSocketContext->pIOContext->pIOContextForward = NULL;
+	return(lpPerSocketContext);
+}
+
+static void CtxtRelease(URING_WORKER *pWorker, PPER_SOCKET_CONTEXT lpPerSocketContext) {
+
+	lpPerSocketContext->Socket = INVALID_SOCKET;
+	pWorker->FreeContexts.push_back(lpPerSocketContext);
+}
+
+//
+//  A connection the multishot accept on the worker's listening socket brought.
+//  The accept stays armed until a completion without IORING_CQE_F_MORE; then
+//  another is posted in its place.  Kernels before 5.19 reject it.
+//
+BOOL AcceptCompleted(PIO_COMPLETION pCompletion, PPER_SOCKET_CONTEXT *ppAcceptSocketContext) {
+
+	URING_WORKER *pWorker = t_pWorker;
+
+	*ppAcceptSocketContext = NULL;
+
+	if( pCompletion->nResult == -EINVAL ) {
+		printf("multishot accept failed; io_uring server needs Linux 5.19 or later\n");
+		return(TRUE);
+	}
+
+	if( !(pCompletion->uFlags & IORING_CQE_F_MORE) )
+		UringQueueIo(pWorker, pCompletion->lpPerSocketContext, NULL, 0);
+
+	if( pCompletion->nResult < 0 )
+		return(TRUE);
+
+	//
+	// The accepted socket has TCP_NODELAY from the listening socket.  No data
+	// comes with it, so the state machine starts with a receive.
+	//
+	*ppAcceptSocketContext = CtxtAllocate(pWorker, pCompletion->nResult);
+	return(TRUE);
+}
+
+//
+//  The socket's IORING_OP_CLOSE has completed.
+//
+VOID DisconnectCompleted(PPER_SOCKET_CONTEXT lpPerSocketContext, BOOL bSuccess) {
+
+	(void)bSuccess;
+	CtxtRelease(t_pWorker, lpPerSocketContext);
+}
+
+//
+//  Close a connection with no I/O outstanding.  A graceful close goes through the
+//  ring like any other I/O; otherwise the socket is reset and closed right away.
+//
+VOID CloseClient(PPER_SOCKET_CONTEXT lpPerSocketContext, BOOL bGraceful) {
+
+	URING_WORKER *pWorker = t_pWorker;
+	SOCKET sd = lpPerSocketContext->Socket;
+
+	if( bGraceful ) {
+		lpPerSocketContext->pIOContext->IOOperation = ClientIoDisconnect;
+		if( UringQueueIo(pWorker, lpPerSocketContext, NULL, 0) ) {
+			lpPerSocketContext->Socket = INVALID_SOCKET;
+			return;
+		}
+	} else {
+		struct linger lingerStruct;
+
+		lingerStruct.l_onoff = 1;
+		lingerStruct.l_linger = 0;
+		setsockopt(sd, SOL_SOCKET, SO_LINGER, &lingerStruct, sizeof(lingerStruct));
+	}
+
+	closesocket(sd);
+	CtxtRelease(pWorker, lpPerSocketContext);
+}
+
+ULONGLONG StatsMicroseconds() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return((ULONGLONG)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+DWORD GetCurrentThreadId() {
+
+	return((DWORD)syscall(SYS_gettid));
+}
+
+int myprintf(const char *lpFormat, ...) {
+
+	va_list arglist;
+	int nLen = 0;
+
+	va_start(arglist, lpFormat);
+	nLen = vprintf(lpFormat, arglist);
+	va_end(arglist);
+	return(nLen);
+}
+
+//
+//  Cancel the I/O still outstanding and wait for all of it to complete, so no
+//  context is freed while the kernel may still use its buffer.  Connections are
+//  closed by WorkerFree; only sockets accepted since the exit packet are closed
+//  here.
+//
+static void WorkerDrain(URING_WORKER *pWorker) {
+
+	IO_COMPLETION Completions[MAX_COMPLETION_BATCH];
+	struct io_uring_sqe *pSqe = UringGetSqe(pWorker);
+
+	if( pSqe ) {
+		pSqe->opcode = IORING_OP_ASYNC_CANCEL;
+		pSqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+		pSqe->user_data = 0;
+	}
+
+	while( pWorker->nInFlight > 0 ) {
+		ULONG ulCount = CompletionPortGet((HANDLE)pWorker, Completions, MAX_COMPLETION_BATCH);
+		if( ulCount == 0 )
+			break;
+
+		for( ULONG i = 0; i < ulCount; i++ ) {
+			if( Completions[i].lpIOContext && Completions[i].lpIOContext->IOOperation == ClientIoAccept &&
+				Completions[i].nResult >= 0 )
+				closesocket(Completions[i].nResult);
+		}
+	}
+}
+
+static void WorkerThread(URING_WORKER *pWorker) {
+
+	t_pWorker = pWorker;
+
+	QueueExitRead(pWorker);
+	UringQueueIo(pWorker, &pWorker->ListenContext, NULL, 0);
+
+	WorkerLoop((HANDLE)pWorker, MAX_COMPLETION_BATCH, &pWorker->Stats);
+
+	WorkerDrain(pWorker);
+}
+
+static void WorkerFree(URING_WORKER *pWorker) {
+
+	for( size_t i = 0; i < pWorker->Contexts.size(); i++ ) {
+		if( pWorker->Contexts[i]->Socket != INVALID_SOCKET )
+			closesocket(pWorker->Contexts[i]->Socket);
+		delete pWorker->Contexts[i]->pIOContext;
+		delete pWorker->Contexts[i];
+	}
+
+	if( pWorker->ListenContext.Socket != INVALID_SOCKET )
+		closesocket(pWorker->ListenContext.Socket);
+	UringFree(&pWorker->Ring);
+	delete pWorker;
+}
+
+//
+//  Open a listening socket on 127.0.0.1 that shares usPort (0 for any) with the
+//  other workers'.  Returns the port, or 0 if it failed.
+//
+static unsigned short ListenReusePort(SOCKET *psd, unsigned short usPort) {
+
+	struct sockaddr_in addr;
+	socklen_t cbAddr = sizeof(addr);
+	int nOne = 1;
+	SOCKET sd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	*psd = INVALID_SOCKET;
+	if( sd == INVALID_SOCKET ) {
+		printf("socket() failed: %d\n", SocketError());
+		return(0);
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(usPort);
+
+	SetNoDelay(sd);
+
+	if( setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, &nOne, sizeof(nOne)) == SOCKET_ERROR ||
+		bind(sd, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR ||
+		listen(sd, SOMAXCONN) == SOCKET_ERROR ||
+		getsockname(sd, (struct sockaddr *)&addr, &cbAddr) == SOCKET_ERROR ) {
+		printf("io_uring server failed to listen: %d\n", SocketError());
+		closesocket(sd);
+		return(0);
+	}
+
+	*psd = sd;
+	return(ntohs(addr.sin_port));
+}
+
+unsigned short UringServerStart(int nThreads, bool bBatchSubmit) {
+
+	unsigned short usPort = 0;
+
+	g_bBatchSubmit = bBatchSubmit;
+
+	g_fdExit = eventfd(0, EFD_SEMAPHORE);
+	if( g_fdExit < 0 ) {
+		printf("eventfd() failed: %d\n", errno);
+		return(0);
+	}
+
+	for( int i = 0; i < nThreads; i++ ) {
+		URING_WORKER *pWorker = new URING_WORKER;
+
+		pWorker->nInFlight = 0;
+		pWorker->ullExitValue = 0;
+		memset(&pWorker->Stats, 0, sizeof(pWorker->Stats));
+		memset(&pWorker->RingStats, 0, sizeof(pWorker->RingStats));
+		memset(&pWorker->ListenContext, 0, sizeof(pWorker->ListenContext));
+		memset(&pWorker->ListenIOContext, 0, sizeof(pWorker->ListenIOContext));
+		pWorker->ListenContext.pIOContext = &pWorker->ListenIOContext;
+		pWorker->ListenIOContext.IOOperation = ClientIoAccept;
+
+		if( !UringCreate(&pWorker->Ring) ) {
+			delete pWorker;
+			UringServerStop();
+			return(0);
+		}
+
+		usPort = ListenReusePort(&pWorker->ListenContext.Socket, usPort);
+		g_Workers.push_back(pWorker);
+		if( usPort == 0 ) {
+			UringServerStop();
+			return(0);
+		}
+	}
+
+	for( size_t i = 0; i < g_Workers.size(); i++ )
+		g_Workers[i]->Thread = std::thread(WorkerThread, g_Workers[i]);
+
+	return(usPort);
+}
+
+void UringServerStop() {
+
+	URING_STATS Stats;
+	unsigned long long ullMessages = 0;
+
+	if( g_fdExit < 0 )
+		return;
+
+	memset(&Stats, 0, sizeof(Stats));
+	CompletionPortPostExit(NULL, (DWORD)g_Workers.size());
+
+	for( size_t i = 0; i < g_Workers.size(); i++ ) {
+		if( g_Workers[i]->Thread.joinable() )
+			g_Workers[i]->Thread.join();
+
+		Stats.ullEnterCalls += g_Workers[i]->RingStats.ullEnterCalls;
+		Stats.ullSubmitted += g_Workers[i]->RingStats.ullSubmitted;
+		ullMessages += g_Workers[i]->Stats.ullMessages;
+		WorkerFree(g_Workers[i]);
+	}
+	g_Workers.clear();
+
+	close(g_fdExit);
+	g_fdExit = -1;
+
+	printf("io_uring server (%s submission): %llu messages, %llu I/Os submitted with %llu io_uring_enter calls\n",
+		   g_bBatchSubmit ? "batched" : "unbatched", ullMessages, Stats.ullSubmitted, Stats.ullEnterCalls);
+	if( ullMessages )
+		printf("%.2f system calls per message\n", (double)Stats.ullEnterCalls / ullMessages);
+}
+
+#else
+
+unsigned short UringServerStart(int nThreads, bool bBatchSubmit) {
+
+	printf("io_uring is only available on Linux\n");
+	return(0);
+}
+
+void UringServerStop() {
+}
+
+#endif
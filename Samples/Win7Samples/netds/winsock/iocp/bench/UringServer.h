@@ -0,0 +1,53 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (C) Microsoft Corporation.  All Rights Reserved.
+//
+// Module:
+//      uringserver.h
+//
+// Abstract:
+//      An echo server on the loopback interface built on io_uring, started
+//      inside iocpbench with -l:uring.  Linux 5.19 or later only; elsewhere
+//      UringServerStart fails.
+//
+//      It is iocpserverex's own worker loop and state machine, built from
+//      serverex\iocpecho.cpp, with io_uring under the completion port functions
+//      of iocpecho.h (CompletionPortGet, CompletionPortSubmit and
+//      CompletionPortPostExit) and the connection functions (AcceptCompleted,
+//      DisconnectCompleted and CloseClient).  Each worker thread dequeues a
+//      batch of completions, takes each connection to its next step with
+//      ProcessCompletion, and queues the send or receive that follows.  Where
+//      iocpserverex then needs one
+//      WSASend or WSARecv for each of them, here the whole batch goes to the
+//      kernel with the io_uring_enter call that waits for the next
+//      completions, so a busy worker makes one system call per batch.  With
+//      bBatchSubmit false each I/O is submitted with its own call instead, as
+//      on an IOCP, for comparison.
+//
+//      Each worker has its own ring and its own listening socket on the same
+//      port (SO_REUSEPORT), with one multishot accept outstanding on it.
+//
+
+#ifndef URINGSERVER_H
+#define URINGSERVER_H
+
+//
+// Start the server with nThreads worker threads on 127.0.0.1, on a port the
+// system picks.  Returns the port, or 0 if the server could not be started.
+//
+unsigned short UringServerStart(
+    int nThreads,
+    bool bBatchSubmit
+    );
+
+//
+// Stop the server and print the messages it echoed and the io_uring_enter
+// calls it made for them.
+//
+void UringServerStop(
+    );
+
+#endif
@@ -0,0 +1,316 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (C) Microsoft Corporation.  All Rights Reserved.
+//
+// Module:
+//      iocpecho.cpp
+//
+// Abstract:
+//      iocpserverex's worker loop and its accept/read/write state machine.
+//      Everything here goes through the completion port and connection
+//      functions in iocpecho.h, so the same source runs on an IOCP in
+//      iocpserverex and on io_uring in iocpbench (bench\uringserver.cpp).
+//
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+#endif
+
+#include "IocpEcho.h"
+
+//
+// Worker thread loop that handles all I/O completions on the completion port,
+// dequeuing up to ulBatchSize at a time, until it is sent an exit packet.
+//
+VOID WorkerLoop(HANDLE hIOCP, ULONG ulBatchSize, PIO_STATS pStats) {
+
+	IO_COMPLETION Completions[MAX_COMPLETION_BATCH];
+	IO_SUBMIT_BATCH Submissions;
+	ULONG ulCount = 0;
+	ULONG ulExits = 0;
+	BOOL bExit = FALSE;
+
+	Submissions.ulCount = 0;
+
+	while( !bExit ) {
+
+        //
+		// continually loop to service io completion packets
+		//
+		ulCount = CompletionPortGet(hIOCP, Completions, ulBatchSize);
+		pStats->ullDequeueCalls++;
+		pStats->ullCompletions += ulCount;
+		if( ulCount == 0 )
+			break;
+
+		//
+		// CTRL-C handler used CompletionPortPostExit to post an I/O packet with a
+		// NULL CompletionKey for each worker thread (or if we get one for any reason).
+		// One batch can hold several of them, anywhere in it, so count them all
+		// before doing anything else.
+		//
+		ulExits = 0;
+		for( ULONG i = 0; i < ulCount; i++ ) {
+			if( Completions[i].lpPerSocketContext == NULL )
+				ulExits++;
+		}
+
+		if( ulExits > 0 ) {
+
+			//
+			// Only one of the exit packets was for this thread; put the others back.
+			// main thread will do all cleanup needed - see finally block - so the
+			// rest of the batch is left alone.
+			//
+			if( ulExits > 1 )
+				CompletionPortPostExit(hIOCP, ulExits - 1);
+			break;
+		}
+
+		if( g_bEndServer ) {
+
+			//
+			// The server is stopping but this thread's exit packet has not come yet.
+			// Leave the completions to the cleanup and wait for it, so that each
+			// thread takes exactly one exit packet.
+			//
+			continue;
+		}
+
+		for( ULONG i = 0; i < ulCount && !bExit; i++ ) {
+			if( !ProcessCompletion(&Completions[i], &Submissions, pStats) )
+				bExit = TRUE;
+		}
+
+		//
+		// Post the sends and receives the batch of completions led to, and close the
+		// connections whose I/O could not be posted.  Once posted, an I/O may already
+		// be completing on another thread, so only the failed entries are touched.
+		//
+		if( Submissions.ulCount ) {
+			pStats->ullSubmitCalls++;
+			if( CompletionPortSubmit(hIOCP, &Submissions) ) {
+				for( ULONG i = 0; i < Submissions.ulCount; i++ ) {
+					if( !Submissions.Entries[i].bSuccess )
+						CloseClient(Submissions.Entries[i].lpPerSocketContext, FALSE);
+				}
+			}
+			Submissions.ulCount = 0;
+		}
+	} //while
+
+	return;
+}
+
+//
+//  Take the next step for the socket whose I/O has completed.  Returns FALSE if
+//  the server can not go on and the worker thread should exit.  The send or
+//  receive that follows is queued in pBatch rather than posted, and counted in
+//  pStats.  Accepts and disconnects are left to the server's AcceptCompleted
+//  and DisconnectCompleted.
+//
+BOOL ProcessCompletion(PIO_COMPLETION pCompletion, PIO_SUBMIT_BATCH pBatch, PIO_STATS pStats)	{
+
+	PPER_SOCKET_CONTEXT lpPerSocketContext = pCompletion->lpPerSocketContext;
+	PPER_SOCKET_CONTEXT lpAcceptSocketContext = NULL;
+	PPER_IO_CONTEXT lpIOContext = pCompletion->lpIOContext;
+	DWORD dwIoSize = pCompletion->dwIoSize;
+	BOOL bContinue = TRUE;
+
+	if( lpIOContext->IOOperation == ClientIoDisconnect ) {
+
+		//
+		// The disconnect is done with the socket, so it can be reused or freed.
+		//
+		DisconnectCompleted(lpPerSocketContext, pCompletion->bSuccess);
+		return(TRUE);
+	}
+
+    //
+	//We should never return without posting another accept if the current
+	//completion packet is for the previous one
+	//
+	if( lpIOContext->IOOperation != ClientIoAccept ) {
+		if( !pCompletion->bSuccess ) {
+
+			//
+			// client connection dropped, go on to service remaining (and possibly
+			// new) client connections
+			//
+			CloseClient(lpPerSocketContext, FALSE);
+			return(TRUE);
+		}
+
+		if( 0 == dwIoSize ) {
+
+			//
+			// client closed its end of the connection; the socket can be reused.
+			//
+			CloseClient(lpPerSocketContext, TRUE);
+			return(TRUE);
+		}
+	}
+
+    //
+	// determine what type of IO packet has completed by checking the PER_IO_CONTEXT
+	// associated with this socket.  This will determine what action to take.
+	//
+	switch( lpIOContext->IOOperation ) {
+	case ClientIoAccept:
+
+		bContinue = AcceptCompleted(pCompletion, &lpAcceptSocketContext);
+		if( lpAcceptSocketContext == NULL )
+			break;
+
+		lpIOContext = lpAcceptSocketContext->pIOContext;
+		dwIoSize = lpIOContext->nTotalBytes;
+
+		if( dwIoSize ) {
+
+			//
+			// The accept returned the first data from the client; echo it.
+			//
+			lpIOContext->IOOperation = ClientIoWrite;
+			lpIOContext->nSentBytes  = 0;
+
+			pStats->ullMessages++;
+			if( g_bStats )
+				lpIOContext->llRecvTime = StatsMicroseconds();
+
+			pStats->ullSendCalls++;
+			if( !CompletionPortQueue(pBatch, lpAcceptSocketContext, lpIOContext, lpIOContext->Buffer, dwIoSize) ) {
+				CloseClient(lpAcceptSocketContext, FALSE);
+			} else if( g_bVerbose ) {
+				myprintf("WorkerThread %d: Socket(%d) Accept completed (%d bytes), Send queued\n",
+					   GetCurrentThreadId(), lpAcceptSocketContext->Socket, dwIoSize);
+			}
+		} else {
+
+			//
+			// The accept completed but didn't read any data so we need to post
+			// an outstanding overlapped read.
+			//
+			lpIOContext->IOOperation = ClientIoRead;
+			pStats->ullRecvCalls++;
+			if( !CompletionPortQueue(pBatch, lpAcceptSocketContext, lpIOContext, lpIOContext->Buffer, MAX_BUFF_SIZE) )
+				CloseClient(lpAcceptSocketContext, FALSE);
+		}
+		break;
+
+
+	case ClientIoRead:
+
+        //
+		// a read operation has completed, post a write operation to echo the
+		// data back to the client using the same data buffer.
+		//
+		lpIOContext->IOOperation = ClientIoWrite;
+		lpIOContext->nTotalBytes = dwIoSize;
+		lpIOContext->nSentBytes  = 0;
+
+		pStats->ullMessages++;
+		if( g_bStats )
+			lpIOContext->llRecvTime = StatsMicroseconds();
+
+		pStats->ullSendCalls++;
+		if( !CompletionPortQueue(pBatch, lpPerSocketContext, lpIOContext, lpIOContext->Buffer, dwIoSize) ) {
+			CloseClient(lpPerSocketContext, FALSE);
+		} else if( g_bVerbose ) {
+			myprintf("WorkerThread %d: Socket(%d) Recv completed (%d bytes), Send queued\n",
+				   GetCurrentThreadId(), lpPerSocketContext->Socket, dwIoSize);
+		}
+		break;
+
+	case ClientIoWrite:
+
+		//
+		// a write operation has completed, determine if all the data intended to be
+		// sent actually was sent.
+		//
+		lpIOContext->IOOperation = ClientIoWrite;
+		lpIOContext->nSentBytes  += dwIoSize;
+		if( lpIOContext->nSentBytes < lpIOContext->nTotalBytes ) {
+
+			//
+			// the previous write operation didn't send all the data,
+			// post another send to complete the operation
+			//
+			pStats->ullSendCalls++;
+			if( !CompletionPortQueue(pBatch, lpPerSocketContext, lpIOContext,
+									 lpIOContext->Buffer + lpIOContext->nSentBytes,
+									 lpIOContext->nTotalBytes - lpIOContext->nSentBytes) ) {
+				CloseClient(lpPerSocketContext, FALSE);
+			} else if( g_bVerbose ) {
+				myprintf("WorkerThread %d: Socket(%d) Send partially completed (%d bytes), Send queued\n",
+					   GetCurrentThreadId(), lpPerSocketContext->Socket, dwIoSize);
+			}
+		} else {
+
+			//
+			// previous write operation completed for this socket, post another recv
+			//
+			if( g_bStats )
+				StatsRecordLatency(pStats, lpIOContext);
+
+			lpIOContext->IOOperation = ClientIoRead;
+			pStats->ullRecvCalls++;
+			if( !CompletionPortQueue(pBatch, lpPerSocketContext, lpIOContext, lpIOContext->Buffer, MAX_BUFF_SIZE) ) {
+				CloseClient(lpPerSocketContext, FALSE);
+			} else if( g_bVerbose ) {
+				myprintf("WorkerThread %d: Socket(%d) Send completed (%d bytes), Recv queued\n",
+					   GetCurrentThreadId(), lpPerSocketContext->Socket, dwIoSize);
+			}
+		}
+		break;
+
+	default:
+		break;
+	} //switch
+	return(bContinue);
+}
+
+//
+//  Add a send or receive on the socket to pBatch, to be posted by CompletionPortSubmit.
+//  lpIOContext->IOOperation must already say which it is.  Returns FALSE if the
+//  batch is full.
+//
+BOOL CompletionPortQueue(PIO_SUBMIT_BATCH pBatch, PPER_SOCKET_CONTEXT lpPerSocketContext,
+						 PPER_IO_CONTEXT lpIOContext, char *pBuffer, ULONG ulLength) {
+
+	PIO_SUBMISSION pEntry = NULL;
+
+	if( pBatch->ulCount >= MAX_COMPLETION_BATCH ) {
+		myprintf("CompletionPortQueue: batch full\n");
+		return(FALSE);
+	}
+
+	pEntry = &pBatch->Entries[pBatch->ulCount++];
+	pEntry->lpPerSocketContext = lpPerSocketContext;
+	pEntry->lpIOContext = lpIOContext;
+	pEntry->wsabuf.buf = pBuffer;
+	pEntry->wsabuf.len = ulLength;
+	pEntry->bSuccess = FALSE;
+	return(TRUE);
+}
+
+//
+//  Count the time since the data in lpIOContext was received in its latency bucket.
+//
+VOID StatsRecordLatency(PIO_STATS pStats, PPER_IO_CONTEXT lpIOContext) {
+
+	ULONGLONG ullMicroseconds;
+	int nBucket = 0;
+
+	ullMicroseconds = StatsMicroseconds() - (ULONGLONG)lpIOContext->llRecvTime;
+
+	while( nBucket < LATENCY_BUCKETS - 1 && (ullMicroseconds >> nBucket) != 0 )
+		nBucket++;
+	pStats->aullLatency[nBucket]++;
+
+	return;
+}
@@ -0,0 +1,247 @@
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (C) Microsoft Corporation.  All Rights Reserved.
+//
+// Module:
+//      iocpecho.h
+//
+// Abstract:
+//      The accept/read/write state machine of iocpserverex and the worker loop
+//      that drives it, written only against the completion port functions
+//      below.  iocpserverex implements them with an IOCP and Winsock; the
+//      bench directory's uringserver.cpp implements them with io_uring and
+//      builds iocpecho.cpp unchanged.
+//
+
+#ifndef IOCPECHO_H
+#define IOCPECHO_H
+
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <mswsock.h>
+
+#else
+
+//
+// The few Win32 types the state machine uses, for systems without them.
+//
+#include <stddef.h>
+
+typedef int                 BOOL;
+typedef unsigned int        DWORD;
+typedef unsigned int        ULONG;
+typedef long long           LONGLONG;
+typedef unsigned long long  ULONGLONG;
+typedef void                *HANDLE;
+typedef int                 SOCKET;
+
+#define VOID                void
+#define TRUE                1
+#define FALSE               0
+#define INVALID_SOCKET      (-1)
+
+typedef struct _WSABUF {
+    ULONG                       len;
+    char                        *buf;
+} WSABUF;
+
+DWORD GetCurrentThreadId(
+    void
+    );
+
+#endif
+
+#define MAX_BUFF_SIZE       8192
+#define MAX_COMPLETION_BATCH 64     // most completions a worker dequeues at once (-b)
+#define LATENCY_BUCKETS     32      // echo latency histogram buckets (-s)
+
+typedef enum _IO_OPERATION {
+    ClientIoAccept,
+    ClientIoRead,
+    ClientIoWrite,
+    ClientIoDisconnect
+} IO_OPERATION, *PIO_OPERATION;
+
+//
+// data to be associated for every I/O operation on a socket
+//
+typedef struct _PER_IO_CONTEXT {
+#ifdef _WIN32
+    WSAOVERLAPPED               Overlapped;
+#endif
+    char                        Buffer[MAX_BUFF_SIZE];
+    WSABUF                      wsabuf;
+    int                         nTotalBytes;
+    int                         nSentBytes;
+    IO_OPERATION                IOOperation;
+    SOCKET                      SocketAccept;
+    LONGLONG                    llRecvTime;     // when the data being echoed was received (-s)
+    LONGLONG                    llPostTime;     // when the AcceptEx was posted
+    struct _PER_SOCKET_CONTEXT  *pAcceptContext;    // context of a recycled SocketAccept, or NULL
+
+    struct _PER_IO_CONTEXT      *pIOContextForward;
+} PER_IO_CONTEXT, *PPER_IO_CONTEXT;
+
+//
+// For AcceptEx, the IOCP key is the PER_SOCKET_CONTEXT for the listening socket,
+// so we need to another field SocketAccept in PER_IO_CONTEXT. When the outstanding
+// AcceptEx completes, this field is our connection socket handle.  If the socket
+// is being reused after DisconnectEx, it is already on the IOCP and pAcceptContext
+// is the context it was added with.
+//
+
+//
+// data to be associated with every socket added to the IOCP
+//
+typedef struct _PER_SOCKET_CONTEXT {
+    SOCKET                      Socket;
+
+#ifdef _WIN32
+    LPFN_ACCEPTEX               fnAcceptEx;
+#endif
+
+	//
+    //linked list for all outstanding i/o on the socket
+	//
+    PPER_IO_CONTEXT             pIOContext;
+    struct _PER_SOCKET_CONTEXT  *pCtxtBack;
+    struct _PER_SOCKET_CONTEXT  *pCtxtForward;
+
+    int                         nShard;     // which context list this socket is on
+} PER_SOCKET_CONTEXT, *PPER_SOCKET_CONTEXT;
+
+//
+// one dequeued completion packet
+//
+typedef struct _IO_COMPLETION {
+    PPER_SOCKET_CONTEXT         lpPerSocketContext;     // completion key
+    PPER_IO_CONTEXT             lpIOContext;            // the overlapped I/O that completed
+    DWORD                       dwIoSize;
+    BOOL                        bSuccess;
+#ifndef _WIN32
+    int                         nResult;                // io_uring result: bytes, accepted socket, or -errno
+    unsigned                    uFlags;                 // io_uring completion flags
+#endif
+} IO_COMPLETION, *PIO_COMPLETION;
+
+//
+// a send or receive queued by ProcessCompletion, posted by CompletionPortSubmit once
+// the worker thread has been through all the completions it dequeued.  At most one
+// is queued for each completion, so a batch never holds more than MAX_COMPLETION_BATCH.
+//
+typedef struct _IO_SUBMISSION {
+    PPER_SOCKET_CONTEXT         lpPerSocketContext;
+    PPER_IO_CONTEXT             lpIOContext;            // IOOperation says whether to send or receive
+    WSABUF                      wsabuf;                 // data to send, or buffer to receive into
+    BOOL                        bSuccess;               // set by CompletionPortSubmit
+} IO_SUBMISSION, *PIO_SUBMISSION;
+
+typedef struct _IO_SUBMIT_BATCH {
+    ULONG                       ulCount;
+    IO_SUBMISSION               Entries[MAX_COMPLETION_BATCH];
+} IO_SUBMIT_BATCH, *PIO_SUBMIT_BATCH;
+
+//
+// I/O counts, kept by each worker thread and added together when it exits.
+// Bucket i of aullLatency counts echoes that took less than 2^i microseconds
+// from the receive completing to the last of the data being sent.
+//
+typedef struct _IO_STATS {
+    ULONGLONG                   ullDequeueCalls;        // GetQueuedCompletionStatus(Ex) calls
+    ULONGLONG                   ullCompletions;
+    ULONGLONG                   ullRecvCalls;
+    ULONGLONG                   ullSendCalls;
+    ULONGLONG                   ullMessages;            // buffers received and echoed
+    ULONGLONG                   ullSubmitCalls;         // CompletionPortSubmit calls
+    ULONGLONG                   aullLatency[LATENCY_BUCKETS];
+} IO_STATS, *PIO_STATS;
+
+extern BOOL g_bEndServer;
+extern BOOL g_bVerbose;
+extern BOOL g_bStats;
+
+//
+// Completion port functions, implemented by the server.  The worker threads only
+// see the completion port through these.
+//
+
+ULONG CompletionPortGet(
+    HANDLE hIOCP,
+    PIO_COMPLETION pCompletions,
+    ULONG ulMaxCount
+    );
+
+VOID CompletionPortPostExit(
+    HANDLE hIOCP,
+    DWORD dwCount
+    );
+
+ULONG CompletionPortSubmit(
+    HANDLE hIOCP,
+    PIO_SUBMIT_BATCH pBatch
+    );
+
+//
+// Connection functions, implemented by the server.
+//
+
+BOOL AcceptCompleted(
+    PIO_COMPLETION pCompletion,
+    PPER_SOCKET_CONTEXT *ppAcceptSocketContext
+    );
+//
+// Set up the connection an accept completion brought, and post the next accept.
+// *ppAcceptSocketContext is the new connection's context, or NULL if the accept
+// failed.  Data that came with the connection is in its pIOContext->Buffer,
+// pIOContext->nTotalBytes long.  Returns FALSE if the server can not go on.
+//
+
+VOID DisconnectCompleted(
+    PPER_SOCKET_CONTEXT lpPerSocketContext,
+    BOOL bSuccess
+    );
+
+VOID CloseClient (
+    PPER_SOCKET_CONTEXT lpPerSocketContext,
+    BOOL bGraceful
+    );
+
+ULONGLONG StatsMicroseconds(
+    );
+
+int myprintf(const char *lpFormat, ...);
+
+//
+// Implemented in iocpecho.cpp.
+//
+
+VOID WorkerLoop(
+    HANDLE hIOCP,
+    ULONG ulBatchSize,
+    PIO_STATS pStats
+    );
+
+BOOL ProcessCompletion(
+    PIO_COMPLETION pCompletion,
+    PIO_SUBMIT_BATCH pBatch,
+    PIO_STATS pStats
+    );
+
+BOOL CompletionPortQueue(
+    PIO_SUBMIT_BATCH pBatch,
+    PPER_SOCKET_CONTEXT lpPerSocketContext,
+    PPER_IO_CONTEXT lpIOContext,
+    char *pBuffer,
+    ULONG ulLength
+    );
+
+VOID StatsRecordLatency(
+    PIO_STATS pStats,
+    PPER_IO_CONTEXT lpIOContext
+    );
+
+#endif
@@ -12,54 +12,77 @@
 #ifndef IOCPSERVER_H
 #define IOCPSERVER_H
 
-#include <mswsock.h>
+#include "IocpEcho.h"
 
 #define DEFAULT_PORT        "5001"
-#define MAX_BUFF_SIZE       8192
 #define MAX_WORKER_THREAD   16
-
-typedef enum _IO_OPERATION {
-    ClientIoAccept,
-    ClientIoRead,
-    ClientIoWrite
-} IO_OPERATION, *PIO_OPERATION;
+#define CTXT_SLAB_COUNT     64      // contexts allocated from the heap at a time
+#define CTXT_LIST_SHARDS    64      // separately locked lists of connection contexts
+#define ACCEPT_MIN_OUTSTANDING 4    // fewest AcceptEx calls kept posted
+#define ACCEPT_MAX_OUTSTANDING 256  // most AcceptEx calls kept posted
+#define ACCEPT_ADJUST_INTERVAL 1000 // milliseconds between accept manager adjustments
 
 //
-// data to be associated for every I/O operation on a socket
+// Free PER_SOCKET_CONTEXT and PER_IO_CONTEXT structures are kept on a lock-free
+// list.  When the list is empty, CTXT_SLAB_COUNT more are carved out of one heap
+// block (a slab).  Slabs are only given back to the heap when the server exits.
 //
-typedef struct _PER_IO_CONTEXT {
-    WSAOVERLAPPED               Overlapped;
-    char                        Buffer[MAX_BUFF_SIZE];
-    WSABUF                      wsabuf;
-    int                         nTotalBytes;
-    int                         nSentBytes;
-    IO_OPERATION                IOOperation;
-    SOCKET                      SocketAccept; 
-
-    struct _PER_IO_CONTEXT      *pIOContextForward;
-} PER_IO_CONTEXT, *PPER_IO_CONTEXT;
+typedef struct _CTXT_POOL {
+    SLIST_HEADER                FreeList;
+    SLIST_HEADER                SlabList;
+    SIZE_T                      cbContext;  // size of one context, rounded up for SLIST alignment
+} CTXT_POOL, *PCTXT_POOL;
 
 //
-// For AcceptEx, the IOCP key is the PER_SOCKET_CONTEXT for the listening socket,
-// so we need to another field SocketAccept in PER_IO_CONTEXT. When the outstanding
-// AcceptEx completes, this field is our connection socket handle.
+// Connection contexts are spread over CTXT_LIST_SHARDS lists, each with its own
+// lock, so that connects and disconnects on different threads rarely wait on each
+// other.  Each shard is on its own cache line.
 //
+typedef struct DECLSPEC_ALIGN(64) _CTXT_LIST_SHARD {
+    CRITICAL_SECTION            CriticalSection;
+    PPER_SOCKET_CONTEXT         pCtxtList;
+} CTXT_LIST_SHARD, *PCTXT_LIST_SHARD;
 
 //
-// data to be associated with every socket added to the IOCP
+// Counts kept by the accept manager.  The AcceptEx wait is the time from an AcceptEx
+// being posted to it completing: when it is short, connections are taking the calls
+// as fast as they are posted.
 //
-typedef struct _PER_SOCKET_CONTEXT {
-    SOCKET                      Socket;
-
-    LPFN_ACCEPTEX               fnAcceptEx;
+typedef struct _ACCEPT_STATS {
+    ULONGLONG                   ullAccepts;
+    ULONGLONG                   ullRecycledAccepts;     // accepts that reused a disconnected socket
+    ULONGLONG                   ullFailedAccepts;
+    ULONGLONG                   ullBacklogEvents;       // times a connection waited with no AcceptEx posted
+    ULONGLONG                   ullWaitMicroseconds;    // total AcceptEx wait
+    ULONGLONG                   ullMaxWaitMicroseconds;
+    LONG                        nMaxOutstanding;
+} ACCEPT_STATS, *PACCEPT_STATS;
 
-	//
-    //linked list for all outstanding i/o on the socket
-	//
-    PPER_IO_CONTEXT             pIOContext;  
-    struct _PER_SOCKET_CONTEXT  *pCtxtBack; 
-    struct _PER_SOCKET_CONTEXT  *pCtxtForward;
-} PER_SOCKET_CONTEXT, *PPER_SOCKET_CONTEXT;
+//
+// The accept manager keeps nTarget AcceptEx calls posted on the listening socket,
+// each with its own PER_IO_CONTEXT on the listening socket's list of i/o contexts.
+// The sockets for them are disconnected connections that are being reused, or
+// sockets the main thread created ahead of time.  nTarget is doubled when a
+// connection is found waiting in the listen backlog or the posted calls were all
+// used more than once in an ACCEPT_ADJUST_INTERVAL, and halved when fewer than a
+// quarter of them were used.  Everything here is protected by CriticalSection.
+//
+typedef struct _ACCEPT_MANAGER {
+    CRITICAL_SECTION            CriticalSection;
+    LPFN_DISCONNECTEX           fnDisconnectEx;         // NULL if sockets are not reused
+    WSAEVENT                    hBacklogEvent;          // FD_ACCEPT on the listening socket
+    LONG                        nTarget;                // AcceptEx calls to keep posted
+    LONG                        nOutstanding;           // AcceptEx calls posted and not yet completed
+    LONG                        nIntervalAccepts;       // completed since the last adjustment
+    BOOL                        bIntervalBacklog;       // backlog seen since the last adjustment
+    SOCKET                      aFreeSockets[ACCEPT_MAX_OUTSTANDING];
+    LONG                        nFreeSockets;
+    PPER_SOCKET_CONTEXT         pRecycled;              // disconnected, ready for AcceptEx
+    LONG                        nRecycled;
+    PPER_SOCKET_CONTEXT         pDisconnecting;         // DisconnectEx posted
+    LONG                        nDisconnecting;
+    ACCEPT_STATS                Stats;
+} ACCEPT_MANAGER, *PACCEPT_MANAGER;
 
 BOOL ValidOptions(int argc, char *argv[]);
 
@@ -73,10 +96,58 @@ BOOL CreateAcceptSocket(
     BOOL fUpdateIOCP
     );
 
+BOOL AcceptManagerInit(
+    );
+
+VOID AcceptManagerTerm(
+    );
+
+BOOL AcceptManagerAdjust(
+    BOOL bBacklog
+    );
+
+VOID AcceptManagerCompleted(
+    PPER_IO_CONTEXT lpIOContext,
+    BOOL bSuccess
+    );
+
+VOID AcceptManagerDiscard(
+    PPER_IO_CONTEXT lpIOContext
+    );
+
+BOOL AcceptManagerRecycle(
+    PPER_SOCKET_CONTEXT lpPerSocketContext
+    );
+
+VOID AcceptManagerDisconnected(
+    PPER_SOCKET_CONTEXT lpPerSocketContext,
+    BOOL bSuccess
+    );
+
+VOID AcceptManagerFree(
+    );
+
+HANDLE CompletionPortCreate(
+    void
+    );
+
+BOOL CompletionPortAssociate(
+    HANDLE hIOCP,
+    SOCKET sd,
+    PPER_SOCKET_CONTEXT lpPerSocketContext
+    );
+
 DWORD WINAPI WorkerThread (
     LPVOID WorkContext
     );
 
+VOID StatsAdd(
+    PIO_STATS pStats
+    );
+
+VOID StatsPrint(
+    );
+
 PPER_SOCKET_CONTEXT UpdateCompletionPort(
     SOCKET s,
     IO_OPERATION ClientIo,
@@ -88,9 +159,27 @@ PPER_SOCKET_CONTEXT UpdateCompletionPort(
 // don't need to add it to the list.
 //
 
-VOID CloseClient (
-    PPER_SOCKET_CONTEXT lpPerSocketContext,
-    BOOL bGraceful
+VOID CtxtPoolInit(
+    PCTXT_POOL pPool,
+    SIZE_T cbContext
+    );
+
+PVOID CtxtPoolAlloc(
+    PCTXT_POOL pPool
+    );
+
+VOID CtxtPoolRelease(
+    PCTXT_POOL pPool,
+    PVOID pContext
+    );
+
+VOID CtxtPoolFree(
+    PCTXT_POOL pPool
+    );
+
+VOID CtxtInitIO(
+    PPER_IO_CONTEXT lpIOContext,
+    IO_OPERATION ClientIO
     );
 
 PPER_SOCKET_CONTEXT CtxtAllocate(
@@ -98,6 +187,16 @@ PPER_SOCKET_CONTEXT CtxtAllocate(
     IO_OPERATION ClientIO
     );
 
+VOID CtxtFree(
+    PPER_SOCKET_CONTEXT lpPerSocketContext
+    );
+
+BOOL CtxtListInit(
+    );
+
+VOID CtxtListTerm(
+    );
+
 VOID CtxtListFree(
     );
 
@@ -105,6 +204,10 @@ VOID CtxtListAddTo (
     PPER_SOCKET_CONTEXT lpPerSocketContext
     );
 
+VOID CtxtListRemove(
+    PPER_SOCKET_CONTEXT lpPerSocketContext
+    );
+
 VOID CtxtListDeleteFrom(
     PPER_SOCKET_CONTEXT lpPerSocketContext
     );